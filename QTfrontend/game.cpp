@@ -21,10 +21,13 @@
 #include <QString>
 #include <QCheckBox>
 #include <QByteArray>
+#include <QDir>
+#include <QFile>
 #include <QUuid>
 #include <QColor>
 #include <QStringListModel>
 #include <QTextStream>
+#include <QTimer>
 #include <utility>
 
 #include "hwform.h"
@@ -37,6 +40,7 @@
 #include "proto.h"
 #include "binds.h"
 #include "campaign.h"
+#include "DemoContainer.h"
 
 #include <QTextStream>
 #include "ThemeModel.h"
@@ -51,6 +55,12 @@ TeamSelWidget * lastGameTeamSel = NULL;
 
 QString training, campaign, campaignScript, campaignTeam; // TODO: Cleaner solution?
 
+// engine messages of a net game wait up to net/sendWindow ms (about a frame by
+// default) to go to the server together, 0 sends them after every read
+static const int defaultNetSendWindow = 16;
+// a batch reaching this size is sent at once
+static const int maxNetBatchSize = 1024;
+
 HWGame::HWGame(GameUIConfig * config, GameCFGWidget * gamecfg, QString ammo, TeamSelWidget* pTeamSelWidget) :
     TCPBase(true, 0),
     ammostr(ammo),
@@ -59,6 +69,12 @@ HWGame::HWGame(GameUIConfig * config, GameCFGWidget * gamecfg, QString ammo, Tea
     this->config = config;
     this->gamecfg = gamecfg;
     netSuspend = false;
+    m_demoLength = 0;
+    m_netSendWindow = 0;
+
+    m_netFlushTimer = new QTimer(this);
+    m_netFlushTimer->setSingleShot(true);
+    connect(m_netFlushTimer, SIGNAL(timeout()), this, SLOT(flushNetBuffer()));
 
     lastGameCfg = gamecfg;
     lastGameAmmo = ammo;
@@ -79,7 +95,7 @@ void HWGame::onClientDisconnect()
     {
         case gtDemo:
             // for video recording we need demo anyway
-            emit HaveRecord(rtNeither, demo);
+            emit HaveRecord(rtNeither, demoForVideo());
             break;
         case gtNet:
             emit HaveRecord(rtDemo, demo);
@@ -95,6 +111,21 @@ void HWGame::onClientDisconnect()
     SetGameState(gsStopped);
 }
 
+// The streamed demo isn't kept in memory, it is only read back if a video
+// has been recorded during playback
+QByteArray HWGame::demoForVideo()
+{
+    QDir videoTempDir(cfgdir->absolutePath() + "/VideoTemp/");
+    if (videoTempDir.entryList(QStringList("*.txtout"), QDir::Files).isEmpty())
+        return QByteArray();
+
+    QFile demofile(m_demoFileName);
+    if (!demofile.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    return DemoContainer::unpack(demofile.readAll()) + demo;
+}
+
 void HWGame::commonConfig()
 {
     QByteArray buf;
@@ -324,10 +355,23 @@ void HWGame::ParseMessage(const QByteArray & msg)
             emit SendConsoleCommand(msgbody);
             break;
         }
+        case 'K':
+        {
+            int size = msg.size();
+            emit CheckpointTaken(msg.mid(2).left(size - 4).toUInt());
+            break;
+        }
         default:
         {
+            // everything else is timestamped game traffic
+            m_stats.markFirstTick();
+
             if (gameType == gtNet && !netSuspend)
+            {
                 m_netSendBuffer.append(msg);
+                if (m_netSendBuffer.size() >= maxNetBatchSize)
+                    flushNetBuffer();
+            }
 
             demo.append(msg);
         }
@@ -346,27 +390,32 @@ void HWGame::FromNetChat(const QString & msg)
     RawSendIPC(buf);
 }
 
+bool HWGame::framedIPC()
+{
+    return true;
+}
+
 void HWGame::onClientRead()
 {
-    quint8 msglen;
-    quint32 bufsize;
-    while (!readbuffer.isEmpty() && ((bufsize = readbuffer.size()) > 0) &&
-            ((msglen = readbuffer.data()[0]) < bufsize))
-    {
-        QByteArray msg = readbuffer.left(msglen + 1);
-        readbuffer.remove(0, msglen + 1);
+    QByteArray msg;
+    while (nextFrame(msg))
         ParseMessage(msg);
-    }
 
-    flushNetBuffer();
+    if (m_netSendWindow <= 0)
+        flushNetBuffer();
+    else if (!m_netSendBuffer.isEmpty() && !m_netFlushTimer->isActive())
+        m_netFlushTimer->start(m_netSendWindow);
 }
 
 void HWGame::flushNetBuffer()
 {
+    m_netFlushTimer->stop();
+
     if(m_netSendBuffer.size())
     {
         emit SendNet(m_netSendBuffer);
 
+        m_stats.recordNetBatch(m_netSendBuffer.size());
         m_netSendBuffer.clear();
     }
 }
@@ -378,8 +427,7 @@ QStringList HWGame::getArguments()
     QString nick = config->netNick().toUtf8().toBase64();
 
     arguments << "--internal"; //Must be passed as first argument
-    arguments << "--port";
-    arguments << QString("%1").arg(ipc_port);
+    arguments << ipcArguments();
     arguments << "--prefix";
     arguments << datadir->absolutePath();
     arguments << "--user-prefix";
@@ -428,6 +476,14 @@ QStringList HWGame::getArguments()
     if (config->Form->ui.pageOptions->CBTagOpacity->isChecked())
         arguments << "--translucent-tags";
 
+    // checkpoints of the game state make seeking in demos possible
+    int checkpointInterval = config->value("frontend/checkpointinterval", 30).toInt();
+    if ((gameType == gtDemo) && (checkpointInterval > 0))
+    {
+        arguments << "--checkpoint-interval";
+        arguments << QString::number(checkpointInterval);
+    }
+
     return arguments;
 }
 
@@ -435,15 +491,26 @@ void HWGame::PlayDemo(const QString & demofilename, bool isSave)
 {
     gameType = isSave ? gtSave : gtDemo;
     lastGameType = gameType;
-    QFile demofile(demofilename);
-    if (!demofile.open(QIODevice::ReadOnly))
+    QIODevice * demofile = DemoContainer::open(demofilename);
+    if (!demofile)
     {
         emit ErrorMessage(tr("Cannot open demofile %1").arg(demofilename));
         return ;
     }
 
-    // read demo
-    toSendBuf = demofile.readAll();
+    // the index of a packed record tells where its last block starts, which
+    // is close enough to the length for seeking
+    m_demoLength = 0;
+    DemoReader * reader = qobject_cast<DemoReader *>(demofile);
+    HWDemoBlock block;
+    if (reader && reader->blockInfo(reader->blockCount() - 1, block))
+        m_demoLength = block.firstTick;
+
+    // stream demo, works for physfs:// paths as well and unpacks packed
+    // records on the fly. Saves are kept in memory, the game goes on and has
+    // to be saved again as a whole.
+    m_demoFileName = demofilename;
+    setStreamSource(demofile, isSave);
 
     // run engine
     demo.clear();
@@ -458,6 +525,7 @@ void HWGame::StartNet()
 
     gameType = gtNet;
     demo.clear();
+    m_netSendWindow = config->value("net/sendWindow", defaultNetSendWindow).toInt();
     Start(false);
     SetGameState(gsStarted);
 }
@@ -518,6 +586,10 @@ void HWGame::StartCampaign(const QString & camp, const QString & campScript, con
 
 void HWGame::SetGameState(GameState state)
 {
+    // whatever the engine sent must reach the server before the new state
+    // is acted upon, e.g. the round being reported finished
+    flushNetBuffer();
+
     gameState = state;
     emit GameStateChanged(state);
     if (gameType == gtCampaign)
@@ -533,6 +605,21 @@ void HWGame::abort()
     RawSendIPC(buf);
 }
 
+void HWGame::seekDemo(quint32 ticks)
+{
+    if (gameType != gtDemo)
+        return;
+
+    QByteArray buf;
+    HWProto::addStringToBuffer(buf, QString("eseek %1").arg(ticks));
+    RawSendIPC(buf);
+}
+
+quint32 HWGame::demoLength() const
+{
+    return m_demoLength;
+}
+
 void HWGame::sendCampaignVar(const QByteArray &varToSend)
 {
     QString varToFind = QString::fromUtf8(varToSend);
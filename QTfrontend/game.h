@@ -28,6 +28,7 @@
 class GameUIConfig;
 class GameCFGWidget;
 class TeamSelWidget;
+class QTimer;
 
 enum GameType
 {
@@ -83,11 +84,14 @@ class HWGame : public TCPBase
         void StartTraining(const QString & file, const QString & subFolder);
         void StartCampaign(const QString & camp, const QString & campScript, const QString & campTeam);
         void abort();
+        // length of the played demo in game ticks, 0 if unknown
+        quint32 demoLength() const;
         GameState gameState;
         bool netSuspend;
 
     protected:
         virtual QStringList getArguments();
+        virtual bool framedIPC();
         virtual void onClientRead();
         virtual void onClientDisconnect();
 
@@ -101,10 +105,12 @@ class HWGame : public TCPBase
         void ErrorMessage(const QString &);
         void CampStateChanged(int);
         void SendConsoleCommand(const QString & command);
+        void CheckpointTaken(quint32 ticks);
 
     public slots:
         void FromNet(const QByteArray & msg);
         void FromNetChat(const QString & msg);
+        void seekDemo(quint32 ticks);
 
     private:
         char msgbuf[MAXMSGCHARS];
@@ -114,7 +120,12 @@ class HWGame : public TCPBase
         TeamSelWidget* m_pTeamSelWidget;
         GameType gameType;
         QByteArray m_netSendBuffer;
+        QTimer * m_netFlushTimer;
+        int m_netSendWindow; // ms engine messages may wait to be sent together
+        QString m_demoFileName;
+        quint32 m_demoLength;
 
+        QByteArray demoForVideo();
         void commonConfig();
         void SendConfig();
         void SendQuickConfig();
@@ -125,6 +136,8 @@ class HWGame : public TCPBase
         void SetGameState(GameState state);
         void sendCampaignVar(const QByteArray & varToSend);
         void writeCampaignVar(const QByteArray &varVal);
+
+    private slots:
         void flushNetBuffer();
 };
 
@@ -38,6 +38,7 @@ extern bool custom_data;
 
 extern int cMaxTeams;
 extern int cMinServerVersion;
+extern int cCompactEMServerVersion;
 
 class QStandardItemModel;
 
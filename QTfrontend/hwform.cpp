@@ -48,6 +48,7 @@
 #include <QSortFilterProxyModel>
 #include <QIcon>
 #include <QImage>
+#include <QThread>
 
 #if (QT_VERSION >= 0x040600)
 #include <QGraphicsEffect>
@@ -82,6 +83,7 @@
 #include "pageplayrecord.h"
 #include "pagedata.h"
 #include "pagevideos.h"
+#include "pageingame.h"
 #include "hwconsts.h"
 #include "newnetclient.h"
 #include "gamecfgwidget.h"
@@ -94,8 +96,11 @@
 #include "bgwidget.h"
 #include "drawmapwidget.h"
 #include "mouseoverfilter.h"
+#include "DemoContainer.h"
 #include "roomslistmodel.h"
 #include "recorder.h"
+#include "enginejobpool.h"
+#include "PreviewCache.h"
 #include "playerslistmodel.h"
 #include "feedbackdialog.h"
 
@@ -167,6 +172,16 @@ HWForm::HWForm(QWidget *parent, QString styleSheet)
 
     config = new GameUIConfig(this, DataManager::instance().settingsFileName());
     frontendEffects = config->value("frontend/effects", true).toBool();
+    EngineJobPool::instance().setMaxWorkers(config->value("frontend/enginejobs", QThread::idealThreadCount()).toInt());
+    PreviewCache::instance().setMemoryLimit(config->value("frontend/previewcachesize", 64).toInt());
+    PreviewCache::instance().setDiskLimit(config->value("frontend/previewcachedisk", 32).toLongLong() * 1024 * 1024);
+    TCPBase::setLocalIPC(config->value("frontend/localipc", true).toBool());
+    if (config->value("frontend/ipcstats", false).toBool())
+    {
+        QString statsPath = cfgdir->absolutePath() + "/Logs/IPC";
+        QDir().mkpath(statsPath);
+        TCPBase::setStatsPath(statsPath);
+    }
     playerHash = QString(QCryptographicHash::hash(config->value("net/nick",tr("Guest")+QString("%1").arg(rand())).toString().toUtf8(), QCryptographicHash::Md5).toHex());
 
     // Icons for finished missions
@@ -1112,6 +1127,8 @@ void HWForm::PlayDemo()
     }
     CreateGame(0, 0, 0);
     game->PlayDemo(curritem->data(Qt::UserRole).toString(), ui.pagePlayDemo->isSave());
+    if (!ui.pagePlayDemo->isSave())
+        ConnectDemoSeeking();
 }
 
 void HWForm::PlayDemoQuick(const QString & demofilename)
@@ -1120,6 +1137,14 @@ void HWForm::PlayDemoQuick(const QString & demofilename)
     //GoBack() <- don't or you'll close the socket
     CreateGame(0, 0, 0);
     game->PlayDemo(demofilename, false);
+    ConnectDemoSeeking();
+}
+
+void HWForm::ConnectDemoSeeking()
+{
+    connect(game, SIGNAL(CheckpointTaken(quint32)), ui.pageInGame, SLOT(checkpointTaken(quint32)));
+    connect(ui.pageInGame, SIGNAL(seekRequested(quint32)), game, SLOT(seekDemo(quint32)));
+    ui.pageInGame->showSeekControl(game->demoLength());
 }
 
 void HWForm::NetConnectQuick(const QString & host, quint16 port)
@@ -1785,6 +1810,8 @@ void HWForm::CreateGame(GameCFGWidget * gamecfg, TeamSelWidget* pTeamSelWidget,
     connect(game, SIGNAL(GameStats(char, const QString &)), ui.pageGameStats, SLOT(GameStats(char, const QString &)));
     connect(game, SIGNAL(ErrorMessage(const QString &)), this, SLOT(ShowFatalErrorMessage(const QString &)), Qt::QueuedConnection);
     connect(game, SIGNAL(HaveRecord(RecordType, const QByteArray &)), this, SLOT(GetRecord(RecordType, const QByteArray &)));
+    disconnect(ui.pageInGame, SIGNAL(seekRequested(quint32)), 0, 0);
+    ui.pageInGame->hideSeekControl();
     m_lastDemo = QByteArray();
 }
 
@@ -1821,7 +1848,7 @@ void HWForm::GetRecord(RecordType type, const QByteArray & record)
             MessageDialog::ShowErrorMessage(tr("Cannot save record to file %1").arg(filename), this);
         else
         {
-            demofile.write(demo);
+            demofile.write(DemoContainer::pack(demo));
             demofile.close();
         }
     }
@@ -2204,7 +2231,7 @@ void HWForm::saveDemoWithCustomName()
                     MessageDialog::ShowErrorMessage(tr("Cannot save record to file %1").arg(filePath), this);
                 else
                 {
-                    ok = -1 != demofile.write(m_lastDemo);
+                    ok = -1 != demofile.write(DemoContainer::pack(m_lastDemo));
                     demofile.close();
                 }
             }
@@ -5,11 +5,17 @@
 #include <QTextStream>
 #include <QDebug>
 
+#include <algorithm>
+#include <functional>
+
 #include "playerslistmodel.h"
 #include "hwconsts.h"
 
 PlayersListModel::PlayersListModel(QObject *parent) :
-    QAbstractListModel(parent)
+    QAbstractListModel(parent),
+    m_updateLevel(0),
+    m_changedFirst(-1),
+    m_changedLast(-1)
 {
     m_fontInRoom = QFont();
     m_fontInRoom.setItalic(true);
@@ -39,9 +45,17 @@ bool PlayersListModel::setData(const QModelIndex &index, const QVariant &value,
     if(!index.isValid() || index.row() < 0 || index.row() >= rowCount() || index.column() != 0)
         return false;
 
-    m_data[index.row()].insert(role, value);
+    DataEntry & entry = m_data[index.row()];
+
+    if(role == Qt::DisplayRole)
+    {
+        m_rows.remove(entry.value(Qt::DisplayRole).toString().toLower());
+        m_rows.insert(value.toString().toLower(), index.row());
+    }
+
+    entry.insert(role, value);
 
-    emit dataChanged(index, index);
+    changed(index.row());
 
     return true;
 }
@@ -58,11 +72,15 @@ bool PlayersListModel::insertRows(int row, int count, const QModelIndex &parent)
     if(parent.isValid() || row > rowCount() || row < 0 || count < 1)
         return false;
 
+    flushChanges();
+
     beginInsertRows(parent, row, row + count - 1);
 
     for(int i = 0; i < count; ++i)
         m_data.insert(row, DataEntry());
 
+    reindex(row);
+
     endInsertRows();
 
     return true;
@@ -74,62 +92,197 @@ bool PlayersListModel::removeRows(int row, int count, const QModelIndex &parent)
     if(parent.isValid() || row + count > rowCount() || row < 0 || count < 1)
         return false;
 
+    flushChanges();
+
     beginRemoveRows(parent, row, row + count - 1);
 
     for(int i = 0; i < count; ++i)
+    {
+        m_rows.remove(m_data.at(row).value(Qt::DisplayRole).toString().toLower());
         m_data.removeAt(row);
+    }
+
+    reindex(row);
 
     endRemoveRows();
 
     return true;
 }
 
+
+int PlayersListModel::rowOf(const QString & nickname) const
+{
+    return m_rows.value(nickname.toLower(), -1);
+}
+
+
+void PlayersListModel::reindex(int from)
+{
+    for(int i = from; i < m_data.size(); ++i)
+    {
+        QString nickname = m_data.at(i).value(Qt::DisplayRole).toString();
+
+        if(!nickname.isEmpty())
+            m_rows.insert(nickname.toLower(), i);
+    }
+}
+
+
+void PlayersListModel::beginUpdate()
+{
+    ++m_updateLevel;
+}
+
+
+void PlayersListModel::endUpdate()
+{
+    Q_ASSERT(m_updateLevel > 0);
+
+    if(--m_updateLevel == 0)
+        flushChanges();
+}
+
+
+void PlayersListModel::changed(int row)
+{
+    if(m_updateLevel == 0)
+    {
+        emit dataChanged(index(row), index(row));
+        return;
+    }
+
+    if(m_changedFirst < 0)
+        m_changedFirst = m_changedLast = row;
+    else
+    {
+        m_changedFirst = qMin(m_changedFirst, row);
+        m_changedLast = qMax(m_changedLast, row);
+    }
+}
+
+
+void PlayersListModel::flushChanges()
+{
+    if(m_changedFirst < 0)
+        return;
+
+    emit dataChanged(index(m_changedFirst), index(m_changedLast));
+
+    m_changedFirst = m_changedLast = -1;
+}
+
+
 QModelIndex PlayersListModel::nicknameIndex(const QString & nickname)
 {
-    QModelIndexList mil = match(index(0), Qt::DisplayRole, nickname, 1, Qt::MatchExactly);
+    int row = rowOf(nickname);
 
-    if(mil.size() > 0)
-        return mil[0];
+    if(row >= 0)
+        return index(row);
     else
         return QModelIndex();
 }
 
+
 void PlayersListModel::addPlayer(const QString & nickname, bool notify)
 {
-    insertRow(rowCount());
+    addPlayers(QStringList(nickname), notify);
+}
+
+
+void PlayersListModel::addPlayers(const QStringList & nicknames, bool notify)
+{
+    if(nicknames.isEmpty())
+        return;
+
+    int first = rowCount();
 
-    QModelIndex mi = index(rowCount() - 1);
-    setData(mi, nickname);
+    flushChanges();
 
-    checkFriendIgnore(mi);
+    // rows are complete when they show up, no dataChanged() needed
+    beginInsertRows(QModelIndex(), first, first + nicknames.size() - 1);
 
-    emit nickAddedLobby(nickname, notify);
+    foreach(const QString & nickname, nicknames)
+    {
+        DataEntry entry;
+        entry.insert(Qt::DisplayRole, nickname);
+        checkFriendIgnore(entry);
+
+        m_rows.insert(nickname.toLower(), m_data.size());
+        m_data.append(entry);
+    }
+
+    endInsertRows();
+
+    foreach(const QString & nickname, nicknames)
+        emit nickAddedLobby(nickname, notify);
 }
 
 
 void PlayersListModel::removePlayer(const QString & nickname, const QString &msg)
 {
-    if(msg.isEmpty())
-        emit nickRemovedLobby(nickname);
-    else
-        emit nickRemovedLobby(nickname, msg);
+    removePlayers(QStringList(nickname), msg);
+}
 
-    QModelIndex mi = nicknameIndex(nickname);
 
-    if(mi.isValid())
-        removeRow(mi.row());
+void PlayersListModel::removePlayers(const QStringList & nicknames, const QString & msg)
+{
+    QList<int> rows;
+
+    foreach(const QString & nickname, nicknames)
+    {
+        if(msg.isEmpty())
+            emit nickRemovedLobby(nickname);
+        else
+            emit nickRemovedLobby(nickname, msg);
+
+        int row = rowOf(nickname);
+        if(row >= 0)
+            rows << row;
+    }
+
+    if(rows.isEmpty())
+        return;
+
+    flushChanges();
+
+    // remove runs of adjacent rows at once, from the end so that
+    // the rows still to be removed don't move
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+
+    for(int i = 0; i < rows.size(); )
+    {
+        int last = rows[i];
+        int first = last;
+
+        while(++i < rows.size() && rows[i] >= first - 1)
+            first = rows[i];
+
+        beginRemoveRows(QModelIndex(), first, last);
+
+        for(int row = last; row >= first; --row)
+        {
+            m_rows.remove(m_data.at(row).value(Qt::DisplayRole).toString().toLower());
+            m_data.removeAt(row);
+        }
+
+        endRemoveRows();
+    }
+
+    reindex(rows.last());
 }
 
 
 void PlayersListModel::playerJoinedRoom(const QString & nickname, bool notify)
 {
-    QModelIndex mi = nicknameIndex(nickname);
+    int row = rowOf(nickname);
 
-    if(mi.isValid())
+    if(row >= 0)
     {
-        setData(mi, true, RoomFilterRole);
-        updateIcon(mi);
-        updateSortData(mi);
+        DataEntry & entry = m_data[row];
+        entry.insert(RoomFilterRole, true);
+        updateIcon(entry);
+        updateSortData(entry);
+        changed(row);
     }
 
     emit nickAdded(nickname, notify);
@@ -140,15 +293,17 @@ void PlayersListModel::playerLeftRoom(const QString & nickname)
 {
     emit nickRemoved(nickname);
 
-    QModelIndex mi = nicknameIndex(nickname);
+    int row = rowOf(nickname);
 
-    if(mi.isValid())
+    if(row >= 0)
     {
-        setData(mi, false, RoomFilterRole);
-        setData(mi, false, RoomAdmin);
-        setData(mi, false, Ready);
-        setData(mi, false, InGame);
-        updateIcon(mi);
+        DataEntry & entry = m_data[row];
+        entry.insert(RoomFilterRole, false);
+        entry.insert(RoomAdmin, false);
+        entry.insert(Ready, false);
+        entry.insert(InGame, false);
+        updateIcon(entry);
+        changed(row);
     }
 }
 
@@ -174,27 +329,29 @@ void PlayersListModel::setFlag(const QString &nickname, StateFlag flagType, bool
         saveSet(m_ignoredSet, "ignore");
     }
 
-    QModelIndex mi = nicknameIndex(nickname);
+    int row = rowOf(nickname);
 
-    if(mi.isValid())
+    if(row >= 0)
     {
-        setData(mi, isSet, flagType);
+        DataEntry & entry = m_data[row];
+        entry.insert(flagType, isSet);
 
         if(flagType == Friend || flagType == ServerAdmin
                 || flagType == Ignore || flagType == RoomAdmin)
-            updateSortData(mi);
+            updateSortData(entry);
 
-        updateIcon(mi);
+        updateIcon(entry);
+        changed(row);
     }
 }
 
 
 bool PlayersListModel::isFlagSet(const QString & nickname, StateFlag flagType)
 {
-    QModelIndex mi = nicknameIndex(nickname);
+    int row = rowOf(nickname);
 
-    if(mi.isValid())
-        return mi.data(flagType).toBool();
+    if(row >= 0)
+        return m_data.at(row).value(flagType).toBool();
     else if(flagType == Friend)
         return isFriend(nickname);
     else if(flagType == Ignore)
@@ -207,37 +364,38 @@ void PlayersListModel::resetRoomFlags()
 {
     for(int i = rowCount() - 1; i >= 0; --i)
     {
-        QModelIndex mi = index(i);
+        DataEntry & entry = m_data[i];
 
-        if(mi.data(RoomFilterRole).toBool())
+        if(entry.value(RoomFilterRole).toBool())
         {
-            setData(mi, false, RoomFilterRole);
-            setData(mi, false, RoomAdmin);
-            setData(mi, false, Ready);
-            setData(mi, false, InGame);
-
-            updateSortData(mi);
-            updateIcon(mi);
+            entry.insert(RoomFilterRole, false);
+            entry.insert(RoomAdmin, false);
+            entry.insert(Ready, false);
+            entry.insert(InGame, false);
+
+            updateSortData(entry);
+            updateIcon(entry);
+            changed(i);
         }
     }
 }
 
-void PlayersListModel::updateIcon(const QModelIndex & index)
+void PlayersListModel::updateIcon(DataEntry & entry)
 {
     quint32 iconNum = 0;
 
     QList<bool> flags;
     flags
-        << index.data(Ready).toBool()
-        << index.data(ServerAdmin).toBool()
-        << index.data(RoomAdmin).toBool()
-        << index.data(Registered).toBool()
-        << index.data(Friend).toBool()
-        << index.data(Ignore).toBool()
-        << index.data(InGame).toBool()
-        << index.data(RoomFilterRole).toBool()
-        << index.data(InRoom).toBool()
-        << index.data(Contributor).toBool()
+        << entry.value(Ready).toBool()
+        << entry.value(ServerAdmin).toBool()
+        << entry.value(RoomAdmin).toBool()
+        << entry.value(Registered).toBool()
+        << entry.value(Friend).toBool()
+        << entry.value(Ignore).toBool()
+        << entry.value(InGame).toBool()
+        << entry.value(RoomFilterRole).toBool()
+        << entry.value(InRoom).toBool()
+        << entry.value(Contributor).toBool()
         ;
 
     for(int i = flags.size() - 1; i >= 0; --i)
@@ -246,7 +404,7 @@ void PlayersListModel::updateIcon(const QModelIndex & index)
 
     if(m_icons().contains(iconNum))
     {
-        setData(index, m_icons().value(iconNum), Qt::DecorationRole);
+        entry.insert(Qt::DecorationRole, m_icons().value(iconNum));
     }
     else
     {
@@ -255,66 +413,66 @@ void PlayersListModel::updateIcon(const QModelIndex & index)
 
         QPainter painter(&result);
 
-        if(index.data(RoomFilterRole).toBool())
+        if(entry.value(RoomFilterRole).toBool())
         {
-            if(index.data(InGame).toBool())
+            if(entry.value(InGame).toBool())
             {
                 painter.drawPixmap(0, 0, 16, 16, QPixmap(":/res/chat/ingame.png"));
             }
             else
             {
-                if(index.data(Ready).toBool())
+                if(entry.value(Ready).toBool())
                     painter.drawPixmap(0, 0, 16, 16, QPixmap(":/res/chat/lamp.png"));
                 else
                     painter.drawPixmap(0, 0, 16, 16, QPixmap(":/res/chat/lamp_off.png"));
             }
         } else
         { // we're in lobby
-            if(!index.data(InRoom).toBool())
+            if(!entry.value(InRoom).toBool())
                 painter.drawPixmap(0, 0, 16, 16, QPixmap(":/res/Flake.png"));
         }
 
         QString mainIconName(":/res/chat/");
 
-        if(index.data(ServerAdmin).toBool())
+        if(entry.value(ServerAdmin).toBool())
             mainIconName += "serveradmin";
         else
         {
-            if(index.data(RoomAdmin).toBool())
+            if(entry.value(RoomAdmin).toBool())
                 mainIconName += "roomadmin";
             else
                 mainIconName += "hedgehog";
 
-            if(index.data(Contributor).toBool())
+            if(entry.value(Contributor).toBool())
                 mainIconName += "contributor";
         }
 
-        if(!index.data(Registered).toBool())
+        if(!entry.value(Registered).toBool())
             mainIconName += "_gray";
 
         painter.drawPixmap(8, 0, 16, 16, QPixmap(mainIconName + ".png"));
 
-        if(index.data(Ignore).toBool())
+        if(entry.value(Ignore).toBool())
             painter.drawPixmap(8, 0, 16, 16, QPixmap(":/res/chat/ignore.png"));
         else
-        if(index.data(Friend).toBool())
+        if(entry.value(Friend).toBool())
             painter.drawPixmap(8, 0, 16, 16, QPixmap(":/res/chat/friend.png"));
 
         painter.end();
 
         QIcon icon(result);
 
-        setData(index, icon, Qt::DecorationRole);
+        entry.insert(Qt::DecorationRole, icon);
         m_icons().insert(iconNum, icon);
     }
 
-    if(index.data(Ignore).toBool())
-        setData(index, QColor(Qt::gray), Qt::ForegroundRole);
+    if(entry.value(Ignore).toBool())
+        entry.insert(Qt::ForegroundRole, QColor(Qt::gray));
     else
-    if(index.data(Friend).toBool())
-        setData(index, QColor(Qt::green), Qt::ForegroundRole);
+    if(entry.value(Friend).toBool())
+        entry.insert(Qt::ForegroundRole, QColor(Qt::green));
     else
-        setData(index, QBrush(QColor(0xff, 0xcc, 0x00)), Qt::ForegroundRole);
+        entry.insert(Qt::ForegroundRole, QBrush(QColor(0xff, 0xcc, 0x00)));
 }
 
 
@@ -326,23 +484,25 @@ QHash<quint32, QIcon> & PlayersListModel::m_icons()
 }
 
 
-void PlayersListModel::updateSortData(const QModelIndex & index)
+void PlayersListModel::updateSortData(DataEntry & entry)
 {
+    QString nickname = entry.value(Qt::DisplayRole).toString();
+
     QString result = QString("%1%2%3%4%5%6")
             // room admins go first, then server admins, then friends
-            .arg(1 - index.data(RoomAdmin).toInt())
-            .arg(1 - index.data(ServerAdmin).toInt())
-            .arg(1 - index.data(Friend).toInt())
+            .arg(1 - entry.value(RoomAdmin).toInt())
+            .arg(1 - entry.value(ServerAdmin).toInt())
+            .arg(1 - entry.value(Friend).toInt())
             // ignored at bottom
-            .arg(index.data(Ignore).toInt())
+            .arg(entry.value(Ignore).toInt())
             // keep nicknames starting from non-letter character at bottom within group
             // assume there are no empty nicks in list
-            .arg(index.data(Qt::DisplayRole).toString().at(0).isLetter() ? 0 : 1)
+            .arg(nickname.at(0).isLetter() ? 0 : 1)
             // sort ignoring case
-            .arg(index.data(Qt::DisplayRole).toString().toLower())
+            .arg(nickname.toLower())
             ;
 
-    setData(index, result, SortRole);
+    entry.insert(SortRole, result);
 }
 
 
@@ -354,7 +514,10 @@ void PlayersListModel::setNickname(const QString &nickname)
     loadSet(m_ignoredSet, "ignore");
 
     for(int i = rowCount() - 1; i >= 0; --i)
-        checkFriendIgnore(index(i));
+    {
+        checkFriendIgnore(m_data[i]);
+        changed(i);
+    }
 }
 
 bool PlayersListModel::isFriend(const QString & nickname)
@@ -367,13 +530,15 @@ bool PlayersListModel::isIgnored(const QString & nickname)
     return m_ignoredSet.contains(nickname.toLower());
 }
 
-void PlayersListModel::checkFriendIgnore(const QModelIndex &mi)
+void PlayersListModel::checkFriendIgnore(DataEntry & entry)
 {
-    setData(mi, isFriend(mi.data().toString()), Friend);
-    setData(mi, isIgnored(mi.data().toString()), Ignore);
+    QString nickname = entry.value(Qt::DisplayRole).toString();
+
+    entry.insert(Friend, isFriend(nickname));
+    entry.insert(Ignore, isIgnored(nickname));
 
-    updateIcon(mi);
-    updateSortData(mi);
+    updateIcon(entry);
+    updateSortData(entry);
 }
 
 void PlayersListModel::loadSet(QSet<QString> & set, const QString & suffix)
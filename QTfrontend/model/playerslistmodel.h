@@ -6,6 +6,7 @@
 #include <QIcon>
 #include <QModelIndex>
 #include <QSet>
+#include <QStringList>
 #include <QFont>
 
 class PlayersListModel : public QAbstractListModel
@@ -47,9 +48,20 @@ public:
 
     QModelIndex nicknameIndex(const QString & nickname);
 
+    /**
+     * @brief Starts collecting changes, calls may nest.
+     *
+     * Until the matching endUpdate() changed players are announced with
+     * one dataChanged(), so the sorting proxies rearrange once per burst.
+     */
+    void beginUpdate();
+    void endUpdate();
+
 public slots:
     void addPlayer(const QString & nickname, bool notify);
+    void addPlayers(const QStringList & nicknames, bool notify);
     void removePlayer(const QString & nickname, const QString & msg = QString());
+    void removePlayers(const QStringList & nicknames, const QString & msg = QString());
     void playerJoinedRoom(const QString & nickname, bool notify);
     void playerLeftRoom(const QString & nickname);
     void resetRoomFlags();
@@ -66,15 +78,24 @@ private:
     QHash<quint32, QIcon> & m_icons();
     typedef QHash<int, QVariant> DataEntry;
     QList<DataEntry> m_data;
+    QHash<QString, int> m_rows; // lower case nickname to row
     QSet<QString> m_friendsSet, m_ignoredSet;
     QString m_nickname;
     QFont m_fontInRoom;
 
-    void updateIcon(const QModelIndex & index);
-    void updateSortData(const QModelIndex & index);
+    int m_updateLevel;
+    int m_changedFirst; // rows with pending dataChanged()
+    int m_changedLast;
+
+    int rowOf(const QString & nickname) const;
+    void reindex(int from);
+    void changed(int row);
+    void flushChanges();
+    void updateIcon(DataEntry & entry);
+    void updateSortData(DataEntry & entry);
     void loadSet(QSet<QString> & set, const QString & suffix);
     void saveSet(const QSet<QString> & set, const QString & suffix);
-    void checkFriendIgnore(const QModelIndex & mi);
+    void checkFriendIgnore(DataEntry & entry);
     bool isFriend(const QString & nickname);
     bool isIgnored(const QString & nickname);
 };
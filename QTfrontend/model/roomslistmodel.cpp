@@ -30,8 +30,15 @@
 
 RoomsListModel::RoomsListModel(QObject *parent) :
     QAbstractTableModel(parent),
-    c_nColumns(9)
+    c_nColumns(9),
+    m_updateLevel(0),
+    m_structureChanges(0),
+    m_resetting(false),
+    m_changedFirst(-1),
+    m_changedLast(-1)
 {
+    m_columns.resize(c_nColumns);
+
     m_headerData = QStringList();
     m_headerData << tr("In progress");
     m_headerData << tr("Room Name");
@@ -64,7 +71,7 @@ int RoomsListModel::rowCount(const QModelIndex & parent) const
     if(parent.isValid())
         return 0;
     else
-        return m_data.size();
+        return size();
 }
 
 
@@ -87,9 +94,11 @@ QVariant RoomsListModel::data(const QModelIndex &index, int role) const
         return QVariant();
 
     // invalid row
-    if ((row < 0) || (row >= m_data.size()))
+    if ((row < 0) || (row >= size()))
         return QVariant();
 
+    int pos = rowOf(row);
+
     // invalid column
     if ((column < 0) || (column >= c_nColumns))
         return QVariant();
@@ -115,7 +124,7 @@ QVariant RoomsListModel::data(const QModelIndex &index, int role) const
         const QIcon roomWaitingIconGreen(":/res/iconTimeLockG.png");
         const QIcon roomWaitingIconRed(":/res/iconTimeLockR.png");
 
-        QString flags = m_data.at(row).at(StateColumn);
+        const QString & flags = m_columns[StateColumn].at(pos);
 
         if (flags.contains("g"))
         {
@@ -137,7 +146,7 @@ QVariant RoomsListModel::data(const QModelIndex &index, int role) const
         }
     }
 
-    QString content = m_data.at(row).at(column);
+    const QString & content = m_columns[column].at(pos);
 
     if (role == Qt::DisplayRole)
     {
@@ -188,88 +197,221 @@ QVariant RoomsListModel::data(const QModelIndex &index, int role) const
 }
 
 
-void RoomsListModel::setRoomsList(const QStringList & rooms)
+int RoomsListModel::size() const
 {
-    beginResetModel();
+    return m_columns[NameColumn].size();
+}
+
 
-    m_data.clear();
+// rows and positions count from opposite ends, so this works both ways
+int RoomsListModel::rowOf(int pos) const
+{
+    return size() - 1 - pos;
+}
+
+
+void RoomsListModel::setRoom(int pos, const QStringList & info)
+{
+    for (int c = 0; c < c_nColumns; c++)
+        m_columns[c][pos] = info.value(c);
+}
+
+
+void RoomsListModel::reindex(int from)
+{
+    const QVector<QString> & names = m_columns[NameColumn];
+    int nRooms = names.size();
+
+    for (int i = from; i < nRooms; i++)
+        m_index.insert(names[i], i);
+}
+
+
+void RoomsListModel::beginUpdate()
+{
+    m_updateLevel++;
+}
 
-    int nRooms = rooms.size();
 
-    for (int i = 0; i < nRooms; i += c_nColumns)
+void RoomsListModel::endUpdate()
+{
+    Q_ASSERT(m_updateLevel > 0);
+
+    if (--m_updateLevel > 0)
+        return;
+
+    m_structureChanges = 0;
+
+    if (m_resetting)
     {
-        QStringList l;
+        m_resetting = false;
+        endResetModel();
+    }
+    else
+        flushChanges();
+}
 
-#if QT_VERSION >= QT_VERSION_CHECK(4, 7, 0)
-        l.reserve(c_nColumns);  // small optimisation not supported in old Qt
-#endif
 
-        for (int t = 0; t < c_nColumns; t++)
-        {
-            l.append(rooms[i + t]);
-        }
+void RoomsListModel::startReset()
+{
+    if (m_resetting)
+        return;
+
+    // the reset covers pending updates
+    m_changedFirst = m_changedLast = -1;
+
+    beginResetModel();
+    m_resetting = true;
+}
+
+
+// returns true if the change has to be announced with row signals,
+// otherwise it is covered by a model reset
+bool RoomsListModel::beginStructureChange()
+{
+    if (m_resetting)
+        return false;
+
+    if (m_updateLevel == 0)
+        return true;
 
-        m_data.append(l);
+    // a single room coming or going doesn't need a reset
+    if (m_structureChanges++ == 0)
+    {
+        // positions are about to shift
+        flushChanges();
+        return true;
     }
 
-    endResetModel();
+    startReset();
+    return false;
 }
 
 
-void RoomsListModel::addRoom(const QStringList & info)
+void RoomsListModel::flushChanges()
 {
-    beginInsertRows(QModelIndex(), 0, 0);
+    if (m_changedFirst < 0)
+        return;
 
-    m_data.prepend(info);
+    emit dataChanged(index(rowOf(m_changedLast), 0), index(rowOf(m_changedFirst), c_nColumns - 1));
 
-    endInsertRows();
+    m_changedFirst = m_changedLast = -1;
 }
 
 
-int RoomsListModel::rowOfRoom(const QString & name)
+void RoomsListModel::setRoomsList(const QStringList & rooms)
 {
-    int size = m_data.size();
+    startReset();
 
-    if (size < 1)
-        return -1;
+    int nRooms = rooms.size() / c_nColumns;
 
-    int i = 0;
+    // the first room of the list is the newest one
+    for (int c = 0; c < c_nColumns; c++)
+    {
+        QVector<QString> & column = m_columns[c];
+        column.resize(nRooms);
+
+        for (int i = 0; i < nRooms; i++)
+            column[nRooms - 1 - i] = rooms[i * c_nColumns + c];
+    }
 
-    // search for record with matching room name
-    while(m_data[i].at(NameColumn) != name)
+    m_index.clear();
+    m_index.reserve(nRooms);
+    reindex(0);
+
+    if (m_updateLevel == 0)
     {
-        i++;
-        if(i >= size)
-            return -1;
+        m_resetting = false;
+        endResetModel();
     }
+}
 
-    return i;
+
+void RoomsListModel::addRoom(const QStringList & info)
+{
+    bool announce = beginStructureChange();
+
+    if (announce)
+        beginInsertRows(QModelIndex(), 0, 0);
+
+    int pos = size();
+
+    for (int c = 0; c < c_nColumns; c++)
+        m_columns[c].append(info.value(c));
+
+    m_index.insert(info.value(NameColumn), pos);
+
+    if (announce)
+        endInsertRows();
+}
+
+
+int RoomsListModel::rowOfRoom(const QString & name)
+{
+    int pos = m_index.value(name, -1);
+
+    if (pos < 0)
+        return -1;
+
+    return rowOf(pos);
 }
 
 
 void RoomsListModel::removeRoom(const QString & name)
 {
-    int i = rowOfRoom(name);
+    int pos = m_index.value(name, -1);
 
-    if (i < 0)
+    if (pos < 0)
         return;
 
-    beginRemoveRows(QModelIndex(), i, i);
+    bool announce = beginStructureChange();
+
+    if (announce)
+        beginRemoveRows(QModelIndex(), rowOf(pos), rowOf(pos));
+
+    for (int c = 0; c < c_nColumns; c++)
+        m_columns[c].remove(pos);
 
-    m_data.removeAt(i);
+    m_index.remove(name);
+    reindex(pos);
 
-    endRemoveRows();
+    if (announce)
+        endRemoveRows();
 }
 
 
 void RoomsListModel::updateRoom(const QString & name, const QStringList & info)
 {
-    int i = rowOfRoom(name);
+    int pos = m_index.value(name, -1);
+
+    if (pos < 0)
+        return;
 
-    if (i < 0)
+    setRoom(pos, info);
+
+    // room got renamed
+    const QString & newName = m_columns[NameColumn].at(pos);
+    if (newName != name)
+    {
+        m_index.remove(name);
+        m_index.insert(newName, pos);
+    }
+
+    if (m_resetting)
         return;
 
-    m_data[i] = info;
+    if (m_updateLevel > 0)
+    {
+        if (m_changedFirst < 0)
+            m_changedFirst = m_changedLast = pos;
+        else
+        {
+            m_changedFirst = qMin(m_changedFirst, pos);
+            m_changedLast = qMax(m_changedLast, pos);
+        }
+        return;
+    }
 
-    emit dataChanged(index(i, 0), index(i, columnCount(QModelIndex()) - 1));
+    int row = rowOf(pos);
+    emit dataChanged(index(row, 0), index(row, c_nColumns - 1));
 }
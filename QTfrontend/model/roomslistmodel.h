@@ -25,7 +25,9 @@
 #define HEDGEWARS_ROOMSLISTMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QStringList>
+#include <QVector>
 
 #include "DataManager.h"
 
@@ -53,6 +55,16 @@ public:
     int columnCount(const QModelIndex & parent) const;
     QVariant data(const QModelIndex &index, int role) const;
 
+    /**
+     * @brief Starts collecting changes, calls may nest.
+     *
+     * Until the matching endUpdate() room updates are merged into one
+     * dataChanged() and more than one added or removed room into one
+     * model reset, so attached proxies and views update once per burst.
+     */
+    void beginUpdate();
+    void endUpdate();
+
 public slots:
     void setRoomsList(const QStringList & rooms);
     void addRoom(const QStringList & info);
@@ -62,8 +74,25 @@ public slots:
 
 private:
     const int c_nColumns;
-    QList<QStringList> m_data;
+    // one vector per column, rooms in the order they were added,
+    // so the newest room at the end is row 0
+    QVector<QVector<QString> > m_columns;
+    QHash<QString, int> m_index; // room name to position in m_columns
     QStringList m_headerData;
+
+    int m_updateLevel;
+    int m_structureChanges;
+    bool m_resetting;
+    int m_changedFirst; // positions of the rooms with pending dataChanged()
+    int m_changedLast;
+
+    int size() const;
+    int rowOf(int pos) const;
+    void setRoom(int pos, const QStringList & info);
+    void reindex(int from);
+    bool beginStructureChange();
+    void startReset();
+    void flushChanges();
     MapModel * m_staticMapModel;
     MapModel * m_missionMapModel;
 };
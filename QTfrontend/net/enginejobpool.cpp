@@ -0,0 +1,187 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QThread>
+
+#include "enginejobpool.h"
+#include "tcpBase.h"
+
+EngineJobPool & EngineJobPool::instance()
+{
+    static EngineJobPool instance;
+    return instance;
+}
+
+EngineJobPool::EngineJobPool() :
+    QObject(0),
+    m_maxQueueDepth(0),
+    m_startedJobs(0),
+    m_cancelledJobs(0),
+    m_totalWaitTime(0),
+    m_maxWaitTime(0)
+{
+    setMaxWorkers(QThread::idealThreadCount());
+}
+
+void EngineJobPool::setMaxWorkers(int workers)
+{
+#ifdef HWLIBRARY
+    // the engine library keeps its state in globals, it can't run twice
+    Q_UNUSED(workers);
+    m_maxWorkers = 1;
+#else
+    m_maxWorkers = qMax(1, workers);
+#endif
+
+    schedule();
+}
+
+int EngineJobPool::maxWorkers() const
+{
+    return m_maxWorkers;
+}
+
+void EngineJobPool::enqueue(TCPBase * job, bool couldCancelPreviousRequest)
+{
+    EngineJobType type = job->jobType();
+    QList<TCPBase *> & pending = m_pending[type];
+
+    // drop stale requests of the same owner which haven't been started yet
+    if(couldCancelPreviousRequest)
+    {
+        QList<TCPBase *> stale;
+        foreach(TCPBase * other, pending)
+            if((other->parent() == job->parent()) && other->couldBeRemoved())
+                stale << other;
+
+        foreach(TCPBase * other, stale)
+        {
+            pending.removeOne(other);
+            m_waitTimers.remove(other);
+            ++m_cancelledJobs;
+            delete other;
+        }
+    }
+
+    connect(job, SIGNAL(isReadyNow()), this, SLOT(jobReady()));
+    pending.append(job);
+    m_waitTimers[job].start();
+
+    m_maxQueueDepth = qMax(m_maxQueueDepth, queueDepth());
+
+    schedule();
+}
+
+void EngineJobPool::remove(TCPBase * job)
+{
+    bool wasRunning = m_running.removeOne(job);
+
+    for(int i = 0; i < ejtCount; ++i)
+        m_pending[i].removeOne(job);
+
+    m_waitTimers.remove(job);
+
+    if(wasRunning)
+        schedule();
+}
+
+void EngineJobPool::jobReady()
+{
+    TCPBase * job = qobject_cast<TCPBase *>(sender());
+
+    if(!job)
+        return;
+
+    disconnect(job, SIGNAL(isReadyNow()), this, SLOT(jobReady()));
+
+    if(m_running.removeOne(job))
+        schedule();
+}
+
+bool EngineJobPool::canStart(EngineJobType type) const
+{
+    if(m_running.size() >= m_maxWorkers)
+        return false;
+
+    // keep a worker free for what the user actually asked for
+    if((type == ejtPrefetch) && !m_running.isEmpty() && (m_running.size() >= m_maxWorkers - 1))
+        return false;
+
+    // only one game at a time, it owns the screen
+    if(type == ejtGame)
+        foreach(TCPBase * job, m_running)
+            if(job->jobType() == ejtGame)
+                return false;
+
+    return true;
+}
+
+void EngineJobPool::schedule()
+{
+    // a job may finish (and reenter here) from within RealStart, so the
+    // state is reevaluated on every iteration
+    bool started = true;
+    while(started)
+    {
+        started = false;
+
+        for(int i = 0; (i < ejtCount) && !started; ++i)
+        {
+            EngineJobType type = static_cast<EngineJobType>(i);
+            if(m_pending[type].isEmpty() || !canStart(type))
+                continue;
+
+            TCPBase * job = m_pending[type].takeFirst();
+
+            qint64 waited = m_waitTimers.take(job).elapsed();
+            m_totalWaitTime += waited;
+            m_maxWaitTime = qMax(m_maxWaitTime, waited);
+            ++m_startedJobs;
+
+            m_running.append(job);
+            started = true;
+
+            job->RealStart();
+        }
+    }
+}
+
+int EngineJobPool::queueDepth() const
+{
+    int depth = 0;
+    for(int i = 0; i < ejtCount; ++i)
+        depth += m_pending[i].size();
+
+    return depth;
+}
+
+QJsonObject EngineJobPool::toJson() const
+{
+    // wait times in ms
+    QJsonObject result;
+    result["workers"] = m_maxWorkers;
+    result["running"] = m_running.size();
+    result["queued"] = queueDepth();
+    result["maxQueued"] = m_maxQueueDepth;
+    result["started"] = m_startedJobs;
+    result["cancelled"] = m_cancelledJobs;
+    result["maxWait"] = m_maxWaitTime;
+    result["avgWait"] = m_startedJobs ? double(m_totalWaitTime) / m_startedJobs : 0.0;
+
+    return result;
+}
@@ -0,0 +1,86 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _ENGINEJOBPOOL_INCLUDED
+#define _ENGINEJOBPOOL_INCLUDED
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QJsonObject>
+
+class TCPBase;
+
+// Order defines priority: lower value is started first
+enum EngineJobType
+{
+    ejtPreview = 0,
+    ejtGame = 1,
+    ejtRecorder = 2,
+    ejtPrefetch = 3, // speculative previews, only run on otherwise idle workers
+    ejtCount = 4
+};
+
+/**
+ * @brief Schedules engine runs (previews, games, recorders) on a bounded
+ * number of workers.
+ *
+ * Replaces the old global serial queue: independent jobs run in parallel,
+ * pending jobs are started by priority of their type and only one game may
+ * run at a time.
+ */
+class EngineJobPool : public QObject
+{
+        Q_OBJECT
+
+    public:
+        static EngineJobPool & instance();
+
+        void setMaxWorkers(int workers);
+        int maxWorkers() const;
+
+        void enqueue(TCPBase * job, bool couldCancelPreviousRequest);
+        void remove(TCPBase * job);
+
+        // queue statistics, saved along with the IPC statistics of each job
+        QJsonObject toJson() const;
+
+    private:
+        EngineJobPool();
+
+        int m_maxWorkers;
+        QList<TCPBase *> m_pending[ejtCount];
+        QList<TCPBase *> m_running;
+        QHash<TCPBase *, QElapsedTimer> m_waitTimers;
+
+        int m_maxQueueDepth;
+        int m_startedJobs;
+        int m_cancelledJobs;
+        qint64 m_totalWaitTime;
+        qint64 m_maxWaitTime;
+
+        void schedule();
+        bool canStart(EngineJobType type) const;
+        int queueDepth() const;
+
+    private slots:
+        void jobReady();
+};
+
+#endif // _ENGINEJOBPOOL_INCLUDED
@@ -23,6 +23,9 @@
 
 #include "hwconsts.h"
 #include "hwmap.h"
+#include "previewengine.h"
+#include "proto.h"
+#include "PreviewCache.h"
 
 HWMap::HWMap(QObject * parent) :
     TCPBase(false, parent)
@@ -31,6 +34,7 @@ HWMap::HWMap(QObject * parent) :
     m_mapgen = MAPGEN_REGULAR;
     m_maze_size = 0;
     m_feature_size = 50;
+    m_prefetch = false;
 }
 
 HWMap::~HWMap()
@@ -42,6 +46,21 @@ bool HWMap::couldBeRemoved()
     return !m_hasStarted;
 }
 
+EngineJobType HWMap::jobType()
+{
+    return m_prefetch ? ejtPrefetch : ejtPreview;
+}
+
+void HWMap::setPrefetch(bool prefetch)
+{
+    m_prefetch = prefetch;
+}
+
+bool HWMap::isPrefetch() const
+{
+    return m_prefetch;
+}
+
 void HWMap::getImage(const QString & seed, int filter, MapGenerator mapgen, int maze_size, const QByteArray & drawMapData, QString & script, QString & scriptparam, int feature_size)
 {
     m_seed = seed;
@@ -52,15 +71,53 @@ void HWMap::getImage(const QString & seed, int filter, MapGenerator mapgen, int
     m_maze_size = maze_size;
     m_feature_size = feature_size;
     if(mapgen == MAPGEN_DRAWN) m_drawMapData = drawMapData;
-    Start(true);
+
+    // same request has been answered before, no need to bother the engine
+    PreviewCache & cache = PreviewCache::instance();
+    m_cacheKey = PreviewCache::key(previewRequest());
+
+    QPixmap px;
+    int hhLimit;
+    if(cache.find(m_cacheKey, px, hhLimit))
+    {
+        emit HHLimitReceived(hhLimit);
+        emit ImageReceived(px);
+        deleteLater();
+        return;
+    }
+
+    QByteArray data = cache.load(m_cacheKey);
+    if(!data.isEmpty())
+    {
+        if(setPreviewData(data))
+        {
+            deleteLater();
+            return;
+        }
+
+        // couldn't be decoded, let the engine render it again
+        cache.remove(m_cacheKey);
+    }
+
+    HWPreviewEngine * engine = HWPreviewEngine::instance();
+    if(engine)
+        engine->requestPreview(this);
+    else
+        runEngine();
+}
+
+// spawns an engine just for this preview
+void HWMap::runEngine()
+{
+    // prefetches of the same owner are meant to run side by side
+    Start(!m_prefetch);
 }
 
 QStringList HWMap::getArguments()
 {
     QStringList arguments;
     arguments << "--internal";
-    arguments << "--port";
-    arguments << QString("%1").arg(ipc_port);
+    arguments << ipcArguments();
     arguments << "--user-prefix";
     arguments << cfgdir->absolutePath();
     arguments << "--prefix";
@@ -70,16 +127,23 @@ QStringList HWMap::getArguments()
 }
 
 void HWMap::onClientDisconnect()
-{    
+{
+    setPreviewData(readbuffer);
+}
+
+bool HWMap::setPreviewData(const QByteArray & data)
+{
     QLinearGradient linearGrad(QPoint(128, 0), QPoint(128, 128));
     linearGrad.setColorAt(1, QColor(0, 0, 192));
     linearGrad.setColorAt(0, QColor(66, 115, 225));
 
-    if (readbuffer.size() == 128 * 32 + 1)
+    if (data.size() == 128 * 32 + 1)
     {
-        quint8 *buf = (quint8*) readbuffer.constData();
+        quint8 *buf = (quint8*) data.constData();
         QImage im(buf, 256, 128, QImage::Format_Mono);
         im.setColorCount(2);
+        if (im.isNull())
+            return false;
 
         QPixmap px(QSize(256, 128));
         QPixmap pxres(px.size());
@@ -92,65 +156,85 @@ void HWMap::onClientDisconnect()
         p.fillRect(pxres.rect(), linearGrad);
         p.drawPixmap(0, 0, px);
 
+        if(!m_cacheKey.isEmpty())
+            PreviewCache::instance().insert(m_cacheKey, data, px, buf[128 * 32]);
+
         emit HHLimitReceived(buf[128 * 32]);
         emit ImageReceived(px);
-    } else if (readbuffer.size() == 128 * 256 + 1)
+    } else if (data.size() == 128 * 256 + 1)
     {
         QVector<QRgb> colorTable;
         colorTable.resize(256);
         for(int i = 0; i < 256; ++i)
             colorTable[i] = qRgba(255, 255, 0, i);
 
-        const quint8 *buf = (const quint8*) readbuffer.constData();
+        const quint8 *buf = (const quint8*) data.constData();
         QImage im(buf, 256, 128, QImage::Format_Indexed8);
         im.setColorTable(colorTable);
 
         QPixmap px = QPixmap::fromImage(im, Qt::ColorOnly);
+        if (px.isNull())
+            return false;
+
         QPixmap pxres(px.size());
         QPainter p(&pxres);
 
         p.fillRect(pxres.rect(), linearGrad);
         p.drawPixmap(0, 0, px);
 
+        if(!m_cacheKey.isEmpty())
+            PreviewCache::instance().insert(m_cacheKey, data, px, buf[128 * 256]);
+
         emit HHLimitReceived(buf[128 * 256]);
         emit ImageReceived(px);
     }
+    else
+        return false;
+
+    return true;
 }
 
 void HWMap::SendToClientFirst()
 {
-    SendIPC(QString("eseed %1").arg(m_seed).toUtf8());
-    SendIPC(QString("e$template_filter %1").arg(templateFilter).toUtf8());
-    SendIPC(QString("e$mapgen %1").arg(m_mapgen).toUtf8());
-    SendIPC(QString("e$feature_size %1").arg(m_feature_size).toUtf8());
-    if (!m_script.isEmpty())
+    RawSendIPC(previewRequest());
+}
+
+QByteArray HWMap::previewRequest() const
+{
+    return previewRequest(m_seed, templateFilter, m_mapgen, m_maze_size, m_drawMapData, m_script, m_scriptparam, m_feature_size);
+}
+
+QByteArray HWMap::previewRequest(const QString & seed, int templateFilter, MapGenerator mapgen, int maze_size, const QByteArray & drawMapData, const QString & script, const QString & scriptparam, int feature_size)
+{
+    QByteArray buf;
+
+    HWProto::addStringToBuffer(buf, QString("eseed %1").arg(seed));
+    HWProto::addStringToBuffer(buf, QString("e$template_filter %1").arg(templateFilter));
+    HWProto::addStringToBuffer(buf, QString("e$mapgen %1").arg(mapgen));
+    HWProto::addStringToBuffer(buf, QString("e$feature_size %1").arg(feature_size));
+    if (!script.isEmpty())
     {
-        SendIPC(QString("escript Scripts/Multiplayer/%1.lua").arg(m_script).toUtf8());
-        SendIPC(QString("e$scriptparam %1").arg(m_scriptparam).toUtf8());
+        HWProto::addStringToBuffer(buf, QString("escript Scripts/Multiplayer/%1.lua").arg(script));
+        HWProto::addStringToBuffer(buf, QString("e$scriptparam %1").arg(scriptparam));
     }
 
-    switch (m_mapgen)
+    switch (mapgen)
     {
         case MAPGEN_MAZE:
         case MAPGEN_PERLIN:
-            SendIPC(QString("e$maze_size %1").arg(m_maze_size).toUtf8());
+            HWProto::addStringToBuffer(buf, QString("e$maze_size %1").arg(maze_size));
             break;
 
         case MAPGEN_DRAWN:
         {
-            QByteArray data = m_drawMapData;
-            while(data.size() > 0)
-            {
-                QByteArray tmp = data;
-                tmp.truncate(200);
-                SendIPC("edraw " + tmp);
-                data.remove(0, 200);
-            }
+            HWProto::addExtendedByteArrayToBuffer(buf, "edraw " + drawMapData);
             break;
         }
         default:
             ;
     }
 
-    SendIPC("!");
+    HWProto::addStringToBuffer(buf, "!");
+
+    return buf;
 }
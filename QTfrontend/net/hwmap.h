@@ -45,6 +45,17 @@ class HWMap : public TCPBase
         virtual ~HWMap();
         void getImage(const QString & seed, int templateFilter, MapGenerator mapgen, int maze_size, const QByteArray & drawMapData, QString & script, QString & scriptparam, int feature_size);
         bool couldBeRemoved();
+        EngineJobType jobType();
+
+        QByteArray previewRequest() const;
+        static QByteArray previewRequest(const QString & seed, int templateFilter, MapGenerator mapgen, int maze_size, const QByteArray & drawMapData, const QString & script, const QString & scriptparam, int feature_size);
+        // returns false if data isn't a preview
+        bool setPreviewData(const QByteArray & data);
+        void runEngine();
+
+        // prefetched previews only fill the cache and yield to other requests
+        void setPrefetch(bool prefetch);
+        bool isPrefetch() const;
 
     protected:
         virtual QStringList getArguments();
@@ -64,6 +75,8 @@ class HWMap : public TCPBase
         int m_maze_size;  // going to try and deprecate this one
         int m_feature_size;
         QByteArray m_drawMapData;
+        QByteArray m_cacheKey;
+        bool m_prefetch;
 
     private slots:
 };
@@ -11,6 +11,11 @@ bool HWMapOptimizer::couldBeRemoved()
     return !m_hasStarted;
 }
 
+EngineJobType HWMapOptimizer::jobType()
+{
+    return ejtPreview;
+}
+
 void HWMapOptimizer::optimizeMap(const Paths &paths)
 {
     m_paths = paths;
@@ -22,8 +27,7 @@ QStringList HWMapOptimizer::getArguments()
 {
     QStringList arguments;
     arguments << "--internal";
-    arguments << "--port";
-    arguments << QString("%1").arg(ipc_port);
+    arguments << ipcArguments();
     arguments << "--user-prefix";
     arguments << cfgdir->absolutePath();
     arguments << "--prefix";
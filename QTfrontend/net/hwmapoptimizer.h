@@ -12,6 +12,7 @@ public:
 
     void optimizeMap(const Paths & paths);
     bool couldBeRemoved();
+    EngineJobType jobType();
     
 signals:    
     void optimizedMap(const Paths & paths);
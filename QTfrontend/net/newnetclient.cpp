@@ -18,6 +18,7 @@
  */
 
 #include <QDebug>
+#include <QLoggingCategory>
 #include <QInputDialog>
 #include <QCryptographicHash>
 #include <QSortFilterProxyModel>
@@ -32,11 +33,17 @@
 #include "servermessages.h"
 #include "HWApplication.h"
 
+// protocol dumps, off unless enabled with QT_LOGGING_RULES="hw.net.traffic.debug=true";
+// the arguments of a disabled qCDebug aren't evaluated
+Q_LOGGING_CATEGORY(netTraffic, "hw.net.traffic", QtWarningMsg)
+
 char delimiter='\n';
 
 HWNewNet::HWNewNet() :
     isChief(false),
     m_game_connected(false),
+    m_reading(false),
+    m_compactEM(false),
     netClientState(Disconnected)
 {
     m_private_game = false;
@@ -66,8 +73,6 @@ HWNewNet::HWNewNet() :
     connect(&NetSocket, SIGNAL(disconnected()), this, SLOT(OnDisconnect()));
     connect(&NetSocket, SIGNAL(error(QAbstractSocket::SocketError)), this,
             SLOT(displayError(QAbstractSocket::SocketError)));
-
-    connect(this, SIGNAL(messageProcessed()), this, SLOT(ClientRead()), Qt::QueuedConnection);
 }
 
 HWNewNet::~HWNewNet()
@@ -83,6 +88,7 @@ HWNewNet::~HWNewNet()
 void HWNewNet::Connect(const QString & hostName, quint16 port, const QString & nick)
 {
     netClientState = Connecting;
+    m_compactEM = false;
     mynick = nick;
     myhost = hostName + QString(":%1").arg(port);
     NetSocket.connectToHost(hostName, port);
@@ -171,9 +177,10 @@ void HWNewNet::ToggleReady()
 
 void HWNewNet::SendNet(const QByteArray & buf)
 {
-    QString msg = QString(buf.toBase64());
-
-    RawSendNet(QString("EM%1%2").arg(delimiter).arg(msg));
+    if (m_compactEM)
+        RawSendNet(QByteArray("EMR").append(delimiter).append(HWProto::escapeEngineMessages(buf)));
+    else
+        RawSendNet(QByteArray("EM").append(delimiter).append(buf.toBase64()));
 }
 
 int HWNewNet::ByteLength(const QString & str)
@@ -188,28 +195,36 @@ void HWNewNet::RawSendNet(const QString & str)
 
 void HWNewNet::RawSendNet(const QByteArray & buf)
 {
-    qDebug() << "Client: " << QString(QString::fromUtf8(buf)).split("\n");
+    qCDebug(netTraffic) << "Client: " << QString::fromUtf8(buf).split("\n");
     NetSocket.write(buf);
     NetSocket.write("\n\n", 2);
 }
 
 void HWNewNet::ClientRead()
 {
-    while (NetSocket.canReadLine())
-    {
-        QString s = QString::fromUtf8(NetSocket.readLine());
-        if (s.endsWith('\n')) s.chop(1);
+    // handlers may open dialogs running a nested event loop, data arriving
+    // meanwhile is picked up by the outer call
+    if (m_reading)
+        return;
 
-        if (s.size() == 0)
-        {
-            ParseCmd(cmdbuf);
-            cmdbuf.clear();
-            emit messageProcessed();
-            return ;
-        }
-        else
-            cmdbuf << s;
+    m_reading = true;
+
+    // models apply what changed in one go when everything is decoded
+    m_roomsListModel->beginUpdate();
+    m_playersModel->beginUpdate();
+
+    // decode everything which arrived, including what came in while
+    // the handlers were running
+    while (m_buffer.readFrom(&NetSocket) > 0)
+    {
+        while (m_buffer.next(m_message))
+            ParseCmd(m_message);
     }
+
+    m_playersModel->endUpdate();
+    m_roomsListModel->endUpdate();
+
+    m_reading = false;
 }
 
 void HWNewNet::OnConnect()
@@ -252,460 +267,522 @@ void HWNewNet::SendPasswordHash(const QString & hash)
     maybeSendPassword();
 }
 
-void HWNewNet::ParseCmd(const QStringList & lst)
+const QHash<QLatin1String, HWNewNet::Command> & HWNewNet::commands()
+{
+    static QHash<QLatin1String, Command> commands;
+
+    if(commands.isEmpty())
+    {
+        static const struct
+        {
+            const char * name;
+            Command command;
+        } table[] = {
+            {"NICK",            {&HWNewNet::cmdNick,            false}},
+            {"PROTO",           {&HWNewNet::cmdProto,           false}},
+            {"ERROR",           {&HWNewNet::cmdError,           false}},
+            {"WARNING",         {&HWNewNet::cmdWarning,         false}},
+            {"CONNECTED",       {&HWNewNet::cmdConnected,       false}},
+            {"SERVER_AUTH",     {&HWNewNet::cmdServerAuth,      false}},
+            {"PING",            {&HWNewNet::cmdPing,            false}},
+            {"ROOMS",           {&HWNewNet::cmdRooms,           false}},
+            {"SERVER_MESSAGE",  {&HWNewNet::cmdServerMessage,   false}},
+            {"CHAT",            {&HWNewNet::cmdChat,            false}},
+            {"INFO",            {&HWNewNet::cmdInfo,            false}},
+            {"SERVER_VARS",     {&HWNewNet::cmdServerVars,      false}},
+            {"BANLIST",         {&HWNewNet::cmdBanList,         false}},
+            {"CLIENT_FLAGS",    {&HWNewNet::cmdClientFlags,     false}},
+            {"CF",              {&HWNewNet::cmdClientFlags,     false}},
+            {"KICKED",          {&HWNewNet::cmdKicked,          false}},
+            {"LOBBY:JOINED",    {&HWNewNet::cmdLobbyJoined,     false}},
+            {"ROOM",            {&HWNewNet::cmdRoom,            false}},
+            {"LOBBY:LEFT",      {&HWNewNet::cmdLobbyLeft,       false}},
+            {"ASKPASSWORD",     {&HWNewNet::cmdAskPassword,     false}},
+            {"NOTICE",          {&HWNewNet::cmdNotice,          false}},
+            {"BYE",             {&HWNewNet::cmdBye,             false}},
+            {"JOINING",         {&HWNewNet::cmdJoining,         false}},
+            {"JOINED",          {&HWNewNet::cmdJoined,          false}},
+            {"EM",              {&HWNewNet::cmdEngineMessage,   true}},
+            {"EMR",             {&HWNewNet::cmdEngineMessageRaw, true}},
+            {"ROUND_FINISHED",  {&HWNewNet::cmdRoundFinished,   true}},
+            {"ADD_TEAM",        {&HWNewNet::cmdAddTeam,         true}},
+            {"REMOVE_TEAM",     {&HWNewNet::cmdRemoveTeam,      true}},
+            {"ROOMABANDONED",   {&HWNewNet::cmdRoomAbandoned,   true}},
+            {"RUN_GAME",        {&HWNewNet::cmdRunGame,         true}},
+            {"TEAM_ACCEPTED",   {&HWNewNet::cmdTeamAccepted,    true}},
+            {"CFG",             {&HWNewNet::cmdCfg,             true}},
+            {"HH_NUM",          {&HWNewNet::cmdHedgehogsNum,    true}},
+            {"TEAM_COLOR",      {&HWNewNet::cmdTeamColor,       true}},
+            {"LEFT",            {&HWNewNet::cmdLeft,            true}},
+        };
+
+        for(unsigned int i = 0; i < sizeof(table) / sizeof(table[0]); ++i)
+            commands.insert(QLatin1String(table[i].name), table[i].command);
+    }
+
+    return commands;
+}
+
+void HWNewNet::ParseCmd(const NetMessage & msg)
 {
-    qDebug() << "Server: " << lst;
+    qCDebug(netTraffic) << "Server: " << msg;
 
-    if(!lst.size())
+    if(msg.isEmpty())
     {
         qWarning("Net client: Bad message");
         return;
     }
 
-    if (lst[0] == "NICK")
+    const QHash<QLatin1String, Command> & cmds = commands();
+    QHash<QLatin1String, Command>::const_iterator it = cmds.constFind(msg.command());
+
+    if((it == cmds.constEnd()) || (it->roomOnly && !isInRoom()))
     {
-        mynick = lst[1];
-        m_playersModel->setNickname(mynick);
-        m_nick_registered = false;
-        return ;
+        unknownCmd(msg);
+        return;
     }
 
-    if (lst[0] == "PROTO")
-        return ;
+    (this->*(it->handler))(msg);
+}
+
+void HWNewNet::unknownCmd(const NetMessage & msg)
+{
+    qWarning() << "Net: Unknown message or wrong state:" << msg;
+}
 
-    if (lst[0] == "ERROR")
+void HWNewNet::cmdNick(const NetMessage & msg)
+{
+    if(msg.size() < 2)
     {
-        if (lst.size() == 2)
-            emit Error(HWApplication::translate("server", lst[1].toLatin1().constData()));
-        else
-            emit Error("Unknown error");
+        qWarning("Net: Bad NICK message");
         return;
     }
 
-    if (lst[0] == "WARNING")
+    mynick = msg.string(1);
+    m_playersModel->setNickname(mynick);
+    m_nick_registered = false;
+}
+
+void HWNewNet::cmdProto(const NetMessage & msg)
+{
+    // the extensions the server agreed to follow the protocol number
+    m_compactEM = false;
+    for(int i = 2; i < msg.size(); ++i)
     {
-        if (lst.size() == 2)
-            emit Warning(HWApplication::translate("server", lst[1].toLatin1().constData()));
-        else
-            emit Warning("Unknown warning");
-        return;
+        if(msg.equals(i, "EMR"))
+            m_compactEM = true;
     }
+}
+
+void HWNewNet::cmdError(const NetMessage & msg)
+{
+    if (msg.size() == 2)
+        emit Error(HWApplication::translate("server", msg.bytes(1).constData()));
+    else
+        emit Error("Unknown error");
+}
+
+void HWNewNet::cmdWarning(const NetMessage & msg)
+{
+    if (msg.size() == 2)
+        emit Warning(HWApplication::translate("server", msg.bytes(1).constData()));
+    else
+        emit Warning("Unknown warning");
+}
 
-    if (lst[0] == "CONNECTED")
+void HWNewNet::cmdConnected(const NetMessage & msg)
+{
+    if(msg.size() < 3 || msg.toInt(2) < cMinServerVersion)
     {
-        if(lst.size() < 3 || lst[2].toInt() < cMinServerVersion)
-        {
-            // TODO: Warn user, disconnect
-            qWarning() << "Server too old";
-            RawSendNet(QString("QUIT%1%2").arg(delimiter).arg("Server too old"));
-            Disconnect();
-            emit disconnected(tr("The server is too old. Disconnecting now."));
-            return;
-        }
+        // TODO: Warn user, disconnect
+        qWarning() << "Server too old";
+        RawSendNet(QString("QUIT%1%2").arg(delimiter).arg("Server too old"));
+        Disconnect();
+        emit disconnected(tr("The server is too old. Disconnecting now."));
+        return;
+    }
 
-        RawSendNet(QString("NICK%1%2").arg(delimiter).arg(mynick));
+    RawSendNet(QString("NICK%1%2").arg(delimiter).arg(mynick));
+    // newer servers relay engine messages without base64 if asked to
+    if(msg.toInt(2) >= cCompactEMServerVersion)
+        RawSendNet(QString("PROTO%1%2%1EMR").arg(delimiter).arg(*cProtoVer));
+    else
         RawSendNet(QString("PROTO%1%2").arg(delimiter).arg(*cProtoVer));
-        netClientState = Connected;
-        m_game_connected = true;
-        emit adminAccess(false);
+    netClientState = Connected;
+    m_game_connected = true;
+    emit adminAccess(false);
+}
+
+void HWNewNet::cmdServerAuth(const NetMessage & msg)
+{
+    if(msg.size() < 2)
+    {
+        qWarning("Net: Malformed SERVER_AUTH message");
         return;
     }
 
-    if (lst[0] == "SERVER_AUTH")
+    if(msg.string(1) != m_serverHash)
     {
-        if(lst.size() < 2)
-        {
-            qWarning("Net: Malformed SERVER_AUTH message");
-            return;
-        }
+        Error("Server authentication error");
+        Disconnect();
+    } else
+    {
+        // empty m_serverHash variable means no authentication was performed
+        // or server passed authentication
+        m_serverHash.clear();
+    }
+}
 
-        if(lst[1] != m_serverHash)
-        {
-            Error("Server authentication error");
-            Disconnect();
-        } else
-        {
-            // empty m_serverHash variable means no authentication was performed
-            // or server passed authentication
-            m_serverHash.clear();
-        }
+void HWNewNet::cmdPing(const NetMessage & msg)
+{
+    if (msg.size() > 1)
+        RawSendNet(QByteArray("PONG").append(delimiter).append(msg.data(1), msg.length(1)));
+    else
+        RawSendNet(QByteArray("PONG"));
+}
 
+void HWNewNet::cmdRooms(const NetMessage & msg)
+{
+    if(msg.size() % 9 != 1)
+    {
+        qWarning("Net: Malformed ROOMS message");
         return;
     }
-
-    if (lst[0] == "PING")
+    m_roomsListModel->setRoomsList(msg.strings(1));
+    if (m_private_game == false && m_nick_registered == false)
     {
-        if (lst.size() > 1)
-            RawSendNet(QString("PONG%1%2").arg(delimiter).arg(lst[1]));
-        else
-            RawSendNet(QString("PONG"));
-        return;
+        emit NickNotRegistered(mynick);
     }
+}
 
-    if (lst[0] == "ROOMS")
+void HWNewNet::cmdServerMessage(const NetMessage & msg)
+{
+    if(msg.size() < 2)
     {
-        if(lst.size() % 9 != 1)
-        {
-            qWarning("Net: Malformed ROOMS message");
-            return;
-        }
-        m_roomsListModel->setRoomsList(lst.mid(1));
-        if (m_private_game == false && m_nick_registered == false)
-        {
-            emit NickNotRegistered(mynick);
-        }
+        qWarning("Net: Empty SERVERMESSAGE message");
         return;
     }
+    emit serverMessage(msg.string(1));
+}
 
-    if (lst[0] == "SERVER_MESSAGE")
+void HWNewNet::cmdChat(const NetMessage & msg)
+{
+    if(msg.size() < 3)
     {
-        if(lst.size() < 2)
-        {
-            qWarning("Net: Empty SERVERMESSAGE message");
-            return;
-        }
-        emit serverMessage(lst[1]);
+        qWarning("Net: Empty CHAT message");
         return;
     }
 
-    if (lst[0] == "CHAT")
-    {
-        if(lst.size() < 3)
-        {
-            qWarning("Net: Empty CHAT message");
-            return;
-        }
+    QString nick = msg.string(1);
+    QString text = msg.string(2);
+    QString action = HWProto::chatStringToAction(text);
 
-        QString action = HWProto::chatStringToAction(lst[2]);
-
-        if (netClientState == InLobby)
-        {
-            if (action != NULL)
-                emit lobbyChatAction(lst[1], action);
-            else
-                emit lobbyChatMessage(lst[1], lst[2]);
-        }
+    if (netClientState == InLobby)
+    {
+        if (action != NULL)
+            emit lobbyChatAction(nick, action);
         else
-        {
-            emit chatStringFromNet(HWProto::formatChatMsg(lst[1], lst[2]));
-            if (action != NULL)
-                emit roomChatAction(lst[1], action);
-            else
-                emit roomChatMessage(lst[1], lst[2]);
-        }
-        return;
+            emit lobbyChatMessage(nick, text);
     }
+    else
+    {
+        emit chatStringFromNet(HWProto::formatChatMsg(nick, text));
+        if (action != NULL)
+            emit roomChatAction(nick, action);
+        else
+            emit roomChatMessage(nick, text);
+    }
+}
 
-    if (lst[0] == "INFO")
+void HWNewNet::cmdInfo(const NetMessage & msg)
+{
+    if(msg.size() < 5)
     {
-        if(lst.size() < 5)
-        {
-            qWarning("Net: Malformed INFO message");
-            return;
-        }
-        emit playerInfo(lst[1], lst[2], lst[3], lst[4]);
-        if (netClientState != InLobby)
-        {
-            QStringList tmp = lst;
-            tmp.removeFirst();
-            emit chatStringFromNet(tmp.join(" ").prepend('\x01'));
-        }
+        qWarning("Net: Malformed INFO message");
         return;
     }
 
-    if (lst[0] == "SERVER_VARS")
-    {
-        QStringList tmp = lst;
-        tmp.removeFirst();
-        while (tmp.size() >= 2)
-        {
-            if(tmp[0] == "MOTD_NEW") emit serverMessageNew(tmp[1]);
-            else if(tmp[0] == "MOTD_OLD") emit serverMessageOld(tmp[1]);
-            else if(tmp[0] == "LATEST_PROTO") emit latestProtocolVar(tmp[1].toInt());
+    QStringList info = msg.strings(1);
+    emit playerInfo(info[0], info[1], info[2], info[3]);
+    if (netClientState != InLobby)
+        emit chatStringFromNet(info.join(" ").prepend('\x01'));
+}
 
-            tmp.removeFirst();
-            tmp.removeFirst();
-        }
-        return;
+void HWNewNet::cmdServerVars(const NetMessage & msg)
+{
+    for(int i = 1; i + 1 < msg.size(); i += 2)
+    {
+        if(msg.equals(i, "MOTD_NEW")) emit serverMessageNew(msg.string(i + 1));
+        else if(msg.equals(i, "MOTD_OLD")) emit serverMessageOld(msg.string(i + 1));
+        else if(msg.equals(i, "LATEST_PROTO")) emit latestProtocolVar(msg.toInt(i + 1));
     }
+}
+
+void HWNewNet::cmdBanList(const NetMessage & msg)
+{
+    emit bansList(msg.strings(1));
+}
 
-    if (lst[0] == "BANLIST")
+void HWNewNet::cmdClientFlags(const NetMessage & msg)
+{
+    if(msg.size() < 3 || msg.length(1) < 2)
     {
-        QStringList tmp = lst;
-        tmp.removeFirst();
-        emit bansList(tmp);
+        qWarning("Net: Malformed CLIENT_FLAGS message");
         return;
     }
 
-    if (lst[0] == "CLIENT_FLAGS" || lst[0] == "CF")
-    {
-        if(lst.size() < 3 || lst[1].size() < 2)
-        {
-            qWarning("Net: Malformed CLIENT_FLAGS message");
-            return;
-        }
+    const char * flags = msg.data(1);
+    int flagsCount = msg.length(1);
+    bool setFlag = flags[0] == '+';
+    const QStringList nicks = msg.strings(2);
+    bool inRoom = isInRoom();
 
-        QString flags = lst[1];
-        bool setFlag = flags[0] == '+';
-        const QStringList nicks = lst.mid(2);
+    for(int i = 1; i < flagsCount; ++i)
+    {
+        char c = flags[i];
 
-        while(flags.size() > 1)
+        switch(c)
         {
-            flags.remove(0, 1);
-            char c = flags[0].toLatin1();
-            bool inRoom = (netClientState == InRoom || netClientState == InGame);
-
-            switch(c)
-            {
-                // flag indicating if a player is ready to start a game
-                case 'r':
-                    if(inRoom)
-                        foreach (const QString & nick, nicks)
+            // flag indicating if a player is ready to start a game
+            case 'r':
+                if(inRoom)
+                    foreach (const QString & nick, nicks)
+                    {
+                        if (nick == mynick)
                         {
-                            if (nick == mynick)
-                            {
-                                emit setMyReadyStatus(setFlag);
-                            }
-                            m_playersModel->setFlag(nick, PlayersListModel::Ready, setFlag);
+                            emit setMyReadyStatus(setFlag);
                         }
-                        break;
-
-                // flag indicating if a player is a registered user
-                case 'u':
-                        foreach(const QString & nick, nicks)
-                            m_playersModel->setFlag(nick, PlayersListModel::Registered, setFlag);
-                        break;
-                // flag indicating if a player is in room
-                case 'i':
-                        foreach(const QString & nick, nicks)
-                            m_playersModel->setFlag(nick, PlayersListModel::InRoom, setFlag);
-                        break;
-                // flag indicating if a player is contributor
-                case 'c':
-                        foreach(const QString & nick, nicks)
-                            m_playersModel->setFlag(nick, PlayersListModel::Contributor, setFlag);
-                        break;
-                // flag indicating if a player has engine running
-                case 'g':
-                    if(inRoom)
-                        foreach(const QString & nick, nicks)
-                            m_playersModel->setFlag(nick, PlayersListModel::InGame, setFlag);
-                        break;
-
-                // flag indicating if a player is the host/master of the room
-                case 'h':
-                    if(inRoom)
-                        foreach (const QString & nick, nicks)
+                        m_playersModel->setFlag(nick, PlayersListModel::Ready, setFlag);
+                    }
+                    break;
+
+            // flag indicating if a player is a registered user
+            case 'u':
+                    foreach(const QString & nick, nicks)
+                        m_playersModel->setFlag(nick, PlayersListModel::Registered, setFlag);
+                    break;
+            // flag indicating if a player is in room
+            case 'i':
+                    foreach(const QString & nick, nicks)
+                        m_playersModel->setFlag(nick, PlayersListModel::InRoom, setFlag);
+                    break;
+            // flag indicating if a player is contributor
+            case 'c':
+                    foreach(const QString & nick, nicks)
+                        m_playersModel->setFlag(nick, PlayersListModel::Contributor, setFlag);
+                    break;
+            // flag indicating if a player has engine running
+            case 'g':
+                if(inRoom)
+                    foreach(const QString & nick, nicks)
+                        m_playersModel->setFlag(nick, PlayersListModel::InGame, setFlag);
+                    break;
+
+            // flag indicating if a player is the host/master of the room
+            case 'h':
+                if(inRoom)
+                    foreach (const QString & nick, nicks)
+                    {
+                        if (nick == mynick)
                         {
-                            if (nick == mynick)
-                            {
-                                isChief = setFlag;
-                                emit roomMaster(isChief);
-                            }
-
-                            m_playersModel->setFlag(nick, PlayersListModel::RoomAdmin, setFlag);
+                            isChief = setFlag;
+                            emit roomMaster(isChief);
                         }
-                        break;
 
-                // flag indicating if a player is admin (if so -> worship them!)
-                case 'a':
-                        foreach (const QString & nick, nicks)
-                        {
-                            if (nick == mynick)
-                                emit adminAccess(setFlag);
+                        m_playersModel->setFlag(nick, PlayersListModel::RoomAdmin, setFlag);
+                    }
+                    break;
 
-                            m_playersModel->setFlag(nick, PlayersListModel::ServerAdmin, setFlag);
-                        }
-                        break;
+            // flag indicating if a player is admin (if so -> worship them!)
+            case 'a':
+                    foreach (const QString & nick, nicks)
+                    {
+                        if (nick == mynick)
+                            emit adminAccess(setFlag);
 
-                default:
-                        qWarning() << "Net: Unknown client-flag: " << c;
-            }
-        }
+                        m_playersModel->setFlag(nick, PlayersListModel::ServerAdmin, setFlag);
+                    }
+                    break;
 
-        return;
+            default:
+                    qWarning() << "Net: Unknown client-flag: " << c;
+        }
     }
+}
 
-    if(lst[0] == "KICKED")
-    {
-        netClientState = InLobby;
-        askRoomsList();
-        emit LeftRoom(tr("You got kicked"));
-        m_playersModel->resetRoomFlags();
+void HWNewNet::cmdKicked(const NetMessage & msg)
+{
+    Q_UNUSED(msg);
 
-        return;
-    }
+    netClientState = InLobby;
+    askRoomsList();
+    emit LeftRoom(tr("You got kicked"));
+    m_playersModel->resetRoomFlags();
+}
 
-    if(lst[0] == "LOBBY:JOINED")
+void HWNewNet::cmdLobbyJoined(const NetMessage & msg)
+{
+    if(msg.size() < 2)
     {
-        if(lst.size() < 2)
-        {
-            qWarning("Net: Bad JOINED message");
-            return;
-        }
+        qWarning("Net: Bad JOINED message");
+        return;
+    }
 
-        for(int i = 1; i < lst.size(); ++i)
-        {
-            if (lst[i] == mynick)
-            {
-                // check if server is authenticated or no authentication was performed at all
-                if(!m_serverHash.isEmpty())
-                {
-                    Error(tr("Server authentication error"));
+    QStringList nicks = msg.strings(1);
 
-                    Disconnect();
-                }
+    // slots of connected() expect the nicks of the lobby to be known already
+    m_playersModel->addPlayers(nicks, false);
 
-                netClientState = InLobby;
-                //RawSendNet(QString("LIST")); //deprecated
-                emit connected();
-            }
+    if (nicks.contains(mynick))
+    {
+        // check if server is authenticated or no authentication was performed at all
+        if(!m_serverHash.isEmpty())
+        {
+            Error(tr("Server authentication error"));
 
-            m_playersModel->addPlayer(lst[i], false);
+            Disconnect();
         }
-        return;
+
+        netClientState = InLobby;
+        //RawSendNet(QString("LIST")); //deprecated
+        emit connected();
     }
+}
 
-    if(lst[0] == "ROOM" && lst.size() == 11 && lst[1] == "ADD")
+void HWNewNet::cmdRoom(const NetMessage & msg)
+{
+    if(msg.size() == 11 && msg.equals(1, "ADD"))
     {
-        QStringList tmp = lst;
-        tmp.removeFirst();
-        tmp.removeFirst();
-
-        m_roomsListModel->addRoom(tmp);
+        m_roomsListModel->addRoom(msg.strings(2));
         return;
     }
 
-    if(lst[0] == "ROOM" && lst.size() == 12 && lst[1] == "UPD")
+    if(msg.size() == 12 && msg.equals(1, "UPD"))
     {
-        QStringList tmp = lst;
-        tmp.removeFirst();
-        tmp.removeFirst();
-
-        QString roomName = tmp.takeFirst();
-        m_roomsListModel->updateRoom(roomName, tmp);
+        QString roomName = msg.string(2);
+        QStringList info = msg.strings(3);
+        m_roomsListModel->updateRoom(roomName, info);
 
         // keep track of room name so correct name is displayed
-        if(myroom == roomName && myroom != tmp[1])
+        if(myroom == roomName && myroom != info[1])
         {
-            myroom = tmp[1];
+            myroom = info[1];
             emit roomNameUpdated(myroom);
         }
 
         return;
     }
 
-    if(lst[0] == "ROOM" && lst.size() == 3 && lst[1] == "DEL")
+    if(msg.size() == 3 && msg.equals(1, "DEL"))
     {
-        m_roomsListModel->removeRoom(lst[2]);
+        m_roomsListModel->removeRoom(msg.string(2));
         return;
     }
 
-    if(lst[0] == "LOBBY:LEFT")
-    {
-        if(lst.size() < 2)
-        {
-            qWarning("Net: Bad LOBBY:LEFT message");
-            return;
-        }
-
-        if (lst.size() < 3)
-            m_playersModel->removePlayer(lst[1]);
-        else
-            m_playersModel->removePlayer(lst[1], lst[2]);
+    unknownCmd(msg);
+}
 
+void HWNewNet::cmdLobbyLeft(const NetMessage & msg)
+{
+    if(msg.size() < 2)
+    {
+        qWarning("Net: Bad LOBBY:LEFT message");
         return;
     }
 
-    if (lst[0] == "ASKPASSWORD")
-    {
-        // server should send us salt of at least 16 characters
+    if (msg.size() < 3)
+        m_playersModel->removePlayer(msg.string(1));
+    else
+        m_playersModel->removePlayer(msg.string(1), msg.string(2));
+}
 
-        if(lst.size() < 2 || lst[1].size() < 16)
-        {
-            qWarning("Net: Bad ASKPASSWORD message");
-            return;
-        }
+void HWNewNet::cmdAskPassword(const NetMessage & msg)
+{
+    // server should send us salt of at least 16 characters
+
+    if(msg.size() < 2 || msg.length(1) < 16)
+    {
+        qWarning("Net: Bad ASKPASSWORD message");
+        return;
+    }
 
-        emit NickRegistered(mynick);
-        m_nick_registered = true;
+    emit NickRegistered(mynick);
+    m_nick_registered = true;
 
-        // store server salt
-        // when this variable is set, it is assumed that server asked us for a password
-        m_serverSalt = lst[1];
-        m_clientSalt = QUuid::createUuid().toString();
+    // store server salt
+    // when this variable is set, it is assumed that server asked us for a password
+    m_serverSalt = msg.string(1);
+    m_clientSalt = QUuid::createUuid().toString();
 
-        maybeSendPassword();
+    maybeSendPassword();
+}
 
+void HWNewNet::cmdNotice(const NetMessage & msg)
+{
+    if(msg.size() < 2)
+    {
+        qWarning("Net: Bad NOTICE message");
         return;
     }
 
-    if (lst[0] == "NOTICE")
+    bool ok;
+    int n = msg.toInt(1, &ok);
+    if(!ok)
     {
-        if(lst.size() < 2)
-        {
-            qWarning("Net: Bad NOTICE message");
-            return;
-        }
-
-        bool ok;
-        int n = lst[1].toInt(&ok);
-        if(!ok)
-        {
-            qWarning("Net: Bad NOTICE message");
-            return;
-        }
+        qWarning("Net: Bad NOTICE message");
+        return;
+    }
 
-        handleNotice(n);
+    handleNotice(n);
+}
 
+void HWNewNet::cmdBye(const NetMessage & msg)
+{
+    if (msg.size() < 2)
+    {
+        qWarning("Net: Bad BYE message");
         return;
     }
-
-    if (lst[0] == "BYE")
+    if (msg.equals(1, "Authentication failed"))
     {
-        if (lst.size() < 2)
-        {
-            qWarning("Net: Bad BYE message");
-            return;
-        }
-        if (lst[1] == "Authentication failed")
-        {
-            emit AuthFailed();
-            m_game_connected = false;
-            Disconnect();
-            //omitted 'emit disconnected()', we don't want the error message
-            return;
-        }
+        emit AuthFailed();
         m_game_connected = false;
         Disconnect();
-        emit disconnected(HWApplication::translate("server", lst[1].toLatin1().constData()));
+        //omitted 'emit disconnected()', we don't want the error message
         return;
     }
+    m_game_connected = false;
+    Disconnect();
+    emit disconnected(HWApplication::translate("server", msg.bytes(1).constData()));
+}
 
-    if(lst[0] == "JOINING")
+void HWNewNet::cmdJoining(const NetMessage & msg)
+{
+    if(msg.size() != 2)
     {
-        if(lst.size() != 2)
-        {
-            qWarning("Net: Bad JOINING message");
-            return;
-        }
-
-        myroom = lst[1];
-        emit roomNameUpdated(myroom);
+        qWarning("Net: Bad JOINING message");
         return;
     }
 
-    if(netClientState == InLobby && lst[0] == "JOINED")
+    myroom = msg.string(1);
+    emit roomNameUpdated(myroom);
+}
+
+void HWNewNet::cmdJoined(const NetMessage & msg)
+{
+    if(netClientState == InLobby)
     {
-        if(lst.size() < 2 || lst[1] != mynick)
+        if(msg.size() < 2 || msg.string(1) != mynick)
         {
             qWarning("Net: Bad JOINED message");
             return;
         }
 
-        for(int i = 1; i < lst.size(); ++i)
+        for(int i = 1; i < msg.size(); ++i)
         {
-            if (lst[i] == mynick)
+            QString nick = msg.string(i);
+
+            if (nick == mynick)
             {
                 netClientState = InRoom;
                 emit EnteredGame();
@@ -714,164 +791,173 @@ void HWNewNet::ParseCmd(const QStringList & lst)
                     emit configAsked();
             }
 
-            m_playersModel->playerJoinedRoom(lst[i], isChief && (lst[i] != mynick));
+            m_playersModel->playerJoinedRoom(nick, isChief && (nick != mynick));
 
-            emit chatStringFromNet(tr("%1 *** %2 has joined the room").arg('\x03').arg(lst[i]));
+            emit chatStringFromNet(tr("%1 *** %2 has joined the room").arg('\x03').arg(nick));
         }
         return;
     }
 
-    if(netClientState == InRoom || netClientState == InGame)
+    if(!isInRoom())
     {
-        if (lst[0] == "EM")
-        {
-            if(lst.size() < 2)
-            {
-                qWarning("Net: Bad EM message");
-                return;
-            }
-            for(int i = 1; i < lst.size(); ++i)
-            {
-                QByteArray em = QByteArray::fromBase64(lst[i].toLatin1());
-                emit FromNet(em);
-            }
-            return;
-        }
+        unknownCmd(msg);
+        return;
+    }
 
-        if (lst[0] == "ROUND_FINISHED")
-        {
-            emit FromNet(QByteArray("\x01o"));
-            return;
-        }
+    if(msg.size() < 2)
+    {
+        qWarning("Net: Bad JOINED message");
+        return;
+    }
 
-        if (lst[0] == "ADD_TEAM")
-        {
-            if(lst.size() != 24)
-            {
-                qWarning("Net: Bad ADDTEAM message");
-                return;
-            }
-            QStringList tmp = lst;
-            tmp.removeFirst();
-            HWTeam team(tmp);
-            emit AddNetTeam(team);
-            return;
-        }
+    for(int i = 1; i < msg.size(); ++i)
+    {
+        QString nick = msg.string(i);
 
-        if (lst[0] == "REMOVE_TEAM")
-        {
-            if(lst.size() != 2)
-            {
-                qWarning("Net: Bad REMOVETEAM message");
-                return;
-            }
-            emit RemoveNetTeam(HWTeam(lst[1]));
-            return;
-        }
+        emit chatStringFromNet(tr("%1 *** %2 has joined the room").arg('\x03').arg(nick));
+        m_playersModel->playerJoinedRoom(nick, isChief && (nick != mynick));
+    }
+}
 
-        if(lst[0] == "ROOMABANDONED")
-        {
-            netClientState = InLobby;
-            m_playersModel->resetRoomFlags();
-            emit LeftRoom(tr("Room destroyed"));
-            return;
-        }
+void HWNewNet::cmdEngineMessage(const NetMessage & msg)
+{
+    if(msg.size() < 2)
+    {
+        qWarning("Net: Bad EM message");
+        return;
+    }
+    for(int i = 1; i < msg.size(); ++i)
+    {
+        QByteArray em = QByteArray::fromBase64(QByteArray::fromRawData(msg.data(i), msg.length(i)));
+        emit FromNet(em);
+    }
+}
 
-        if (lst[0] == "RUN_GAME")
+void HWNewNet::cmdEngineMessageRaw(const NetMessage & msg)
+{
+    if(msg.size() < 2)
+    {
+        qWarning("Net: Bad EMR message");
+        return;
+    }
+    for(int i = 1; i < msg.size(); ++i)
+    {
+        QByteArray em;
+        if(!HWProto::unescapeEngineMessages(msg.data(i), msg.length(i), em))
         {
-            netClientState = InGame;
-            emit AskForRunGame();
+            qWarning("Net: Bad EMR message");
             return;
         }
+        emit FromNet(em);
+    }
+}
 
-        if (lst[0] == "TEAM_ACCEPTED")
-        {
-            if (lst.size() != 2)
-            {
-                qWarning("Net: Bad TEAM_ACCEPTED message");
-                return;
-            }
-            emit TeamAccepted(lst[1]);
-            return;
-        }
+void HWNewNet::cmdRoundFinished(const NetMessage & msg)
+{
+    Q_UNUSED(msg);
 
-        if (lst[0] == "CFG")
-        {
-            if(lst.size() < 3)
-            {
-                qWarning("Net: Bad CFG message");
-                return;
-            }
-            QStringList tmp = lst;
-            tmp.removeFirst();
-            tmp.removeFirst();
-            if (lst[1] == "SCHEME")
-                emit netSchemeConfig(tmp);
-            else
-                emit paramChanged(lst[1], tmp);
-            return;
-        }
+    emit FromNet(QByteArray("\x01o"));
+}
 
-        if (lst[0] == "HH_NUM")
-        {
-            if (lst.size() != 3)
-            {
-                qWarning("Net: Bad TEAM_ACCEPTED message");
-                return;
-            }
-            HWTeam tmptm(lst[1]);
-            tmptm.setNumHedgehogs(lst[2].toUInt());
-            emit hhnumChanged(tmptm);
-            return;
-        }
+void HWNewNet::cmdAddTeam(const NetMessage & msg)
+{
+    if(msg.size() != 24)
+    {
+        qWarning("Net: Bad ADDTEAM message");
+        return;
+    }
+    HWTeam team(msg.strings(1));
+    emit AddNetTeam(team);
+}
 
-        if (lst[0] == "TEAM_COLOR")
-        {
-            if (lst.size() != 3)
-            {
-                qWarning("Net: Bad TEAM_COLOR message");
-                return;
-            }
-            HWTeam tmptm(lst[1]);
-            tmptm.setColor(lst[2].toInt());
-            emit teamColorChanged(tmptm);
-            return;
-        }
+void HWNewNet::cmdRemoveTeam(const NetMessage & msg)
+{
+    if(msg.size() != 2)
+    {
+        qWarning("Net: Bad REMOVETEAM message");
+        return;
+    }
+    emit RemoveNetTeam(HWTeam(msg.string(1)));
+}
 
-        if(lst[0] == "JOINED")
-        {
-            if(lst.size() < 2)
-            {
-                qWarning("Net: Bad JOINED message");
-                return;
-            }
+void HWNewNet::cmdRoomAbandoned(const NetMessage & msg)
+{
+    Q_UNUSED(msg);
 
-            for(int i = 1; i < lst.size(); ++i)
-            {
-                emit chatStringFromNet(tr("%1 *** %2 has joined the room").arg('\x03').arg(lst[i]));
-                m_playersModel->playerJoinedRoom(lst[i], isChief && (lst[i] != mynick));
-            }
-            return;
-        }
+    netClientState = InLobby;
+    m_playersModel->resetRoomFlags();
+    emit LeftRoom(tr("Room destroyed"));
+}
 
-        if(lst[0] == "LEFT")
-        {
-            if(lst.size() < 2)
-            {
-                qWarning("Net: Bad LEFT message");
-                return;
-            }
+void HWNewNet::cmdRunGame(const NetMessage & msg)
+{
+    Q_UNUSED(msg);
 
-            if (lst.size() < 3)
-                emit chatStringFromNet(tr("%1 *** %2 has left").arg('\x03').arg(lst[1]));
-            else
-                emit chatStringFromNet(tr("%1 *** %2 has left (%3)").arg('\x03').arg(lst[1], lst[2]));
-            m_playersModel->playerLeftRoom(lst[1]);
-            return;
-        }
+    netClientState = InGame;
+    emit AskForRunGame();
+}
+
+void HWNewNet::cmdTeamAccepted(const NetMessage & msg)
+{
+    if (msg.size() != 2)
+    {
+        qWarning("Net: Bad TEAM_ACCEPTED message");
+        return;
     }
+    emit TeamAccepted(msg.string(1));
+}
 
-    qWarning() << "Net: Unknown message or wrong state:" << lst;
+void HWNewNet::cmdCfg(const NetMessage & msg)
+{
+    if(msg.size() < 3)
+    {
+        qWarning("Net: Bad CFG message");
+        return;
+    }
+    if (msg.equals(1, "SCHEME"))
+        emit netSchemeConfig(msg.strings(2));
+    else
+        emit paramChanged(msg.string(1), msg.strings(2));
+}
+
+void HWNewNet::cmdHedgehogsNum(const NetMessage & msg)
+{
+    if (msg.size() != 3)
+    {
+        qWarning("Net: Bad HH_NUM message");
+        return;
+    }
+    HWTeam tmptm(msg.string(1));
+    tmptm.setNumHedgehogs(msg.toInt(2));
+    emit hhnumChanged(tmptm);
+}
+
+void HWNewNet::cmdTeamColor(const NetMessage & msg)
+{
+    if (msg.size() != 3)
+    {
+        qWarning("Net: Bad TEAM_COLOR message");
+        return;
+    }
+    HWTeam tmptm(msg.string(1));
+    tmptm.setColor(msg.toInt(2));
+    emit teamColorChanged(tmptm);
+}
+
+void HWNewNet::cmdLeft(const NetMessage & msg)
+{
+    if(msg.size() < 2)
+    {
+        qWarning("Net: Bad LEFT message");
+        return;
+    }
+
+    QString nick = msg.string(1);
+    if (msg.size() < 3)
+        emit chatStringFromNet(tr("%1 *** %2 has left").arg('\x03').arg(nick));
+    else
+        emit chatStringFromNet(tr("%1 *** %2 has left (%3)").arg('\x03').arg(nick, msg.string(2)));
+    m_playersModel->playerLeftRoom(nick);
 }
 
 void HWNewNet::onHedgehogsNumChanged(const HWTeam& team)
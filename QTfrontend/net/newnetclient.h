@@ -24,9 +24,11 @@
 #include <QString>
 #include <QTcpSocket>
 #include <QMap>
+#include <QHash>
 
 #include "team.h"
 #include "game.h" // for GameState
+#include "NetMessageBuffer.h"
 
 class GameUIConfig;
 class GameCFGWidget;
@@ -82,14 +84,62 @@ class HWNewNet : public QObject
         QString m_clientSalt;
         QString m_serverHash;
 
-        QStringList cmdbuf;
+        NetMessageBuffer m_buffer;
+        NetMessage m_message;
+        bool m_reading;
+        bool m_compactEM; // the server agreed to EMR engine messages
+
+        typedef void (HWNewNet::*CommandHandler)(const NetMessage & msg);
+        struct Command
+        {
+            CommandHandler handler;
+            bool roomOnly; // only valid in InRoom or InGame state
+        };
+        static const QHash<QLatin1String, Command> & commands();
 
         int  ByteLength(const QString & str);
         void RawSendNet(const QString & buf);
         void RawSendNet(const QByteArray & buf);
-        void ParseCmd(const QStringList & lst);
+        void ParseCmd(const NetMessage & msg);
+        void unknownCmd(const NetMessage & msg);
         void handleNotice(int n);
 
+        void cmdNick(const NetMessage & msg);
+        void cmdProto(const NetMessage & msg);
+        void cmdError(const NetMessage & msg);
+        void cmdWarning(const NetMessage & msg);
+        void cmdConnected(const NetMessage & msg);
+        void cmdServerAuth(const NetMessage & msg);
+        void cmdPing(const NetMessage & msg);
+        void cmdRooms(const NetMessage & msg);
+        void cmdServerMessage(const NetMessage & msg);
+        void cmdChat(const NetMessage & msg);
+        void cmdInfo(const NetMessage & msg);
+        void cmdServerVars(const NetMessage & msg);
+        void cmdBanList(const NetMessage & msg);
+        void cmdClientFlags(const NetMessage & msg);
+        void cmdKicked(const NetMessage & msg);
+        void cmdLobbyJoined(const NetMessage & msg);
+        void cmdRoom(const NetMessage & msg);
+        void cmdLobbyLeft(const NetMessage & msg);
+        void cmdAskPassword(const NetMessage & msg);
+        void cmdNotice(const NetMessage & msg);
+        void cmdBye(const NetMessage & msg);
+        void cmdJoining(const NetMessage & msg);
+        void cmdJoined(const NetMessage & msg);
+        void cmdEngineMessage(const NetMessage & msg);
+        void cmdEngineMessageRaw(const NetMessage & msg);
+        void cmdRoundFinished(const NetMessage & msg);
+        void cmdAddTeam(const NetMessage & msg);
+        void cmdRemoveTeam(const NetMessage & msg);
+        void cmdRoomAbandoned(const NetMessage & msg);
+        void cmdRunGame(const NetMessage & msg);
+        void cmdTeamAccepted(const NetMessage & msg);
+        void cmdCfg(const NetMessage & msg);
+        void cmdHedgehogsNum(const NetMessage & msg);
+        void cmdTeamColor(const NetMessage & msg);
+        void cmdLeft(const NetMessage & msg);
+
         void maybeSendPassword();
 
         ClientState netClientState;
@@ -141,8 +191,6 @@ class HWNewNet : public QObject
 
         void setMyReadyStatus(bool isReady);
 
-        void messageProcessed();
-
     public slots:
         void ToggleReady();
         void chatLineToNet(const QString& str);
@@ -0,0 +1,173 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QApplication>
+#include <QtEndian>
+
+#include "previewengine.h"
+#include "hwmap.h"
+#include "hwconsts.h"
+
+QPointer<HWPreviewEngine> HWPreviewEngine::m_instance(0);
+bool HWPreviewEngine::m_disabled = false;
+
+HWPreviewEngine * HWPreviewEngine::instance()
+{
+#ifdef HWLIBRARY
+    // the engine library can't keep an instance running next to games
+    return 0;
+#else
+    if(m_disabled)
+        return 0;
+
+    if(!m_instance)
+    {
+        m_instance = new HWPreviewEngine(qApp);
+        m_instance->Start(false);
+    }
+
+    return m_instance;
+#endif
+}
+
+HWPreviewEngine::HWPreviewEngine(QObject * parent) :
+    TCPBase(false, parent),
+    m_busy(false),
+    m_served(0)
+{
+}
+
+void HWPreviewEngine::requestPreview(HWMap * map)
+{
+    if(map->isPrefetch())
+    {
+        m_queue.append(map);
+    }
+    else
+    {
+        // requests of the same owner which haven't been sent yet are outdated now,
+        // prefetches are left alone, they go after real requests anyway
+        QList<QPointer<HWMap> >::iterator i = m_queue.begin();
+        while(i != m_queue.end())
+        {
+            if(!*i || (!(*i)->isPrefetch() && ((*i)->parent() == map->parent())))
+            {
+                if(*i)
+                    (*i)->deleteLater();
+                i = m_queue.erase(i);
+            }
+            else
+                ++i;
+        }
+
+        int pos = 0;
+        while((pos < m_queue.size()) && !m_queue[pos]->isPrefetch())
+            ++pos;
+
+        m_queue.insert(pos, map);
+    }
+
+    if(isConnected() && !m_busy)
+        sendNext();
+}
+
+void HWPreviewEngine::sendNext()
+{
+    while(!m_queue.isEmpty() && !m_queue.first())
+        m_queue.removeFirst();
+
+    if(m_queue.isEmpty())
+        return;
+
+    m_current = m_queue.takeFirst();
+    m_busy = true;
+
+    RawSendIPC(m_current->previewRequest());
+}
+
+void HWPreviewEngine::onClientRead()
+{
+    while(readbuffer.size() >= 4)
+    {
+        quint32 size = qFromBigEndian<quint32>((const uchar *)readbuffer.constData());
+        if((quint32)readbuffer.size() < size + 4)
+            return;
+
+        QByteArray data = readbuffer.mid(4, size);
+        readbuffer.remove(0, size + 4);
+
+        ++m_served;
+        m_busy = false;
+
+        // owner could have lost interest in the meantime
+        if(m_current)
+        {
+            m_current->setPreviewData(data);
+            m_current->deleteLater();
+            m_current = 0;
+        }
+
+        sendNext();
+    }
+}
+
+void HWPreviewEngine::onClientDisconnect()
+{
+    // an engine which never delivered anything is unlikely to do better next time
+    if(m_served == 0)
+        m_disabled = true;
+
+    if(m_current)
+        m_queue.prepend(m_current);
+
+    foreach(QPointer<HWMap> map, m_queue)
+        if(map)
+            map->runEngine();
+
+    m_queue.clear();
+    m_current = 0;
+}
+
+void HWPreviewEngine::SendToClientFirst()
+{
+    sendNext();
+}
+
+QStringList HWPreviewEngine::getArguments()
+{
+    QStringList arguments;
+    arguments << "--internal";
+    arguments << ipcArguments();
+    arguments << "--user-prefix";
+    arguments << cfgdir->absolutePath();
+    arguments << "--prefix";
+    arguments << datadir->absolutePath();
+    arguments << "--landpreview-server";
+    return arguments;
+}
+
+bool HWPreviewEngine::simultaneousRun()
+{
+    // it stays forever, don't hold a worker
+    return true;
+}
+
+EngineJobType HWPreviewEngine::jobType()
+{
+    return ejtPreview;
+}
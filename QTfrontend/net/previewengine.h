@@ -0,0 +1,71 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _PREVIEWENGINE_INCLUDED
+#define _PREVIEWENGINE_INCLUDED
+
+#include <QList>
+#include <QPointer>
+
+#include "tcpBase.h"
+
+class HWMap;
+
+/**
+ * @brief Long-living engine instance (--landpreview-server) which renders
+ * map previews one after another over a single IPC connection.
+ *
+ * If the engine goes away, requests still waiting for it fall back to a
+ * one-shot engine run each.
+ */
+class HWPreviewEngine : public TCPBase
+{
+        Q_OBJECT
+
+    public:
+        /**
+         * @brief Returns the running preview engine, starting it if needed.
+         * @return engine instance or 0 if previews have to be generated by one-shot engines.
+         */
+        static HWPreviewEngine * instance();
+
+        void requestPreview(HWMap * map);
+        bool simultaneousRun();
+        EngineJobType jobType();
+
+    protected:
+        virtual QStringList getArguments();
+        virtual void onClientRead();
+        virtual void onClientDisconnect();
+        virtual void SendToClientFirst();
+
+    private:
+        HWPreviewEngine(QObject * parent);
+
+        static QPointer<HWPreviewEngine> m_instance;
+        static bool m_disabled;
+
+        QList<QPointer<HWMap> > m_queue;
+        QPointer<HWMap> m_current;
+        bool m_busy;
+        int m_served;
+
+        void sendNext();
+};
+
+#endif // _PREVIEWENGINE_INCLUDED
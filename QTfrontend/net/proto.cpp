@@ -16,7 +16,10 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <QtEndian>
+
 #include "proto.h"
+#include "IPCFrameBuffer.h"
 
 HWProto::HWProto()
 {
@@ -26,13 +29,33 @@ HWProto::HWProto()
 QByteArray & HWProto::addByteArrayToBuffer(QByteArray & buf, const QByteArray & msg)
 {
     QByteArray bmsg = msg;
-    bmsg = bmsg.left(250);
+    bmsg = bmsg.left(IPC_MAX_FRAME_PAYLOAD);
     quint8 sz = bmsg.size();
     buf.append(QByteArray((char *)&sz, 1));
     buf.append(bmsg);
     return buf;
 }
 
+QByteArray & HWProto::addExtendedByteArrayToBuffer(QByteArray & buf, const QByteArray & msg)
+{
+    // an empty payload goes into an extended frame too, a length byte of 0
+    // would be read as the start of one
+    if ((msg.size() > 0) && (msg.size() <= IPC_MAX_FRAME_PAYLOAD))
+    {
+        quint8 sz = msg.size();
+        buf.append(QByteArray((char *)&sz, 1));
+    }
+    else
+    {
+        // zero length byte, version and big endian 32-bit length
+        char header[IPC_EXTENDED_HEADER] = {0, IPC_EXTENDED_VERSION};
+        qToBigEndian<quint32>(msg.size(), (uchar *)header + 2);
+        buf.append(header, IPC_EXTENDED_HEADER);
+    }
+    buf.append(msg);
+    return buf;
+}
+
 QByteArray & HWProto::addStringToBuffer(QByteArray & buf, const QString & string)
 {
     return addByteArrayToBuffer(buf, string.toUtf8());
@@ -45,6 +68,47 @@ QByteArray & HWProto::addStringListToBuffer(QByteArray & buf, const QStringList
     return buf;
 }
 
+QByteArray HWProto::escapeEngineMessages(const QByteArray & msg)
+{
+    QByteArray buf;
+    buf.reserve(msg.size() + msg.size() / 16);
+
+    for (int i = 0; i < msg.size(); i++)
+    {
+        char c = msg.at(i);
+        if (c == '\n')
+            buf.append("\\n", 2);
+        else if (c == '\\')
+            buf.append("\\\\", 2);
+        else
+            buf.append(c);
+    }
+
+    return buf;
+}
+
+bool HWProto::unescapeEngineMessages(const char * data, int size, QByteArray & msg)
+{
+    msg.clear();
+    msg.reserve(size);
+
+    for (int i = 0; i < size; i++)
+    {
+        if (data[i] != '\\')
+            msg.append(data[i]);
+        else if (i + 1 == size)
+            return false;
+        else if (data[++i] == 'n')
+            msg.append('\n');
+        else if (data[i] == '\\')
+            msg.append('\\');
+        else
+            return false;
+    }
+
+    return true;
+}
+
 QString HWProto::formatChatMsg(const QString & nick, const QString & msg)
 {
     if(msg.left(4) == "/me ")
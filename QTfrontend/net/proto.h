@@ -32,7 +32,31 @@ class HWProto : public QObject
         HWProto();
         static QByteArray & addStringToBuffer(QByteArray & buf, const QString & string);
         static QByteArray & addByteArrayToBuffer(QByteArray & buf, const QByteArray & msg);
+        /**
+         * @brief Appends msg as a single frame, using an extended frame if it doesn't fit into a normal one.
+         * @param buf buffer to append to
+         * @param msg message of any size, it is never truncated
+         * @return buf
+         */
+        static QByteArray & addExtendedByteArrayToBuffer(QByteArray & buf, const QByteArray & msg);
         static QByteArray & addStringListToBuffer(QByteArray & buf, const QStringList & strList);
+        /**
+         * @brief Encodes engine messages for the EMR net command.
+         *
+         * The messages are kept as they are, except that newlines and backslashes
+         * are escaped by a backslash, so they can't end a field of the net message.
+         * @param msg engine messages
+         * @return the encoded messages
+         */
+        static QByteArray escapeEngineMessages(const QByteArray & msg);
+        /**
+         * @brief Decodes engine messages encoded by escapeEngineMessages.
+         * @param data field of an EMR net message
+         * @param size length of the field
+         * @param msg decoded engine messages
+         * @return false if the field contains an invalid escape sequence
+         */
+        static bool unescapeEngineMessages(const char * data, int size, QByteArray & msg);
         static QString formatChatMsg(const QString & nick, const QString & msg);
         static QString formatChatMsgForFrontend(const QString & msg);
         /**
@@ -18,19 +18,15 @@
 
 #include <QString>
 #include <QByteArray>
+#include <QFile>
 
 #include "recorder.h"
+#include "recorderscheduler.h"
 #include "gameuiconfig.h"
 #include "hwconsts.h"
 #include "game.h"
 #include "LibavInteraction.h"
-
-// Encoding is memory expensive process, so we need to limit maximum number
-// of simultaneous encoders.
-static const int maxRecorders = 3;
-static int numRecorders = 0;
-
-static QList<HWRecorder*> queue;
+#include "DemoContainer.h"
 
 HWRecorder::HWRecorder(GameUIConfig * config, const QString &prefix) :
     TCPBase(false)
@@ -39,39 +35,48 @@ HWRecorder::HWRecorder(GameUIConfig * config, const QString &prefix) :
     this->prefix = prefix;
     item = 0;
     finished = false;
+    priority = 0;
+    paused = false;
+    started = false;
+    framesSinceUpdate = 0;
+    progressAtUpdate = 0;
+    m_fps = 0;
+    m_eta = -1;
     name = prefix + "." + LibavInteraction::instance().getExtension(config->AVFormat());
 }
 
 HWRecorder::~HWRecorder()
 {
     emit encodingFinished(finished);
-    if (queue.empty())
-        numRecorders--;
-    else
-        queue.takeFirst()->Start(false);
+    RecorderScheduler::instance().remove(this);
 }
 
 void HWRecorder::onClientDisconnect()
 {
 }
 
+bool HWRecorder::framedIPC()
+{
+    return true;
+}
+
 void HWRecorder::onClientRead()
 {
-    quint8 msglen;
-    quint32 bufsize;
-    while (!readbuffer.isEmpty() && ((bufsize = readbuffer.size()) > 0) &&
-            ((msglen = readbuffer.data()[0]) < bufsize))
+    QByteArray msg;
+    while (nextFrame(msg))
     {
-        QByteArray msg = readbuffer.left(msglen + 1);
-        readbuffer.remove(0, msglen + 1);
         switch (msg.at(1))
         {
         case '?':
             SendIPC("!");
             break;
         case 'p':
-            emit onProgress((quint8(msg.at(2))*256.0 + quint8(msg.at(3)))*0.0001);
+        {
+            float progress = (quint8(msg.at(2))*256.0 + quint8(msg.at(3)))*0.0001;
+            updateSpeed(progress);
+            emit onProgress(progress);
             break;
+        }
         case 'v':
             finished = true;
             break;
@@ -87,13 +92,75 @@ void HWRecorder::EncodeVideo(const QByteArray & record)
     toSendBuf.replace(QByteArray("\x02TN"), QByteArray("\x02TV"));
     toSendBuf.replace(QByteArray("\x02TS"), QByteArray("\x02TV"));
 
-    if (numRecorders < maxRecorders)
+    // keep the record next to the camera positions, so the job can be
+    // encoded again if the frontend is closed before it is finished
+    QFile demofile(cfgdir->absoluteFilePath("VideoTemp/" + prefix + ".hwd"));
+    if (!demofile.exists() && demofile.open(QIODevice::WriteOnly))
+        demofile.write(DemoContainer::pack(record));
+
+    RecorderScheduler::instance().enqueue(this);
+}
+
+void HWRecorder::startEncoding()
+{
+    started = true;
+    Start(false); // run engine
+    if (paused)
+        SendIPC("erecpause on");
+}
+
+void HWRecorder::setPaused(bool paused)
+{
+    this->paused = paused;
+    if (!started)
+        return;
+
+    // the engine keeps its state, encoding continues where it stopped
+    SendIPC(paused ? "erecpause on" : "erecpause off");
+    speedTimer.invalidate(); // measure again from the next frame
+    m_fps = 0;
+    m_eta = -1;
+}
+
+void HWRecorder::updateSpeed(float progress)
+{
+    // the engine takes a while to load, so start measuring at the first frame
+    if (!speedTimer.isValid())
     {
-        numRecorders++;
-        Start(false); // run engine
+        speedTimer.start();
+        framesSinceUpdate = 0;
+        progressAtUpdate = progress;
+        return;
     }
-    else
-        queue.push_back(this);
+
+    framesSinceUpdate++;
+
+    qint64 elapsed = speedTimer.elapsed();
+    if (elapsed < 1000)
+        return;
+
+    m_fps = framesSinceUpdate * 1000.0 / elapsed;
+    float rate = (progress - progressAtUpdate) * 1000 / elapsed; // progress per second
+    m_eta = rate > 0 ? int((1 - progress) / rate) : -1;
+
+    framesSinceUpdate = 0;
+    progressAtUpdate = progress;
+    speedTimer.restart();
+}
+
+float HWRecorder::fps() const
+{
+    return m_fps;
+}
+
+int HWRecorder::eta() const
+{
+    return m_eta;
+}
+
+QSize HWRecorder::resolution() const
+{
+    return config->rec_Resolution().size();
 }
 
 QStringList HWRecorder::getArguments()
@@ -103,8 +170,7 @@ QStringList HWRecorder::getArguments()
     QString nick = config->netNick().toUtf8().toBase64();
 
     arguments << "--internal";
-    arguments << "--port";
-    arguments << QString("%1").arg(ipc_port);
+    arguments << ipcArguments();
     arguments << "--prefix";
     arguments << datadir->absolutePath();
     arguments << "--user-prefix";
@@ -149,3 +215,8 @@ bool HWRecorder::simultaneousRun()
 {
     return true;
 }
+
+EngineJobType HWRecorder::jobType()
+{
+    return ejtRecorder;
+}
@@ -21,6 +21,8 @@
 
 #include <QString>
 #include <QByteArray>
+#include <QElapsedTimer>
+#include <QSize>
 
 #include "tcpBase.h"
 
@@ -36,14 +38,28 @@ class HWRecorder : public TCPBase
 
         void EncodeVideo(const QByteArray & record);
         bool simultaneousRun();
+        EngineJobType jobType();
+
+        // called by RecorderScheduler
+        void startEncoding();
+        void setPaused(bool paused);
+
+        float fps() const; // encoded frames per second, 0 if unknown
+        int eta() const; // seconds until finished, -1 if unknown
+        QSize resolution() const;
 
         VideoItem * item; // used by pagevideos
         QString name;
         QString prefix;
+        QString targetName; // name in Videos directory chosen by user, empty for default
+        int priority; // higher is encoded first
+        bool paused;
+        bool started;
 
     protected:
         // virtuals from TCPBase
         virtual QStringList getArguments();
+        virtual bool framedIPC();
         virtual void onClientRead();
         virtual void onClientDisconnect();
 
@@ -54,6 +70,15 @@ class HWRecorder : public TCPBase
     private:
         bool finished;
         GameUIConfig * config;
+
+        // encoding speed, measured over the last second or so
+        QElapsedTimer speedTimer;
+        int framesSinceUpdate;
+        float progressAtUpdate;
+        float m_fps;
+        int m_eta;
+
+        void updateSpeed(float progress);
 };
 
 #endif // RECORDER_H
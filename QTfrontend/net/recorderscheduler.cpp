@@ -0,0 +1,245 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QThread>
+#include <QFile>
+#include <QSettings>
+
+#include "recorderscheduler.h"
+#include "recorder.h"
+#include "hwconsts.h"
+
+#ifdef Q_OS_WIN
+#ifndef WINVER
+#define WINVER 0x0500
+#endif
+#include <windows.h>
+#endif
+
+// physical memory which can be used without swapping, -1 if unknown
+static qint64 availableMemory()
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if(GlobalMemoryStatusEx(&status))
+        return status.ullAvailPhys;
+#elif defined(Q_OS_LINUX)
+    QFile meminfo("/proc/meminfo");
+    if(meminfo.open(QIODevice::ReadOnly))
+    {
+        // MemAvailable: 12345678 kB
+        while(!meminfo.atEnd())
+        {
+            QList<QByteArray> fields = meminfo.readLine().simplified().split(' ');
+            if((fields.size() >= 2) && (fields[0] == "MemAvailable:"))
+                return fields[1].toLongLong() * 1024;
+        }
+    }
+#endif
+    return -1;
+}
+
+static QString queueFileName()
+{
+    return cfgdir->absoluteFilePath("VideoTemp/queue.ini");
+}
+
+RecorderScheduler & RecorderScheduler::instance()
+{
+    static RecorderScheduler instance;
+    return instance;
+}
+
+RecorderScheduler::RecorderScheduler() :
+    QObject(0),
+    m_maxRecorders(0),
+    m_shutdown(false)
+{
+}
+
+void RecorderScheduler::setMaxRecorders(int recorders)
+{
+    m_maxRecorders = qMax(0, recorders);
+
+    schedule();
+}
+
+int RecorderScheduler::maxRecorders() const
+{
+    return m_maxRecorders;
+}
+
+int RecorderScheduler::automaticMaxRecorders(const QSize & resolution) const
+{
+    // every encoder converts and encodes frames in several threads already,
+    // more of them would only take turns on the same cores
+    int recorders = qBound(1, QThread::idealThreadCount() / 4, 4);
+
+    qint64 available = availableMemory();
+    if(available > 0)
+    {
+        // the engine itself, plus frames waiting for conversion and the
+        // reference frames of the codec
+        qint64 perRecorder = Q_INT64_C(160) * 1024 * 1024
+                           + qint64(resolution.width()) * resolution.height() * 48;
+
+        // running recorders have taken their memory already, leave half of
+        // the rest for everything else
+        recorders = qMin(recorders, m_running.size() + int(available / 2 / perRecorder));
+    }
+
+    return qMax(1, recorders);
+}
+
+void RecorderScheduler::enqueue(HWRecorder * recorder)
+{
+    m_pending.append(recorder);
+    save();
+
+    schedule();
+}
+
+// finished or not, the job leaves the queue: a failed one would only fail
+// again, its files are dealt with by the videos page
+void RecorderScheduler::remove(HWRecorder * recorder)
+{
+    bool wasRunning = m_running.removeOne(recorder);
+    m_pending.removeOne(recorder);
+
+    if(m_shutdown)
+        return;
+
+    save();
+
+    if(wasRunning)
+        schedule();
+}
+
+void RecorderScheduler::cancel(HWRecorder * recorder)
+{
+    // the destructor takes it off the lists
+    recorder->deleteLater();
+}
+
+void RecorderScheduler::setPaused(HWRecorder * recorder, bool paused)
+{
+    if(recorder->paused == paused)
+        return;
+
+    // a paused engine keeps its memory, so it keeps its place as well
+    recorder->setPaused(paused);
+    save();
+    emit stateChanged(recorder);
+
+    schedule();
+}
+
+void RecorderScheduler::encodeFirst(HWRecorder * recorder)
+{
+    int priority = recorder->priority;
+    foreach(HWRecorder * other, m_pending + m_running)
+        if(other != recorder)
+            priority = qMax(priority, other->priority + 1);
+
+    recorder->priority = priority;
+    save();
+    emit stateChanged(recorder);
+}
+
+void RecorderScheduler::setTargetName(HWRecorder * recorder, const QString & name)
+{
+    recorder->targetName = name;
+    save();
+}
+
+bool RecorderScheduler::isRunning(HWRecorder * recorder) const
+{
+    return m_running.contains(recorder);
+}
+
+void RecorderScheduler::schedule()
+{
+    while(!m_pending.isEmpty())
+    {
+        // highest priority first, in order of arrival otherwise
+        HWRecorder * next = 0;
+        foreach(HWRecorder * recorder, m_pending)
+            if(!recorder->paused && (!next || (recorder->priority > next->priority)))
+                next = recorder;
+
+        if(!next)
+            break;
+
+        int limit = m_maxRecorders ? m_maxRecorders : automaticMaxRecorders(next->resolution());
+        if(m_running.size() >= limit)
+            break;
+
+        m_pending.removeOne(next);
+        m_running.append(next);
+        next->startEncoding();
+        emit stateChanged(next);
+    }
+}
+
+void RecorderScheduler::save() const
+{
+    QSettings queue(queueFileName(), QSettings::IniFormat);
+    queue.remove("jobs");
+
+    // running jobs go first, they will be started first again
+    QList<HWRecorder *> jobs = m_running + m_pending;
+    queue.beginWriteArray("jobs", jobs.size());
+    for(int i = 0; i < jobs.size(); ++i)
+    {
+        queue.setArrayIndex(i);
+        queue.setValue("prefix", jobs[i]->prefix);
+        queue.setValue("name", jobs[i]->targetName);
+        queue.setValue("priority", jobs[i]->priority);
+        queue.setValue("paused", jobs[i]->paused);
+    }
+    queue.endArray();
+}
+
+QList<RecorderJob> RecorderScheduler::savedJobs() const
+{
+    QList<RecorderJob> jobs;
+    QSettings queue(queueFileName(), QSettings::IniFormat);
+
+    int size = queue.beginReadArray("jobs");
+    for(int i = 0; i < size; ++i)
+    {
+        queue.setArrayIndex(i);
+        RecorderJob job;
+        job.prefix = queue.value("prefix").toString();
+        job.targetName = queue.value("name").toString();
+        job.priority = queue.value("priority", 0).toInt();
+        job.paused = queue.value("paused", false).toBool();
+        if(!job.prefix.isEmpty())
+            jobs.append(job);
+    }
+    queue.endArray();
+
+    return jobs;
+}
+
+void RecorderScheduler::shutdown()
+{
+    save();
+    m_shutdown = true;
+}
@@ -0,0 +1,89 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _RECORDERSCHEDULER_INCLUDED
+#define _RECORDERSCHEDULER_INCLUDED
+
+#include <QObject>
+#include <QList>
+#include <QSize>
+#include <QString>
+
+class HWRecorder;
+
+// pending video as stored in VideoTemp/queue.ini
+struct RecorderJob
+{
+    QString prefix;
+    QString targetName;
+    int priority;
+    bool paused;
+};
+
+/**
+ * @brief Decides which video recorders run, and in which order.
+ *
+ * The number of simultaneous encoders follows the number of cores and the
+ * memory which is available, waiting recorders are started by priority.
+ * Unfinished jobs are kept in VideoTemp/queue.ini so they can be encoded
+ * again after a restart of the frontend.
+ */
+class RecorderScheduler : public QObject
+{
+        Q_OBJECT
+
+    public:
+        static RecorderScheduler & instance();
+
+        void setMaxRecorders(int recorders); // 0 to size from cores and memory
+        int maxRecorders() const;
+
+        void enqueue(HWRecorder * recorder);
+        void remove(HWRecorder * recorder); // called when recorder is deleted
+
+        void cancel(HWRecorder * recorder);
+        void setPaused(HWRecorder * recorder, bool paused);
+        void encodeFirst(HWRecorder * recorder);
+        void setTargetName(HWRecorder * recorder, const QString & name);
+
+        bool isRunning(HWRecorder * recorder) const;
+
+        // jobs which were not finished when the frontend was closed
+        QList<RecorderJob> savedJobs() const;
+
+        // keeps the saved jobs as they are, recorders deleted from now on
+        // are interrupted rather than finished
+        void shutdown();
+
+    signals:
+        void stateChanged(HWRecorder * recorder);
+
+    private:
+        RecorderScheduler();
+
+        int m_maxRecorders;
+        bool m_shutdown;
+        QList<HWRecorder *> m_pending;
+        QList<HWRecorder *> m_running;
+
+        void schedule();
+        void save() const;
+        int automaticMaxRecorders(const QSize & resolution) const;
+};
+
+#endif // _RECORDERSCHEDULER_INCLUDED
@@ -21,10 +21,16 @@
 #include <QImage>
 #include <QThread>
 #include <QApplication>
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
 
 #include "tcpBase.h"
 #include "hwconsts.h"
 #include "MessageDialog.h"
+#include "proto.h"
+#include "PreviewCache.h"
 
 #ifdef HWLIBRARY
 extern "C" {
@@ -74,8 +80,13 @@ void EngineInstance::start()
 
 #endif
 
-QList<TCPBase*> srvsList;
-QPointer<QTcpServer> TCPBase::IPCServer(0);
+#ifdef LOCAL_IPC
+bool TCPBase::m_localIPC = true;
+#else
+bool TCPBase::m_localIPC = false;
+#endif
+
+QString TCPBase::m_statsPath;
 
 TCPBase::~TCPBase()
 {
@@ -96,8 +107,8 @@ TCPBase::~TCPBase()
 #endif
         }
     }
-    // make sure this object is not in the server list anymore
-    srvsList.removeOne(this);
+    // make sure this object is not scheduled anymore
+    EngineJobPool::instance().remove(this);
 
     if (IPCSocket)
         IPCSocket->deleteLater();
@@ -109,19 +120,40 @@ TCPBase::TCPBase(bool demoMode, QObject *parent) :
     m_hasStarted(false),
     m_isDemoMode(demoMode),
     m_connected(false),
-    IPCSocket(0)
+    IPCSocket(0),
+    m_recordStream(false)
 {
     process = 0;
 
-    if(!IPCServer)
+    ipc_port = 0;
+
+    // every job gets its own server, so that engines running in parallel
+    // can't pick up each other's connection
+    if(m_localIPC)
     {
-        IPCServer = new QTcpServer(0);
-        IPCServer->setMaxPendingConnections(1);
-        if (!IPCServer->listen(QHostAddress::LocalHost))
+        static QAtomicInt serverNumber(0);
+        QString name = QString("hedgewars-%1-%2").arg(QCoreApplication::applicationPid()).arg(serverNumber.fetchAndAddRelaxed(1));
+
+        IPCLocalServer = new QLocalServer(this);
+        IPCLocalServer->setMaxPendingConnections(1);
+        QLocalServer::removeServer(name);
+        if (IPCLocalServer->listen(name))
         {
-            MessageDialog::ShowFatalMessage(tr("Unable to start server at %1.").arg(IPCServer->errorString()));
-            exit(0); // FIXME - should be graceful exit here (lower Critical -> Warning above when implemented)
+            ipc_path = IPCLocalServer->fullServerName();
+            return;
         }
+
+        // fall back to tcp
+        qWarning("Unable to start local IPC server: %s", qPrintable(IPCLocalServer->errorString()));
+        delete IPCLocalServer;
+    }
+
+    IPCServer = new QTcpServer(this);
+    IPCServer->setMaxPendingConnections(1);
+    if (!IPCServer->listen(QHostAddress::LocalHost))
+    {
+        MessageDialog::ShowFatalMessage(tr("Unable to start server at %1.").arg(IPCServer->errorString()));
+        exit(0); // FIXME - should be graceful exit here (lower Critical -> Warning above when implemented)
     }
 
     ipc_port=IPCServer->serverPort();
@@ -135,27 +167,43 @@ void TCPBase::NewConnection()
         return;
     }
 
-    disconnect(IPCServer, SIGNAL(newConnection()), this, SLOT(NewConnection()));
-    IPCSocket = IPCServer->nextPendingConnection();
+    if(IPCLocalServer)
+    {
+        disconnect(IPCLocalServer, SIGNAL(newConnection()), this, SLOT(NewConnection()));
+        IPCSocket = IPCLocalServer->nextPendingConnection();
+    }
+    else
+    {
+        disconnect(IPCServer, SIGNAL(newConnection()), this, SLOT(NewConnection()));
+        IPCSocket = IPCServer->nextPendingConnection();
+    }
 
     if(!IPCSocket) return;
 
     m_connected = true;
+    m_stats.markConnected();
 
     connect(IPCSocket, SIGNAL(disconnected()), this, SLOT(ClientDisconnect()));
     connect(IPCSocket, SIGNAL(readyRead()), this, SLOT(ClientRead()));
     SendToClientFirst();
 
-    if(simultaneousRun())
+    if(m_streamSource)
     {
-        srvsList.removeOne(this);
-        emit isReadyNow();
+        connect(IPCSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(streamMore()));
+        RawSendIPC(QByteArray());
+        streamMore();
     }
+
+    if(simultaneousRun())
+        emit isReadyNow();
 }
 
 void TCPBase::RealStart()
 {
-    connect(IPCServer, SIGNAL(newConnection()), this, SLOT(NewConnection()));
+    if(IPCLocalServer)
+        connect(IPCLocalServer, SIGNAL(newConnection()), this, SLOT(NewConnection()));
+    else
+        connect(IPCServer, SIGNAL(newConnection()), this, SLOT(NewConnection()));
     IPCSocket = 0;
 
 #ifdef HWLIBRARY
@@ -186,11 +234,13 @@ void TCPBase::RealStart()
     process->start(bindir->absolutePath() + "/hwengine", arguments);
 #endif
     m_hasStarted = true;
+    m_stats.markProcessStarted();
 }
 
 void TCPBase::ClientDisconnect()
 {
     onClientDisconnect();
+    saveStats();
 
     if(!simultaneousRun())
     {
@@ -212,9 +262,17 @@ void TCPBase::ClientDisconnect()
 
 void TCPBase::ClientRead()
 {
-    QByteArray read = IPCSocket->readAll();
-    if(read.isEmpty()) return;
-    readbuffer.append(read);
+    if(framedIPC())
+    {
+        if(frames.readFrom(IPCSocket) == 0) return;
+    }
+    else
+    {
+        QByteArray read = IPCSocket->readAll();
+        if(read.isEmpty()) return;
+        readbuffer.append(read);
+        m_stats.recordRawIncoming(read.size());
+    }
     onClientRead();
 }
 
@@ -249,37 +307,10 @@ void TCPBase::onEngineDeath(int exitCode, QProcess::ExitStatus exitStatus)
     }
 }
 
-void TCPBase::tcpServerReady()
-{
-    disconnect(srvsList.first(), SIGNAL(isReadyNow()), this, SLOT(tcpServerReady()));
-
-    RealStart();
-}
-
 void TCPBase::Start(bool couldCancelPreviousRequest)
 {
-    if(srvsList.isEmpty())
-    {
-        srvsList.push_back(this);
-        RealStart();
-    }
-    else
-    {
-        TCPBase * last = srvsList.last();
-        if(couldCancelPreviousRequest
-            && last->couldBeRemoved()
-            && (last->isConnected() || !last->hasStarted())
-            && (last->parent() == parent()))
-        {
-            srvsList.removeLast();
-            delete last;
-            Start(couldCancelPreviousRequest);
-        } else
-        {
-            connect(last, SIGNAL(isReadyNow()), this, SLOT(tcpServerReady()));
-            srvsList.push_back(this);
-        }
-    }
+    m_stats.markStarted();
+    EngineJobPool::instance().enqueue(this, couldCancelPreviousRequest);
 }
 
 void TCPBase::onClientRead()
@@ -296,9 +327,8 @@ void TCPBase::SendToClientFirst()
 
 void TCPBase::SendIPC(const QByteArray & buf)
 {
-    if (buf.size() > MAXMSGCHARS) return;
-    quint8 len = buf.size();
-    RawSendIPC(QByteArray::fromRawData((char *)&len, 1) + buf);
+    QByteArray frame;
+    RawSendIPC(HWProto::addExtendedByteArrayToBuffer(frame, buf));
 }
 
 void TCPBase::RawSendIPC(const QByteArray & buf)
@@ -312,17 +342,70 @@ void TCPBase::RawSendIPC(const QByteArray & buf)
         if (toSendBuf.size() > 0)
         {
             IPCSocket->write(toSendBuf);
+            m_stats.recordOutgoing(toSendBuf);
             if(m_isDemoMode) demo.append(toSendBuf);
             toSendBuf.clear();
         }
         if(!buf.isEmpty())
         {
             IPCSocket->write(buf);
+            m_stats.recordOutgoing(buf);
             if(m_isDemoMode) demo.append(buf);
         }
     }
 }
 
+void TCPBase::setStreamSource(QIODevice * source, bool record)
+{
+    source->setParent(this);
+    m_streamSource = source;
+    m_recordStream = record;
+    m_streamCarry.clear();
+}
+
+void TCPBase::streamMore()
+{
+    // keep a limited amount in flight, refill as the engine reads
+    static const qint64 highWater = 64 * 1024;
+    static const qint64 chunkSize = 16 * 1024;
+
+    if(!IPCSocket || !m_streamSource)
+        return;
+
+    while(IPCSocket->bytesToWrite() < highWater)
+    {
+        QByteArray data = m_streamSource->read(chunkSize);
+        if(data.isEmpty() && !m_streamSource->atEnd())
+            return;
+
+        QByteArray chunk = m_streamCarry + data;
+
+        // only whole frames, so that RawSendIPC can't end up in the middle of one
+        int size = IPCFrameBuffer::completeFramesSize(chunk);
+        m_streamCarry = chunk.mid(size);
+        chunk.truncate(size);
+
+        if(!chunk.isEmpty())
+        {
+            IPCSocket->write(chunk);
+            m_stats.recordOutgoing(chunk);
+            if(m_isDemoMode && m_recordStream) demo.append(chunk);
+        }
+
+        if(m_streamSource->atEnd() && (chunk.isEmpty() || m_streamCarry.isEmpty()))
+        {
+            if(!m_streamCarry.isEmpty())
+                qWarning("Streamed IPC data ends with an incomplete frame");
+
+            disconnect(IPCSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(streamMore()));
+            m_streamSource->deleteLater();
+            m_streamSource = 0;
+            m_streamCarry.clear();
+            return;
+        }
+    }
+}
+
 bool TCPBase::couldBeRemoved()
 {
     return false;
@@ -338,6 +421,86 @@ bool TCPBase::simultaneousRun()
     return false;
 }
 
+QStringList TCPBase::ipcArguments()
+{
+    QStringList arguments;
+
+    if(IPCLocalServer)
+    {
+        arguments << "--ipc-socket";
+        arguments << ipc_path;
+    }
+    else
+    {
+        arguments << "--port";
+        arguments << QString("%1").arg(ipc_port);
+    }
+
+    return arguments;
+}
+
+void TCPBase::setLocalIPC(bool enabled)
+{
+    m_localIPC = enabled && localIPCSupported();
+}
+
+bool TCPBase::localIPCSupported()
+{
+#ifdef LOCAL_IPC
+    return true;
+#else
+    return false;
+#endif
+}
+
+EngineJobType TCPBase::jobType()
+{
+    return ejtGame;
+}
+
+bool TCPBase::framedIPC()
+{
+    return false;
+}
+
+bool TCPBase::nextFrame(QByteArray & msg)
+{
+    if(!frames.next(msg))
+        return false;
+
+    m_stats.recordIncoming(msg);
+    return true;
+}
+
+void TCPBase::setStatsPath(const QString & path)
+{
+    m_statsPath = path;
+}
+
+void TCPBase::saveStats()
+{
+    if(m_statsPath.isEmpty())
+        return;
+
+    static const char * jobNames[ejtCount] = {"preview", "game", "recorder", "prefetch"};
+    QString job = jobNames[jobType()];
+
+    QJsonObject stats = m_stats.toJson();
+    stats["job"] = job;
+    stats["pool"] = EngineJobPool::instance().toJson();
+    if((jobType() == ejtPreview) || (jobType() == ejtPrefetch))
+        stats["previewCache"] = PreviewCache::instance().toJson();
+
+    QFile file(QString("%1/%2-%3.json")
+               .arg(m_statsPath)
+               .arg(job)
+               .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss-zzz")));
+    if(file.open(QIODevice::WriteOnly))
+        file.write(QJsonDocument(stats).toJson());
+    else
+        qWarning("Unable to write IPC statistics to %s", qPrintable(file.fileName()));
+}
+
 bool TCPBase::hasStarted()
 {
     return m_hasStarted;
@@ -23,6 +23,8 @@
 #include <QObject>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
 #include <QByteArray>
 #include <QString>
 #include <QDir>
@@ -34,7 +36,9 @@
 
 #include <QImage>
 
-#define MAXMSGCHARS 255
+#include "enginejobpool.h"
+#include "IPCFrameBuffer.h"
+#include "IPCStats.h"
 
 class TCPBase : public QObject
 {
@@ -46,19 +50,37 @@ class TCPBase : public QObject
 
         virtual bool couldBeRemoved();
         virtual bool simultaneousRun();
+        virtual EngineJobType jobType();
+        // engine output is split into frames instead of collected in readbuffer
+        virtual bool framedIPC();
         bool isConnected();
         bool hasStarted();
 
+        // use unix domain sockets instead of tcp for engines started from now on
+        static void setLocalIPC(bool enabled);
+        static bool localIPCSupported();
+
+        // write IPC statistics of every engine run as json into path, empty disables it
+        static void setStatsPath(const QString & path);
+
     signals:
         void isReadyNow();
 
     protected:
         bool m_hasStarted;
         quint16 ipc_port;
+        QString ipc_path;
+
+        QStringList ipcArguments();
 
         void Start(bool couldCancelPreviousRequest);
 
         QByteArray readbuffer;
+        IPCFrameBuffer frames;
+        IPCStats m_stats;
+
+        // takes the next frame out of frames and accounts for it
+        bool nextFrame(QByteArray & msg);
 
         QByteArray toSendBuf;
         QByteArray demo;
@@ -66,13 +88,26 @@ class TCPBase : public QObject
         void SendIPC(const QByteArray & buf);
         void RawSendIPC(const QByteArray & buf);
 
+        // Sends the contents of source after toSendBuf, in chunks as the socket
+        // drains, instead of loading it into memory at once. Takes ownership.
+        // Streamed data is only appended to demo if record is set.
+        void setStreamSource(QIODevice * source, bool record);
+
         virtual QStringList getArguments()=0;
         virtual void onClientRead();
         virtual void onClientDisconnect();
         virtual void SendToClientFirst();
 
     private:
-        static QPointer<QTcpServer> IPCServer;
+        friend class EngineJobPool;
+
+        static bool m_localIPC;
+        static QString m_statsPath;
+
+        void saveStats();
+
+        QPointer<QTcpServer> IPCServer;
+        QPointer<QLocalServer> IPCLocalServer;
 #ifdef HWLIBRARY
         QThread * thread;
 #else
@@ -81,16 +116,18 @@ class TCPBase : public QObject
         bool m_isDemoMode;
         bool m_connected;
         void RealStart();
-        QPointer<QTcpSocket> IPCSocket;
+        QPointer<QIODevice> IPCSocket;
+        QPointer<QIODevice> m_streamSource;
+        QByteArray m_streamCarry; ///< incomplete frame at the end of the last chunk
+        bool m_recordStream;
 
     private slots:
         void NewConnection();
         void ClientDisconnect();
         void ClientRead();
+        void streamMore();
         void StartProcessError(QProcess::ProcessError error);
         void onEngineDeath(int exitCode, QProcess::ExitStatus exitStatus);
-
-        void tcpServerReady();
 };
 
 #ifdef HWLIBRARY
@@ -36,7 +36,7 @@ HWAskQuitDialog::HWAskQuitDialog(QWidget* parent, HWForm * form) : QDialog(paren
 
     QLabel * lbLabel = new QLabel(this);
     lbLabel->setText(QLabel::tr("There are videos that are currently being processed.\n"
-                                "Exiting now will abort them.\n"
+                                "Exiting now will interrupt them, they will be encoded again from the start next time.\n"
                                 "Do you really want to quit?"));
     layout->addWidget(lbLabel);
 
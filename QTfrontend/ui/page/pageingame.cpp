@@ -17,24 +17,82 @@
  */
 
 #include <QHBoxLayout>
+#include <QVBoxLayout>
 #include <QLabel>
+#include <QSlider>
+#include <QPushButton>
 
 #include "pageingame.h"
 
 QLayout * PageInGame::bodyLayoutDefinition()
 {
-    QHBoxLayout * pageLayout = new QHBoxLayout();
+    QVBoxLayout * pageLayout = new QVBoxLayout();
 
     QLabel * label = new QLabel(this);
     label->setText(tr("In game..."));
     pageLayout->addWidget(label);
 
+    // seeking in demos, the engine restores its nearest checkpoint
+    seekWidget = new QWidget(this);
+    QHBoxLayout * seekLayout = new QHBoxLayout(seekWidget);
+    seekLayout->setContentsMargins(0, 0, 0, 0);
+
+    seekSlider = new QSlider(Qt::Horizontal, seekWidget);
+    seekSlider->setRange(0, 0);
+    seekLayout->addWidget(seekSlider, 1);
+
+    lblSeekTime = new QLabel(seekWidget);
+    seekLayout->addWidget(lblSeekTime);
+
+    btnSeek = new QPushButton(tr("Seek"), seekWidget);
+    btnSeek->setWhatsThis(tr("Continue the demo at the selected time"));
+    seekLayout->addWidget(btnSeek);
+
+    pageLayout->addWidget(seekWidget);
+    seekWidget->hide();
+
     setBackButtonVisible(false);
 
     return pageLayout;
 }
 
+void PageInGame::connectSignals()
+{
+    connect(seekSlider, SIGNAL(valueChanged(int)), this, SLOT(updateSeekTime(int)));
+    connect(btnSeek, SIGNAL(clicked()), this, SLOT(seek()));
+}
+
 PageInGame::PageInGame(QWidget * parent) :  AbstractPage(parent)
 {
     initPage();
+    updateSeekTime(0);
+}
+
+void PageInGame::showSeekControl(quint32 length)
+{
+    seekSlider->setRange(0, length / 1000);
+    seekSlider->setValue(0);
+    seekWidget->show();
+}
+
+void PageInGame::hideSeekControl()
+{
+    seekWidget->hide();
+}
+
+void PageInGame::checkpointTaken(quint32 ticks)
+{
+    int seconds = ticks / 1000;
+    if (seconds > seekSlider->maximum())
+        seekSlider->setMaximum(seconds);
+}
+
+void PageInGame::updateSeekTime(int seconds)
+{
+    lblSeekTime->setText(QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0')));
+}
+
+void PageInGame::seek()
+{
+    emit seekRequested((quint32)seekSlider->value() * 1000);
 }
@@ -21,6 +21,10 @@
 
 #include "AbstractPage.h"
 
+class QLabel;
+class QSlider;
+class QPushButton;
+
 class PageInGame : public AbstractPage
 {
         Q_OBJECT
@@ -28,8 +32,33 @@ class PageInGame : public AbstractPage
     public:
         PageInGame(QWidget * parent = 0);
 
+        /**
+         * @brief Shows the seek control for a demo being played.
+         *
+         * @param length length of the demo in game ticks, 0 if it isn't known
+         * yet. The range grows with the checkpoints reported by the engine.
+         */
+        void showSeekControl(quint32 length);
+        void hideSeekControl();
+
+    signals:
+        void seekRequested(quint32 ticks);
+
+    public slots:
+        void checkpointTaken(quint32 ticks);
+
+    private:
         QLayout * bodyLayoutDefinition();
+        void connectSignals();
+
+        QWidget * seekWidget;
+        QSlider * seekSlider;
+        QLabel * lblSeekTime;
+        QPushButton * btnSeek;
+
+    private slots:
+        void updateSeekTime(int seconds);
+        void seek();
 };
 
 #endif
-
@@ -26,10 +26,15 @@
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QInputDialog>
+#include <QLabel>
+#include <QLineEdit>
+#include <QDateTime>
+#include <QSet>
 
 #include "hwconsts.h"
 
 #include "DataManager.h"
+#include "DemoIndex.h"
 
 QLayout * PagePlayDemo::bodyLayoutDefinition()
 {
@@ -38,7 +43,7 @@ QLayout * PagePlayDemo::bodyLayoutDefinition()
     pageLayout->setColumnStretch(0, 1);
     pageLayout->setColumnStretch(1, 2);
     pageLayout->setColumnStretch(2, 1);
-    pageLayout->setRowStretch(2, 100);
+    pageLayout->setRowStretch(3, 100);
 
     BtnRenameRecord = new QPushButton(this);
     BtnRenameRecord->setText(QPushButton::tr("Rename"));
@@ -48,9 +53,18 @@ QLayout * PagePlayDemo::bodyLayoutDefinition()
     BtnRemoveRecord->setText(QPushButton::tr("Delete"));
     pageLayout->addWidget(BtnRemoveRecord, 1, 2);
 
+    leFilter = new QLineEdit(this);
+    leFilter->setPlaceholderText(tr("Filter by name, map or team"));
+    pageLayout->addWidget(leFilter, 0, 1);
+
     DemosList = new QListWidget(this);
     DemosList->setGeometry(QRect(170, 10, 311, 311));
-    pageLayout->addWidget(DemosList, 0, 1, 3, 1);
+    pageLayout->addWidget(DemosList, 1, 1, 3, 1);
+
+    lblRecordInfo = new QLabel(this);
+    lblRecordInfo->setWordWrap(true);
+    lblRecordInfo->setAlignment(Qt::AlignTop | Qt::AlignLeft);
+    pageLayout->addWidget(lblRecordInfo, 2, 2);
 
     return pageLayout;
 }
@@ -77,6 +91,10 @@ void PagePlayDemo::connectSignals()
     connect(BtnRenameRecord, SIGNAL(clicked()), this, SLOT(renameRecord()));
     connect(BtnRemoveRecord, SIGNAL(clicked()), this, SLOT(removeRecord()));
     connect(&DataManager::instance(), SIGNAL(updated()), this, SLOT(refresh()));
+    connect(&DemoIndex::instance(), SIGNAL(fileIndexed(const QString &)), this, SLOT(onRecordIndexed(const QString &)));
+    connect(&DemoIndex::instance(), SIGNAL(directoryChanged(const QString &)), this, SLOT(onDirectoryChanged(const QString &)));
+    connect(leFilter, SIGNAL(textChanged(const QString &)), this, SLOT(applyFilter()));
+    connect(DemosList, SIGNAL(currentItemChanged(QListWidgetItem *, QListWidgetItem *)), this, SLOT(showRecordInfo()));
 }
 
 PagePlayDemo::PagePlayDemo(QWidget* parent) : AbstractPage(parent)
@@ -106,26 +124,125 @@ void PagePlayDemo::FillFromDir(RecordType rectype)
         BtnPlayDemo->setText(QPushButton::tr("Load"));
         BtnPlayDemo->setWhatsThis(tr("Load the selected game"));
     }
-    dir.setFilter(QDir::Files);
 
-    QStringList sl = dir.entryList(QStringList(QString("*.%2.%1").arg(extension, *cProtoVer)));
-    sl.replaceInStrings(QRegExp(QString("^(.*)\\.%2\\.%1$").arg(extension, *cProtoVer)), "\\1");
+    QString pattern = QString("*.%2.%1").arg(extension, *cProtoVer);
+    if (dir.absolutePath() != m_dir || pattern != m_pattern)
+    {
+        m_dir = dir.absolutePath();
+        m_pattern = pattern;
+        DemosList->clear();
+        m_items.clear();
+    }
+
+    // records are parsed in the background, the list only needs file names
+    DemoIndex::instance().watch(m_dir, m_pattern);
+    syncList();
+}
+
+// adds and removes entries according to the directory contents
+void PagePlayDemo::syncList()
+{
+    if (m_dir.isEmpty())
+        return;
+
+    QDir dir(m_dir);
+    QStringList files = dir.entryList(QStringList(m_pattern), QDir::Files);
+    QString suffix = m_pattern.mid(1);
+
+    QSet<QString> present;
+    bool added = false;
+    foreach(const QString & file, files)
+    {
+        QString path = dir.absoluteFilePath(file);
+        present.insert(path);
+
+        if (m_items.contains(path))
+            continue;
+
+        QListWidgetItem * item = new QListWidgetItem(file.left(file.size() - suffix.size()));
+        item->setData(Qt::UserRole, path);
+        item->setIcon(recType == RT_Demo ? QIcon(":/res/file_demo.png") : QIcon(":/res/file_save.png"));
+        DemosList->addItem(item);
+        m_items.insert(path, item);
+        updateItem(item);
+        added = true;
+    }
+
+    QHash<QString, QListWidgetItem *>::iterator i = m_items.begin();
+    while (i != m_items.end())
+    {
+        if (present.contains(i.key()))
+            ++i;
+        else
+        {
+            delete i.value();
+            i = m_items.erase(i);
+        }
+    }
 
-    DemosList->clear();
-    DemosList->addItems(sl);
+    if (added)
+        DemosList->sortItems();
+}
 
-    for (int i = 0; i < DemosList->count(); ++i)
+void PagePlayDemo::updateItem(QListWidgetItem * item)
+{
+    DemoInfo info;
+    if (!DemoIndex::instance().find(item->data(Qt::UserRole).toString(), info))
     {
-        DemosList->item(i)->setData(Qt::UserRole, dir.absoluteFilePath(QString("%1.%3.%2").arg(sl[i], extension, *cProtoVer)));
-        DemosList->item(i)->setIcon(recType == RT_Demo ? QIcon(":/res/file_demo.png") : QIcon(":/res/file_save.png"));
+        item->setToolTip(QString());
+        item->setHidden(!leFilter->text().isEmpty() && !item->text().contains(leFilter->text(), Qt::CaseInsensitive));
+        return;
     }
+
+    QStringList lines;
+    lines << tr("Map: %1").arg(info.map.isEmpty() ? tr("random map") : info.map);
+    if (!info.theme.isEmpty())
+        lines << tr("Theme: %1").arg(info.theme);
+    if (!info.script.isEmpty())
+        lines << tr("Script: %1").arg(info.script);
+    if (!info.teams.isEmpty())
+        lines << tr("Teams: %1").arg(info.teams.join(", "));
+    lines << tr("Date: %1").arg(QDateTime::fromMSecsSinceEpoch(info.modified).toString(Qt::SystemLocaleShortDate));
+    lines << tr("Size: %1 KiB").arg((info.size + 1023) / 1024);
+
+    item->setToolTip(lines.join("\n"));
+    item->setHidden(!info.matches(leFilter->text()));
+}
+
+void PagePlayDemo::onRecordIndexed(const QString & path)
+{
+    QListWidgetItem * item = m_items.value(path);
+    if (!item)
+        return;
+
+    updateItem(item);
+    if (item == DemosList->currentItem())
+        showRecordInfo();
+}
+
+void PagePlayDemo::onDirectoryChanged(const QString & path)
+{
+    if (path == m_dir && isVisible())
+        syncList();
+}
+
+void PagePlayDemo::applyFilter()
+{
+    foreach(QListWidgetItem * item, m_items)
+        updateItem(item);
+}
+
+void PagePlayDemo::showRecordInfo()
+{
+    QListWidgetItem * item = DemosList->currentItem();
+    lblRecordInfo->setText(item ? item->toolTip() : QString());
 }
 
 
 void PagePlayDemo::refresh()
 {
     if (this->isVisible())
-        FillFromDir(recType);
+        syncList();
 }
 
 
@@ -203,6 +320,7 @@ void PagePlayDemo::removeRecord()
     else
     {
         int i = DemosList->row(curritem);
+        m_items.remove(rfile.fileName());
         delete curritem;
         DemosList->setCurrentRow(i < DemosList->count() ? i : DemosList->count() - 1);
     }
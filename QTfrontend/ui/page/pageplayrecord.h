@@ -20,11 +20,15 @@
 #define PLAYRECORDPAGE_H
 
 #include <QDir>
+#include <QHash>
 
 #include "AbstractPage.h"
 
 class QPushButton;
 class QListWidget;
+class QListWidgetItem;
+class QLineEdit;
+class QLabel;
 
 class PagePlayDemo : public AbstractPage
 {
@@ -46,6 +50,8 @@ class PagePlayDemo : public AbstractPage
         QPushButton *BtnRenameRecord;
         QPushButton *BtnRemoveRecord;
         QListWidget *DemosList;
+        QLineEdit *leFilter;
+        QLabel *lblRecordInfo;
 
     public slots:
         void refresh();
@@ -56,10 +62,20 @@ class PagePlayDemo : public AbstractPage
         void connectSignals();
 
         RecordType recType;
+        QString m_dir;
+        QString m_pattern;
+        QHash<QString, QListWidgetItem *> m_items; ///< path -> list entry
+
+        void syncList();
+        void updateItem(QListWidgetItem * item);
 
     private slots:
         void renameRecord();
         void removeRecord();
+        void onRecordIndexed(const QString & path);
+        void onDirectoryChanged(const QString & path);
+        void applyFilter();
+        void showRecordInfo();
 };
 
 
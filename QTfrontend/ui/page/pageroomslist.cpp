@@ -227,6 +227,32 @@ void PageRoomsList::roomSelectionChanged(const QModelIndex & current, const QMod
     BtnJoin->setEnabled(current.isValid());
 }
 
+void PageRoomsList::saveSelectedRoom()
+{
+    QModelIndex current = roomsList->currentIndex();
+
+    if (current.isValid())
+        m_selectedRoom = current.sibling(current.row(), RoomsListModel::NameColumn).data().toString();
+    else
+        m_selectedRoom.clear();
+}
+
+void PageRoomsList::restoreSelectedRoom()
+{
+    if (m_selectedRoom.isEmpty())
+        return;
+
+    QModelIndexList found = roomsModel->match(
+        roomsModel->index(0, RoomsListModel::NameColumn),
+        Qt::DisplayRole, m_selectedRoom, 1, Qt::MatchExactly);
+
+    if (!found.isEmpty())
+        roomsList->selectionModel()->setCurrentIndex(found.first(),
+            QItemSelectionModel::SelectCurrent | QItemSelectionModel::Rows);
+
+    m_selectedRoom.clear();
+}
+
 PageRoomsList::PageRoomsList(QWidget* parent) :
     AbstractPage(parent)
 {
@@ -585,6 +611,10 @@ void PageRoomsList::setModel(RoomsListModel * model)
 
     stateFilteredModel->setSourceModel(model);
 
+    // bursts of room changes reset the model, keep the selected room
+    connect(model, SIGNAL(modelAboutToBeReset()), this, SLOT(saveSelectedRoom()));
+    connect(model, SIGNAL(modelReset()), this, SLOT(restoreSelectedRoom()));
+
     QHeaderView * h = roomsList->horizontalHeader();
 
     h->setSortIndicatorShown(true);
@@ -88,6 +88,8 @@ class PageRoomsList : public AbstractPage
         void roomSelectionChanged(const QModelIndex &, const QModelIndex &);
         void moveSelectionUp();
         void moveSelectionDown();
+        void saveSelectedRoom();
+        void restoreSelectedRoom();
 
     private:
         QSettings * m_gameSettings;
@@ -98,6 +100,7 @@ class PageRoomsList : public AbstractPage
         QAction * showPassword;
         QAction * showJoinRestricted;
         QSplitter * m_splitter;
+        QString m_selectedRoom; // kept over model resets
 
         GameSchemeModel * gameSchemeModel;
 
@@ -38,6 +38,7 @@
 #include <QHBoxLayout>
 #include <QFileSystemWatcher>
 #include <QDateTime>
+#include <QPixmap>
 #include <QRegExp>
 #include <QXmlStreamReader>
 
@@ -47,6 +48,9 @@
 #include "LibavInteraction.h"
 #include "gameuiconfig.h"
 #include "recorder.h"
+#include "recorderscheduler.h"
+#include "VideoIndex.h"
+#include "DemoContainer.h"
 #include "ask_quit.h"
 
 static const QSize ThumbnailSize(350, 350*3/5);
@@ -72,7 +76,7 @@ class VideoItem : public QTableWidgetItem
 
         QString name;
         QString prefix; // original filename without extension
-        QString desc;   // description (duration, resolution, etc...)
+        QPixmap thumbnail;
         HWRecorder    * pRecorder; // non NULL if file is being encoded
         bool seen; // used when updating directory
         float lastSizeUpdate;
@@ -184,6 +188,16 @@ QLayout * PageVideos::bodyLayoutDefinition()
         btnDelete->setWhatsThis(QPushButton::tr("Delete this video"));
         pBottomDescLayout->addWidget(btnDelete);
 
+        // buttons for videos in progress: pause and encode first
+        btnPause = new QPushButton(QPushButton::tr("Pause"), pDescGroup);
+        btnPause->setVisible(false);
+        btnPause->setWhatsThis(QPushButton::tr("Pause or resume encoding of this video"));
+        pBottomDescLayout->addWidget(btnPause);
+        btnEncodeFirst = new QPushButton(QPushButton::tr("Encode first"), pDescGroup);
+        btnEncodeFirst->setVisible(false);
+        btnEncodeFirst->setWhatsThis(QPushButton::tr("Encode this video before the other waiting videos"));
+        pBottomDescLayout->addWidget(btnEncodeFirst);
+
         pDescLayout->addWidget(labelThumbnail, 0);
         pDescLayout->addWidget(labelDesc, 0);
         pDescLayout->addLayout(pBottomDescLayout, 0);
@@ -208,6 +222,9 @@ void PageVideos::connectSignals()
     connect(btnPlay,   SIGNAL(clicked()), this, SLOT(playSelectedFile()));
     connect(btnDelete, SIGNAL(clicked()), this, SLOT(deleteSelectedFiles()));
     connect(btnOpenDir, SIGNAL(clicked()), this, SLOT(openVideosDirectory()));
+    connect(btnPause, SIGNAL(clicked()), this, SLOT(pauseSelectedFile()));
+    connect(btnEncodeFirst, SIGNAL(clicked()), this, SLOT(encodeSelectedFileFirst()));
+    connect(&RecorderScheduler::instance(), SIGNAL(stateChanged(HWRecorder*)), this, SLOT(recorderStateChanged(HWRecorder*)));
 }
 
 PageVideos::PageVideos(QWidget* parent) : AbstractPage(parent),
@@ -223,18 +240,24 @@ void PageVideos::init(GameUIConfig * config)
     this->config = config;
 
     QString path = cfgdir->absolutePath() + "/Videos";
+    VideoIndex::instance().watch(path, ThumbnailSize);
+    connect(&VideoIndex::instance(), SIGNAL(fileIndexed(const QString &)), this, SLOT(videoIndexed(const QString &)));
+
     QFileSystemWatcher * pWatcher = new QFileSystemWatcher(this);
     pWatcher->addPath(path);
     connect(pWatcher, SIGNAL(directoryChanged(const QString &)), this, SLOT(updateFileList(const QString &)));
     updateFileList(path);
 
+    // videos which were not finished when the frontend was closed last time
+    foreach (const RecorderJob & job, RecorderScheduler::instance().savedJobs())
+        resumeEncoding(job);
+
     startEncoding(); // this is for videos recorded from demos which were executed directly (without frontend)
 }
 
 // get file size as string
-static QString FileSizeStr(const QString & path)
+static QString FileSizeStr(qint64 size)
 {
-    qint64 size = QFileInfo(path).size();
 
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
     return QLocale().formattedDataSize(size);
@@ -254,6 +277,20 @@ static QString FileSizeStr(const QString & path)
 #endif
 }
 
+// get duration in seconds as string like 1:05:09 or 5:09
+static QString DurationStr(int seconds)
+{
+    QString str = QString("%1:%2").arg((seconds / 60) % 60).arg(seconds % 60, 2, 10, QChar('0'));
+    if (seconds >= 3600)
+        str = QString("%1:%2").arg(seconds / 3600).arg(str, 5, QChar('0'));
+    return str;
+}
+
+static QString FileSizeStr(const QString & path)
+{
+    return FileSizeStr(QFileInfo(path).size());
+}
+
 // set file size in file list in specified row
 void PageVideos::updateSize(int row)
 {
@@ -286,7 +323,6 @@ void PageVideos::updateFileList(const QString & path)
             row = appendRow(name);
         VideoItem * item = nameItem(row);
         item->seen = true;
-        item->desc = "";
         updateSize(row);
     }
 
@@ -303,7 +339,7 @@ void PageVideos::updateFileList(const QString & path)
 
 void PageVideos::addRecorder(HWRecorder* pRecorder)
 {
-    int row = appendRow(pRecorder->name);
+    int row = appendRow(pRecorder->targetName.isEmpty()? pRecorder->name : pRecorder->targetName);
     VideoItem * item = nameItem(row);
     item->pRecorder = pRecorder;
     pRecorder->item = item;
@@ -316,6 +352,7 @@ void PageVideos::addRecorder(HWRecorder* pRecorder)
     connect(pRecorder, SIGNAL(onProgress(float)), this, SLOT(updateProgress(float)));
     connect(pRecorder, SIGNAL(encodingFinished(bool)), this, SLOT(encodingFinished(bool)));
     filesTable->setCellWidget(row, vcProgress, progressBar);
+    setProgress(row, item, 0);
 
     numRecorders++;
 }
@@ -325,10 +362,45 @@ void PageVideos::setProgress(int row, VideoItem* item, float value)
     QProgressBar * progressBar = (QProgressBar*)filesTable->cellWidget(row, vcProgress);
     progressBar->setValue(value*10000);
     //: Video encoding progress. %1 = number
-    progressBar->setFormat(QString(tr("%1%")).arg(QLocale().toString(value*100, 'f', 2)));
+    QString format = QString(tr("%1%")).arg(QLocale().toString(value*100, 'f', 2));
+    QString state = recorderState(item->pRecorder);
+    if (!state.isEmpty())
+        format += " - " + state;
+    progressBar->setFormat(format);
     item->progress = value;
 }
 
+// returns what the recorder is doing, empty if it is encoding and
+// its speed is not known yet
+QString PageVideos::recorderState(HWRecorder* pRecorder)
+{
+    if (pRecorder->paused)
+        //: Video encoding state
+        return tr("paused");
+    if (!RecorderScheduler::instance().isRunning(pRecorder))
+        //: Video encoding state, waiting for other videos to finish
+        return tr("queued");
+    if (pRecorder->fps() <= 0)
+        return QString();
+    QString fps = QLocale().toString(pRecorder->fps(), 'f', 1);
+    if (pRecorder->eta() < 0)
+        //: Video encoding speed. %1 = frames per second
+        return tr("%1 fps").arg(fps);
+    //: Video encoding speed. %1 = frames per second, %2 = remaining time
+    return tr("%1 fps, %2 left").arg(fps).arg(DurationStr(pRecorder->eta()));
+}
+
+void PageVideos::recorderStateChanged(HWRecorder* pRecorder)
+{
+    VideoItem * item = pRecorder->item;
+    if (!item) // not added yet
+        return;
+
+    setProgress(filesTable->row(item), item, item->progress);
+    if (filesTable->currentRow() == filesTable->row(item))
+        updateDescription();
+}
+
 void PageVideos::updateProgress(float value)
 {
     HWRecorder * pRecorder = (HWRecorder*)sender();
@@ -414,7 +486,9 @@ void PageVideos::cellChanged(int row, int column)
         return;
     }
 #endif
-    if (item->ready() && !cfgdir->rename("Videos/" + oldName, "Videos/" + newName))
+    if (!item->ready())
+        RecorderScheduler::instance().setTargetName(item->pRecorder, newName);
+    else if (!cfgdir->rename("Videos/" + oldName, "Videos/" + newName))
     {
         // unable to rename for some reason (maybe user entered incorrect name),
         // therefore restore old name in cell
@@ -482,39 +556,45 @@ void PageVideos::updateDescription()
         clearThumbnail();
         btnPlay->setEnabled(false);
         btnDelete->setEnabled(false);
+        btnPause->setVisible(false);
+        btnEncodeFirst->setVisible(false);
         return;
     }
 
     btnPlay->setEnabled(item->ready());
     btnDelete->setEnabled(true);
     btnDelete->setText(item->ready()? QPushButton::tr("Delete") :  QPushButton::tr("Cancel"));
+    btnPause->setVisible(!item->ready());
+    btnEncodeFirst->setVisible(!item->ready());
+    if (!item->ready())
+    {
+        btnPause->setText(item->pRecorder->paused? QPushButton::tr("Resume") : QPushButton::tr("Pause"));
+        btnEncodeFirst->setEnabled(!RecorderScheduler::instance().isRunning(item->pRecorder));
+    }
 
     // construct string with desctiption of this file to display it
     QString desc = item->name + "\n\n";
 
     if (!item->ready())
-        desc += tr("(in progress...)");
+    {
+        QString state = recorderState(item->pRecorder);
+        desc += state.isEmpty()? tr("(in progress...)") : QString("(%1)").arg(state);
+    }
     else
     {
-        QString path = item->path();
-        desc += tr("Date: %1").arg(QFileInfo(path).created().toString(Qt::DefaultLocaleLongDate)) + "\n";
-        desc += tr("Size: %1").arg(FileSizeStr(path)) + "\n";
-        if (item->desc.isEmpty())
+        // everything comes from the index, selecting a video doesn't touch the disk
+        VideoInfo info;
+        if (VideoIndex::instance().find(item->path(), info))
         {
-            // Extract description from file;
-            // It will contain duration, resolution, etc and also comment added by hwengine.
-            item->desc = LibavInteraction::instance().getFileInfo(path);
-
-            // extract prefix (original name) from description (it is enclosed in prefix[???]prefix)
-            int prefixBegin = item->desc.indexOf("prefix[");
-            int prefixEnd   = item->desc.indexOf("]prefix");
-            if (prefixBegin != -1 && prefixEnd != -1)
-            {
-                item->prefix = item->desc.mid(prefixBegin + 7, prefixEnd - (prefixBegin + 7));
-                item->desc.remove(prefixBegin, prefixEnd + 7 - prefixBegin);
-            }
+            desc += tr("Date: %1").arg(QDateTime::fromMSecsSinceEpoch(info.modified).toString(Qt::DefaultLocaleLongDate)) + "\n";
+            desc += tr("Size: %1").arg(FileSizeStr(info.size)) + "\n";
+            desc += LibavInteraction::instance().getFileInfo(info.file) + '\n';
+            item->prefix = info.prefix;
+            if (item->thumbnail.isNull() && !info.thumbnail.isEmpty())
+                item->thumbnail.loadFromData(info.thumbnail, "PNG");
         }
-        desc += item->desc + '\n';
+        else
+            desc += tr("(reading file information...)");
     }
 
     if (item->prefix.isEmpty())
@@ -535,7 +615,8 @@ void PageVideos::updateDescription()
 
     labelDesc->setText(desc);
 
-    if (!item->prefix.isEmpty())
+    // videos in progress are not indexed, their thumbnail is loaded once
+    if (!item->ready() && item->thumbnail.isNull() && !item->prefix.isEmpty())
     {
         QString thumbName = cfgdir->absoluteFilePath("VideoTemp/" + item->prefix);
         QPixmap pic;
@@ -545,11 +626,21 @@ void PageVideos::updateDescription()
                 pic = pic.scaledToWidth(ThumbnailSize.width());
             else
                 pic = pic.scaledToHeight(ThumbnailSize.height());
-            labelThumbnail->setPixmap(pic);
+            item->thumbnail = pic;
         }
-        else
-            clearThumbnail();
     }
+
+    if (item->thumbnail.isNull())
+        clearThumbnail();
+    else
+        labelThumbnail->setPixmap(item->thumbnail);
+}
+
+void PageVideos::videoIndexed(const QString & path)
+{
+    VideoItem * item = nameItem(filesTable->currentRow());
+    if (item && item->ready() && item->path() == path)
+        updateDescription();
 }
 
 // user selected another cell, so we should change description
@@ -596,7 +687,7 @@ void PageVideos::deleteSelectedFiles()
 
     // remove
     if (!item->ready())
-        item->pRecorder->deleteLater();
+        RecorderScheduler::instance().cancel(item->pRecorder);
     else
     {
         cfgdir->remove("Videos/" + item->name);
@@ -661,14 +752,21 @@ void PageVideos::openVideosDirectory()
     QDesktopServices::openUrl(QUrl("file:///" + path));
 }
 
-// clear VideoTemp directory (except for thumbnails)
+// clear VideoTemp directory (except for thumbnails and unfinished videos)
 void PageVideos::clearTemp()
 {
+    // record, camera positions and sound are needed to encode a video again
+    QStringList keep;
+    foreach (const RecorderJob & job, RecorderScheduler::instance().savedJobs())
+        keep << job.prefix + ".hwd" << job.prefix + ".txtin" << job.prefix + ".sw";
+    if (!keep.isEmpty())
+        keep << "queue.ini";
+
     QDir temp(cfgdir->absolutePath() + "/VideoTemp");
     QStringList files = temp.entryList(QDir::Files);
     foreach (const QString& file, files)
     {
-        if (!file.endsWith(".bmp") && !file.endsWith(".png"))
+        if (!file.endsWith(".bmp") && !file.endsWith(".png") && !keep.contains(file))
             temp.remove(file);
     }
 }
@@ -684,7 +782,10 @@ bool PageVideos::tryQuit(HWForm * form)
         quit = askd->exec();
     }
     if (quit)
+    {
+        RecorderScheduler::instance().shutdown();
         clearTemp();
+    }
     return quit;
 }
 
@@ -705,11 +806,12 @@ QString PageVideos::getVideosInProgress()
         float progress = 100*item->progress;
         if (progress > 99.99)
             progress = 99.99; // displaying 100% may be confusing
+        QString state = recorderState(item->pRecorder);
         //: Video encoding list entry. %1 = file name, %2 = percent complete, %3 = video operation type (e.g. “encoding”)
         list += QString(tr("%1 (%2%) - %3"))
             .arg(item->name)
             .arg(QLocale().toString(progress, 'f', 2))
-            .arg(tr("encoding"))
+            .arg(state.isEmpty()? tr("encoding") : state)
             + "\n";
     }
     return list;
@@ -735,7 +837,7 @@ void PageVideos::startEncoding(const QByteArray & record)
             QFile demofile(videoTempDir.absoluteFilePath(prefix + ".hwd"));
             if (!demofile.open(QIODevice::ReadOnly))
                 continue;
-            QByteArray demo = demofile.readAll();
+            QByteArray demo = DemoContainer::unpack(demofile.readAll());
             if (demo.isEmpty())
                 continue;
             pRecorder->EncodeVideo(demo);
@@ -744,3 +846,43 @@ void PageVideos::startEncoding(const QByteArray & record)
     }
 }
 
+
+void PageVideos::resumeEncoding(const RecorderJob & job)
+{
+    QDir videoTempDir(cfgdir->absolutePath() + "/VideoTemp/");
+    if (!videoTempDir.exists(job.prefix + ".txtin"))
+        return;
+
+    QFile demofile(videoTempDir.absoluteFilePath(job.prefix + ".hwd"));
+    if (!demofile.open(QIODevice::ReadOnly))
+        return;
+    QByteArray demo = DemoContainer::unpack(demofile.readAll());
+    if (demo.isEmpty())
+        return;
+
+    // encoding starts from the beginning, the engine can't continue a file
+    HWRecorder* pRecorder = new HWRecorder(config, job.prefix);
+    pRecorder->targetName = job.targetName;
+    pRecorder->priority = job.priority;
+    pRecorder->paused = job.paused;
+    pRecorder->EncodeVideo(demo);
+    addRecorder(pRecorder);
+}
+
+void PageVideos::pauseSelectedFile()
+{
+    VideoItem * item = nameItem(filesTable->currentRow());
+    if (!item || item->ready())
+        return;
+
+    RecorderScheduler::instance().setPaused(item->pRecorder, !item->pRecorder->paused);
+}
+
+void PageVideos::encodeSelectedFileFirst()
+{
+    VideoItem * item = nameItem(filesTable->currentRow());
+    if (!item || item->ready())
+        return;
+
+    RecorderScheduler::instance().encodeFirst(item->pRecorder);
+}
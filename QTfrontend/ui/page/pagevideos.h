@@ -26,6 +26,7 @@ class GameUIConfig;
 class HWRecorder;
 class VideoItem;
 class HWForm;
+struct RecorderJob;
 
 class PageVideos : public AbstractPage
 {
@@ -58,6 +59,8 @@ class PageVideos : public AbstractPage
         void clearTemp();
         void clearThumbnail();
         void setProgress(int row, VideoItem* item, float value);
+        QString recorderState(HWRecorder* pRecorder);
+        void resumeEncoding(const RecorderJob & job);
 
         GameUIConfig * config;
 
@@ -67,6 +70,7 @@ class PageVideos : public AbstractPage
 
         // description group
         QPushButton *btnPlay, *btnDelete;
+        QPushButton *btnPause, *btnEncodeFirst;
         QLabel *labelDesc;
         QLabel *labelThumbnail;
 
@@ -79,6 +83,9 @@ class PageVideos : public AbstractPage
     private slots:
         void encodingFinished(bool success);
         void updateProgress(float value);
+        void recorderStateChanged(HWRecorder* pRecorder);
+        void pauseSelectedFile();
+        void encodeSelectedFileFirst();
         void cellDoubleClicked(int row, int column);
         void cellChanged(int row, int column);
         void currentCellChanged();
@@ -86,6 +93,7 @@ class PageVideos : public AbstractPage
         void deleteSelectedFiles();
         void openVideosDirectory();
         void updateFileList(const QString & path);
+        void videoIndexed(const QString & path);
 };
 
 #endif // PAGE_VIDEOS_H
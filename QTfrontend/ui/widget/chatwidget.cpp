@@ -33,6 +33,12 @@
 #include <QMenu>
 #include <QScrollBar>
 #include <QMimeData>
+#include <QSettings>
+#include <QTextBlockFormat>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTimer>
 
 #include "DataManager.h"
 #include "hwconsts.h"
@@ -47,6 +53,8 @@ QStringList * HWChatWidget::s_displayNone = NULL;
 bool HWChatWidget::s_isTimeStamped = true;
 QString HWChatWidget::s_tsFormat = ":mm:ss";
 
+static const int defaultScrollback = 250;
+
 const QString & HWChatWidget::styleSheet()
 {
     if (s_styleSheet != NULL)
@@ -188,6 +196,14 @@ HWChatWidget::HWChatWidget(QWidget* parent, bool notify) :
     m_scrollToBottom = false;
     m_scrollBarPos = 0;
 
+    m_scrollback = defaultScrollback;
+
+    // lines arriving in the same event loop iteration are added at once
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(0);
+    connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flushLines()));
+
     QStringList vpList =
          QStringList() << "Classic" << "Default" << "Mobster" << "Russian";
 
@@ -217,6 +233,7 @@ HWChatWidget::HWChatWidget(QWidget* parent, bool notify) :
     chatText->setMinimumWidth(10);
     chatText->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     chatText->setOpenLinks(false);
+    chatText->setUndoRedoEnabled(false);
     chatText->setStyleSheet("QTextBrowser { background-color: rgb(23, 11, 54); border-width: 0px; }");
     connect(chatText, SIGNAL(anchorClicked(const QUrl&)),
             this, SLOT(linkClicked(const QUrl&)));
@@ -298,12 +315,42 @@ HWChatWidget::HWChatWidget(QWidget* parent, bool notify) :
 
     m_nicksMenu = new QMenu(this);
 
+    updateHighlights();
     clear();
 }
 
 void HWChatWidget::setSettings(QSettings * settings)
 {
     gameSettings = settings;
+
+    if (gameSettings)
+        setScrollback(gameSettings->value("frontend/chatScrollback", defaultScrollback).toInt());
+}
+
+void HWChatWidget::setScrollback(int lines)
+{
+    m_scrollback = qMax(0, lines);
+
+    QTextCursor cursor(chatText->document());
+    cursor.beginEditBlock();
+    trimLines(cursor);
+    cursor.endEditBlock();
+}
+
+// drops the oldest lines beyond the scrollback. Lines are counted rather
+// than text blocks, horizontal rules and line breaks add blocks of their own
+void HWChatWidget::trimLines(QTextCursor & cursor)
+{
+    if ((m_scrollback == 0) || (m_lineBlocks.size() <= m_scrollback))
+        return;
+
+    int blocks = 0;
+    while (m_lineBlocks.size() > m_scrollback)
+        blocks += m_lineBlocks.dequeue();
+
+    cursor.movePosition(QTextCursor::Start);
+    cursor.movePosition(QTextCursor::NextBlock, QTextCursor::KeepAnchor, blocks);
+    cursor.removeSelectedText();
 }
 
 void HWChatWidget::linkClicked(const QUrl & link)
@@ -383,37 +430,77 @@ QString HWChatWidget::linkedNick(const QString & nickname)
 
 const QRegExp HWChatWidget::URLREGEXP = QRegExp("(http(s)?://)?(www\\.)?((([^/:?&#]+\\.)?hedgewars\\.org|code\\.google\\.com|googlecode\\.com|hh\\.unit22\\.org)(/[^ ]*)?)");
 
-bool HWChatWidget::containsHighlight(const QString & sender, const QString & message)
+// every match of URLREGEXP contains one of these
+const char * const HWChatWidget::URLHOSTS[] =
+    { "hedgewars.org", "code.google.com", "googlecode.com", "hh.unit22.org", 0 };
+
+// whether the word found at start is a highlight, i.e. the lower case
+// message matches "^(.* )?word[^-a-z0-9_]*( .*)?$" there
+static bool isHighlightWord(const QString & str, int start, int length)
 {
-    if ((sender != m_userNick) && (!m_userNick.isEmpty()))
+    if ((start > 0) && (str.at(start - 1) != ' '))
+        return false;
+
+    for (int i = start + length; i < str.size(); i++)
     {
-        QString lcStr = message.toLower();
+        QChar c = str.at(i);
+        if (c == ' ')
+            return true;
+        if ((c == '-') || (c == '_') || ((c >= 'a') && (c <= 'z')) || ((c >= '0') && (c <= '9')))
+            return false;
+    }
 
-        foreach (const QRegExp & hl, m_highlights)
-        {
-            if (lcStr.contains(hl))
-                return true;
-        }
+    return true;
+}
+
+bool HWChatWidget::containsHighlight(const QString & sender, const QString & message, bool & hasLink)
+{
+    bool checkHighlight = (sender != m_userNick) && (!m_userNick.isEmpty());
+    bool highlight = false;
+    QString lcStr = message.toLower();
+
+    // one pass for the link hosts and all highlight words
+    hasLink = false;
+    m_keywords.findAll(lcStr, m_matches);
+
+    foreach (const KeywordMatcher::Match & match, m_matches)
+    {
+        if (match.keyword < m_highlightKeywords)
+            hasLink = true;
+        else if (checkHighlight && !highlight)
+            highlight = isHighlightWord(lcStr, match.start, m_keywords.keyword(match.keyword).size());
     }
-    return false;
+
+    if (checkHighlight && !highlight && !m_highlightRegExp.isEmpty())
+        highlight = lcStr.contains(m_highlightRegExp);
+
+    for (int i = 0; checkHighlight && !highlight && (i < m_backrefRegExps.size()); ++i)
+        highlight = lcStr.contains(m_backrefRegExps[i]);
+
+    return highlight;
 }
 
-QString HWChatWidget::messageToHTML(const QString & message)
+QString HWChatWidget::messageToHTML(const QString & message, bool hasLink)
 {
     QString formattedStr = message.toHtmlEscaped();
     // link some urls
-    formattedStr = formattedStr.replace(URLREGEXP, "<a href=\"http\\2://\\4\">\\4</a>");
+    if (hasLink)
+        formattedStr = formattedStr.replace(URLREGEXP, "<a href=\"http\\2://\\4\">\\4</a>");
     return formattedStr;
 }
 
 void HWChatWidget::onChatAction(const QString & nick, const QString & action)
 {
-    printChatString(nick, "* " + linkedNick(nick) + " " + messageToHTML(action), "Action", containsHighlight(nick, action));
+    bool hasLink;
+    bool highlight = containsHighlight(nick, action, hasLink);
+    printChatString(nick, "* " + linkedNick(nick) + " " + messageToHTML(action, hasLink), "Action", highlight);
 }
 
 void HWChatWidget::onChatMessage(const QString & nick, const QString & message)
 {
-    printChatString(nick, linkedNick(nick) + ": " + messageToHTML(message), "Chat", containsHighlight(nick, message));
+    bool hasLink;
+    bool highlight = containsHighlight(nick, message, hasLink);
+    printChatString(nick, linkedNick(nick) + ": " + messageToHTML(message, hasLink), "Chat", highlight);
 }
 
 void HWChatWidget::printChatString(
@@ -445,11 +532,6 @@ void HWChatWidget::addLine(const QString & cssClass, QString line, bool isHighli
     if (s_displayNone->contains(cssClass))
         return; // the css forbids us to display this line
 
-    beforeContentAdd();
-
-    if (chatStrings.size() > 250)
-        chatStrings.removeFirst();
-
     if (s_isTimeStamped)
     {
         QString tsMarkUp = "<span class=\"timestamp\">[%1]</span> ";
@@ -467,23 +549,56 @@ void HWChatWidget::addLine(const QString & cssClass, QString line, bool isHighli
             HWApplication::alert(this, 800);
     }
 
-    chatStrings.append(line);
+    appendLine(line);
+}
+
+void HWChatWidget::onServerMessage(const QString& str)
+{
+    appendLine("<hr>" + str + "<hr>");
+}
 
-    chatText->setHtml("<html><body>"+chatStrings.join("<br>")+"</body></html>");
+void HWChatWidget::appendLine(const QString & html)
+{
+    m_pendingLines.append(html);
 
-    afterContentAdd();
+    if (!m_flushTimer->isActive())
+        m_flushTimer->start();
 }
 
-void HWChatWidget::onServerMessage(const QString& str)
+void HWChatWidget::flushLines()
 {
+    if (m_pendingLines.isEmpty())
+        return;
+
     beforeContentAdd();
 
-    if (chatStrings.size() > 250)
-        chatStrings.removeFirst();
+    // lines beyond the scrollback would be dropped right away
+    int first = 0;
+    if (m_scrollback > 0)
+        first = qMax(0, m_pendingLines.size() - m_scrollback);
 
-    chatStrings.append("<hr>" + str + "<hr>");
+    // add the new lines at the end instead of parsing the whole log again
+    QTextDocument * doc = chatText->document();
+    QTextCursor cursor(doc);
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
 
-    chatText->setHtml("<html><body>"+chatStrings.join("<br>")+"</body></html>");
+    for (int i = first; i < m_pendingLines.size(); ++i)
+    {
+        // the first line takes the empty block of an empty document
+        int blocks = 0;
+        if (!doc->isEmpty())
+        {
+            blocks = doc->blockCount();
+            cursor.insertBlock(QTextBlockFormat(), QTextCharFormat());
+        }
+        cursor.insertHtml(m_pendingLines[i]);
+        m_lineBlocks.enqueue(doc->blockCount() - blocks);
+    }
+
+    trimLines(cursor);
+    cursor.endEditBlock();
+    m_pendingLines.clear();
 
     afterContentAdd();
 }
@@ -552,17 +667,28 @@ void HWChatWidget::clear()
     chatEditLine->addCommands(cmds);
 
     chatText->clear();
-    chatStrings.clear();
+    m_pendingLines.clear();
+    m_lineBlocks.clear();
     //chatNicks->clear();
+}
 
-    // clear and re compile regexp for highlighting
-    m_highlights.clear();
+void HWChatWidget::updateHighlights()
+{
+    m_keywords.clear();
+    m_highlightRegExp = QRegExp();
+    m_backrefRegExps.clear();
+
+    for (int i = 0; URLHOSTS[i]; i++)
+        m_keywords.addKeyword(URLHOSTS[i]);
+
+    m_highlightKeywords = m_keywords.keywordCount();
+
+    if (m_userNick.isEmpty())
+        return;
 
-    QString hlRegExp("^(.* )?%1[^-a-z0-9_]*( .*)?$");
     QRegExp whitespace("\\s");
 
-    if (!m_userNick.isEmpty())
-        m_highlights.append(QRegExp(hlRegExp.arg(QRegExp::escape(m_userNick.toLower()))));
+    m_keywords.addKeyword(m_userNick.toLower());
 
     QFile file(cfgdir->absolutePath() + "/" + m_userNick.toLower() + "_highlight.txt");
 
@@ -572,11 +698,10 @@ void HWChatWidget::clear()
         while (!in.atEnd())
         {
             QString line = in.readLine();
-            QStringList list = line.split(whitespace);
+            QStringList list = line.split(whitespace, QString::SkipEmptyParts);
             foreach (QString word, list)
             {
-                m_highlights.append(QRegExp(
-                                        hlRegExp.arg(QRegExp::escape(word.toLower()))));
+                m_keywords.addKeyword(word.toLower());
             }
         }
 
@@ -588,12 +713,27 @@ void HWChatWidget::clear()
 
     if (file2.exists() && (file2.open(QIODevice::ReadOnly | QIODevice::Text)))
     {
+        // one alternation, so every message is matched against all at once.
+        // Combining renumbers capture groups, patterns with backreferences
+        // (an odd number of backslashes before a digit) are kept apart
+        QRegExp backref("(^|[^\\\\])(\\\\\\\\)*\\\\[1-9]");
+        QStringList patterns;
         QTextStream in(&file2);
         while (!in.atEnd())
         {
-            m_highlights.append(QRegExp(in.readLine().toLower()));
+            QString pattern = in.readLine().toLower();
+            if (pattern.isEmpty() || !QRegExp(pattern).isValid())
+                continue;
+
+            if (pattern.contains(backref))
+                m_backrefRegExps << QRegExp(pattern);
+            else
+                patterns << QString("(?:%1)").arg(pattern);
         }
 
+        if (!patterns.isEmpty())
+            m_highlightRegExp = QRegExp(patterns.join("|"));
+
         if (file2.isOpen())
             file2.close();
     }
@@ -849,7 +989,8 @@ bool HWChatWidget::parseCommand(const QString & line)
         if (tline.startsWith("/me"))
             return false; // not a real command
         else if (tline == "/clear") {
-            chatStrings.clear();
+            m_pendingLines.clear();
+            m_lineBlocks.clear();
             chatText->clear();
         }
         else if (tline == "/discardStyleSheet")
@@ -870,6 +1011,7 @@ void HWChatWidget::setUser(const QString & nickname)
 {
     m_userNick = nickname;
     nickRemoved(nickname);
+    updateHighlights();
     clear();
 }
 
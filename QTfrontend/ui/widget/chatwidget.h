@@ -25,12 +25,14 @@
 #include <QGridLayout>
 #include <QList>
 #include <QPair>
+#include <QQueue>
 #include <QRegExp>
 #include <QHash>
 #include <QListWidgetItem>
 
 #include "SDLInteraction.h"
 
+#include "KeywordMatcher.h"
 #include "SmartLineEdit.h"
 #include "playerslistmodel.h"
 
@@ -40,6 +42,8 @@ class QListView;
 class QSettings;
 class QAbstractItemModel;
 class QMenu;
+class QTimer;
+class QTextCursor;
 
 /**
  * @brief Chat widget.
@@ -65,6 +69,7 @@ class HWChatWidget : public QWidget
         void setUser(const QString & nickname);
         void setUsersModel(QAbstractItemModel * model);
         void setSettings(QSettings * settings);
+        void setScrollback(int lines); ///< number of lines kept, 0 keeps everything
 
     protected:
         virtual void dragEnterEvent(QDragEnterEvent * event);
@@ -78,10 +83,12 @@ class HWChatWidget : public QWidget
         static bool s_isTimeStamped;
         static QString s_tsFormat;
         static const QRegExp URLREGEXP;
+        static const char * const URLHOSTS[];
 
         static void setStyleSheet(const QString & styleSheet = "");
 
         void addLine(const QString & cssClass, QString line, bool isHighlight = false);
+        void appendLine(const QString & html);
         bool parseCommand(const QString & line);
         void discardStyleSheet();
         void saveStyleSheet();
@@ -90,19 +97,28 @@ class HWChatWidget : public QWidget
         void afterContentAdd();
         bool isInGame();
 
+        /**
+         * @brief Compiles the nick and the user's highlight files into the matchers.
+         */
+        void updateHighlights();
         /**
          * @brief Checks whether the message contains a highlight.
+         *
+         * Scans the message once for all highlight words and link hosts.
+         *
          * @param sender the sender of the message
          * @param message the message
+         * @param hasLink set to whether the message may contain a link
          * @return true if the sender is somebody else and the message contains a highlight, otherwise false
          */
-        bool containsHighlight(const QString & sender, const QString & message);
+        bool containsHighlight(const QString & sender, const QString & message, bool & hasLink);
         /**
          * @brief Escapes HTML chars in the message and converts URls to HTML links.
          * @param message the message to be converted to HTML
+         * @param hasLink false if the message is known not to contain links
          * @return the HTML message
          */
-        QString messageToHTML(const QString & message);
+        QString messageToHTML(const QString & message, bool hasLink = true);
         void printChatString(
             const QString & nick,
             const QString & str,
@@ -139,7 +155,10 @@ class HWChatWidget : public QWidget
         bool m_isAdmin;
         QHBoxLayout mainLayout;
         QTextBrowser* chatText;
-        QStringList chatStrings;
+        QStringList m_pendingLines; ///< html of lines not shown yet
+        QTimer * m_flushTimer;
+        int m_scrollback;
+        QQueue<int> m_lineBlocks; ///< text blocks of each shown line, a line may have several
         QListView* chatNicks;
         SmartLineEdit* chatEditLine;
         QAction * acInfo;
@@ -155,13 +174,20 @@ class HWChatWidget : public QWidget
         QString m_hilightSound;
         QString m_userNick;
         QString m_clickedNick;
-        QList<QRegExp> m_highlights; ///< regular expressions used for highlighting
+        KeywordMatcher m_keywords; ///< link hosts, then the words used for highlighting
+        int m_highlightKeywords; ///< index of the first highlight word in m_keywords
+        QVector<KeywordMatcher::Match> m_matches;
+        QRegExp m_highlightRegExp; ///< the user's highlight patterns combined
+        QList<QRegExp> m_backrefRegExps; ///< highlight patterns with backreferences, matched one by one
         bool notify;
         bool m_autoKickEnabled;
         bool m_scrollToBottom;
         int m_scrollBarPos;
 
+        void trimLines(QTextCursor & cursor);
+
     private slots:
+        void flushLines();
         void returnPressed();
         void onBan();
         void onKick();
@@ -366,19 +366,6 @@ QByteArray GameCFGWidget::getFullConfig() const
             bcfg << QString("e$maze_size %1").arg(pMapContainer->getMazeSize()).toUtf8();
             break;
 
-        case MAPGEN_DRAWN:
-        {
-            QByteArray data = pMapContainer->getDrawnMapData();
-            while(data.size() > 0)
-            {
-                QByteArray tmp = data;
-                tmp.truncate(200);
-                tmp.prepend("edraw ");
-                bcfg << tmp;
-                data.remove(0, 200);
-            }
-            break;
-        }
         default:
             ;
     }
@@ -388,6 +375,10 @@ QByteArray GameCFGWidget::getFullConfig() const
     foreach(QByteArray ba, bcfg)
     HWProto::addByteArrayToBuffer(result, ba);
 
+    // drawn map goes in one piece, it doesn't fit into a normal frame
+    if (mapgen == MAPGEN_DRAWN)
+        HWProto::addExtendedByteArrayToBuffer(result, "edraw " + pMapContainer->getDrawnMapData());
+
     return result;
 }
 
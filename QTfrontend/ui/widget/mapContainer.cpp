@@ -41,6 +41,7 @@
 
 #include "hwconsts.h"
 #include "mapContainer.h"
+#include "PreviewCache.h"
 #include "themeprompt.h"
 #include "seedprompt.h"
 #include "igbox.h"
@@ -65,6 +66,11 @@ HWMapContainer::HWMapContainer(QWidget * parent) :
     m_mapFeatureSize = 12;
     m_withoutDLC = false;
     m_missingMap = false;
+    m_nextSeed = QUuid::createUuid().toString();
+
+    m_previewTimer.setSingleShot(true);
+    m_previewTimer.setInterval(100);
+    connect(&m_previewTimer, SIGNAL(timeout()), this, SLOT(askForGeneratedPreview()));
 
     hhSmall.load(":/res/hh_small.png");
     hhLimit = 18;
@@ -346,6 +352,7 @@ void HWMapContainer::onImageReceived(const QPixmap &newImage)
         case MapModel::HandDrawnMap:
         case MapModel::FortsMap:
             setImage(newImage);
+            prefetchPreviews();
             break;
         // Throw away image if we have switched the map mode in the meantime
         default:
@@ -414,6 +421,24 @@ void HWMapContainer::addInfoToPreview(const QPixmap &image, const QLinearGradien
 
 void HWMapContainer::askForGeneratedPreview()
 {
+    m_previewTimer.stop();
+
+    // show the waiting image first, cached previews arrive right from getImage
+    setHHLimit(0);
+
+    QPixmap waitImage(m_previewSize);
+    waitImage.fill(Qt::transparent);
+
+    QPainter p(&waitImage);
+    const QPixmap waitIcon(":/res/iconTime.png");
+    int x = (waitImage.width() - waitIcon.width()) / 2;
+    int y = (waitImage.height() - waitIcon.height()) / 2;
+    p.drawPixmap(QPoint(x, y), waitIcon);
+
+    setImage(waitImage, linearGradLoading, false);
+
+    cType->setEnabled(false);
+
     pMap = new HWMap(this);
     connect(pMap, SIGNAL(ImageReceived(QPixmap)), this, SLOT(onImageReceived(const QPixmap)));
     connect(pMap, SIGNAL(HHLimitReceived(int)), this, SLOT(setHHLimit(int)));
@@ -427,21 +452,59 @@ void HWMapContainer::askForGeneratedPreview()
                    m_scriptparam,
 		           m_mapFeatureSize
                   );
+}
 
-    setHHLimit(0);
+QByteArray HWMapContainer::previewRequest(const QString & seed, int featureSize)
+{
+    return HWMap::previewRequest(seed,
+                                 getTemplateFilter(),
+                                 get_mapgen(),
+                                 getMazeSize(),
+                                 getDrawnMapData(),
+                                 m_script,
+                                 m_scriptparam,
+                                 featureSize);
+}
 
-    QPixmap waitImage(m_previewSize);
-    waitImage.fill(Qt::transparent);
+// Warms the preview cache with the states the user is likely to pick next:
+// the next random seed and the neighbouring feature sizes.
+void HWMapContainer::prefetchPreviews()
+{
+    // stale prefetches nobody has started on yet
+    foreach(QPointer<HWMap> map, m_prefetchMaps)
+        if(map && map->couldBeRemoved())
+            delete map;
+    m_prefetchMaps.clear();
 
-    QPainter p(&waitImage);
-    const QPixmap waitIcon(":/res/iconTime.png");
-    int x = (waitImage.width() - waitIcon.width()) / 2;
-    int y = (waitImage.height() - waitIcon.height()) / 2;
-    p.drawPixmap(QPoint(x, y), waitIcon);
+    // only the master can change the map, everyone else just follows
+    if(!isMaster() || (m_mapInfo.type == MapModel::HandDrawnMap))
+        return;
 
-    setImage(waitImage, linearGradLoading, false);
+    prefetchPreview(m_nextSeed, m_mapFeatureSize);
 
-    cType->setEnabled(false);
+    if(m_mapFeatureSize < mapFeatureSize->maximum())
+        prefetchPreview(m_seed, m_mapFeatureSize + 1);
+    if(m_mapFeatureSize > mapFeatureSize->minimum())
+        prefetchPreview(m_seed, m_mapFeatureSize - 1);
+}
+
+void HWMapContainer::prefetchPreview(const QString & seed, int featureSize)
+{
+    if(PreviewCache::instance().contains(PreviewCache::key(previewRequest(seed, featureSize))))
+        return;
+
+    HWMap * map = new HWMap(this);
+    map->setPrefetch(true);
+    m_prefetchMaps << map;
+    map->getImage(seed,
+                  getTemplateFilter(),
+                  get_mapgen(),
+                  getMazeSize(),
+                  getDrawnMapData(),
+                  m_script,
+                  m_scriptparam,
+                  featureSize
+                 );
 }
 
 void HWMapContainer::previewClicked()
@@ -649,7 +712,11 @@ void HWMapContainer::setRandomMap()
 
 void HWMapContainer::setRandomSeed()
 {
-    setSeed(QUuid::createUuid().toString());
+    // its preview has likely been prefetched already
+    QString seed = m_nextSeed;
+    m_nextSeed = QUuid::createUuid().toString();
+
+    setSeed(seed);
     emit seedChanged(m_seed);
 }
 
@@ -811,6 +878,8 @@ void HWMapContainer::updatePreview()
     if (!m_previewEnabled)
         return;
 
+    m_previewTimer.stop();
+
     if (pMap)
     {
         disconnect(pMap, 0, this, SLOT(onImageReceived(const QPixmap)));
@@ -835,7 +904,12 @@ void HWMapContainer::updatePreview()
         case MapModel::GeneratedPerlin:
         case MapModel::HandDrawnMap:
         case MapModel::FortsMap:
-            askForGeneratedPreview();
+            // known previews are shown right away, everything else waits
+            // until the user has stopped fiddling with the settings
+            if(PreviewCache::instance().contains(PreviewCache::key(previewRequest(m_seed, m_mapFeatureSize))))
+                askForGeneratedPreview();
+            else
+                m_previewTimer.start();
             break;
         default:
             // For maps loaded from image
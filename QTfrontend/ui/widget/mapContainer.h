@@ -27,6 +27,7 @@
 #include <QTextEdit>
 #include <QLineEdit>
 #include <QSlider>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
 
@@ -130,7 +131,10 @@ class HWMapContainer : public QWidget
         QListView* lvThemes;
         ThemeModel * m_themeModel;
         HWMap* pMap;
+        QList<QPointer<HWMap> > m_prefetchMaps;
+        QTimer m_previewTimer; ///< collects bursts of changes into a single preview request
         QString m_seed;
+        QString m_nextSeed; ///< seed the next click on "random" will use, prefetched
         QString m_script;
         QString m_scriptparam;
         QPushButton* seedSet;
@@ -184,6 +188,9 @@ class HWMapContainer : public QWidget
         void changeMapType(MapModel::MapType type, const QModelIndex & newMap = QModelIndex());
         void updateHelpTexts(MapModel::MapType type);
         void updatePreview();
+        QByteArray previewRequest(const QString & seed, int featureSize);
+        void prefetchPreviews();
+        void prefetchPreview(const QString & seed, int featureSize);
         void updateThemeButtonSize();
         void setupMissionMapsView(const QString & initialMap = QString());
         void setupStaticMapsView(const QString & initialMap = QString());
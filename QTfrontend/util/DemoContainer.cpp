@@ -0,0 +1,232 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief DemoContainer and DemoReader class implementations
+ */
+
+#include <QFile>
+
+#include "DemoContainer.h"
+
+bool DemoContainer::isPacked(const QByteArray & head)
+{
+    // a packed record of unknown version counts as packed, it must not be
+    // sent to the engine as frames
+    return hwdemoHeaderSize(head.constData(), head.size()) != 0;
+}
+
+QByteArray DemoContainer::pack(const QByteArray & record)
+{
+    QByteArray packed((int)hwdemoPackBound(record.size()), Qt::Uninitialized);
+
+    size_t size = hwdemoPack(record.constData(), record.size(), packed.data(), packed.size());
+    if(size == 0)
+    {
+        qWarning("Could not pack record, saving it plain");
+        return record;
+    }
+
+    packed.truncate(size);
+    return packed;
+}
+
+QByteArray DemoContainer::unpack(const QByteArray & data)
+{
+    if(!isPacked(data))
+        return data;
+
+    int headerSize = hwdemoHeaderSize(data.constData(), data.size());
+    if((headerSize <= 0) || (headerSize > data.size()))
+        return QByteArray();
+
+    const char * header = data.constData();
+    QByteArray result(hwdemoUnpackedSize(header), Qt::Uninitialized);
+    qint64 pos = 0;
+
+    for(int i = 0; i < hwdemoBlockCount(header); ++i)
+    {
+        HWDemoBlock block;
+        hwdemoBlockInfo(header, i, &block);
+
+        if(((qint64)block.offset + block.packedSize > data.size())
+                || (pos + block.unpackedSize > result.size())
+                || hwdemoUnpackBlock(header, i, data.constData() + block.offset, block.packedSize, result.data() + pos))
+            return QByteArray();
+
+        pos += block.unpackedSize;
+    }
+
+    result.truncate(pos);
+    return result;
+}
+
+QIODevice * DemoContainer::open(const QString & fileName)
+{
+    QFile * file = new QFile(fileName);
+    if(!file->open(QIODevice::ReadOnly))
+    {
+        delete file;
+        return 0;
+    }
+
+    if(!isPacked(file->peek(HWDEMO_HEADER_SIZE)))
+        return file;
+
+    DemoReader * reader = new DemoReader(file);
+    if(!reader->open(QIODevice::ReadOnly))
+    {
+        delete reader;
+        return 0;
+    }
+
+    return reader;
+}
+
+DemoReader::DemoReader(QIODevice * source, QObject * parent) :
+    QIODevice(parent),
+    m_source(source),
+    m_blockPos(0),
+    m_nextBlock(0),
+    m_remaining(0)
+{
+    m_source->setParent(this);
+}
+
+bool DemoReader::open(OpenMode mode)
+{
+    if(mode & QIODevice::WriteOnly)
+        return false;
+
+    m_header = m_source->read(HWDEMO_HEADER_SIZE);
+    int headerSize = hwdemoHeaderSize(m_header.constData(), m_header.size());
+    if(headerSize <= 0)
+        return false;
+
+    m_header += m_source->read(headerSize - m_header.size());
+    if(m_header.size() != headerSize)
+        return false;
+
+    m_block.clear();
+    m_blockPos = 0;
+    m_nextBlock = 0;
+    m_remaining = hwdemoUnpackedSize(m_header.constData());
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+bool DemoReader::isSequential() const
+{
+    return true;
+}
+
+qint64 DemoReader::bytesAvailable() const
+{
+    // counts blocks not unpacked yet, otherwise atEnd() would be true
+    // between two blocks
+    return m_remaining + QIODevice::bytesAvailable();
+}
+
+int DemoReader::blockCount() const
+{
+    return m_header.isEmpty() ? 0 : hwdemoBlockCount(m_header.constData());
+}
+
+bool DemoReader::blockInfo(int block, HWDemoBlock & info) const
+{
+    return !m_header.isEmpty() && (hwdemoBlockInfo(m_header.constData(), block, &info) == 0);
+}
+
+int DemoReader::findBlock(quint32 tick) const
+{
+    return m_header.isEmpty() ? -1 : hwdemoFindBlock(m_header.constData(), tick);
+}
+
+bool DemoReader::seekBlock(int block)
+{
+    if((block < 0) || (block >= blockCount()))
+        return false;
+
+    m_remaining = 0;
+    for(int i = block; i < blockCount(); ++i)
+    {
+        HWDemoBlock info;
+        blockInfo(i, info);
+        m_remaining += info.unpackedSize;
+    }
+
+    m_block.clear();
+    m_blockPos = 0;
+    m_nextBlock = block;
+
+    return true;
+}
+
+bool DemoReader::loadBlock()
+{
+    HWDemoBlock info;
+    if(!blockInfo(m_nextBlock, info))
+        return false;
+
+    m_block.resize(info.unpackedSize);
+    m_blockPos = 0;
+
+    QByteArray packed;
+    if(m_source->seek(info.offset))
+        packed = m_source->read(info.packedSize);
+
+    if((packed.size() != (int)info.packedSize)
+            || hwdemoUnpackBlock(m_header.constData(), m_nextBlock, packed.constData(), packed.size(), m_block.data()))
+    {
+        qWarning("Record block %d is damaged", m_nextBlock);
+        m_block.clear();
+        m_remaining = 0;
+        return false;
+    }
+
+    ++m_nextBlock;
+    return true;
+}
+
+qint64 DemoReader::readData(char * data, qint64 maxSize)
+{
+    qint64 read = 0;
+
+    while(read < maxSize)
+    {
+        if((m_blockPos >= m_block.size()) && !loadBlock())
+            break;
+
+        qint64 size = qMin(maxSize - read, (qint64)(m_block.size() - m_blockPos));
+        memcpy(data + read, m_block.constData() + m_blockPos, size);
+        m_blockPos += size;
+        m_remaining -= size;
+        read += size;
+    }
+
+    return read;
+}
+
+qint64 DemoReader::writeData(const char * data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+
+    return -1;
+}
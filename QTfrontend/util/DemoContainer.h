@@ -0,0 +1,115 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief DemoContainer and DemoReader class definitions
+ */
+
+#ifndef HEDGEWARS_DEMOCONTAINER_H
+#define HEDGEWARS_DEMOCONTAINER_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+#include "hwdemo.h"
+
+/**
+ * @brief Reading and writing of packed demo and save files.
+ *
+ * Packed records hold the IPC stream in LZMA compressed blocks with an
+ * index keyed by game tick, see hwdemo.h in physlayer for the layout.
+ * Plain records (a concatenation of IPC frames) are still accepted
+ * everywhere a record is read.
+ */
+class DemoContainer
+{
+    public:
+        static bool isPacked(const QByteArray & head);
+
+        /**
+         * @brief Packs a plain record.
+         *
+         * @return the packed record, or the plain one if packing failed.
+         */
+        static QByteArray pack(const QByteArray & record);
+
+        /**
+         * @brief Returns the plain IPC stream of a packed or plain record.
+         *
+         * @return empty array if a packed record is damaged.
+         */
+        static QByteArray unpack(const QByteArray & data);
+
+        /**
+         * @brief Opens a record file for reading its plain IPC stream.
+         *
+         * Packed records are unpacked block by block while they are read.
+         *
+         * @return open device owned by the caller, 0 if the file can't be read.
+         */
+        static QIODevice * open(const QString & fileName);
+};
+
+/**
+ * @brief Sequential device unpacking a packed record as it is read.
+ *
+ * Only one block is kept in memory. Reading can start at any block,
+ * findBlock() maps a game tick to the block which has to be read from.
+ */
+class DemoReader : public QIODevice
+{
+        Q_OBJECT
+
+    public:
+        /**
+         * @brief Constructs a reader of an open packed record.
+         *
+         * Takes ownership of source, it has to support seeking.
+         */
+        explicit DemoReader(QIODevice * source, QObject * parent = 0);
+
+        bool open(OpenMode mode);
+        bool isSequential() const;
+        qint64 bytesAvailable() const;
+
+        int blockCount() const;
+        bool blockInfo(int block, HWDemoBlock & info) const;
+        int findBlock(quint32 tick) const;
+
+        /**
+         * @brief Continues reading at the start of a block.
+         */
+        bool seekBlock(int block);
+
+    protected:
+        qint64 readData(char * data, qint64 maxSize);
+        qint64 writeData(const char * data, qint64 maxSize);
+
+    private:
+        QIODevice * m_source;
+        QByteArray m_header;
+        QByteArray m_block;
+        int m_blockPos;
+        int m_nextBlock;
+        qint64 m_remaining;
+
+        bool loadBlock();
+};
+
+#endif // HEDGEWARS_DEMOCONTAINER_H
@@ -0,0 +1,169 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief DemoIndex class implementation
+ */
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QScopedPointer>
+
+#include "DemoContainer.h"
+#include "DemoIndex.h"
+#include "IPCFrameBuffer.h"
+
+// bump when DemoInfo changes
+static const quint32 cacheVersion = 2;
+
+// configuration is at the start, drawn maps being the biggest part of it
+static const qint64 headerLimit = 256 * 1024;
+
+DemoInfo::DemoInfo() :
+    size(-1),
+    modified(-1)
+{
+}
+
+bool DemoInfo::matches(const QString & filter) const
+{
+    if(filter.isEmpty())
+        return true;
+
+    if(QFileInfo(path).fileName().contains(filter, Qt::CaseInsensitive)
+            || map.contains(filter, Qt::CaseInsensitive)
+            || theme.contains(filter, Qt::CaseInsensitive))
+        return true;
+
+    foreach(const QString & team, teams)
+        if(team.contains(filter, Qt::CaseInsensitive))
+            return true;
+
+    return false;
+}
+
+static QDataStream & operator<<(QDataStream & stream, const DemoInfo & info)
+{
+    return stream << info.path << info.size << info.modified << info.gameType
+                  << info.map << info.theme << info.seed << info.script << info.teams;
+}
+
+static QDataStream & operator>>(QDataStream & stream, DemoInfo & info)
+{
+    return stream >> info.path >> info.size >> info.modified >> info.gameType
+                  >> info.map >> info.theme >> info.seed >> info.script >> info.teams;
+}
+
+DemoIndex & DemoIndex::instance()
+{
+    static DemoIndex instance;
+    return instance;
+}
+
+DemoIndex::DemoIndex() :
+    MetadataIndex("records.idx", cacheVersion)
+{
+    qRegisterMetaTypeStreamOperators<DemoInfo>("DemoInfo");
+
+    load();
+}
+
+void DemoIndex::watch(const QString & path, const QString & pattern)
+{
+    watchDirectory(path, QStringList(pattern));
+}
+
+bool DemoIndex::find(const QString & path, DemoInfo & info) const
+{
+    QVariant data;
+    if(!lookup(path, data))
+        return false;
+
+    info = data.value<DemoInfo>();
+    return true;
+}
+
+QVariant DemoIndex::parseFile(const QString & path, const QVariant & options) const
+{
+    Q_UNUSED(options);
+    return QVariant::fromValue(parse(path));
+}
+
+DemoInfo DemoIndex::parse(const QString & path)
+{
+    DemoInfo info;
+    info.path = path;
+
+    QFileInfo fi(path);
+    info.size = fi.size();
+    info.modified = fi.lastModified().toMSecsSinceEpoch();
+
+    // for packed records only the first blocks get unpacked
+    QScopedPointer<QIODevice> file(DemoContainer::open(path));
+    if(!file)
+        return info;
+
+    IPCFrameBuffer frames;
+    frames.append(file->read(headerLimit));
+
+    QByteArray frame;
+    while(frames.next(frame))
+    {
+        QByteArray msg = IPCFrameBuffer::payload(frame);
+        if(msg.isEmpty())
+            continue;
+
+        if(msg.at(0) == 'T')
+        {
+            info.gameType = QString::fromLatin1(msg);
+            continue;
+        }
+
+        // game messages follow the configuration, which ends with the teams
+        if(msg.at(0) != 'e')
+        {
+            if(!info.teams.isEmpty())
+                break;
+            continue;
+        }
+
+        int space = msg.indexOf(' ');
+        QByteArray command = msg.mid(1, space - 1);
+        QString argument = space > 0 ? QString::fromUtf8(msg.mid(space + 1)) : QString();
+
+        if(command == "map")
+            info.map = argument;
+        else if(command == "theme")
+            info.theme = argument;
+        else if(command == "seed")
+            info.seed = argument;
+        else if(command == "script")
+            info.script = argument;
+        else if(command == "addteam")
+        {
+            // eaddteam <owner hash> <color> <name>
+            QString name = argument.section(' ', 2);
+            if(!name.isEmpty())
+                info.teams << name;
+        }
+    }
+
+    return info;
+}
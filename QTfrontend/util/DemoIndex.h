@@ -0,0 +1,101 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief DemoIndex class definition
+ */
+
+#ifndef HEDGEWARS_DEMOINDEX_H
+#define HEDGEWARS_DEMOINDEX_H
+
+#include <QMetaType>
+#include <QStringList>
+
+#include "MetadataIndex.h"
+
+/**
+ * @brief What the header of a demo or save file tells about the game.
+ */
+struct DemoInfo
+{
+    QString path;
+    qint64 size;
+    qint64 modified; ///< ms since epoch
+    QString gameType; ///< "TD", "TL", "TN" or "TS"
+    QString map; ///< empty for generated maps
+    QString theme;
+    QString seed;
+    QString script;
+    QStringList teams;
+
+    DemoInfo();
+    bool matches(const QString & filter) const;
+};
+
+Q_DECLARE_METATYPE(DemoInfo)
+
+/**
+ * @brief Background indexer of demo and save files.
+ *
+ * Only the configuration at the start of each record is parsed.
+ *
+ * @see <a href="https://en.wikipedia.org/wiki/Singleton_pattern">singleton pattern</a>
+ */
+class DemoIndex : public MetadataIndex
+{
+        Q_OBJECT
+
+    public:
+        /**
+         * @brief Returns reference to the <i>singleton</i> instance of this class.
+         *
+         * @return reference to the instance.
+         */
+        static DemoIndex & instance();
+
+        /**
+         * @brief Starts indexing a directory and keeps watching it.
+         *
+         * @param path directory with records.
+         * @param pattern file name pattern of the records, e.g. "*.48.hwd".
+         */
+        void watch(const QString & path, const QString & pattern);
+
+        /**
+         * @brief Looks up indexed information of a record.
+         *
+         * @return true if the record has been indexed in its current state.
+         */
+        bool find(const QString & path, DemoInfo & info) const;
+
+        /**
+         * @brief Parses the configuration at the start of a record.
+         *
+         * @return information, empty apart from path, size and date if the file isn't a record.
+         */
+        static DemoInfo parse(const QString & path);
+
+    protected:
+        QVariant parseFile(const QString & path, const QVariant & options) const;
+
+    private:
+        DemoIndex();
+};
+
+#endif // HEDGEWARS_DEMOINDEX_H
@@ -0,0 +1,220 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief IPCFrameBuffer class implementation
+ */
+
+#include <QIODevice>
+
+#include <string.h>
+
+#include "IPCFrameBuffer.h"
+
+IPCFrameBuffer::IPCFrameBuffer(int capacity) :
+    m_data(0),
+    m_capacity(0),
+    m_head(0),
+    m_size(0)
+{
+    reserve(capacity);
+    m_scratch.reserve(256);
+}
+
+IPCFrameBuffer::~IPCFrameBuffer()
+{
+    delete [] m_data;
+}
+
+void IPCFrameBuffer::reserve(int size)
+{
+    if(size <= m_capacity)
+        return;
+
+    int capacity = qMax(m_capacity, 256);
+    while(capacity < size)
+        capacity *= 2;
+
+    // unwrap the contents while moving them
+    char * data = new char[capacity];
+    int first = qMin(m_size, m_capacity - m_head);
+    if(first > 0)
+        memcpy(data, m_data + m_head, first);
+    if(m_size > first)
+        memcpy(data + first, m_data, m_size - first);
+
+    delete [] m_data;
+    m_data = data;
+    m_capacity = capacity;
+    m_head = 0;
+}
+
+void IPCFrameBuffer::append(const char * data, int size)
+{
+    if(size <= 0)
+        return;
+
+    reserve(m_size + size);
+
+    int tail = (m_head + m_size) & (m_capacity - 1);
+    int first = qMin(size, m_capacity - tail);
+    memcpy(m_data + tail, data, first);
+    if(size > first)
+        memcpy(m_data, data + first, size - first);
+
+    m_size += size;
+}
+
+void IPCFrameBuffer::append(const QByteArray & data)
+{
+    append(data.constData(), data.size());
+}
+
+qint64 IPCFrameBuffer::readFrom(QIODevice * device)
+{
+    qint64 total = 0;
+    qint64 available;
+
+    while((available = device->bytesAvailable()) > 0)
+    {
+        reserve(m_size + (int)available);
+
+        // read straight into the free space, it is at most two pieces
+        int tail = (m_head + m_size) & (m_capacity - 1);
+        int chunk = qMin((int)available, qMin(m_capacity - m_size, m_capacity - tail));
+        qint64 read = device->read(m_data + tail, chunk);
+        if(read <= 0)
+            break;
+
+        m_size += read;
+        total += read;
+    }
+
+    return total;
+}
+
+quint8 IPCFrameBuffer::byteAt(int offset) const
+{
+    return m_data[(m_head + offset) & (m_capacity - 1)];
+}
+
+// size of the buffered frame including its header, 0 if it isn't complete
+int IPCFrameBuffer::frameSize() const
+{
+    if(m_size == 0)
+        return 0;
+
+    qint64 size = byteAt(0) + 1;
+    if(size == 1)
+    {
+        if(m_size < IPC_EXTENDED_HEADER)
+            return 0;
+
+        quint32 length = 0;
+        for(int i = 2; i < IPC_EXTENDED_HEADER; ++i)
+            length = (length << 8) | byteAt(i);
+
+        size = IPC_EXTENDED_HEADER + length;
+    }
+
+    return size <= m_size ? (int)size : 0;
+}
+
+bool IPCFrameBuffer::next(QByteArray & frame)
+{
+    int frameSize = this->frameSize();
+    if(frameSize == 0)
+        return false;
+
+    int first = m_capacity - m_head;
+    if(frameSize <= first)
+    {
+        frame = QByteArray::fromRawData(m_data + m_head, frameSize);
+    }
+    else
+    {
+        m_scratch.resize(frameSize);
+        memcpy(m_scratch.data(), m_data + m_head, first);
+        memcpy(m_scratch.data() + first, m_data, frameSize - first);
+        frame = QByteArray::fromRawData(m_scratch.constData(), frameSize);
+    }
+
+    m_head = (m_head + frameSize) & (m_capacity - 1);
+    m_size -= frameSize;
+
+    // keep the next bursts contiguous
+    if(m_size == 0)
+        m_head = 0;
+
+    return true;
+}
+
+QByteArray IPCFrameBuffer::payload(const QByteArray & frame)
+{
+    int header = (!frame.isEmpty() && (frame.at(0) == 0)) ? IPC_EXTENDED_HEADER : 1;
+    if(frame.size() < header)
+        return QByteArray();
+
+    return QByteArray::fromRawData(frame.constData() + header, frame.size() - header);
+}
+
+int IPCFrameBuffer::completeFramesSize(const QByteArray & data)
+{
+    const uchar * buf = (const uchar *)data.constData();
+    qint64 pos = 0;
+
+    while(pos < data.size())
+    {
+        qint64 size = buf[pos] + 1;
+        if(size == 1)
+        {
+            if(pos + IPC_EXTENDED_HEADER > data.size())
+                break;
+
+            quint32 length = 0;
+            for(int i = 2; i < IPC_EXTENDED_HEADER; ++i)
+                length = (length << 8) | buf[pos + i];
+
+            size = IPC_EXTENDED_HEADER + length;
+        }
+
+        if(pos + size > data.size())
+            break;
+
+        pos += size;
+    }
+
+    return (int)pos;
+}
+
+int IPCFrameBuffer::size() const
+{
+    return m_size;
+}
+
+bool IPCFrameBuffer::isEmpty() const
+{
+    return m_size == 0;
+}
+
+void IPCFrameBuffer::clear()
+{
+    m_head = 0;
+    m_size = 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief IPCFrameBuffer class definition
+ */
+
+#ifndef HEDGEWARS_IPCFRAMEBUFFER_H
+#define HEDGEWARS_IPCFRAMEBUFFER_H
+
+#include <QByteArray>
+
+class QIODevice;
+
+#define MAXMSGCHARS 255
+
+// A zero length byte starts an extended frame for payloads which don't fit
+// into MAXMSGCHARS: version byte and big endian 32-bit length follow.
+// Normal frames carry 1 to IPC_MAX_FRAME_PAYLOAD bytes, so the engine's
+// shortstring buffers always have room for a whole frame.
+#define IPC_MAX_FRAME_PAYLOAD 250
+#define IPC_EXTENDED_HEADER 6
+#define IPC_EXTENDED_VERSION 1
+
+/**
+ * @brief Splits the engine IPC stream into frames.
+ *
+ * Incoming bytes are stored in a ring buffer which only grows when a burst
+ * doesn't fit, frames are handed out as views into it
+ * (QByteArray::fromRawData), so parsing doesn't allocate or move the
+ * remaining data per message. Only a frame wrapping around the end of the
+ * ring is copied into a reused scratch buffer.
+ *
+ * A frame is a length byte followed by that many bytes, or an extended
+ * frame header followed by its payload. Views returned by next() include
+ * the header, payload() strips it.
+ */
+class IPCFrameBuffer
+{
+    public:
+        explicit IPCFrameBuffer(int capacity = 4096);
+        ~IPCFrameBuffer();
+
+        void append(const char * data, int size);
+        void append(const QByteArray & data);
+
+        /**
+         * @brief Reads everything available from the device into the buffer.
+         *
+         * @return number of bytes read.
+         */
+        qint64 readFrom(QIODevice * device);
+
+        /**
+         * @brief Takes the next complete frame.
+         *
+         * The view stays valid until the next call to next(), append()
+         * or readFrom(), copy it if it's needed for longer.
+         *
+         * @return false if there is no complete frame buffered.
+         */
+        bool next(QByteArray & frame);
+
+        static QByteArray payload(const QByteArray & frame);
+
+        /**
+         * @brief Measures the complete frames at the start of data.
+         *
+         * @return number of bytes up to the end of the last complete frame.
+         */
+        static int completeFramesSize(const QByteArray & data);
+
+        int size() const;
+        bool isEmpty() const;
+        void clear();
+
+    private:
+        Q_DISABLE_COPY(IPCFrameBuffer)
+
+        char * m_data;
+        int m_capacity; // always a power of two
+        int m_head;
+        int m_size;
+        QByteArray m_scratch;
+
+        void reserve(int size);
+        quint8 byteAt(int offset) const;
+        int frameSize() const;
+};
+
+#endif // HEDGEWARS_IPCFRAMEBUFFER_H
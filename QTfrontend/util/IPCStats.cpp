@@ -0,0 +1,231 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief IPCStats class implementation
+ */
+
+#include <QJsonArray>
+#include <QtEndian>
+
+#include "IPCStats.h"
+#include "IPCFrameBuffer.h"
+
+IPCStats::TypeStats::TypeStats() :
+    count(0),
+    bytes(0),
+    lastSeen(-1),
+    minInterval(-1),
+    maxInterval(0),
+    totalInterval(0)
+{
+    for(int i = 0; i < histogramBuckets; ++i)
+        histogram[i] = 0;
+}
+
+void IPCStats::TypeStats::record(int size, qint64 now)
+{
+    ++count;
+    bytes += size;
+
+    if(lastSeen >= 0)
+    {
+        qint64 interval = now - lastSeen;
+
+        if((minInterval < 0) || (interval < minInterval))
+            minInterval = interval;
+        maxInterval = qMax(maxInterval, interval);
+        totalInterval += interval;
+
+        int bucket = 0;
+        while((bucket < histogramBuckets - 1) && (interval >= (Q_INT64_C(1) << bucket)))
+            ++bucket;
+        ++histogram[bucket];
+    }
+
+    lastSeen = now;
+}
+
+QJsonObject IPCStats::TypeStats::toJson() const
+{
+    QJsonObject result;
+    result["count"] = count;
+    result["bytes"] = bytes;
+
+    if(count > 1)
+    {
+        QJsonArray buckets;
+        for(int i = 0; i < histogramBuckets; ++i)
+            buckets.append(histogram[i]);
+
+        QJsonObject intervals;
+        intervals["min"] = minInterval;
+        intervals["max"] = maxInterval;
+        intervals["avg"] = double(totalInterval) / (count - 1);
+        intervals["histogram"] = buckets;
+        result["interArrival"] = intervals;
+    }
+
+    return result;
+}
+
+IPCStats::IPCStats() :
+    m_started(-1),
+    m_processStarted(-1),
+    m_connected(-1),
+    m_configSent(-1),
+    m_firstTick(-1),
+    m_rawBytes(0),
+    m_netBatches(0),
+    m_netBatchBytes(0)
+{
+    m_clock.start();
+}
+
+void IPCStats::markStarted()
+{
+    m_started = m_clock.elapsed();
+}
+
+void IPCStats::markProcessStarted()
+{
+    m_processStarted = m_clock.elapsed();
+}
+
+void IPCStats::markConnected()
+{
+    m_connected = m_clock.elapsed();
+}
+
+void IPCStats::markFirstTick()
+{
+    if(m_firstTick < 0)
+        m_firstTick = m_clock.elapsed();
+}
+
+void IPCStats::recordOutgoing(const QByteArray & buf)
+{
+    qint64 now = m_clock.elapsed();
+    const uchar * data = (const uchar *)buf.constData();
+    int pos = 0;
+
+    while(pos < buf.size())
+    {
+        int header = 1;
+        qint64 length = data[pos];
+        if(length == 0)
+        {
+            if(pos + IPC_EXTENDED_HEADER > buf.size())
+                break;
+
+            header = IPC_EXTENDED_HEADER;
+            length = qFromBigEndian<quint32>(data + pos + 2);
+        }
+
+        if((length == 0) || (pos + header + length > buf.size()))
+            break;
+
+        quint8 type = data[pos + header];
+
+        // config is made of engine commands, it's the first thing sent
+        if((m_configSent < 0) && (type == 'e'))
+            m_configSent = now;
+
+        m_outgoing[type].record(header + length, now);
+        pos += header + length;
+    }
+}
+
+void IPCStats::recordIncoming(const QByteArray & frame)
+{
+    QByteArray payload = IPCFrameBuffer::payload(frame);
+    if(payload.isEmpty())
+        return;
+
+    m_incoming[payload.at(0)].record(frame.size(), m_clock.elapsed());
+}
+
+void IPCStats::recordRawIncoming(int size)
+{
+    m_rawBytes += size;
+}
+
+void IPCStats::recordNetBatch(int size)
+{
+    m_netBatches++;
+    m_netBatchBytes += size;
+}
+
+qint64 IPCStats::interval(qint64 from, qint64 to)
+{
+    return ((from < 0) || (to < 0)) ? -1 : to - from;
+}
+
+qint64 IPCStats::startupLatency() const
+{
+    return interval(m_started, m_connected);
+}
+
+qint64 IPCStats::configToFirstTick() const
+{
+    return interval(m_configSent, m_firstTick);
+}
+
+QJsonObject IPCStats::toJson(const QMap<quint8, TypeStats> & stats)
+{
+    QJsonObject result;
+
+    QMap<quint8, TypeStats>::const_iterator i;
+    for(i = stats.constBegin(); i != stats.constEnd(); ++i)
+    {
+        QString type = ((i.key() > 32) && (i.key() < 127))
+                       ? QString(QChar(i.key()))
+                       : QString("0x%1").arg(i.key(), 2, 16, QChar('0'));
+        result[type] = i.value().toJson();
+    }
+
+    return result;
+}
+
+QJsonObject IPCStats::toJson() const
+{
+    QJsonObject timings;
+    timings["queued"] = interval(m_started, m_processStarted);
+    timings["engineStartup"] = interval(m_processStarted, m_connected);
+    timings["startupLatency"] = startupLatency();
+    timings["configToFirstTick"] = configToFirstTick();
+    timings["total"] = m_clock.elapsed();
+
+    QJsonObject result;
+    result["timings"] = timings;
+    result["incoming"] = toJson(m_incoming);
+    result["outgoing"] = toJson(m_outgoing);
+    if(m_rawBytes > 0)
+        result["rawIncomingBytes"] = m_rawBytes;
+
+    if(m_netBatches > 0)
+    {
+        QJsonObject batches;
+        batches["count"] = m_netBatches;
+        batches["bytes"] = m_netBatchBytes;
+        result["netBatches"] = batches;
+    }
+
+    return result;
+}
@@ -0,0 +1,102 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief IPCStats class definition
+ */
+
+#ifndef HEDGEWARS_IPCSTATS_H
+#define HEDGEWARS_IPCSTATS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMap>
+
+/**
+ * @brief Instrumentation of a single frontend-engine IPC connection.
+ *
+ * Counts messages and bytes per message type (the command byte following
+ * the frame header) in both directions, keeps a histogram of the
+ * inter-arrival times of each type and records the milestones of an
+ * engine run: start requested, process started, engine connected, first
+ * config sent and first game tick received. In net games the batches of
+ * engine messages sent to the server are counted as well.
+ */
+class IPCStats
+{
+    public:
+        IPCStats();
+
+        void markStarted();
+        void markProcessStarted();
+        void markConnected();
+        void markFirstTick();
+
+        // buf may hold any number of complete frames
+        void recordOutgoing(const QByteArray & buf);
+        void recordIncoming(const QByteArray & frame);
+        // data which isn't split into frames, e.g. preview images
+        void recordRawIncoming(int size);
+        // engine messages relayed to the server in one batch
+        void recordNetBatch(int size);
+
+        QJsonObject toJson() const;
+
+    private:
+        // inter-arrival times in ms: < 1, < 2, < 4, ..., < 1024, >= 1024
+        static const int histogramBuckets = 12;
+
+        struct TypeStats
+        {
+            TypeStats();
+
+            qint64 count;
+            qint64 bytes;
+            qint64 lastSeen;
+            qint64 minInterval;
+            qint64 maxInterval;
+            qint64 totalInterval;
+            qint64 histogram[histogramBuckets];
+
+            void record(int size, qint64 now);
+            QJsonObject toJson() const;
+        };
+
+        QElapsedTimer m_clock;
+        qint64 m_started;
+        qint64 m_processStarted;
+        qint64 m_connected;
+        qint64 m_configSent;
+        qint64 m_firstTick;
+        qint64 m_rawBytes;
+        qint64 m_netBatches;
+        qint64 m_netBatchBytes;
+
+        QMap<quint8, TypeStats> m_incoming;
+        QMap<quint8, TypeStats> m_outgoing;
+
+        qint64 startupLatency() const; // ms from start request to connection, -1 if unknown
+        qint64 configToFirstTick() const; // ms, -1 if unknown
+
+        static QJsonObject toJson(const QMap<quint8, TypeStats> & stats);
+        static qint64 interval(qint64 from, qint64 to);
+};
+
+#endif // HEDGEWARS_IPCSTATS_H
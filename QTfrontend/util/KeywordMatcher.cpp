@@ -0,0 +1,169 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief KeywordMatcher class implementation
+ */
+
+#include <QQueue>
+
+#include "KeywordMatcher.h"
+
+KeywordMatcher::KeywordMatcher() :
+    m_built(true)
+{
+    clear();
+}
+
+void KeywordMatcher::clear()
+{
+    m_nodes.clear();
+    m_keywords.clear();
+
+    // the root
+    m_nodes.resize(1);
+    m_nodes[0].fail = 0;
+    m_nodes[0].output = -1;
+    m_built = true;
+}
+
+int KeywordMatcher::addKeyword(const QString & keyword)
+{
+    if (keyword.isEmpty())
+        return -1;
+
+    int state = 0;
+    for (int i = 0; i < keyword.size(); ++i)
+    {
+        ushort c = keyword.at(i).unicode();
+        int next = m_nodes[state].next.value(c, -1);
+
+        if (next < 0)
+        {
+            next = m_nodes.size();
+            m_nodes.resize(next + 1);
+            m_nodes[state].next.insert(c, next);
+        }
+
+        state = next;
+    }
+
+    int index = m_keywords.size();
+    m_keywords.append(keyword);
+    m_nodes[state].keywords.append(index);
+    m_built = false;
+
+    return index;
+}
+
+int KeywordMatcher::keywordCount() const
+{
+    return m_keywords.size();
+}
+
+const QString & KeywordMatcher::keyword(int index) const
+{
+    return m_keywords.at(index);
+}
+
+bool KeywordMatcher::isEmpty() const
+{
+    return m_keywords.isEmpty();
+}
+
+// breadth first, so the links of shallower nodes are known already;
+// all links are computed again, keywords may have been added since the
+// last build
+void KeywordMatcher::build()
+{
+    QQueue<int> queue;
+
+    m_nodes[0].fail = 0;
+    m_nodes[0].output = -1;
+
+    foreach (int child, m_nodes[0].next)
+    {
+        m_nodes[child].fail = 0;
+        m_nodes[child].output = -1;
+        queue.enqueue(child);
+    }
+
+    while (!queue.isEmpty())
+    {
+        int state = queue.dequeue();
+
+        QHash<ushort, int>::const_iterator it = m_nodes[state].next.constBegin();
+        for (; it != m_nodes[state].next.constEnd(); ++it)
+        {
+            int child = it.value();
+            int fail = step(m_nodes[state].fail, it.key());
+
+            m_nodes[child].fail = fail;
+            m_nodes[child].output = m_nodes[fail].keywords.isEmpty() ? m_nodes[fail].output : fail;
+            queue.enqueue(child);
+        }
+    }
+
+    m_built = true;
+}
+
+int KeywordMatcher::step(int state, ushort c) const
+{
+    for (;;)
+    {
+        int next = m_nodes[state].next.value(c, -1);
+        if (next >= 0)
+            return next;
+        if (state == 0)
+            return 0;
+        state = m_nodes[state].fail;
+    }
+}
+
+void KeywordMatcher::findAll(const QString & text, QVector<Match> & matches) const
+{
+    matches.clear();
+
+    if (isEmpty())
+        return;
+
+    // the automaton is completed lazily, on the first search after changes
+    if (!m_built)
+        const_cast<KeywordMatcher *>(this)->build();
+
+    const QChar * data = text.constData();
+    int state = 0;
+
+    for (int i = 0; i < text.size(); ++i)
+    {
+        state = step(state, data[i].unicode());
+
+        // the keywords ending here and at all suffixes which are keywords
+        for (int node = state; node > 0; node = m_nodes[node].output)
+        {
+            foreach (int keyword, m_nodes[node].keywords)
+            {
+                Match match;
+                match.keyword = keyword;
+                match.start = i + 1 - m_keywords[keyword].size();
+                matches.append(match);
+            }
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief KeywordMatcher class definition
+ */
+
+#ifndef HEDGEWARS_KEYWORDMATCHER_H
+#define HEDGEWARS_KEYWORDMATCHER_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Finds all occurrences of a set of keywords in one pass.
+ *
+ * An Aho-Corasick automaton: the keywords form a trie, every node knows
+ * the longest suffix of its path that is also a path from the root, and
+ * the longest such suffix at which a keyword ends. Scanning a text
+ * follows one edge per character, so the cost depends on the text and the
+ * number of matches but not on how many keywords there are.
+ *
+ * Matching is exact, lower case text and keywords for case insensitive
+ * matching.
+ */
+class KeywordMatcher
+{
+    public:
+        struct Match
+        {
+            int keyword; ///< index of the keyword in the order added
+            int start;   ///< position of its first character in the text
+        };
+
+        KeywordMatcher();
+
+        void clear();
+
+        /**
+         * @brief Adds a keyword, empty keywords are ignored.
+         *
+         * @return index of the keyword, reported in matches.
+         */
+        int addKeyword(const QString & keyword);
+
+        int keywordCount() const;
+        const QString & keyword(int index) const;
+        bool isEmpty() const;
+
+        /**
+         * @brief Finds all occurrences, overlapping ones included.
+         *
+         * matches is cleared first and ordered by end position.
+         */
+        void findAll(const QString & text, QVector<Match> & matches) const;
+
+    private:
+        struct Node
+        {
+            QHash<ushort, int> next;
+            int fail;
+            int output; // longest suffix node with keywords, -1 if none
+            QVector<int> keywords; // ending exactly here
+        };
+
+        QVector<Node> m_nodes;
+        QVector<QString> m_keywords;
+        bool m_built;
+
+        void build();
+        int step(int state, ushort c) const;
+};
+
+#endif // HEDGEWARS_KEYWORDMATCHER_H
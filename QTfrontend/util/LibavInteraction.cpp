@@ -29,6 +29,8 @@ extern "C"
 #include <QVector>
 #include <QList>
 #include <QComboBox>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include "HWApplication.h"
 
@@ -281,18 +283,25 @@ QString LibavInteraction::getExtension(const QString & format)
 }
 
 // get information abaout file (duration, resolution etc) in multiline string
-QString LibavInteraction::getFileInfo(const QString & filepath)
+VideoFileInfo LibavInteraction::readFileInfo(const QString & filepath)
 {
+    // probing opens decoders, which older libav doesn't allow from two threads at once
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+
+    VideoFileInfo info;
     AVFormatContext* pContext = NULL;
     QByteArray utf8path = filepath.toUtf8();
     if (avformat_open_input(&pContext, utf8path.data(), NULL, NULL) < 0)
-        return "";
+        return info;
     if (avformat_find_stream_info(pContext, NULL) < 0)
-        return "";
+    {
+        avformat_close_input(&pContext);
+        return info;
+    }
 
-    int s = float(pContext->duration)/AV_TIME_BASE;
-    //: Duration in minutes and seconds (SI units)
-    QString desc = tr("Duration: %1min %2s").arg(s/60).arg(s%60) + "\n";
+    info.valid = true;
+    info.duration = float(pContext->duration)/AV_TIME_BASE;
     for (int i = 0; i < (int)pContext->nb_streams; i++)
     {
         AVStream* pStream = pContext->streams[i];
@@ -301,40 +310,64 @@ QString LibavInteraction::getFileInfo(const QString & filepath)
         AVCodecContext* pCodec = pContext->streams[i]->codec;
         if (!pCodec)
             continue;
+        if (pCodec->codec_type != AVMEDIA_TYPE_VIDEO && pCodec->codec_type != AVMEDIA_TYPE_AUDIO)
+            continue;
 
-
+        VideoFileInfo::Stream stream;
         AVCodec* pDecoder = avcodec_find_decoder(pCodec->codec_id);
-        QString decoderName = pDecoder ? pDecoder->name : tr("unknown");
-        if (pCodec->codec_type == AVMEDIA_TYPE_VIDEO)
+        stream.decoder = pDecoder ? pDecoder->name : "";
+        stream.isVideo = pCodec->codec_type == AVMEDIA_TYPE_VIDEO;
+        stream.width = pCodec->width;
+        stream.height = pCodec->height;
+        stream.fps = 0;
+        if (stream.isVideo && pStream->avg_frame_rate.den)
+            stream.fps = float(pStream->avg_frame_rate.num)/pStream->avg_frame_rate.den;
+        info.streams.append(stream);
+    }
+    AVDictionaryEntry* pComment = av_dict_get(pContext->metadata, "comment", NULL, 0);
+    if (pComment)
+        info.comment = QString::fromUtf8(pComment->value);
+    avformat_close_input(&pContext);
+    return info;
+}
+
+QString LibavInteraction::getFileInfo(const VideoFileInfo & info)
+{
+    if (!info.valid)
+        return "";
+
+    int s = info.duration;
+    //: Duration in minutes and seconds (SI units)
+    QString desc = tr("Duration: %1min %2s").arg(s/60).arg(s%60) + "\n";
+    foreach (const VideoFileInfo::Stream & stream, info.streams)
+    {
+        QString decoderName = stream.decoder.isEmpty() ? tr("unknown") : stream.decoder;
+        if (stream.isVideo)
         {
-            if (pStream->avg_frame_rate.den)
+            if (stream.fps != 0)
             {
-                float fps = float(pStream->avg_frame_rate.num)/pStream->avg_frame_rate.den;
                 //: Video metadata. %1 = video width, %2 = video height, %3 = frames per second = %4 = decoder name
-                desc += QString(tr("Video: %1x%2, %3 FPS, %4")).arg(pCodec->width).arg(pCodec->height).arg(QLocale().toString(fps, 'f', 2)).arg(decoderName);
+                desc += QString(tr("Video: %1x%2, %3 FPS, %4")).arg(stream.width).arg(stream.height).arg(QLocale().toString(stream.fps, 'f', 2)).arg(decoderName);
             }
             else
             {
                 //: Video metadata. %1 = video width, %2 = video height, %3 = decoder name
-                desc += QString(tr("Video: %1x%2, %3")).arg(pCodec->width).arg(pCodec->height).arg(decoderName);
+                desc += QString(tr("Video: %1x%2, %3")).arg(stream.width).arg(stream.height).arg(decoderName);
             }
         }
-        else if (pCodec->codec_type == AVMEDIA_TYPE_AUDIO)
+        else
         {
             desc += tr("Audio: ");
             desc += decoderName;
         }
-        else
-            continue;
         desc += "\n";
     }
-    AVDictionaryEntry* pComment = av_dict_get(pContext->metadata, "comment", NULL, 0);
-    if (pComment)
+    if (!info.comment.isEmpty())
     {
         // Video comment. We expect a simple key value storage in a particular format
         // and parse it here so the key names can be localized.
         desc += QString("\n");
-        QStringList strings = QString(pComment->value).split('\n');
+        QStringList strings = info.comment.split('\n');
         QString sPlayer, sTheme, sMap, sRecord;
         for(int i=0; i < strings.count(); i++)
         {
@@ -360,7 +393,6 @@ QString LibavInteraction::getFileInfo(const QString & filepath)
             //: As in ‘recording’
             desc += QString(tr("Record: %1")).arg(sRecord);
     }
-    avformat_close_input(&pContext);
     return desc;
 }
 
@@ -389,10 +421,17 @@ QString LibavInteraction::getExtension(const QString & format)
     return QString();
 }
 
-QString LibavInteraction::getFileInfo(const QString & filepath)
+VideoFileInfo LibavInteraction::readFileInfo(const QString & filepath)
 {
     Q_UNUSED(filepath);
 
+    return VideoFileInfo();
+}
+
+QString LibavInteraction::getFileInfo(const VideoFileInfo & info)
+{
+    Q_UNUSED(info);
+
     return QString();
 }
 #endif
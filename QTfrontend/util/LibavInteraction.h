@@ -20,6 +20,29 @@
 #define LIBAV_INTERACTION
 
 #include <QComboBox>
+#include <QList>
+#include <QString>
+
+/**
+ * @brief What libav tells about a video file.
+ */
+struct VideoFileInfo
+{
+    struct Stream
+    {
+        bool isVideo; // audio otherwise
+        int width, height;
+        float fps; // 0 if unknown
+        QString decoder; // empty if unknown
+    };
+
+    bool valid; // false if libav couldn't read the file
+    int duration; // seconds
+    QList<Stream> streams;
+    QString comment; // as written by the engine
+
+    VideoFileInfo() : valid(false), duration(0) {}
+};
 
 /**
  * @brief Class for interacting with ffmpeg/libav libraries
@@ -44,8 +67,11 @@ public:
 
     QString getExtension(const QString & format);
 
-    // get information about file (duration, resolution etc) in multiline string
-    QString getFileInfo(const QString & filepath);
+    // read information about file (duration, resolution etc), can be called from any thread
+    VideoFileInfo readFileInfo(const QString & filepath);
+
+    // information about file in localized multiline string
+    QString getFileInfo(const VideoFileInfo & info);
 };
 
 #endif // LIBAV_INTERACTION
@@ -0,0 +1,246 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief MetadataIndex class implementation
+ */
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPointer>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "hwconsts.h"
+
+#include "MetadataIndex.h"
+
+// parses files one after another, results are queued back to the index
+class MetadataParser : public QRunnable
+{
+    public:
+        MetadataParser(MetadataIndex * index, const QStringList & paths, const QVariant & options) :
+            m_index(index), m_paths(paths), m_options(options) {}
+
+        void run()
+        {
+            foreach(const QString & path, m_paths)
+            {
+                if(!m_index)
+                    return;
+
+                // stamp before parsing, a file written meanwhile is parsed again
+                QFileInfo fi(path);
+                qint64 size = fi.size();
+                qint64 modified = fi.lastModified().toMSecsSinceEpoch();
+                QVariant data = m_index->parseFile(path, m_options);
+
+                QMetaObject::invokeMethod(m_index, "onParsed", Qt::QueuedConnection,
+                                          Q_ARG(QString, path), Q_ARG(qint64, size),
+                                          Q_ARG(qint64, modified), Q_ARG(QVariant, data));
+            }
+        }
+
+    private:
+        QPointer<MetadataIndex> m_index;
+        QStringList m_paths;
+        QVariant m_options;
+};
+
+MetadataIndex::MetadataIndex(const QString & cacheName, quint32 cacheVersion) :
+    QObject(0),
+    m_cacheVersion(cacheVersion)
+{
+    QDir().mkpath(cfgdir->absolutePath() + "/Cache");
+    m_cacheFile = cfgdir->absolutePath() + "/Cache/" + cacheName;
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(2000);
+    connect(&m_saveTimer, SIGNAL(timeout()), this, SLOT(save()));
+
+    connect(&m_watcher, SIGNAL(directoryChanged(const QString &)), this, SLOT(onDirectoryChanged(const QString &)));
+}
+
+bool MetadataIndex::loadHeader(QDataStream & stream)
+{
+    Q_UNUSED(stream);
+    return true;
+}
+
+void MetadataIndex::saveHeader(QDataStream & stream) const
+{
+    Q_UNUSED(stream);
+}
+
+void MetadataIndex::load()
+{
+    QFile file(m_cacheFile);
+    if(!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 version;
+    stream >> version;
+    if((version != m_cacheVersion) || !loadHeader(stream))
+        return;
+
+    quint32 count;
+    stream >> count;
+    for(quint32 i = 0; (i < count) && (stream.status() == QDataStream::Ok); ++i)
+    {
+        QString path;
+        Entry entry;
+        stream >> path >> entry.size >> entry.modified >> entry.data;
+        if((stream.status() == QDataStream::Ok) && entry.data.isValid())
+            m_entries.insert(path, entry);
+    }
+}
+
+void MetadataIndex::save()
+{
+    QFile file(m_cacheFile);
+    if(!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream << m_cacheVersion;
+    saveHeader(stream);
+
+    stream << quint32(m_entries.size());
+    QHash<QString, Entry>::const_iterator i = m_entries.constBegin();
+    for(; i != m_entries.constEnd(); ++i)
+        stream << i.key() << i->size << i->modified << i->data;
+}
+
+void MetadataIndex::watchDirectory(const QString & path, const QStringList & patterns)
+{
+    QString dir = QDir(path).absolutePath();
+    m_patterns[dir] = patterns;
+
+    if(!m_watcher.directories().contains(dir))
+        m_watcher.addPath(dir);
+
+    scan(dir);
+}
+
+bool MetadataIndex::lookup(const QString & path, QVariant & data) const
+{
+    QHash<QString, Entry>::const_iterator i = m_entries.constFind(path);
+    if(i == m_entries.constEnd())
+        return false;
+
+    data = i->data;
+    return true;
+}
+
+void MetadataIndex::clearEntries()
+{
+    m_entries.clear();
+    m_saveTimer.start();
+}
+
+void MetadataIndex::setParseOptions(const QVariant & options)
+{
+    m_parseOptions = options;
+}
+
+void MetadataIndex::scan(const QString & path)
+{
+    QDir dir(path);
+    QStringList toParse;
+    QSet<QString> present;
+
+    // stat only, parsing happens in the background
+    foreach(const QFileInfo & fi, dir.entryInfoList(m_patterns[path], QDir::Files))
+    {
+        QString file = fi.absoluteFilePath();
+        present.insert(file);
+
+        QHash<QString, Entry>::const_iterator i = m_entries.constFind(file);
+        if((i != m_entries.constEnd())
+                && (i->size == fi.size())
+                && (i->modified == fi.lastModified().toMSecsSinceEpoch()))
+            continue;
+
+        if(!m_pending.contains(file))
+        {
+            m_pending.insert(file);
+            toParse << file;
+        }
+    }
+
+    // forget files which are gone
+    bool removed = false;
+    QHash<QString, Entry>::iterator i = m_entries.begin();
+    while(i != m_entries.end())
+    {
+        if((QFileInfo(i.key()).absolutePath() == path) && !present.contains(i.key()))
+        {
+            i = m_entries.erase(i);
+            removed = true;
+        }
+        else
+            ++i;
+    }
+
+    if(removed)
+        m_saveTimer.start();
+
+    if(!toParse.isEmpty())
+    {
+        QThreadPool::globalInstance()->start(new MetadataParser(this, toParse, m_parseOptions), -1);
+    }
+}
+
+void MetadataIndex::onDirectoryChanged(const QString & path)
+{
+    if(!m_patterns.contains(path))
+        return;
+
+    scan(path);
+    emit directoryChanged(path);
+}
+
+void MetadataIndex::onParsed(const QString & path, qint64 size, qint64 modified, const QVariant & data)
+{
+    m_pending.remove(path);
+
+    // file could have changed or vanished while it was parsed
+    QFileInfo fi(path);
+    if(!fi.exists())
+        return;
+
+    // a file being moved here may still have been written to, parse it again
+    if((fi.size() != size) || (fi.lastModified().toMSecsSinceEpoch() != modified))
+    {
+        scan(fi.absolutePath());
+        return;
+    }
+
+    Entry entry;
+    entry.size = size;
+    entry.modified = modified;
+    entry.data = data;
+    m_entries.insert(path, entry);
+    m_saveTimer.start();
+
+    emit fileIndexed(path);
+}
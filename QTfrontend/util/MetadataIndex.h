@@ -0,0 +1,123 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief MetadataIndex class definition
+ */
+
+#ifndef HEDGEWARS_METADATAINDEX_H
+#define HEDGEWARS_METADATAINDEX_H
+
+#include <QDataStream>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QVariant>
+
+class MetadataParser;
+
+/**
+ * @brief Base of the indexes which read information about files in the background.
+ *
+ * Files of the watched directories are parsed in a worker thread. Results
+ * are kept in a cache file keyed by path, size and modification time, so
+ * unchanged files are never parsed twice. Watched directories are
+ * rescanned incrementally when they change.
+ *
+ * Subclasses parse a single file into a QVariant of a type with registered
+ * stream operators, and call load() once they are constructed.
+ */
+class MetadataIndex : public QObject
+{
+        Q_OBJECT
+
+    signals:
+        /// File has been (re)indexed.
+        void fileIndexed(const QString & path);
+        /// Files have been added to or removed from the directory.
+        void directoryChanged(const QString & path);
+
+    protected:
+        /**
+         * @param cacheName file name of the cache in the Cache directory.
+         * @param cacheVersion format version of the cache, older caches are dropped.
+         */
+        MetadataIndex(const QString & cacheName, quint32 cacheVersion);
+
+        /// Reads the cache file.
+        void load();
+
+        /**
+         * @brief Starts indexing a directory and keeps watching it.
+         *
+         * @param patterns file name patterns, all files if empty.
+         */
+        void watchDirectory(const QString & path, const QStringList & patterns);
+
+        /// @return true if the file has been indexed in its current state.
+        bool lookup(const QString & path, QVariant & data) const;
+
+        /// Forgets everything indexed, e.g. when it was parsed with other options.
+        void clearEntries();
+
+        /// Passed to parseFile() of files which are queued from now on.
+        void setParseOptions(const QVariant & options);
+
+        /**
+         * @brief Reads the information about a file.
+         *
+         * Called in a worker thread, must not touch anything but the arguments.
+         */
+        virtual QVariant parseFile(const QString & path, const QVariant & options) const = 0;
+
+        /// Reads and writes what the cache keeps apart from the entries.
+        virtual bool loadHeader(QDataStream & stream);
+        virtual void saveHeader(QDataStream & stream) const;
+
+    private:
+        friend class MetadataParser;
+
+        struct Entry
+        {
+            qint64 size;
+            qint64 modified; ///< ms since epoch
+            QVariant data;
+        };
+
+        QHash<QString, Entry> m_entries;
+        QHash<QString, QStringList> m_patterns; ///< directory -> file patterns
+        QSet<QString> m_pending;
+        QVariant m_parseOptions;
+        QFileSystemWatcher m_watcher;
+        QTimer m_saveTimer;
+        QString m_cacheFile;
+        quint32 m_cacheVersion;
+
+        void scan(const QString & path);
+
+    private slots:
+        void onDirectoryChanged(const QString & path);
+        void onParsed(const QString & path, qint64 size, qint64 modified, const QVariant & data);
+        void save();
+};
+
+#endif // HEDGEWARS_METADATAINDEX_H
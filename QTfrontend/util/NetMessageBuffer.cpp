@@ -0,0 +1,300 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief NetMessageBuffer and NetMessage class implementations
+ */
+
+#include <QDebug>
+#include <QIODevice>
+
+#include <limits.h>
+#include <string.h>
+
+#include "NetMessageBuffer.h"
+
+NetMessage::NetMessage() :
+    m_data(0),
+    m_size(0)
+{
+    m_fields.resize(16);
+}
+
+int NetMessage::size() const
+{
+    return m_size;
+}
+
+bool NetMessage::isEmpty() const
+{
+    return m_size == 0;
+}
+
+const char * NetMessage::data(int i) const
+{
+    return m_data + m_fields[i].offset;
+}
+
+int NetMessage::length(int i) const
+{
+    return m_fields[i].length;
+}
+
+QLatin1String NetMessage::command() const
+{
+    if(m_size == 0)
+        return QLatin1String("");
+
+    return QLatin1String(data(0), length(0));
+}
+
+bool NetMessage::equals(int i, const char * str) const
+{
+    int len = strlen(str);
+    return (length(i) == len) && (memcmp(data(i), str, len) == 0);
+}
+
+int NetMessage::toInt(int i, bool * ok) const
+{
+    const char * p = data(i);
+    const char * end = p + length(i);
+    bool negative = false;
+    qint64 value = 0;
+
+    if((p < end) && ((*p == '-') || (*p == '+')))
+        negative = (*p++ == '-');
+
+    bool valid = p < end;
+    for(; valid && (p < end); ++p)
+    {
+        if((*p < '0') || (*p > '9'))
+            valid = false;
+        else
+        {
+            value = value * 10 + (*p - '0');
+            if(value > (qint64)INT_MAX + 1)
+                valid = false;
+        }
+    }
+
+    if(negative)
+        value = -value;
+    if(valid && (value > INT_MAX))
+        valid = false;
+
+    if(ok)
+        *ok = valid;
+
+    return valid ? (int)value : 0;
+}
+
+QString NetMessage::string(int i) const
+{
+    return QString::fromUtf8(data(i), length(i));
+}
+
+QStringList NetMessage::strings(int from) const
+{
+    QStringList list;
+    list.reserve(qMax(0, m_size - from));
+    for(int i = from; i < m_size; ++i)
+        list << string(i);
+
+    return list;
+}
+
+QByteArray NetMessage::bytes(int i) const
+{
+    return QByteArray(data(i), length(i));
+}
+
+void NetMessage::clear(const char * data)
+{
+    m_data = data;
+    m_size = 0;
+}
+
+void NetMessage::addField(int offset, int length)
+{
+    if(m_size == m_fields.size())
+        m_fields.resize(m_size * 2);
+
+    Field & field = m_fields[m_size++];
+    field.offset = offset;
+    field.length = length;
+}
+
+QDebug operator<<(QDebug dbg, const NetMessage & msg)
+{
+    return dbg << msg.strings();
+}
+
+
+NetMessageBuffer::NetMessageBuffer(int capacity) :
+    m_data(0),
+    m_capacity(0),
+    m_begin(0),
+    m_end(0),
+    m_scanned(0)
+{
+    reserve(capacity);
+}
+
+NetMessageBuffer::~NetMessageBuffer()
+{
+    delete [] m_data;
+}
+
+// makes room for size more bytes after m_end
+void NetMessageBuffer::reserve(int size)
+{
+    if(m_end + size <= m_capacity)
+        return;
+
+    // the consumed part at the front is usually enough
+    int used = m_end - m_begin;
+    if((m_begin > 0) && (used + size <= m_capacity))
+    {
+        memmove(m_data, m_data + m_begin, used);
+    }
+    else
+    {
+        int capacity = qMax(m_capacity, 1024);
+        while(capacity < used + size)
+            capacity *= 2;
+
+        char * data = new char[capacity];
+        if(used > 0)
+            memcpy(data, m_data + m_begin, used);
+
+        delete [] m_data;
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+    m_scanned -= m_begin;
+    m_end = used;
+    m_begin = 0;
+}
+
+void NetMessageBuffer::append(const char * data, int size)
+{
+    if(size <= 0)
+        return;
+
+    reserve(size);
+    memcpy(m_data + m_end, data, size);
+    m_end += size;
+}
+
+void NetMessageBuffer::append(const QByteArray & data)
+{
+    append(data.constData(), data.size());
+}
+
+qint64 NetMessageBuffer::readFrom(QIODevice * device)
+{
+    qint64 total = 0;
+    qint64 available;
+
+    while((available = device->bytesAvailable()) > 0)
+    {
+        reserve((int)available);
+
+        qint64 read = device->read(m_data + m_end, m_capacity - m_end);
+        if(read <= 0)
+            break;
+
+        m_end += read;
+        total += read;
+    }
+
+    return total;
+}
+
+bool NetMessageBuffer::next(NetMessage & msg)
+{
+    if(m_begin == m_end)
+        return false;
+
+    // find the empty line ending the message, a message which is
+    // just an empty line has no fields
+    int end = m_begin;
+    if(m_data[m_begin] != '\n')
+    {
+        int pos = qMax(m_scanned, m_begin);
+        for(;;)
+        {
+            const char * nl = (const char *)memchr(m_data + pos, '\n', m_end - pos);
+            if(!nl)
+            {
+                m_scanned = m_end;
+                return false;
+            }
+
+            end = nl - m_data;
+            if(end + 1 >= m_end)
+            {
+                // can't tell yet, look at this newline again next time
+                m_scanned = end;
+                return false;
+            }
+
+            if(m_data[end + 1] == '\n')
+                break;
+
+            pos = end + 1;
+        }
+    }
+
+    msg.clear(m_data);
+
+    int field = m_begin;
+    while(field < end)
+    {
+        const char * nl = (const char *)memchr(m_data + field, '\n', end - field);
+        int fieldEnd = nl ? nl - m_data : end;
+        msg.addField(field, fieldEnd - field);
+        field = fieldEnd + 1;
+    }
+
+    m_begin = (end == m_begin) ? end + 1 : end + 2;
+    m_scanned = m_begin;
+
+    // keep the next bursts at the front
+    if(m_begin == m_end)
+        m_begin = m_end = m_scanned = 0;
+
+    return true;
+}
+
+int NetMessageBuffer::size() const
+{
+    return m_end - m_begin;
+}
+
+bool NetMessageBuffer::isEmpty() const
+{
+    return m_begin == m_end;
+}
+
+void NetMessageBuffer::clear()
+{
+    m_begin = m_end = m_scanned = 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief NetMessageBuffer and NetMessage class definitions
+ */
+
+#ifndef HEDGEWARS_NETMESSAGEBUFFER_H
+#define HEDGEWARS_NETMESSAGEBUFFER_H
+
+#include <QByteArray>
+#include <QLatin1String>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class QDebug;
+class QIODevice;
+
+/**
+ * @brief A server message split into its fields.
+ *
+ * Fields point into the NetMessageBuffer the message was taken from, so
+ * looking at them doesn't allocate. Only string(), strings() and bytes()
+ * make copies, use them for what is handed over to the UI.
+ */
+class NetMessage
+{
+    public:
+        NetMessage();
+
+        int size() const;
+        bool isEmpty() const;
+
+        const char * data(int i) const;
+        int length(int i) const;
+
+        /// the first field, valid as long as the message is
+        QLatin1String command() const;
+
+        bool equals(int i, const char * str) const;
+        int toInt(int i, bool * ok = 0) const;
+
+        QString string(int i) const;
+        QStringList strings(int from = 0) const;
+        QByteArray bytes(int i) const;
+
+    private:
+        friend class NetMessageBuffer;
+
+        struct Field
+        {
+            int offset;
+            int length;
+        };
+
+        const char * m_data;
+        QVector<Field> m_fields; // only grows, m_size are in use
+        int m_size;
+
+        void clear(const char * data);
+        void addField(int offset, int length);
+};
+
+QDebug operator<<(QDebug dbg, const NetMessage & msg);
+
+/**
+ * @brief Splits the server stream into messages.
+ *
+ * Messages are lines terminated by an empty line. Incoming bytes are kept
+ * in one linear buffer, next() splits the message in place and only the
+ * incomplete tail is moved to the front when more data arrives. The buffer
+ * remembers how far it searched for the end of a message, so a message
+ * arriving in many pieces isn't scanned over and over again.
+ */
+class NetMessageBuffer
+{
+    public:
+        explicit NetMessageBuffer(int capacity = 16384);
+        ~NetMessageBuffer();
+
+        void append(const char * data, int size);
+        void append(const QByteArray & data);
+
+        /**
+         * @brief Reads everything available from the device into the buffer.
+         *
+         * @return number of bytes read.
+         */
+        qint64 readFrom(QIODevice * device);
+
+        /**
+         * @brief Takes the next complete message.
+         *
+         * The message stays valid until the next call to append() or
+         * readFrom(), copy what is needed for longer.
+         *
+         * @return false if there is no complete message buffered.
+         */
+        bool next(NetMessage & msg);
+
+        int size() const;
+        bool isEmpty() const;
+        void clear();
+
+    private:
+        Q_DISABLE_COPY(NetMessageBuffer)
+
+        char * m_data;
+        int m_capacity;
+        int m_begin;
+        int m_end;
+        int m_scanned; // no message ends before this offset
+
+        void reserve(int size);
+};
+
+#endif // HEDGEWARS_NETMESSAGEBUFFER_H
@@ -0,0 +1,194 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief PreviewCache class implementation
+ */
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "hwconsts.h"
+
+#include "PreviewCache.h"
+
+PreviewCache & PreviewCache::instance()
+{
+    static PreviewCache instance;
+    return instance;
+}
+
+PreviewCache::PreviewCache() :
+    m_memory(64),
+    m_diskLimit(32 * 1024 * 1024),
+    m_diskUsage(0),
+    m_memoryHits(0),
+    m_diskHits(0),
+    m_misses(0)
+{
+    m_path = cfgdir->absolutePath() + "/Cache/Previews";
+    QDir().mkpath(m_path);
+
+    foreach(const QFileInfo & fi, QDir(m_path).entryInfoList(QStringList("*.hwp"), QDir::Files))
+        m_diskUsage += fi.size();
+}
+
+QByteArray PreviewCache::key(const QByteArray & request)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    // another engine could render the same request differently
+    hash.addData(cVersionString->toUtf8());
+    hash.addData(cHashString->toUtf8());
+    hash.addData(request);
+
+    return hash.result().toHex();
+}
+
+bool PreviewCache::find(const QByteArray & key, QPixmap & pixmap, int & hhLimit)
+{
+    Preview * preview = m_memory.object(key);
+
+    if(!preview)
+        return false;
+
+    pixmap = preview->pixmap;
+    hhLimit = preview->hhLimit;
+    ++m_memoryHits;
+
+    return true;
+}
+
+bool PreviewCache::contains(const QByteArray & key) const
+{
+    return m_memory.contains(key) || QFile::exists(fileName(key));
+}
+
+QByteArray PreviewCache::load(const QByteArray & key)
+{
+    QFile file(fileName(key));
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        ++m_misses;
+        return QByteArray();
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    // truncated or otherwise broken, the engine has to render it again
+    if(!isValidPreview(data))
+    {
+        remove(key);
+        ++m_misses;
+        return QByteArray();
+    }
+
+    ++m_diskHits;
+
+    return data;
+}
+
+void PreviewCache::remove(const QByteArray & key)
+{
+    m_memory.remove(key);
+
+    QFileInfo fi(fileName(key));
+    if(fi.exists() && QFile::remove(fi.absoluteFilePath()))
+        m_diskUsage -= fi.size();
+}
+
+bool PreviewCache::isValidPreview(const QByteArray & data)
+{
+    // monochrome or 8-bit 256x128 image followed by the hedgehog limit
+    return (data.size() == 128 * 32 + 1) || (data.size() == 128 * 256 + 1);
+}
+
+void PreviewCache::insert(const QByteArray & key, const QByteArray & data, const QPixmap & pixmap, int hhLimit)
+{
+    Preview * preview = new Preview;
+    preview->pixmap = pixmap;
+    preview->hhLimit = hhLimit;
+    m_memory.insert(key, preview);
+
+    if(!isValidPreview(data) || QFile::exists(fileName(key)))
+        return;
+
+    // written to a temporary file first, a crash can't leave a partial entry
+    QSaveFile file(fileName(key));
+    if(file.open(QIODevice::WriteOnly) && (file.write(data) == data.size()) && file.commit())
+    {
+        m_diskUsage += data.size();
+        pruneDisk();
+    }
+}
+
+void PreviewCache::setMemoryLimit(int previews)
+{
+    m_memory.setMaxCost(previews);
+}
+
+void PreviewCache::setDiskLimit(qint64 bytes)
+{
+    m_diskLimit = bytes;
+    pruneDisk();
+}
+
+QJsonObject PreviewCache::toJson() const
+{
+    QJsonObject result;
+    result["memoryHits"] = m_memoryHits;
+    result["diskHits"] = m_diskHits;
+    result["misses"] = m_misses;
+    result["memoryPreviews"] = m_memory.size();
+    result["diskBytes"] = m_diskUsage;
+
+    return result;
+}
+
+QString PreviewCache::fileName(const QByteArray & key) const
+{
+    return m_path + "/" + QString::fromLatin1(key) + ".hwp";
+}
+
+void PreviewCache::pruneDisk()
+{
+    if(m_diskUsage <= m_diskLimit)
+        return;
+
+    // drop oldest files until there is some room again
+    QFileInfoList files = QDir(m_path).entryInfoList(QStringList("*.hwp"), QDir::Files, QDir::Time | QDir::Reversed);
+
+    m_diskUsage = 0;
+    foreach(const QFileInfo & fi, files)
+        m_diskUsage += fi.size();
+
+    foreach(const QFileInfo & fi, files)
+    {
+        if(m_diskUsage <= m_diskLimit * 3 / 4)
+            break;
+
+        if(QFile::remove(fi.absoluteFilePath()))
+            m_diskUsage -= fi.size();
+    }
+}
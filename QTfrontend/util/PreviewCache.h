@@ -0,0 +1,136 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief PreviewCache class definition
+ */
+
+#ifndef HEDGEWARS_PREVIEWCACHE_H
+#define HEDGEWARS_PREVIEWCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QJsonObject>
+#include <QPixmap>
+#include <QString>
+
+/**
+ * @brief Cache of generated map previews.
+ *
+ * Previews are keyed by a hash of the exact IPC request which would be sent
+ * to the engine. Decoded pixmaps are kept in memory (least recently used
+ * ones are dropped first), the raw engine answers are stored on disk in the
+ * user's config directory (oldest ones are dropped first).
+ *
+ * @see <a href="https://en.wikipedia.org/wiki/Singleton_pattern">singleton pattern</a>
+ */
+class PreviewCache
+{
+    public:
+        /**
+         * @brief Returns reference to the <i>singleton</i> instance of this class.
+         *
+         * @return reference to the instance.
+         */
+        static PreviewCache & instance();
+
+        /**
+         * @brief Computes the cache key for an engine request.
+         *
+         * @param request bytes sent to the engine to generate the preview.
+         * @return cache key.
+         */
+        static QByteArray key(const QByteArray & request);
+
+        /**
+         * @brief Looks up a decoded preview in memory.
+         *
+         * @return true on hit.
+         */
+        bool find(const QByteArray & key, QPixmap & pixmap, int & hhLimit);
+
+        /**
+         * @brief Checks whether a preview is available without counting a hit or miss.
+         *
+         * @return true if the preview is in memory or on disk.
+         */
+        bool contains(const QByteArray & key) const;
+
+        /**
+         * @brief Loads the raw engine answer from disk.
+         *
+         * Files which don't have the size of a preview are deleted.
+         *
+         * @return engine answer or empty array on miss.
+         */
+        QByteArray load(const QByteArray & key);
+
+        /**
+         * @brief Drops a preview from memory and disk, e.g. one which can't be decoded.
+         */
+        void remove(const QByteArray & key);
+
+        /**
+         * @brief Checks whether data has the size of an engine preview answer.
+         */
+        static bool isValidPreview(const QByteArray & data);
+
+        /**
+         * @brief Stores a preview, raw data is only written if not on disk yet.
+         */
+        void insert(const QByteArray & key, const QByteArray & data, const QPixmap & pixmap, int hhLimit);
+
+        /**
+         * @brief Sets how many decoded previews are kept in memory.
+         */
+        void setMemoryLimit(int previews);
+
+        /**
+         * @brief Sets the size of the preview files on disk, oldest files are dropped beyond it.
+         */
+        void setDiskLimit(qint64 bytes);
+
+        /**
+         * @brief Returns hit and miss counts and the usage of the cache.
+         */
+        QJsonObject toJson() const;
+
+    private:
+        PreviewCache();
+
+        struct Preview
+        {
+            QPixmap pixmap;
+            int hhLimit;
+        };
+
+        QCache<QByteArray, Preview> m_memory;
+        QString m_path;
+        qint64 m_diskLimit;
+        qint64 m_diskUsage;
+
+        int m_memoryHits;
+        int m_diskHits;
+        int m_misses;
+
+        QString fileName(const QByteArray & key) const;
+        void pruneDisk();
+};
+
+#endif // HEDGEWARS_PREVIEWCACHE_H
@@ -0,0 +1,160 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief VideoIndex class implementation
+ */
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QImage>
+
+#include "hwconsts.h"
+
+#include "VideoIndex.h"
+
+// bump when VideoInfo changes
+static const quint32 cacheVersion = 2;
+
+VideoInfo::VideoInfo() :
+    size(-1),
+    modified(-1)
+{
+}
+
+static QDataStream & operator<<(QDataStream & stream, const VideoFileInfo::Stream & info)
+{
+    return stream << info.isVideo << info.width << info.height << info.fps << info.decoder;
+}
+
+static QDataStream & operator>>(QDataStream & stream, VideoFileInfo::Stream & info)
+{
+    return stream >> info.isVideo >> info.width >> info.height >> info.fps >> info.decoder;
+}
+
+static QDataStream & operator<<(QDataStream & stream, const VideoInfo & info)
+{
+    return stream << info.path << info.size << info.modified
+                  << info.file.valid << info.file.duration << info.file.streams << info.file.comment
+                  << info.prefix << info.thumbnail;
+}
+
+static QDataStream & operator>>(QDataStream & stream, VideoInfo & info)
+{
+    return stream >> info.path >> info.size >> info.modified
+                  >> info.file.valid >> info.file.duration >> info.file.streams >> info.file.comment
+                  >> info.prefix >> info.thumbnail;
+}
+
+VideoIndex & VideoIndex::instance()
+{
+    static VideoIndex instance;
+    return instance;
+}
+
+VideoIndex::VideoIndex() :
+    MetadataIndex("videos.idx", cacheVersion),
+    m_thumbnailDir(cfgdir->absolutePath() + "/VideoTemp")
+{
+    qRegisterMetaTypeStreamOperators<VideoInfo>("VideoInfo");
+
+    // libav is set up when this is first used, which must not happen in the worker
+    LibavInteraction::instance();
+
+    load();
+}
+
+bool VideoIndex::loadHeader(QDataStream & stream)
+{
+    stream >> m_thumbnailSize;
+    return stream.status() == QDataStream::Ok;
+}
+
+void VideoIndex::saveHeader(QDataStream & stream) const
+{
+    stream << m_thumbnailSize;
+}
+
+void VideoIndex::watch(const QString & path, const QSize & thumbnailSize)
+{
+    // thumbnails of another size are of no use
+    if(thumbnailSize != m_thumbnailSize)
+    {
+        clearEntries();
+        m_thumbnailSize = thumbnailSize;
+    }
+
+    setParseOptions(m_thumbnailSize);
+    watchDirectory(path, QStringList());
+}
+
+bool VideoIndex::find(const QString & path, VideoInfo & info) const
+{
+    QVariant data;
+    if(!lookup(path, data))
+        return false;
+
+    info = data.value<VideoInfo>();
+    return true;
+}
+
+QVariant VideoIndex::parseFile(const QString & path, const QVariant & options) const
+{
+    return QVariant::fromValue(parse(path, m_thumbnailDir, options.toSize()));
+}
+
+VideoInfo VideoIndex::parse(const QString & path, const QString & thumbnailDir, const QSize & thumbnailSize)
+{
+    VideoInfo info;
+    info.path = path;
+
+    QFileInfo fi(path);
+    info.size = fi.size();
+    info.modified = fi.lastModified().toMSecsSinceEpoch();
+    info.file = LibavInteraction::instance().readFileInfo(path);
+
+    // the engine puts the prefix (original name) into the comment, enclosed in prefix[???]prefix
+    int prefixBegin = info.file.comment.indexOf("prefix[");
+    int prefixEnd   = info.file.comment.indexOf("]prefix");
+    if(prefixBegin != -1 && prefixEnd != -1)
+    {
+        info.prefix = info.file.comment.mid(prefixBegin + 7, prefixEnd - (prefixBegin + 7));
+        info.file.comment.remove(prefixBegin, prefixEnd + 7 - prefixBegin);
+    }
+    else
+        info.prefix = fi.completeBaseName();
+
+    QString thumbName = thumbnailDir + "/" + info.prefix;
+    QImage image;
+    if(image.load(thumbName + ".png") || image.load(thumbName + ".bmp"))
+    {
+        if(image.height()*thumbnailSize.width() > image.width()*thumbnailSize.height())
+            image = image.scaledToWidth(thumbnailSize.width(), Qt::SmoothTransformation);
+        else
+            image = image.scaledToHeight(thumbnailSize.height(), Qt::SmoothTransformation);
+
+        QBuffer buffer(&info.thumbnail);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "PNG");
+    }
+
+    return info;
+}
@@ -0,0 +1,107 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief VideoIndex class definition
+ */
+
+#ifndef HEDGEWARS_VIDEOINDEX_H
+#define HEDGEWARS_VIDEOINDEX_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QSize>
+
+#include "LibavInteraction.h"
+#include "MetadataIndex.h"
+
+/**
+ * @brief What the videos page shows about a recorded video.
+ */
+struct VideoInfo
+{
+    QString path;
+    qint64 size;
+    qint64 modified; ///< ms since epoch
+    VideoFileInfo file;
+    QString prefix; ///< name of the recording the video was made from
+    QByteArray thumbnail; ///< scaled thumbnail in PNG format, empty if there is none
+
+    VideoInfo();
+};
+
+Q_DECLARE_METATYPE(VideoInfo)
+
+/**
+ * @brief Background indexer of recorded videos.
+ *
+ * Videos are probed with libav and their thumbnails scaled in the
+ * background, looking up a video later doesn't touch the disk.
+ *
+ * @see <a href="https://en.wikipedia.org/wiki/Singleton_pattern">singleton pattern</a>
+ */
+class VideoIndex : public MetadataIndex
+{
+        Q_OBJECT
+
+    public:
+        /**
+         * @brief Returns reference to the <i>singleton</i> instance of this class.
+         *
+         * @return reference to the instance.
+         */
+        static VideoIndex & instance();
+
+        /**
+         * @brief Starts indexing a directory and keeps watching it.
+         *
+         * @param path directory with videos.
+         * @param thumbnailSize size thumbnails are scaled to fit into.
+         */
+        void watch(const QString & path, const QSize & thumbnailSize);
+
+        /**
+         * @brief Looks up indexed information of a video.
+         *
+         * @return true if the video has been indexed in its current state.
+         */
+        bool find(const QString & path, VideoInfo & info) const;
+
+        /**
+         * @brief Reads information and thumbnail of a video.
+         *
+         * @param path video file.
+         * @param thumbnailDir directory with the thumbnails saved while recording.
+         * @param thumbnailSize size the thumbnail is scaled to fit into.
+         */
+        static VideoInfo parse(const QString & path, const QString & thumbnailDir, const QSize & thumbnailSize);
+
+    protected:
+        QVariant parseFile(const QString & path, const QVariant & options) const;
+        bool loadHeader(QDataStream & stream);
+        void saveHeader(QDataStream & stream) const;
+
+    private:
+        VideoIndex();
+
+        QSize m_thumbnailSize;
+        QString m_thumbnailDir;
+};
+
+#endif // HEDGEWARS_VIDEOINDEX_H
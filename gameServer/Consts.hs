@@ -22,4 +22,4 @@ module Consts where
 import qualified Data.ByteString.Char8 as B
 
 serverVersion :: B.ByteString
-serverVersion = "3"
+serverVersion = "4"
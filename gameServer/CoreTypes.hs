@@ -149,6 +149,7 @@ data ClientInfo =
         isKickedFromServer :: !Bool,
         isJoinedMidGame :: !Bool,
         hasAskedList :: !Bool,
+        hasCompactEM :: !Bool,
         clientClan :: !(Maybe B.ByteString),
         checkInfo :: !(Maybe CheckInfo),
         eiLobbyChat,
@@ -19,9 +19,9 @@
 {-# LANGUAGE CPP, OverloadedStrings #-}
 
 #if defined(OFFICIAL_SERVER)
-module EngineInteraction(replayToDemo, checkNetCmd, toEngineMsg, drawnMapData, prependGhostPoints) where
+module EngineInteraction(replayToDemo, checkNetCmd, toEngineMsg, decodeEM, decodeEMR, encodeEM, encodeEngineMsgs, drawnMapData, prependGhostPoints) where
 #else
-module EngineInteraction(checkNetCmd, toEngineMsg) where
+module EngineInteraction(checkNetCmd, toEngineMsg, decodeEM, decodeEMR, encodeEM, encodeEngineMsgs) where
 #endif
 
 import qualified Data.Set as Set
@@ -66,6 +66,33 @@ fromEngineMsg msg = liftM BW.pack (Base64.decode (B.unpack msg) >>= removeLength
         removeLength (x:xs) = if length xs == fromIntegral x then Just xs else Nothing
         removeLength _ = Nothing-}
 
+-- EM carries engine messages base64 encoded, EMR as they are with newlines
+-- and backslashes escaped by a backslash
+decodeEM :: B.ByteString -> Maybe B.ByteString
+decodeEM = either (const Nothing) Just . Base64.decode
+
+encodeEM :: B.ByteString -> B.ByteString
+encodeEM = Base64.encode
+
+decodeEMR :: B.ByteString -> Maybe B.ByteString
+decodeEMR = liftM B.concat . unescape
+    where
+        unescape s = let (a, b) = B.break (== '\\') s in
+            if B.null b then Just [a] else
+                case B.unpack $ B.take 2 b of
+                    "\\n" -> liftM ([a, "\n"] ++) . unescape $ B.drop 2 b
+                    "\\\\" -> liftM ([a, "\\"] ++) . unescape $ B.drop 2 b
+                    _ -> Nothing
+
+-- the command and field relaying engine messages to a client
+encodeEngineMsgs :: Bool -> B.ByteString -> [B.ByteString]
+encodeEngineMsgs True msgs = ["EMR", B.concatMap escape msgs]
+    where
+        escape '\n' = "\\n"
+        escape '\\' = "\\\\"
+        escape c = B.singleton c
+encodeEngineMsgs False msgs = ["EM", encodeEM msgs]
+
 em :: B.ByteString -> B.ByteString
 em = toEngineMsg
 
@@ -76,13 +103,13 @@ splitMessages :: B.ByteString -> [B.ByteString]
 splitMessages = L.unfoldr (\b -> if B.null b then Nothing else Just $ B.splitAt (1 + fromIntegral (BW.head b)) b)
 
 
-checkNetCmd :: [Word8] -> B.ByteString -> (B.ByteString, B.ByteString, Maybe (Maybe B.ByteString))
+-- takes the decoded engine messages, returns the legal and the non empty ones unencoded
+checkNetCmd :: [Word8] -> Maybe B.ByteString -> (B.ByteString, B.ByteString, Maybe (Maybe B.ByteString))
 checkNetCmd teamsIndexes msg = check decoded
     where
-        decoded = liftM splitMessages $ Base64.decode msg
-        check (Left _) = (B.empty, B.empty, Nothing)
-        check (Right msgs) = let (a, b) = (filter isLegal msgs, filter isNonEmpty a) in (encode a, encode b, lft a)
-        encode = Base64.encode . B.concat
+        decoded = liftM splitMessages msg
+        check Nothing = (B.empty, B.empty, Nothing)
+        check (Just msgs) = let (a, b) = (filter isLegal msgs, filter isNonEmpty a) in (B.concat a, B.concat b, lft a)
         isLegal m = (B.length m > 1) && (flip Set.member legalMessages . B.head . B.tail $ m) && not (isMalformed (B.head m) (B.tail m))
         lft = foldr l Nothing
         l m n = let m' = B.head $ B.tail m; tst = flip Set.member in
@@ -254,22 +254,9 @@ handleCmd_inRoom ["TOGGLE_READY"] = do
 
 handleCmd_inRoom ["START_GAME"] = roomAdminOnly startGame
 
-handleCmd_inRoom ["EM", msg] = do
-    cl <- thisClient
-    rm <- thisRoom
-    chans <- roomOthersChans
-
-    let (legalMsgs, nonEmptyMsgs, lastFTMsg) = checkNetCmd (teamIndexes cl) msg
+handleCmd_inRoom ["EM", msg] = relayEngineMsgs $ decodeEM msg
 
-    if teamsInGame cl > 0 && (isJust $ gameInfo rm) && (not $ B.null legalMsgs) then
-        return $ AnswerClients chans ["EM", legalMsgs]
-            : [ModifyRoom (\r -> r{gameInfo = liftM
-                (\g -> g{
-                    roundMsgs = if B.null nonEmptyMsgs then roundMsgs g else nonEmptyMsgs : roundMsgs g
-                    , lastFilteredTimedMsg = fromMaybe (lastFilteredTimedMsg g) lastFTMsg})
-                $ gameInfo r}), RegisterEvent EngineMessage]
-        else
-        return []
+handleCmd_inRoom ["EMR", msg] = relayEngineMsgs $ decodeEMR msg
 
 
 handleCmd_inRoom ["ROUNDFINISHED", _] = do
@@ -508,3 +495,25 @@ handleCmd_inRoom ["LIST"] = return [] -- for old clients (<= 0.9.17)
 handleCmd_inRoom (s:_) = return [ProtocolError $ "Incorrect command '" `B.append` s `B.append` "' (state: in room)"]
 
 handleCmd_inRoom [] = return [ProtocolError "Empty command (state: in room)"]
+
+
+relayEngineMsgs :: Maybe B.ByteString -> Reader (ClientIndex, IRnC) [Action]
+relayEngineMsgs msg = do
+    cl <- thisClient
+    rm <- thisRoom
+    others <- roomOthersClients
+
+    let (legalMsgs, nonEmptyMsgs, lastFTMsg) = checkNetCmd (teamIndexes cl) msg
+    -- each client gets the encoding it asked for
+    let (compactClients, base64Clients) = L.partition hasCompactEM others
+    let answer cls compact = [AnswerClients (map sendChan cls) $ encodeEngineMsgs compact legalMsgs | not $ null cls]
+
+    if teamsInGame cl > 0 && (isJust $ gameInfo rm) && (not $ B.null legalMsgs) then
+        return $ answer compactClients True ++ answer base64Clients False
+            ++ [ModifyRoom (\r -> r{gameInfo = liftM
+                (\g -> g{
+                    roundMsgs = if B.null nonEmptyMsgs then roundMsgs g else encodeEM nonEmptyMsgs : roundMsgs g
+                    , lastFilteredTimedMsg = fromMaybe (lastFilteredTimedMsg g) lastFTMsg})
+                $ gameInfo r}), RegisterEvent EngineMessage]
+        else
+        return []
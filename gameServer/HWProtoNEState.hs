@@ -43,7 +43,7 @@ handleCmd_NotEntered ["NICK", newNick] = do
                 AnswerClients [sendChan cl] ["NICK", newNick] :
                 [CheckRegistered | clientProto cl /= 0]
 
-handleCmd_NotEntered ["PROTO", protoNum] = do
+handleCmd_NotEntered ("PROTO" : protoNum : extensions) = do
     (ci, irnc) <- ask
     let cl = irnc `client` ci
     if clientProto cl > 0 then return [ProtocolError $ loc "Protocol already known."]
@@ -51,11 +51,13 @@ handleCmd_NotEntered ["PROTO", protoNum] = do
         if parsedProto == 0 then return [ProtocolError $ loc "Bad number."]
             else
             return $
-                ModifyClient (\c -> c{clientProto = parsedProto}) :
-                AnswerClients [sendChan cl] ["PROTO", showB parsedProto] :
+                ModifyClient (\c -> c{clientProto = parsedProto, hasCompactEM = compactEM}) :
+                AnswerClients [sendChan cl] ("PROTO" : showB parsedProto : ["EMR" | compactEM]) :
                 [CheckRegistered | not . B.null $ nick cl]
     where
         parsedProto = readInt_ protoNum
+        -- clients of server version 4 and newer may ask for engine messages without base64
+        compactEM = "EMR" `elem` extensions
 
 
 handleCmd_NotEntered ["PASSWORD", passwd] = do
@@ -48,6 +48,12 @@ roomOthersChans = do
     let ri = clientRoom rnc ci
     return $ map (sendChan . client rnc) $ filter (/= ci) (roomClients rnc ri)
 
+roomOthersClients :: Reader (ClientIndex, IRnC) [ClientInfo]
+roomOthersClients = do
+    (ci, rnc) <- ask
+    let ri = clientRoom rnc ci
+    return $ map (client rnc) $ filter (/= ci) (roomClients rnc ri)
+
 roomSameClanChans :: Reader (ClientIndex, IRnC) [ClientChan]
 roomSameClanChans = do
     (ci, rnc) <- ask
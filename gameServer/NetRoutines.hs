@@ -71,6 +71,7 @@ acceptLoop servSock chan = E.bracket openHandle closeHandle (forever . f)
                     False
                     False
                     False
+                    False
                     Nothing
                     Nothing
                     newEventsInfo
@@ -97,6 +97,7 @@ begin
     WriteLn(stdout, ' --no-healthtag');
     WriteLn(stdout, ' --translucent-tags');
     WriteLn(stdout, ' --stats-only');
+    WriteLn(stdout, ' --checkpoint-interval [seconds of game time]');
     WriteLn(stdout, ' --help');
     WriteLn(stdout, '');
     WriteLn(stdout, 'For more detailed help and examples go to:');
@@ -132,6 +133,22 @@ begin
         end
 end;
 
+procedure setIpcSocket(path: shortstring; var wrongParameter:Boolean);
+begin
+{$IFDEF USE_LOCAL_IPC}
+    if isInternal then
+        ipcSocketPath := path
+    else
+        begin
+        WriteLn(stderr, 'ERROR: use of --ipc-socket is not allowed');
+        wrongParameter := true;
+        end
+{$ELSE}
+    WriteLn(stderr, 'ERROR: --ipc-socket is not supported on this platform');
+    wrongParameter := true;
+{$ENDIF}
+end;
+
 function parseNick(nick: shortstring): shortstring;
 begin
     if isInternal then
@@ -215,13 +232,15 @@ const videoarray: array [0..4] of string = ('--fullscreen-width','--fullscreen-h
       otherarray: array [0..2] of string = ('--locale','--fullscreen','--showfps');
       mediaarray: array [0..9] of string = ('--fullscreen-width', '--fullscreen-height', '--width', '--height', '--depth', '--volume','--nomusic','--nosound','--locale','--fullscreen');
       allarray: array [0..17] of string = ('--fullscreen-width','--fullscreen-height', '--width', '--height', '--depth','--volume','--nomusic','--nosound','--locale','--fullscreen','--showfps','--altdmg','--frame-interval','--low-quality','--no-teamtag','--no-hogtag','--no-healthtag','--translucent-tags');
-      reallyAll: array[0..35] of shortstring = (
+      reallyAll: array[0..38] of shortstring = (
                 '--prefix', '--user-prefix', '--locale', '--fullscreen-width', '--fullscreen-height', '--width',
                 '--height', '--frame-interval', '--volume','--nomusic', '--nosound',
                 '--fullscreen', '--showfps', '--altdmg', '--low-quality', '--raw-quality', '--stereo', '--nick',
   {deprecated}  '--depth', '--set-video', '--set-audio', '--set-other', '--set-multimedia', '--set-everything',
   {internal}    '--internal', '--port', '--recorder', '--landpreview',
-  {misc}        '--stats-only', '--gci', '--help','--no-teamtag','--no-hogtag','--no-healthtag','--translucent-tags','--lua-test');
+  {misc}        '--stats-only', '--gci', '--help','--no-teamtag','--no-hogtag','--no-healthtag','--translucent-tags','--lua-test',
+  {internal}    '--landpreview-server', '--ipc-socket',
+  {misc}        '--checkpoint-interval');
 var cmdIndex: byte;
 begin
     parseParameter:= false;
@@ -271,6 +290,9 @@ begin
         {--no-healthtag}        33 : cTagsMask := cTagsMask and (not htHealth);
         {--translucent-tags}    34 : cTagsMask := cTagsMask or htTransparent;
         {--lua-test}            35 : begin cTestLua := true; SetSound(false); cScriptName := getstringParameter(arg, paramIndex, parseParameter); WriteLn(stdout, 'Lua test file specified: ' + cScriptName);end;
+        {--landpreview-server}  36 : begin GameType := gmtLandPreview; cPreviewServer := true; end;
+        {--ipc-socket}          37 : setIpcSocket( getstringParameter(arg, paramIndex, parseParameter), parseParameter );
+        {--checkpoint-interval} 38 : cCheckpointInterval := max(getLongIntParameter(arg, paramIndex, parseParameter), 0) * 1000;
     else
         begin
         //Assume the first "non parameter" is the replay file, anything else is invalid
@@ -27,6 +27,20 @@
 #include "libavutil/avutil.h"
 #include "libavutil/mathematics.h"
 
+#include "colorconv.h"
+
+#ifdef _WIN32
+// condition variables are available since Windows Vista
+#if !defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0600)
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #if (defined _MSC_VER)
 #define AVWRAP_DECL __declspec(dllexport)
 #elif ((__GNUC__ >= 3) && (!__EMX__) && (!sun))
@@ -40,7 +54,6 @@ static AVOutputFormat* g_pFormat;
 static AVStream* g_pAStream;
 static AVStream* g_pVStream;
 static AVFrame* g_pAFrame;
-static AVFrame* g_pVFrame;
 static AVCodec* g_pACodec;
 static AVCodec* g_pVCodec;
 static AVCodecContext* g_pAudio;
@@ -50,6 +63,8 @@ static int g_Width, g_Height;
 static uint32_t g_Frequency, g_Channels;
 static int g_VQuality;
 static AVRational g_Framerate;
+static int g_ConvKernel;
+static int64_t g_VideoPts;
 
 static FILE* g_pSoundFile;
 static int16_t* g_pSamples;
@@ -76,6 +91,7 @@ static uint8_t g_OutBuffer[OUTBUFFER_SIZE];
 
 #define av_frame_alloc                      avcodec_alloc_frame
 #define av_frame_unref                      avcodec_get_frame_defaults
+#define av_frame_make_writable(x)           0
 #define av_packet_rescale_ts                rescale_ts
 
 static void rescale_ts(AVPacket *pkt, AVRational ctb, AVRational stb)
@@ -115,6 +131,64 @@ static void rescale_ts(AVPacket *pkt, AVRational ctb, AVRational stb)
 #endif
 
 
+// threads
+#ifdef _WIN32
+typedef HANDLE             ThreadHandle;
+typedef CRITICAL_SECTION   Mutex;
+typedef CONDITION_VARIABLE CondVar;
+#define THREAD_PROC(Name)  static DWORD WINAPI Name(LPVOID pArg)
+#define THREAD_RETURN      return 0
+#define MutexInit(m)       InitializeCriticalSection(m)
+#define MutexDestroy(m)    DeleteCriticalSection(m)
+#define MutexLock(m)       EnterCriticalSection(m)
+#define MutexUnlock(m)     LeaveCriticalSection(m)
+#define CondInit(c)        InitializeConditionVariable(c)
+#define CondDestroy(c)
+#define CondWait(c, m)     SleepConditionVariableCS(c, m, INFINITE)
+#define CondBroadcast(c)   WakeAllConditionVariable(c)
+
+static int ThreadStart(ThreadHandle* pThread, LPTHREAD_START_ROUTINE pProc)
+{
+    *pThread = CreateThread(NULL, 0, pProc, NULL, 0, NULL);
+    return *pThread ? 0 : -1;
+}
+
+static void ThreadJoin(ThreadHandle Thread)
+{
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+}
+
+static int NumCores()
+{
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+    return Info.dwNumberOfProcessors;
+}
+#else
+typedef pthread_t          ThreadHandle;
+typedef pthread_mutex_t    Mutex;
+typedef pthread_cond_t     CondVar;
+#define THREAD_PROC(Name)  static void* Name(void* pArg)
+#define THREAD_RETURN      return NULL
+#define MutexInit(m)       pthread_mutex_init(m, NULL)
+#define MutexDestroy(m)    pthread_mutex_destroy(m)
+#define MutexLock(m)       pthread_mutex_lock(m)
+#define MutexUnlock(m)     pthread_mutex_unlock(m)
+#define CondInit(c)        pthread_cond_init(c, NULL)
+#define CondDestroy(c)     pthread_cond_destroy(c)
+#define CondWait(c, m)     pthread_cond_wait(c, m)
+#define CondBroadcast(c)   pthread_cond_broadcast(c)
+#define ThreadStart(t, p)  pthread_create(t, NULL, p, NULL)
+#define ThreadJoin(t)      pthread_join(t, NULL)
+
+static int NumCores()
+{
+    long Cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return Cores > 0 ? Cores : 1;
+}
+#endif
+
 // pointer to function from hwengine (uUtils.pas)
 static void (*AddFileLogRaw)(const char* pString);
 
@@ -305,6 +379,12 @@ static int AddVideoStream()
     if (g_pFormat->flags & AVFMT_GLOBALHEADER)
         g_pVideo->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
+#if LIBAVCODEC_VERSION_MAJOR >= 53
+    // let the codec use all cores, it gets frames from a queue anyway
+    g_pVideo->thread_count = 0;
+    g_pVideo->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+#endif
+
 #if LIBAVCODEC_VERSION_MAJOR < 53
     // for some versions of ffmpeg x264 options must be set explicitly
     if (strcmp(g_pVCodec->name, "libx264") == 0)
@@ -340,16 +420,23 @@ static int AddVideoStream()
     if (avcodec_open2(g_pVideo, g_pVCodec, NULL) < 0)
         return FatalError("Could not open video codec %s", g_pVCodec->long_name);
 
-    g_pVFrame = av_frame_alloc();
-    if (!g_pVFrame)
-        return FatalError("Could not allocate frame");
-    av_frame_unref(g_pVFrame);
-
-    g_pVFrame->width = g_Width;
-    g_pVFrame->height = g_Height;
-    g_pVFrame->format = AV_PIX_FMT_YUV420P;
+    return 0;
+}
 
-    return avcodec_default_get_buffer2(g_pVideo, g_pVFrame, 0);
+static AVFrame* AllocVideoFrame()
+{
+    AVFrame* pFrame = av_frame_alloc();
+    if (!pFrame)
+        return NULL;
+    av_frame_unref(pFrame);
+
+    pFrame->width = g_Width;
+    pFrame->height = g_Height;
+    pFrame->format = AV_PIX_FMT_YUV420P;
+
+    if (avcodec_default_get_buffer2(g_pVideo, pFrame, 0) < 0)
+        av_frame_free(&pFrame);
+    return pFrame;
 }
 
 static int WriteFrame(AVFrame* pFrame)
@@ -359,7 +446,7 @@ static int WriteFrame(AVFrame* pFrame)
     // write interleaved audio frame
     if (g_pAStream)
     {
-        VideoTime = (double)g_pVFrame->pts * g_pVStream->time_base.num/g_pVStream->time_base.den;
+        VideoTime = (double)g_VideoPts * g_pVStream->time_base.num/g_pVStream->time_base.den;
         do
         {
             AudioTime = (double)g_pAFrame->pts * g_pAStream->time_base.num/g_pAStream->time_base.den;
@@ -378,7 +465,9 @@ static int WriteFrame(AVFrame* pFrame)
     Packet.data = NULL;
     Packet.size = 0;
 
-    g_pVFrame->pts++;
+    g_VideoPts++;
+    if (pFrame)
+        pFrame->pts = g_VideoPts;
 #if LIBAVCODEC_VERSION_MAJOR < 58
     if (g_pFormat->flags & AVFMT_RAWPICTURE)
     {
@@ -426,50 +515,247 @@ static int WriteFrame(AVFrame* pFrame)
     }
 }
 
-AVWRAP_DECL int AVWrapper_WriteFrame(uint8_t *buf)
+// Frames go through a ring of slots. The engine fills the RGBA buffer of the
+// next free slot, converter threads turn captured slots into YUV frames and
+// the encoder thread encodes converted slots in order and frees them again.
+// So the engine only has to wait when all slots are in use.
+
+enum
 {
-    int x, y, stride = g_Width * 4;
-    uint8_t *data[3];
-
-    // copy pointers, prepare source
-    memcpy(data, g_pVFrame->data, sizeof(data));
-    buf += (g_Height - 1) * stride;
-
-    // convert to YUV 4:2:0
-    for (y = 0; y < g_Height; y++) {
-        for (x = 0; x < g_Width; x++) {
-            int r = buf[x * 4 + 0];
-            int g = buf[x * 4 + 1];
-            int b = buf[x * 4 + 2];
-
-            int luma = (int)(0.299f * r +  0.587f * g + 0.114f * b);
-            data[0][x] = av_clip_uint8(luma);
-
-            if (!(x & 1) && !(y & 1)) {
-                int r = (buf[x * 4 + 0]          + buf[(x + 1) * 4 + 0] +
-                         buf[x * 4 + 0 - stride] + buf[(x + 1) * 4 + 0 - stride]) / 4;
-                int g = (buf[x * 4 + 1]          + buf[(x + 1) * 4 + 1] +
-                         buf[x * 4 + 1 - stride] + buf[(x + 1) * 4 + 1 - stride]) / 4;
-                int b = (buf[x * 4 + 2]          + buf[(x + 1) * 4 + 2] +
-                         buf[x * 4 + 2 - stride] + buf[(x + 1) * 4 + 2 - stride]) / 4;
-
-                int cr = (int)(-0.14713f * r - 0.28886f * g + 0.436f   * b);
-                int cb = (int)( 0.615f   * r - 0.51499f * g - 0.10001f * b);
-                data[1][x / 2] = av_clip_uint8(128 + cr);
-                data[2][x / 2] = av_clip_uint8(128 + cb);
-            }
-        }
-        buf += -stride;
-        data[0] += g_pVFrame->linesize[0];
-        if (y & 1) {
-            data[1] += g_pVFrame->linesize[1];
-            data[2] += g_pVFrame->linesize[2];
+    SLOT_FREE,
+    SLOT_CAPTURED,
+    SLOT_CONVERTING,
+    SLOT_CONVERTED
+};
+
+typedef struct
+{
+    uint8_t* pRGB;
+    AVFrame* pFrame;
+    int State;
+} FrameSlot;
+
+#define MAX_CONVERTERS 4
+
+static FrameSlot* g_pSlots;
+static int g_NumSlots;
+static ThreadHandle g_Encoder;
+static ThreadHandle g_Converters[MAX_CONVERTERS];
+static int g_NumConverters;
+static int g_EncoderStarted;
+static int g_PipelineInit;
+
+// guard everything below, g_Cond is signalled on any change
+static Mutex g_Mutex;
+static CondVar g_Cond;
+static int64_t g_NumCaptured, g_NumConverting, g_NumEncoded;
+static int g_Stop;
+static int g_PipelineError;
+
+THREAD_PROC(ConvertThread)
+{
+    int stride = g_Width * 4;
+    FrameSlot* pSlot;
+    (void)pArg;
+
+    MutexLock(&g_Mutex);
+    for (;;)
+    {
+        while (g_NumConverting == g_NumCaptured && !g_Stop)
+            CondWait(&g_Cond, &g_Mutex);
+        if (g_NumConverting == g_NumCaptured)
+            break;
+
+        pSlot = &g_pSlots[g_NumConverting++ % g_NumSlots];
+        pSlot->State = SLOT_CONVERTING;
+        MutexUnlock(&g_Mutex);
+
+        // the codec may still hold a reference to the previous frame
+        if (av_frame_make_writable(pSlot->pFrame) >= 0)
+        {
+            // frames are bottom-up, convert starting from the last row
+            ColorConv_RGBAToYUV420(g_ConvKernel, pSlot->pRGB + (g_Height - 1) * stride, -stride,
+                                   g_Width, g_Height, pSlot->pFrame->data, pSlot->pFrame->linesize);
         }
+
+        MutexLock(&g_Mutex);
+        pSlot->State = SLOT_CONVERTED;
+        CondBroadcast(&g_Cond);
+    }
+    MutexUnlock(&g_Mutex);
+
+    THREAD_RETURN;
+}
+
+THREAD_PROC(EncodeThread)
+{
+    FrameSlot* pSlot;
+    int ret = 0;
+    (void)pArg;
+
+    MutexLock(&g_Mutex);
+    for (;;)
+    {
+        pSlot = &g_pSlots[g_NumEncoded % g_NumSlots];
+        while (pSlot->State != SLOT_CONVERTED && !(g_Stop && g_NumEncoded == g_NumCaptured))
+            CondWait(&g_Cond, &g_Mutex);
+        if (pSlot->State != SLOT_CONVERTED)
+            break;
+        MutexUnlock(&g_Mutex);
+
+        // after an error frames are only dropped, so that the engine doesn't get stuck
+        if (ret >= 0)
+            ret = WriteFrame(pSlot->pFrame);
+
+        MutexLock(&g_Mutex);
+        if (ret < 0)
+            g_PipelineError = ret;
+        pSlot->State = SLOT_FREE;
+        g_NumEncoded++;
+        CondBroadcast(&g_Cond);
     }
+    MutexUnlock(&g_Mutex);
 
-    return WriteFrame(g_pVFrame);
+    THREAD_RETURN;
 }
 
+// lets the threads finish all captured frames and waits for them
+static void StopPipeline()
+{
+    int i;
+
+    if (!g_PipelineInit)
+        return;
+
+    MutexLock(&g_Mutex);
+    g_Stop = 1;
+    CondBroadcast(&g_Cond);
+    MutexUnlock(&g_Mutex);
+
+    for (i = 0; i < g_NumConverters; i++)
+        ThreadJoin(g_Converters[i]);
+    g_NumConverters = 0;
+    if (g_EncoderStarted)
+        ThreadJoin(g_Encoder);
+    g_EncoderStarted = 0;
+}
+
+static void FreePipeline()
+{
+    int i;
+
+    StopPipeline();
+    for (i = 0; i < g_NumSlots; i++)
+    {
+        av_frame_free(&g_pSlots[i].pFrame);
+        av_free(g_pSlots[i].pRGB);
+    }
+    av_freep(&g_pSlots);
+    g_NumSlots = 0;
+
+    if (g_PipelineInit)
+    {
+        CondDestroy(&g_Cond);
+        MutexDestroy(&g_Mutex);
+        g_PipelineInit = 0;
+    }
+}
+
+static int StartPipeline()
+{
+    int i;
+
+    MutexInit(&g_Mutex);
+    CondInit(&g_Cond);
+    g_PipelineInit = 1;
+    g_NumCaptured = g_NumConverting = g_NumEncoded = 0;
+    g_Stop = 0;
+    g_PipelineError = 0;
+
+    // conversion is much cheaper than encoding, the codec gets the other cores
+    g_NumConverters = NumCores() / 4;
+    if (g_NumConverters < 1)
+        g_NumConverters = 1;
+    if (g_NumConverters > MAX_CONVERTERS)
+        g_NumConverters = MAX_CONVERTERS;
+
+    // one slot for each thread and two more so that the engine can capture meanwhile
+    g_NumSlots = g_NumConverters + 3;
+    g_pSlots = (FrameSlot*)av_mallocz(g_NumSlots * sizeof(FrameSlot));
+    if (!g_pSlots)
+        return FatalError("Could not allocate frame queue");
+    for (i = 0; i < g_NumSlots; i++)
+    {
+        g_pSlots[i].pRGB = (uint8_t*)av_malloc(g_Width * g_Height * 4);
+        if (!g_pSlots[i].pRGB)
+            return FatalError("Could not allocate frame queue");
+        if (g_pVStream && !(g_pSlots[i].pFrame = AllocVideoFrame()))
+            return FatalError("Could not allocate frame");
+    }
+
+    // without video stream frames are just dropped
+    if (!g_pVStream)
+    {
+        g_NumConverters = 0;
+        return 0;
+    }
+
+    for (i = 0; i < g_NumConverters; i++)
+        if (ThreadStart(&g_Converters[i], ConvertThread) != 0)
+            break;
+    g_NumConverters = i;
+    if (g_NumConverters == 0)
+        return FatalError("Could not start conversion threads");
+    if (ThreadStart(&g_Encoder, EncodeThread) != 0)
+        return FatalError("Could not start encoding thread");
+    g_EncoderStarted = 1;
+
+    Log("Encoding with %d conversion threads, %d frames queued at most\n", g_NumConverters, g_NumSlots);
+    return 0;
+}
+
+// waits until the slot for the next frame is free
+static FrameSlot* NextSlot()
+{
+    FrameSlot* pSlot = &g_pSlots[g_NumCaptured % g_NumSlots];
+
+    MutexLock(&g_Mutex);
+    while (pSlot->State != SLOT_FREE)
+        CondWait(&g_Cond, &g_Mutex);
+    MutexUnlock(&g_Mutex);
+
+    return pSlot;
+}
+
+// Returns the buffer the next frame should be read into, passing it to
+// AVWrapper_WriteFrame then saves a copy. May block while the queue is full.
+AVWRAP_DECL uint8_t* AVWrapper_GetFrameBuffer()
+{
+    return NextSlot()->pRGB;
+}
+
+// queues a frame for encoding, returns negative value if encoding failed
+AVWRAP_DECL int AVWrapper_WriteFrame(uint8_t *buf)
+{
+    FrameSlot* pSlot;
+    int ret;
+
+    if (!g_pVStream)
+        return 0;
+
+    pSlot = NextSlot();
+    if (buf != pSlot->pRGB)
+        memcpy(pSlot->pRGB, buf, g_Width * g_Height * 4);
+
+    MutexLock(&g_Mutex);
+    pSlot->State = SLOT_CAPTURED;
+    g_NumCaptured++;
+    CondBroadcast(&g_Cond);
+    ret = g_PipelineError;
+    MutexUnlock(&g_Mutex);
+
+    return ret;
+}
 AVWRAP_DECL int AVWrapper_Init(
          void (*pAddFileLogRaw)(const char*),
          const char* pFilename,
@@ -491,6 +777,8 @@ AVWRAP_DECL int AVWrapper_Init(
     g_Framerate.num = FramerateNum;
     g_Framerate.den = FramerateDen;
     g_VQuality = VQuality;
+    g_ConvKernel = ColorConv_Best();
+    Log("Using %s color conversion\n", ColorConv_Name(g_ConvKernel));
 
     // initialize libav and register all codecs and formats
     av_register_all();
@@ -562,34 +850,47 @@ AVWRAP_DECL int AVWrapper_Init(
             return FatalError("Could not open output file (%s)", g_pContainer->filename);
     }
 
-    g_pVFrame->pts = -1;
+    g_VideoPts = -1;
 
     // write the stream header, if any
-    return avformat_write_header(g_pContainer, NULL);
+    ret = avformat_write_header(g_pContainer, NULL);
+    if (ret < 0)
+        return ret;
+
+    return StartPipeline();
 }
 
 AVWRAP_DECL int AVWrapper_Close()
 {
-    int ret;
+    int ret, result;
+
+    // encode the queued frames, the threads are joined after an error too
+    StopPipeline();
+    result = g_PipelineError;
+
     // output buffered frames
-    if (g_pVCodec->capabilities & AV_CODEC_CAP_DELAY)
+    if (result >= 0 && g_pVStream && (g_pVCodec->capabilities & AV_CODEC_CAP_DELAY))
     {
         do
             ret = WriteFrame(NULL);
         while (ret > 0);
         if (ret < 0)
-            return ret;
+            result = ret;
     }
     // output any remaining audio
-    do
+    if (result >= 0)
     {
-        ret = WriteAudioFrame();
+        do
+        {
+            ret = WriteAudioFrame();
+        }
+        while(ret > 0);
+        if (ret < 0)
+            result = ret;
     }
-    while(ret > 0);
-    if (ret < 0)
-        return ret;
 
-    // write the trailer, if any.
+    // write the trailer, if any; after an error too, so that the frames
+    // encoded until then stay playable
     av_write_trailer(g_pContainer);
 
     // close the output file
@@ -602,8 +903,8 @@ AVWRAP_DECL int AVWrapper_Close()
         avcodec_close(g_pVideo);
         av_free(g_pVideo);
         av_free(g_pVStream);
-        av_frame_free(&g_pVFrame);
     }
+    FreePipeline();
     if (g_pAStream)
     {
         avcodec_close(g_pAudio);
@@ -615,5 +916,5 @@ AVWRAP_DECL int AVWrapper_Close()
     }
 
     av_free(g_pContainer);
-    return 0;
+    return result;
 }
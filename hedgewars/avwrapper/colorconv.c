@@ -0,0 +1,347 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "colorconv.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define COLORCONV_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// the SIMD kernels are built without -msse2/-mavx2, so that the library
+// still runs on any cpu; they are only called after checking cpuid
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+// BT.601 coefficients scaled by 2^15
+#define Y_R   9798
+#define Y_G  19235
+#define Y_B   3736
+#define U_R (-4821)
+#define U_G (-9465)
+#define U_B  14287
+#define V_R  20152
+#define V_G (-16875)
+#define V_B (-3277)
+
+// converts two rows of pixels, returns the number of pixels done
+typedef int (*RowsFunc)(const uint8_t* pSrc0, const uint8_t* pSrc1,
+                        uint8_t* pY0, uint8_t* pY1, uint8_t* pU, uint8_t* pV,
+                        int Width);
+
+static uint8_t Clip(int Value)
+{
+    return Value < 0 ? 0 : Value > 255 ? 255 : Value;
+}
+
+static uint8_t Luma(const uint8_t* p)
+{
+    return (Y_R * p[0] + Y_G * p[1] + Y_B * p[2]) >> 15;
+}
+
+static void Rows_Scalar(const uint8_t* pSrc0, const uint8_t* pSrc1,
+                        uint8_t* pY0, uint8_t* pY1, uint8_t* pU, uint8_t* pV,
+                        int x, int Width)
+{
+    for (; x < Width; x += 2)
+    {
+        int x1 = x + 1 < Width ? x + 1 : x;
+        const uint8_t* p00 = pSrc0 + x * 4;
+        const uint8_t* p01 = pSrc0 + x1 * 4;
+        const uint8_t* p10 = pSrc1 + x * 4;
+        const uint8_t* p11 = pSrc1 + x1 * 4;
+
+        pY0[x] = Luma(p00);
+        pY0[x1] = Luma(p01);
+        pY1[x] = Luma(p10);
+        pY1[x1] = Luma(p11);
+
+        int r = (p00[0] + p01[0] + p10[0] + p11[0]) >> 2;
+        int g = (p00[1] + p01[1] + p10[1] + p11[1]) >> 2;
+        int b = (p00[2] + p01[2] + p10[2] + p11[2]) >> 2;
+
+        // division rounds towards zero like the float to int cast did
+        pU[x / 2] = Clip(128 + (U_R * r + U_G * g + U_B * b) / 32768);
+        pV[x / 2] = Clip(128 + (V_R * r + V_G * g + V_B * b) / 32768);
+    }
+}
+
+#ifdef COLORCONV_X86
+
+// two 16 bit coefficients for _mm_madd_epi16, lo is applied to the lower word
+static int Coef(int Lo, int Hi)
+{
+    return (int)(((uint32_t)(uint16_t)Hi << 16) | (uint16_t)Lo);
+}
+
+// Pixels are split into the words r, b (and with 0x00ff) and g, a (shift by
+// 8) of each dword, so one madd per pair gives 32 bit sums per pixel.
+
+TARGET_SSE2 static __m128i Dot_SSE2(__m128i RB, __m128i GA, __m128i CoefRB, __m128i CoefG)
+{
+    return _mm_add_epi32(_mm_madd_epi16(RB, CoefRB), _mm_madd_epi16(GA, CoefG));
+}
+
+TARGET_SSE2 static __m128i Trunc_SSE2(__m128i Value)
+{
+    __m128i Bias = _mm_and_si128(_mm_srai_epi32(Value, 31), _mm_set1_epi32(0x7FFF));
+    return _mm_srai_epi32(_mm_add_epi32(Value, Bias), 15);
+}
+
+// moves dwords 0 and 2 of a and b together
+TARGET_SSE2 static __m128i Even_SSE2(__m128i a, __m128i b)
+{
+    return _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0)),
+                              _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+TARGET_SSE2 static int Rows_SSE2(const uint8_t* pSrc0, const uint8_t* pSrc1,
+                                 uint8_t* pY0, uint8_t* pY1, uint8_t* pU, uint8_t* pV,
+                                 int Width)
+{
+    const __m128i Mask = _mm_set1_epi16(0xFF);
+    const __m128i Offset = _mm_set1_epi16(128);
+    const __m128i YRB = _mm_set1_epi32(Coef(Y_R, Y_B)), YG = _mm_set1_epi32(Coef(Y_G, 0));
+    const __m128i URB = _mm_set1_epi32(Coef(U_R, U_B)), UG = _mm_set1_epi32(Coef(U_G, 0));
+    const __m128i VRB = _mm_set1_epi32(Coef(V_R, V_B)), VG = _mm_set1_epi32(Coef(V_G, 0));
+    int x, i;
+
+    for (x = 0; x + 16 <= Width; x += 16)
+    {
+        __m128i y0[4], y1[4], u[4], v[4], Chroma;
+
+        for (i = 0; i < 4; i++)
+        {
+            __m128i p0 = _mm_loadu_si128((const __m128i*)(pSrc0 + (x + i * 4) * 4));
+            __m128i p1 = _mm_loadu_si128((const __m128i*)(pSrc1 + (x + i * 4) * 4));
+            __m128i rb0 = _mm_and_si128(p0, Mask), ga0 = _mm_srli_epi16(p0, 8);
+            __m128i rb1 = _mm_and_si128(p1, Mask), ga1 = _mm_srli_epi16(p1, 8);
+
+            y0[i] = _mm_srli_epi32(Dot_SSE2(rb0, ga0, YRB, YG), 15);
+            y1[i] = _mm_srli_epi32(Dot_SSE2(rb1, ga1, YRB, YG), 15);
+
+            // average of 2x2 blocks, in dwords 0 and 2
+            __m128i rb = _mm_add_epi16(rb0, rb1), ga = _mm_add_epi16(ga0, ga1);
+            rb = _mm_srli_epi16(_mm_add_epi16(rb, _mm_srli_epi64(rb, 32)), 2);
+            ga = _mm_srli_epi16(_mm_add_epi16(ga, _mm_srli_epi64(ga, 32)), 2);
+
+            u[i] = Trunc_SSE2(Dot_SSE2(rb, ga, URB, UG));
+            v[i] = Trunc_SSE2(Dot_SSE2(rb, ga, VRB, VG));
+        }
+
+        _mm_storeu_si128((__m128i*)(pY0 + x),
+                         _mm_packus_epi16(_mm_packs_epi32(y0[0], y0[1]), _mm_packs_epi32(y0[2], y0[3])));
+        _mm_storeu_si128((__m128i*)(pY1 + x),
+                         _mm_packus_epi16(_mm_packs_epi32(y1[0], y1[1]), _mm_packs_epi32(y1[2], y1[3])));
+
+        Chroma = _mm_add_epi16(_mm_packs_epi32(Even_SSE2(u[0], u[1]), Even_SSE2(u[2], u[3])), Offset);
+        _mm_storel_epi64((__m128i*)(pU + x / 2), _mm_packus_epi16(Chroma, Chroma));
+        Chroma = _mm_add_epi16(_mm_packs_epi32(Even_SSE2(v[0], v[1]), Even_SSE2(v[2], v[3])), Offset);
+        _mm_storel_epi64((__m128i*)(pV + x / 2), _mm_packus_epi16(Chroma, Chroma));
+    }
+
+    return x;
+}
+
+TARGET_AVX2 static __m256i Dot_AVX2(__m256i RB, __m256i GA, __m256i CoefRB, __m256i CoefG)
+{
+    return _mm256_add_epi32(_mm256_madd_epi16(RB, CoefRB), _mm256_madd_epi16(GA, CoefG));
+}
+
+TARGET_AVX2 static __m256i Trunc_AVX2(__m256i Value)
+{
+    __m256i Bias = _mm256_and_si256(_mm256_srai_epi32(Value, 31), _mm256_set1_epi32(0x7FFF));
+    return _mm256_srai_epi32(_mm256_add_epi32(Value, Bias), 15);
+}
+
+// packs 16 dwords of luma to bytes, packs work within 128 bit lanes
+TARGET_AVX2 static __m128i PackLuma_AVX2(__m256i a, __m256i b)
+{
+    __m256i Words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_packus_epi16(_mm256_castsi256_si128(Words), _mm256_extracti128_si256(Words, 1));
+}
+
+TARGET_AVX2 static __m128i PackChroma_AVX2(__m256i a, __m256i b)
+{
+    const __m256i Even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    __m128i Words = _mm_packs_epi32(_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(a, Even)),
+                                    _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(b, Even)));
+    Words = _mm_add_epi16(Words, _mm_set1_epi16(128));
+    return _mm_packus_epi16(Words, Words);
+}
+
+TARGET_AVX2 static int Rows_AVX2(const uint8_t* pSrc0, const uint8_t* pSrc1,
+                                 uint8_t* pY0, uint8_t* pY1, uint8_t* pU, uint8_t* pV,
+                                 int Width)
+{
+    const __m256i Mask = _mm256_set1_epi16(0xFF);
+    const __m256i YRB = _mm256_set1_epi32(Coef(Y_R, Y_B)), YG = _mm256_set1_epi32(Coef(Y_G, 0));
+    const __m256i URB = _mm256_set1_epi32(Coef(U_R, U_B)), UG = _mm256_set1_epi32(Coef(U_G, 0));
+    const __m256i VRB = _mm256_set1_epi32(Coef(V_R, V_B)), VG = _mm256_set1_epi32(Coef(V_G, 0));
+    int x, i;
+
+    for (x = 0; x + 16 <= Width; x += 16)
+    {
+        __m256i y0[2], y1[2], u[2], v[2];
+
+        for (i = 0; i < 2; i++)
+        {
+            __m256i p0 = _mm256_loadu_si256((const __m256i*)(pSrc0 + (x + i * 8) * 4));
+            __m256i p1 = _mm256_loadu_si256((const __m256i*)(pSrc1 + (x + i * 8) * 4));
+            __m256i rb0 = _mm256_and_si256(p0, Mask), ga0 = _mm256_srli_epi16(p0, 8);
+            __m256i rb1 = _mm256_and_si256(p1, Mask), ga1 = _mm256_srli_epi16(p1, 8);
+
+            y0[i] = _mm256_srli_epi32(Dot_AVX2(rb0, ga0, YRB, YG), 15);
+            y1[i] = _mm256_srli_epi32(Dot_AVX2(rb1, ga1, YRB, YG), 15);
+
+            // average of 2x2 blocks, in even dwords
+            __m256i rb = _mm256_add_epi16(rb0, rb1), ga = _mm256_add_epi16(ga0, ga1);
+            rb = _mm256_srli_epi16(_mm256_add_epi16(rb, _mm256_srli_epi64(rb, 32)), 2);
+            ga = _mm256_srli_epi16(_mm256_add_epi16(ga, _mm256_srli_epi64(ga, 32)), 2);
+
+            u[i] = Trunc_AVX2(Dot_AVX2(rb, ga, URB, UG));
+            v[i] = Trunc_AVX2(Dot_AVX2(rb, ga, VRB, VG));
+        }
+
+        _mm_storeu_si128((__m128i*)(pY0 + x), PackLuma_AVX2(y0[0], y0[1]));
+        _mm_storeu_si128((__m128i*)(pY1 + x), PackLuma_AVX2(y1[0], y1[1]));
+        _mm_storel_epi64((__m128i*)(pU + x / 2), PackChroma_AVX2(u[0], u[1]));
+        _mm_storel_epi64((__m128i*)(pV + x / 2), PackChroma_AVX2(v[0], v[1]));
+    }
+
+    return x;
+}
+
+static void CpuId(int Leaf, unsigned Regs[4])
+{
+#ifdef _MSC_VER
+    __cpuidex((int*)Regs, Leaf, 0);
+#else
+    __cpuid_count(Leaf, 0, Regs[0], Regs[1], Regs[2], Regs[3]);
+#endif
+}
+
+// register state the OS saves on context switches
+static uint64_t XGetBV(void)
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned Lo, Hi;
+    __asm__ __volatile__ ("xgetbv" : "=a"(Lo), "=d"(Hi) : "c"(0));
+    return ((uint64_t)Hi << 32) | Lo;
+#endif
+}
+
+#endif // COLORCONV_X86
+
+static int g_Supported = -1;
+
+int ColorConv_Supported(int Kernel)
+{
+    if (Kernel < 0 || Kernel >= COLORCONV_KERNELS)
+        return 0;
+
+    if (g_Supported < 0)
+    {
+        int Supported = 1 << COLORCONV_SCALAR;
+#ifdef COLORCONV_X86
+        unsigned Regs[4], MaxLeaf;
+
+        CpuId(0, Regs);
+        MaxLeaf = Regs[0];
+        CpuId(1, Regs);
+        if (Regs[3] & (1 << 26))
+            Supported |= 1 << COLORCONV_SSE2;
+        // AVX2 needs the OS to save ymm registers (OSXSAVE, AVX and XCR0 bits 1-2)
+        if (MaxLeaf >= 7 && (Regs[2] & (1 << 27)) && (Regs[2] & (1 << 28)) && (XGetBV() & 6) == 6)
+        {
+            CpuId(7, Regs);
+            if (Regs[1] & (1 << 5))
+                Supported |= 1 << COLORCONV_AVX2;
+        }
+#endif
+        g_Supported = Supported;
+    }
+
+    return (g_Supported >> Kernel) & 1;
+}
+
+int ColorConv_Best(void)
+{
+    int Kernel = COLORCONV_KERNELS - 1;
+    while (!ColorConv_Supported(Kernel))
+        Kernel--;
+    return Kernel;
+}
+
+const char* ColorConv_Name(int Kernel)
+{
+    switch (Kernel)
+    {
+        case COLORCONV_SCALAR: return "scalar";
+        case COLORCONV_SSE2:   return "SSE2";
+        case COLORCONV_AVX2:   return "AVX2";
+        default:               return "unknown";
+    }
+}
+
+void ColorConv_RGBAToYUV420(int Kernel,
+                            const uint8_t* pSrc, int SrcStride,
+                            int Width, int Height,
+                            uint8_t* const pDst[3], const int DstStride[3])
+{
+    RowsFunc Rows = NULL;
+    int y;
+
+#ifdef COLORCONV_X86
+    if (ColorConv_Supported(Kernel))
+    {
+        if (Kernel == COLORCONV_SSE2)
+            Rows = Rows_SSE2;
+        else if (Kernel == COLORCONV_AVX2)
+            Rows = Rows_AVX2;
+    }
+#endif
+
+    for (y = 0; y < Height; y += 2)
+    {
+        const uint8_t* pSrc0 = pSrc + (ptrdiff_t)y * SrcStride;
+        const uint8_t* pSrc1 = y + 1 < Height ? pSrc0 + SrcStride : pSrc0;
+        uint8_t* pY0 = pDst[0] + (ptrdiff_t)y * DstStride[0];
+        uint8_t* pY1 = y + 1 < Height ? pY0 + DstStride[0] : pY0;
+        uint8_t* pU = pDst[1] + (ptrdiff_t)(y / 2) * DstStride[1];
+        uint8_t* pV = pDst[2] + (ptrdiff_t)(y / 2) * DstStride[2];
+        int x = Rows ? Rows(pSrc0, pSrc1, pY0, pY1, pU, pV, Width) : 0;
+
+        Rows_Scalar(pSrc0, pSrc1, pY0, pY1, pU, pV, x, Width);
+    }
+}
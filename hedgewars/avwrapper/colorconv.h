@@ -0,0 +1,63 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef HEDGEWARS_COLORCONV_H
+#define HEDGEWARS_COLORCONV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// RGBA to YUV 4:2:0 conversion of captured frames.
+//
+// Uses 15 bit fixed point versions of the BT.601 coefficients the av-wrapper
+// used with floats before, results differ from the float version by at most
+// one. Chroma is the average of each 2x2 block. All kernels give exactly the
+// same output, so the fastest one the cpu supports can be picked at runtime.
+
+enum
+{
+    COLORCONV_SCALAR,
+    COLORCONV_SSE2,
+    COLORCONV_AVX2,
+    COLORCONV_KERNELS
+};
+
+// returns non-zero if the kernel can be used on this cpu
+int ColorConv_Supported(int Kernel);
+
+// returns the fastest kernel supported by this cpu
+int ColorConv_Best(void);
+
+const char* ColorConv_Name(int Kernel);
+
+// Converts a Width x Height RGBA image. SrcStride may be negative to flip
+// the image (frames read from OpenGL are bottom-up). Odd widths and heights
+// are fine, the last column or row is then used twice for chroma.
+void ColorConv_RGBAToYUV420(int Kernel,
+                            const uint8_t* pSrc, int SrcStride,
+                            int Width, int Height,
+                            uint8_t* const pDst[3], const int DstStride[3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HEDGEWARS_COLORCONV_H
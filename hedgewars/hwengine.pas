@@ -32,7 +32,7 @@ program hwengine;
 uses {$IFDEF IPHONEOS}cmem, {$ENDIF} SDLh, uMisc, uConsole, uGame, uConsts, uLand, uAmmos, uVisualGears, uGears, uStore, uWorld, uInputHandler
      , uSound, uScript, uTeams, uStats, uIO, uLocale, uChat, uAI, uAIMisc, uAILandMarks, uLandTexture, uCollisions
      , SysUtils, uTypes, uVariables, uCommands, uUtils, uCaptions, uDebug, uCommandHandlers, uLandPainted
-     , uPhysFSLayer, uCursor, uRandom, ArgParsers, uVisualGearsHandlers, uTextures, uRender
+     , uPhysFSLayer, uCheckpoints, uCursor, uRandom, ArgParsers, uVisualGearsHandlers, uTextures, uRender
      {$IFDEF USE_VIDEO_RECORDING}, uVideoRec {$ENDIF}
      {$IFDEF USE_TOUCH_INTERFACE}, uTouch {$ENDIF}
      {$IFDEF ANDROID}, GLUnit{$ENDIF}
@@ -332,6 +332,12 @@ begin
     while LoadNextCameraPosition(newRealTicks, newGameTicks) do
     begin
         IPCCheckSock();
+        // the engine dies with the IPC connection, so this can't hang
+        while recordingPaused do
+        begin
+            SDL_Delay(100);
+            IPCCheckSock();
+        end;
         RealTicks:= newRealTicks;
         DoGameTick(newGameTicks - oldGameTicks);
         if GameState = gsExit then
@@ -452,6 +458,9 @@ begin
 {$ENDIF}
 
     MainLoop;
+
+    if cOnlyStats and allOK then
+        SendStateHash;
 end;
 
 procedure Game;
@@ -506,6 +515,7 @@ begin
         uCaptions.initModule;
 
         uChat.initModule;
+        uCheckpoints.initModule;
         uCollisions.initModule;
         uGears.initModule;
         uInputHandler.initModule;
@@ -539,6 +549,7 @@ begin
         uSound.freeModule;
         uMisc.freeModule;
         uLandTexture.freeModule;
+        uCheckpoints.freeModule;
         uGears.freeModule;
         uCollisions.freeModule;     //stub
         uChat.freeModule;
@@ -567,12 +578,54 @@ begin
 end;
 
 ///////////////////////////////////////////////////////////////////////////////
-procedure GenLandPreview;
+procedure SendLandPreview;
 {$IFDEF MOBILE}
 var Preview: TPreview;
 {$ELSE}
 var Preview: TPreviewAlpha;
 {$ENDIF}
+    len: LongWord;
+begin
+    ScriptOnPreviewInit;
+{$IFDEF MOBILE}
+    GenPreview(Preview);
+{$ELSE}
+    GenPreviewAlpha(Preview);
+{$ENDIF}
+    WriteLnToConsole('Sending preview...');
+    // preview server answers are not delimited by disconnect, so prefix them with the size
+    if cPreviewServer then
+        begin
+        SDLNet_Write32(sizeof(Preview) + sizeof(byte), @len);
+        SendIPCRaw(@len, sizeof(len));
+        end;
+    SendIPCRaw(@Preview, sizeof(Preview));
+    SendIPCRaw(@MaxHedgehogs, sizeof(byte));
+end;
+
+// drop everything the previous preview has set up, keeping PhysFS and the IPC connection
+procedure ResetLandPreview;
+begin
+    uScript.freeModule;
+    uLandPainted.freeModule;
+    uLand.freeModule;
+    uCommandHandlers.freeModule;
+    uCommands.freeModule;
+    uVariables.freeModule;
+
+    cScriptName:= '';
+    cScriptParam:= '';
+
+    uVariables.initModule;
+    uCommands.initModule;
+    uCommandHandlers.initModule;
+    uLand.initModule;
+    uLandPainted.initModule;
+    uIO.initCommands;
+    uScript.initModule;
+end;
+
+procedure GenLandPreview;
 begin
     initEverything(false);
 
@@ -582,21 +635,33 @@ begin
         IPCWaitPongEvent;
         if checkFails(InitStepsFlags = cifRandomize, 'Some parameters not set (flags = ' + inttostr(InitStepsFlags) + ')', true) then exit;
 
-        ScriptOnPreviewInit;
-    {$IFDEF MOBILE}
-        GenPreview(Preview);
-    {$ELSE}
-        GenPreviewAlpha(Preview);
-    {$ENDIF}
-        WriteLnToConsole('Sending preview...');
-        SendIPCRaw(@Preview, sizeof(Preview));
-        SendIPCRaw(@MaxHedgehogs, sizeof(byte));
+        SendLandPreview;
         WriteLnToConsole('Preview sent, disconnect');
     end;
 
     freeEverything(false);
 end;
 
+// one engine instance serving previews until the frontend disconnects,
+// every request is a set of parameters terminated by '!'
+procedure ServeLandPreviews;
+begin
+    initEverything(false);
+
+    InitIPC;
+    while allOK do
+    begin
+        IPCWaitPongEvent;
+        if not allOK then break;
+        if checkFails(InitStepsFlags = cifRandomize, 'Some parameters not set (flags = ' + inttostr(InitStepsFlags) + ')', true) then break;
+
+        SendLandPreview;
+        ResetLandPreview;
+    end;
+
+    freeEverything(false);
+end;
+
 {$IFDEF HWLIBRARY}
 function RunEngine(argc: LongInt; argv: PPChar): LongInt; cdecl; export;
 begin
@@ -628,7 +693,9 @@ begin
 
     GetParams();
 
-    if GameType = gmtLandPreview then
+    if cPreviewServer then
+        ServeLandPreviews()
+    else if GameType = gmtLandPreview then
         GenLandPreview()
     else if GameType <> gmtSyntax then
         Game();
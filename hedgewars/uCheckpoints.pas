@@ -0,0 +1,773 @@
+(*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *)
+
+{$INCLUDE "options.inc"}
+
+unit uCheckpoints;
+(*
+ * Checkpoints of the game state for seeking in demos.
+ *
+ * While a demo is played, a copy of the game state is kept at the start of
+ * a turn every cCheckpointInterval ticks: gears, collision entries, teams,
+ * ammo, random generator, turn machine and Land. Land is split in tiles,
+ * a checkpoint only holds the tiles which differ from the land at the first
+ * checkpoint. The processed demo commands are kept by uIO, so seeking
+ * restores the nearest checkpoint before the target, puts the commands
+ * after it back in the queue and fast forwards from there.
+ *
+ * Only the game logic state is restored. Visual gears, captions, the
+ * camera and other cosmetic state go on as they are. Games with a Lua
+ * script get no checkpoints, the state of the script can't be copied.
+ *)
+interface
+
+procedure initModule;
+procedure freeModule;
+
+procedure TakeCheckpoint;
+procedure SeekStep(var Lag: LongInt);
+function  StatsMuted: boolean;
+
+implementation
+uses SDLh, uConsts, uTypes, uFloat, uVariables, uUtils, uCommands, uIO, uRandom,
+    uGears, uGearsList, uGearsHedgehog, uGearsHandlersMess, uCollisions,
+    uTeams, uStats, uAmmos, uStore, uSound, uTextures, uLandTexture,
+    uVisualGearsList, uScript;
+
+const cTileSize = 128;
+    cCheckpointsBudget = 256 * 1024 * 1024; // bytes of land tiles kept at most
+    cSeekStep = 5000; // game ticks simulated per frame while seeking
+
+type TGameVars = record
+        GameTicks, CheckSum, lastTurnChecksum: LongWord;
+        hiTicks: Word;
+        TurnTimeLeft, TagTurnTimeLeft, ReadyTimeLeft: Longword;
+        TurnClockActive, IsGetAwayTime, GameOver: boolean;
+        InputMask, LeftImpactTimer, RightImpactTimer: LongWord;
+        cWaterLine: LongInt;
+        bBetweenTurns, bWaterRising: boolean;
+        cWindSpeed, cGravity, cDamageModifier: hwFloat;
+        cWindSpeedf, cGravityf: real;
+        cLowGravity, cLaserSighting, cLaserSightingSniper, cVampiric: boolean;
+        isInMultiShoot: boolean;
+        KilledHHs: Longword;
+        SuddenDeath, SuddenDeathActive, SuddenDeathDmg: boolean;
+        PlacingHogs: boolean;
+        CurrentTeam, PreviousTeam: PTeam;
+        CurrentHedgehog: PHedgehog;
+        CurMinAngle, CurMaxAngle: Longword;
+        AllInactive, PrvInactive: boolean;
+        LocalAmmo: LongInt;
+        TargetPoint: TPoint;
+        upd, GCounter, GHStepTicks: LongWord;
+        TeamsGameOver, NextClan: boolean;
+        MaxTeamHealth: LongInt;
+        end;
+
+    TGearState = record
+        Gear: TGear;
+        Old: PGear;     // address of the gear when the checkpoint was taken
+        Listed: boolean; // false for hidden hedgehogs
+        end;
+
+    TTeamState = record
+        Hedgehogs: array[0..cMaxHHIndex] of THedgehog;
+        CurrHedgehog: LongWord;
+        TeamHealth, TeamHealthBarHealth, DrawHealthY: LongInt;
+        AttackBar: LongWord;
+        stats: TTeamStats;
+        hasGone: boolean;
+        skippedTurns: Longword;
+        isGoneFlagPendingToBeSet, isGoneFlagPendingToBeUnset: boolean;
+        end;
+
+    TAmmozState = record
+        Probability, NumberInCase, SkipTurns: Longword;
+        end;
+
+    TCheckpoint = record
+        Ticks: LongWord;
+        History: pointer;
+        Vars: TGameVars;
+        RandomState: TRandomState;
+        StepState: TGearsStepState;
+        StatsState: TStatsState;
+        Gears: array of TGearState;
+        Collisions: TCollisionEntries;
+        Teams: array of TTeamState;
+        Clans: array of TClan;
+        Stores: array of THHAmmo;
+        Ammos: array[TAmmoType] of TAmmozState;
+        Tiles: array of LongWord;      // indices of tiles differing from the base land
+        TileLand: array of Word;
+        TilePixels: array of LongWord;
+        Dirty: TDirtyTag;
+        end;
+
+var Checkpoints: array of TCheckpoint;
+    Interval: LongWord;
+    TilesSize: LongWord;
+    BaseLand: TCollisionArray;
+    BasePixels: TLandArray;
+    TilesX, TilesY, PixelTileSize: LongWord;
+    seekPending, seekRunning: boolean;
+    SeekTarget: LongWord;
+    ReachedTicks: LongWord; // furthest tick played before seeking back
+
+procedure SaveVars(var v: TGameVars);
+begin
+v.GameTicks:= GameTicks;
+v.CheckSum:= CheckSum;
+v.lastTurnChecksum:= lastTurnChecksum;
+v.hiTicks:= hiTicks;
+v.TurnTimeLeft:= TurnTimeLeft;
+v.TagTurnTimeLeft:= TagTurnTimeLeft;
+v.ReadyTimeLeft:= ReadyTimeLeft;
+v.TurnClockActive:= TurnClockActive;
+v.IsGetAwayTime:= IsGetAwayTime;
+v.GameOver:= GameOver;
+v.InputMask:= InputMask;
+v.LeftImpactTimer:= LeftImpactTimer;
+v.RightImpactTimer:= RightImpactTimer;
+v.cWaterLine:= cWaterLine;
+v.bBetweenTurns:= bBetweenTurns;
+v.bWaterRising:= bWaterRising;
+v.cWindSpeed:= cWindSpeed;
+v.cGravity:= cGravity;
+v.cDamageModifier:= cDamageModifier;
+v.cWindSpeedf:= cWindSpeedf;
+v.cGravityf:= cGravityf;
+v.cLowGravity:= cLowGravity;
+v.cLaserSighting:= cLaserSighting;
+v.cLaserSightingSniper:= cLaserSightingSniper;
+v.cVampiric:= cVampiric;
+v.isInMultiShoot:= isInMultiShoot;
+v.KilledHHs:= KilledHHs;
+v.SuddenDeath:= SuddenDeath;
+v.SuddenDeathActive:= SuddenDeathActive;
+v.SuddenDeathDmg:= SuddenDeathDmg;
+v.PlacingHogs:= PlacingHogs;
+v.CurrentTeam:= CurrentTeam;
+v.PreviousTeam:= PreviousTeam;
+v.CurrentHedgehog:= CurrentHedgehog;
+v.CurMinAngle:= CurMinAngle;
+v.CurMaxAngle:= CurMaxAngle;
+v.AllInactive:= AllInactive;
+v.PrvInactive:= PrvInactive;
+v.LocalAmmo:= LocalAmmo;
+v.TargetPoint:= TargetPoint;
+v.upd:= upd;
+v.GCounter:= GCounter;
+v.GHStepTicks:= GHStepTicks;
+v.TeamsGameOver:= TeamsGameOver;
+v.NextClan:= NextClan;
+v.MaxTeamHealth:= MaxTeamHealth
+end;
+
+procedure RestoreVars(var v: TGameVars);
+begin
+GameTicks:= v.GameTicks;
+CheckSum:= v.CheckSum;
+lastTurnChecksum:= v.lastTurnChecksum;
+hiTicks:= v.hiTicks;
+TurnTimeLeft:= v.TurnTimeLeft;
+TagTurnTimeLeft:= v.TagTurnTimeLeft;
+ReadyTimeLeft:= v.ReadyTimeLeft;
+TurnClockActive:= v.TurnClockActive;
+IsGetAwayTime:= v.IsGetAwayTime;
+GameOver:= v.GameOver;
+InputMask:= v.InputMask;
+LeftImpactTimer:= v.LeftImpactTimer;
+RightImpactTimer:= v.RightImpactTimer;
+cWaterLine:= v.cWaterLine;
+bBetweenTurns:= v.bBetweenTurns;
+bWaterRising:= v.bWaterRising;
+cWindSpeed:= v.cWindSpeed;
+cGravity:= v.cGravity;
+cDamageModifier:= v.cDamageModifier;
+cWindSpeedf:= v.cWindSpeedf;
+cGravityf:= v.cGravityf;
+cLowGravity:= v.cLowGravity;
+cLaserSighting:= v.cLaserSighting;
+cLaserSightingSniper:= v.cLaserSightingSniper;
+cVampiric:= v.cVampiric;
+isInMultiShoot:= v.isInMultiShoot;
+KilledHHs:= v.KilledHHs;
+SuddenDeath:= v.SuddenDeath;
+SuddenDeathActive:= v.SuddenDeathActive;
+SuddenDeathDmg:= v.SuddenDeathDmg;
+PlacingHogs:= v.PlacingHogs;
+CurrentTeam:= v.CurrentTeam;
+PreviousTeam:= v.PreviousTeam;
+CurrentHedgehog:= v.CurrentHedgehog;
+CurMinAngle:= v.CurMinAngle;
+CurMaxAngle:= v.CurMaxAngle;
+AllInactive:= v.AllInactive;
+PrvInactive:= v.PrvInactive;
+LocalAmmo:= v.LocalAmmo;
+TargetPoint:= v.TargetPoint;
+upd:= v.upd;
+GCounter:= v.GCounter;
+GHStepTicks:= v.GHStepTicks;
+TeamsGameOver:= v.TeamsGameOver;
+NextClan:= v.NextClan;
+MaxTeamHealth:= v.MaxTeamHealth
+end;
+
+// Land
+
+function LandTileEquals(tx, ty: LongWord; var l: TCollisionArray; var p: TLandArray): boolean;
+var y, x, py, px: LongWord;
+begin
+LandTileEquals:= false;
+x:= tx * cTileSize;
+for y:= ty * cTileSize to Pred(Succ(ty) * cTileSize) do
+    if CompareByte(Land[y, x], l[y, x], cTileSize * SizeOf(Word)) <> 0 then
+        exit;
+
+if not cOnlyStats then
+    begin
+    px:= tx * PixelTileSize;
+    for py:= ty * PixelTileSize to Pred(Succ(ty) * PixelTileSize) do
+        if CompareByte(LandPixels[py, px], p[py, px], PixelTileSize * SizeOf(LongWord)) <> 0 then
+            exit
+    end;
+
+LandTileEquals:= true
+end;
+
+procedure SaveBaseLand;
+var y: LongWord;
+begin
+TilesX:= LAND_WIDTH div cTileSize;
+TilesY:= LAND_HEIGHT div cTileSize;
+if (cReducedQuality and rqBlurryLand) = 0 then
+    PixelTileSize:= cTileSize
+else
+    PixelTileSize:= cTileSize div 2;
+
+SetLength(BaseLand, LAND_HEIGHT, LAND_WIDTH);
+for y:= 0 to Pred(LAND_HEIGHT) do
+    Move(Land[y, 0], BaseLand[y, 0], LAND_WIDTH * SizeOf(Word));
+
+if not cOnlyStats then
+    begin
+    SetLength(BasePixels, Length(LandPixels), Length(LandPixels[0]));
+    for y:= 0 to High(LandPixels) do
+        Move(LandPixels[y, 0], BasePixels[y, 0], Length(LandPixels[0]) * SizeOf(LongWord))
+    end
+end;
+
+procedure SaveLandTiles(var cp: TCheckpoint);
+var tx, ty, y, i, n, ln, pn: LongWord;
+begin
+n:= 0;
+SetLength(cp.Tiles, TilesX * TilesY);
+for ty:= 0 to Pred(TilesY) do
+    for tx:= 0 to Pred(TilesX) do
+        if not LandTileEquals(tx, ty, BaseLand, BasePixels) then
+            begin
+            cp.Tiles[n]:= ty * TilesX + tx;
+            inc(n)
+            end;
+SetLength(cp.Tiles, n);
+
+SetLength(cp.TileLand, n * cTileSize * cTileSize);
+if not cOnlyStats then
+    SetLength(cp.TilePixels, n * PixelTileSize * PixelTileSize);
+
+ln:= 0;
+pn:= 0;
+if n > 0 then
+    for i:= 0 to Pred(n) do
+        begin
+        tx:= cp.Tiles[i] mod TilesX;
+        ty:= cp.Tiles[i] div TilesX;
+        for y:= ty * cTileSize to Pred(Succ(ty) * cTileSize) do
+            begin
+            Move(Land[y, tx * cTileSize], cp.TileLand[ln], cTileSize * SizeOf(Word));
+            inc(ln, cTileSize)
+            end;
+
+        if not cOnlyStats then
+            for y:= ty * PixelTileSize to Pred(Succ(ty) * PixelTileSize) do
+                begin
+                Move(LandPixels[y, tx * PixelTileSize], cp.TilePixels[pn], PixelTileSize * SizeOf(LongWord));
+                inc(pn, PixelTileSize)
+                end
+        end;
+
+SetLength(cp.Dirty, Length(LandDirty), Length(LandDirty[0]));
+for y:= 0 to High(LandDirty) do
+    Move(LandDirty[y, 0], cp.Dirty[y, 0], Length(LandDirty[0]));
+
+inc(TilesSize, Length(cp.TileLand) * SizeOf(Word) + Length(cp.TilePixels) * SizeOf(LongWord))
+end;
+
+procedure RestoreLandTiles(var cp: TCheckpoint);
+var tx, ty, y, i, ln, pn: LongWord;
+    fromBase: boolean;
+begin
+i:= 0;
+for ty:= 0 to Pred(TilesY) do
+    for tx:= 0 to Pred(TilesX) do
+        begin
+        fromBase:= (i >= Length(cp.Tiles)) or (cp.Tiles[i] <> ty * TilesX + tx);
+        if fromBase then
+            begin
+            if not LandTileEquals(tx, ty, BaseLand, BasePixels) then
+                begin
+                for y:= ty * cTileSize to Pred(Succ(ty) * cTileSize) do
+                    Move(BaseLand[y, tx * cTileSize], Land[y, tx * cTileSize], cTileSize * SizeOf(Word));
+                if not cOnlyStats then
+                    for y:= ty * PixelTileSize to Pred(Succ(ty) * PixelTileSize) do
+                        Move(BasePixels[y, tx * PixelTileSize], LandPixels[y, tx * PixelTileSize], PixelTileSize * SizeOf(LongWord));
+                UpdateLandTexture(tx * cTileSize, cTileSize, ty * cTileSize, cTileSize, true)
+                end
+            end
+        else
+            begin
+            ln:= i * cTileSize * cTileSize;
+            for y:= ty * cTileSize to Pred(Succ(ty) * cTileSize) do
+                begin
+                Move(cp.TileLand[ln], Land[y, tx * cTileSize], cTileSize * SizeOf(Word));
+                inc(ln, cTileSize)
+                end;
+            if not cOnlyStats then
+                begin
+                pn:= i * PixelTileSize * PixelTileSize;
+                for y:= ty * PixelTileSize to Pred(Succ(ty) * PixelTileSize) do
+                    begin
+                    Move(cp.TilePixels[pn], LandPixels[y, tx * PixelTileSize], PixelTileSize * SizeOf(LongWord));
+                    inc(pn, PixelTileSize)
+                    end
+                end;
+            UpdateLandTexture(tx * cTileSize, cTileSize, ty * cTileSize, cTileSize, true);
+            inc(i)
+            end
+        end;
+
+for y:= 0 to High(LandDirty) do
+    Move(cp.Dirty[y, 0], LandDirty[y, 0], Length(LandDirty[0]))
+end;
+
+// Gears
+
+function FindGear(var cp: TCheckpoint; Gear: PGear): LongInt;
+var i: LongInt;
+begin
+FindGear:= -1;
+if Gear <> nil then
+    for i:= 0 to High(cp.Gears) do
+        if cp.Gears[i].Old = Gear then
+            exit(i)
+end;
+
+procedure AddGearState(var cp: TCheckpoint; Gear: PGear; Listed: boolean);
+var n: LongInt;
+begin
+n:= Length(cp.Gears);
+SetLength(cp.Gears, Succ(n));
+cp.Gears[n].Gear:= Gear^;
+cp.Gears[n].Old:= Gear;
+cp.Gears[n].Listed:= Listed
+end;
+
+// gear specific data other than a gear pointer can't be copied
+function GearsSaved(var cp: TCheckpoint): boolean;
+var i: LongInt;
+begin
+GearsSaved:= false;
+for i:= 0 to High(cp.Gears) do
+    with cp.Gears[i].Gear do
+        if (Data <> nil) and (FindGear(cp, PGear(Data)) < 0) then
+            exit;
+GearsSaved:= true
+end;
+
+procedure FreeGear(Gear: PGear);
+begin
+if Gear^.SoundChannel >= 0 then
+    StopSoundChan(Gear^.SoundChannel);
+FreeAndNilTexture(Gear^.Tex);
+if (Gear^.Kind = gtCake) and (Gear^.Data <> nil) then
+    Dispose(PCakeData(Gear^.Data));
+Dispose(Gear)
+end;
+
+// frees the current gears without any of the side effects of DeleteGear
+procedure FreeGears;
+var t, tt: PGear;
+    i, h: LongInt;
+begin
+for i:= 0 to Pred(TeamsCount) do
+    for h:= 0 to cMaxHHIndex do
+        with TeamsArray[i]^.Hedgehogs[h] do
+            if GearHidden <> nil then
+                begin
+                FreeGear(GearHidden);
+                GearHidden:= nil
+                end;
+
+tt:= GearsList;
+GearsList:= nil;
+while tt <> nil do
+    begin
+    t:= tt;
+    tt:= tt^.NextGear;
+    FreeGear(t)
+    end
+end;
+
+function RemapGear(var cp: TCheckpoint; var gears: array of PGear; Gear: PGear): PGear;
+var i: LongInt;
+begin
+i:= FindGear(cp, Gear);
+if i < 0 then
+    RemapGear:= nil
+else
+    RemapGear:= gears[i]
+end;
+
+// hedgehogs have to be restored already, their gears are remapped here
+procedure RestoreGears(var cp: TCheckpoint);
+var gears: array of PGear;
+    collisions: TCollisionEntries;
+    last: PGear;
+    i, h: LongInt;
+begin
+SetLength(gears, Length(cp.Gears));
+for i:= 0 to High(cp.Gears) do
+    begin
+    new(gears[i]);
+    gears[i]^:= cp.Gears[i].Gear;
+    gears[i]^.Tex:= nil;
+    gears[i]^.SoundChannel:= -1
+    end;
+
+last:= nil;
+for i:= 0 to High(cp.Gears) do
+    with gears[i]^ do
+        begin
+        LinkedGear:= RemapGear(cp, gears, LinkedGear);
+        if Data <> nil then
+            Data:= RemapGear(cp, gears, PGear(Data));
+
+        PrevGear:= nil;
+        NextGear:= nil;
+        if cp.Gears[i].Listed then
+            begin
+            if last = nil then
+                GearsList:= gears[i]
+            else
+                begin
+                last^.NextGear:= gears[i];
+                PrevGear:= last
+                end;
+            last:= gears[i]
+            end
+        end;
+
+SetLength(collisions, Length(cp.Collisions));
+for i:= 0 to High(cp.Collisions) do
+    begin
+    collisions[i]:= cp.Collisions[i];
+    collisions[i].cGear:= RemapGear(cp, gears, cp.Collisions[i].cGear)
+    end;
+SetCollisionEntries(collisions);
+
+for i:= 0 to Pred(TeamsCount) do
+    for h:= 0 to cMaxHHIndex do
+        with TeamsArray[i]^.Hedgehogs[h] do
+            begin
+            Gear:= RemapGear(cp, gears, Gear);
+            GearHidden:= RemapGear(cp, gears, GearHidden)
+            end
+end;
+
+// Teams and ammo
+
+procedure SaveTeams(var cp: TCheckpoint);
+var i, h: LongInt;
+    a: TAmmoType;
+begin
+SetLength(cp.Teams, TeamsCount);
+for i:= 0 to Pred(TeamsCount) do
+    with TeamsArray[i]^ do
+        begin
+        for h:= 0 to cMaxHHIndex do
+            cp.Teams[i].Hedgehogs[h]:= Hedgehogs[h];
+        cp.Teams[i].CurrHedgehog:= CurrHedgehog;
+        cp.Teams[i].TeamHealth:= TeamHealth;
+        cp.Teams[i].TeamHealthBarHealth:= TeamHealthBarHealth;
+        cp.Teams[i].DrawHealthY:= DrawHealthY;
+        cp.Teams[i].AttackBar:= AttackBar;
+        cp.Teams[i].stats:= stats;
+        cp.Teams[i].hasGone:= hasGone;
+        cp.Teams[i].skippedTurns:= skippedTurns;
+        cp.Teams[i].isGoneFlagPendingToBeSet:= isGoneFlagPendingToBeSet;
+        cp.Teams[i].isGoneFlagPendingToBeUnset:= isGoneFlagPendingToBeUnset
+        end;
+
+SetLength(cp.Clans, ClansCount);
+for i:= 0 to Pred(ClansCount) do
+    cp.Clans[i]:= ClansArray[i]^;
+
+SetLength(cp.Stores, StoreCnt);
+for i:= 0 to Pred(StoreCnt) do
+    cp.Stores[i]:= GetAmmoByNum(i)^;
+
+for a:= Low(TAmmoType) to High(TAmmoType) do
+    begin
+    cp.Ammos[a].Probability:= Ammoz[a].Probability;
+    cp.Ammos[a].NumberInCase:= Ammoz[a].NumberInCase;
+    cp.Ammos[a].SkipTurns:= Ammoz[a].SkipTurns
+    end
+end;
+
+// textures and speech bubbles of the hedgehogs are kept as they are
+procedure RestoreTeams(var cp: TCheckpoint);
+var i, h: LongInt;
+    a: TAmmoType;
+    hh: THedgehog;
+    healthTex: PTexture;
+begin
+for i:= 0 to Pred(TeamsCount) do
+    with TeamsArray[i]^ do
+        begin
+        for h:= 0 to cMaxHHIndex do
+            begin
+            hh:= cp.Teams[i].Hedgehogs[h];
+            hh.SpeechGear:= Hedgehogs[h].SpeechGear;
+            hh.NameTagTex:= Hedgehogs[h].NameTagTex;
+            hh.HealthTagTex:= Hedgehogs[h].HealthTagTex;
+            hh.HatTex:= Hedgehogs[h].HatTex;
+            Hedgehogs[h]:= hh
+            end;
+        CurrHedgehog:= cp.Teams[i].CurrHedgehog;
+        TeamHealth:= cp.Teams[i].TeamHealth;
+        TeamHealthBarHealth:= cp.Teams[i].TeamHealthBarHealth;
+        DrawHealthY:= cp.Teams[i].DrawHealthY;
+        AttackBar:= cp.Teams[i].AttackBar;
+        stats:= cp.Teams[i].stats;
+        hasGone:= cp.Teams[i].hasGone;
+        skippedTurns:= cp.Teams[i].skippedTurns;
+        isGoneFlagPendingToBeSet:= cp.Teams[i].isGoneFlagPendingToBeSet;
+        isGoneFlagPendingToBeUnset:= cp.Teams[i].isGoneFlagPendingToBeUnset
+        end;
+
+for i:= 0 to Pred(ClansCount) do
+    begin
+    healthTex:= ClansArray[i]^.HealthTex;
+    ClansArray[i]^:= cp.Clans[i];
+    ClansArray[i]^.HealthTex:= healthTex
+    end;
+
+for i:= 0 to Pred(StoreCnt) do
+    GetAmmoByNum(i)^:= cp.Stores[i];
+
+for a:= Low(TAmmoType) to High(TAmmoType) do
+    begin
+    Ammoz[a].Probability:= cp.Ammos[a].Probability;
+    Ammoz[a].NumberInCase:= cp.Ammos[a].NumberInCase;
+    Ammoz[a].SkipTurns:= cp.Ammos[a].SkipTurns
+    end
+end;
+
+// Checkpoints
+
+// keeps every other checkpoint, the ones left are twice as far apart
+procedure ThinCheckpoints;
+var i, n: LongInt;
+begin
+n:= (Length(Checkpoints) + 1) div 2;
+TilesSize:= 0;
+for i:= 0 to Pred(n) do
+    begin
+    if i > 0 then
+        Checkpoints[i]:= Checkpoints[i * 2];
+    inc(TilesSize, Length(Checkpoints[i].TileLand) * SizeOf(Word) + Length(Checkpoints[i].TilePixels) * SizeOf(LongWord))
+    end;
+SetLength(Checkpoints, n);
+Interval:= Interval * 2;
+AddFileLog('Checkpoints: thinned out to ' + IntToStr(n) + ', interval ' + IntToStr(Interval))
+end;
+
+procedure TakeCheckpoint;
+var cp: TCheckpoint;
+    t: PGear;
+    i, h, n: LongInt;
+begin
+if (GameType <> gmtDemo) or ScriptIsLoaded or (CurAmmoGear <> nil) then
+    exit;
+
+n:= Length(Checkpoints);
+if Interval = 0 then
+    Interval:= cCheckpointInterval;
+if (n > 0) and (GameTicks < Checkpoints[Pred(n)].Ticks + Interval) then
+    exit;
+
+t:= GearsList;
+while t <> nil do
+    begin
+    AddGearState(cp, t, true);
+    t:= t^.NextGear
+    end;
+for i:= 0 to Pred(TeamsCount) do
+    for h:= 0 to cMaxHHIndex do
+        with TeamsArray[i]^.Hedgehogs[h] do
+            if GearHidden <> nil then
+                AddGearState(cp, GearHidden, false);
+
+if not GearsSaved(cp) then
+    exit;
+
+if n = 0 then
+    begin
+    SaveBaseLand;
+    EnableCommandHistory
+    end;
+
+cp.Ticks:= GameTicks;
+cp.History:= CommandHistoryMark;
+SaveVars(cp.Vars);
+GetRandomState(cp.RandomState);
+GetGearsStepState(cp.StepState);
+GetStatsState(cp.StatsState);
+GetCollisionEntries(cp.Collisions);
+SaveTeams(cp);
+SaveLandTiles(cp);
+
+SetLength(Checkpoints, Succ(n));
+Checkpoints[n]:= cp;
+AddFileLog('Checkpoint at ' + IntToStr(GameTicks) + ', ' + IntToStr(Length(cp.Tiles)) + ' land tiles changed');
+SendIPC('K' + IntToStr(GameTicks));
+
+if TilesSize > cCheckpointsBudget then
+    ThinCheckpoints
+end;
+
+procedure RestoreCheckpoint(var cp: TCheckpoint);
+var i, h: LongInt;
+begin
+AddFileLog('Restoring checkpoint at ' + IntToStr(cp.Ticks) + ' (was at ' + IntToStr(GameTicks) + ')');
+if GameTicks > ReachedTicks then
+    ReachedTicks:= GameTicks;
+
+FreeGears;
+RestoreTeams(cp);
+RestoreGears(cp);
+RestoreLandTiles(cp);
+
+RestoreVars(cp.Vars);
+SetRandomState(cp.RandomState);
+SetGearsStepState(cp.StepState);
+SetStatsState(cp.StatsState);
+RewindCommands(cp.History);
+
+CurAmmoGear:= nil;
+lastGearByUID:= nil;
+curHandledGear:= nil;
+if StepSoundChannel >= 0 then
+    StopSoundChan(StepSoundChannel);
+StepSoundChannel:= -1;
+StepSoundTimer:= 0;
+
+if CurrentHedgehog <> nil then
+    FollowGear:= CurrentHedgehog^.Gear
+else
+    FollowGear:= nil;
+
+if not cOnlyStats then
+    for i:= 0 to Pred(TeamsCount) do
+        for h:= 0 to cMaxHHIndex do
+            if TeamsArray[i]^.Hedgehogs[h].Gear <> nil then
+                RenderHealth(TeamsArray[i]^.Hedgehogs[h]);
+AddVisualGear(0, 0, vgtTeamHealthSorter);
+AddVisualGear(0, 0, vgtSmoothWindBar);
+AmmoMenuInvalidated:= true
+end;
+
+// Seeking
+
+procedure chSeek(var s: shortstring);
+begin
+if (GameType <> gmtDemo) or (s = '') then
+    exit;
+SeekTarget:= StrToInt(s);
+seekPending:= true
+end;
+
+procedure SeekStep(var Lag: LongInt);
+var i, n: LongInt;
+begin
+if seekPending then
+    begin
+    seekPending:= false;
+
+    // nearest checkpoint before the target, the first one if the target is before it
+    n:= -1;
+    for i:= 0 to High(Checkpoints) do
+        if (i = 0) or (Checkpoints[i].Ticks <= SeekTarget) then
+            n:= i;
+
+    if (n >= 0) and ((SeekTarget < GameTicks) or (Checkpoints[n].Ticks > GameTicks)) then
+        RestoreCheckpoint(Checkpoints[n]);
+
+    if (SeekTarget > GameTicks) and (not seekRunning) then
+        begin
+        SetSound(false);
+        seekRunning:= true
+        end
+    end;
+
+if seekRunning then
+    if GameTicks >= SeekTarget then
+        begin
+        seekRunning:= false;
+        ResetSound
+        end
+    else
+        Lag:= Min(SeekTarget - GameTicks, cSeekStep)
+end;
+
+function StatsMuted: boolean;
+begin
+StatsMuted:= GameTicks < ReachedTicks
+end;
+
+procedure initModule;
+begin
+    RegisterVariable('seek', @chSeek, true);
+
+    Interval:= 0;
+    TilesSize:= 0;
+    seekPending:= false;
+    seekRunning:= false;
+    SeekTarget:= 0;
+    ReachedTicks:= 0
+end;
+
+procedure freeModule;
+begin
+    SetLength(Checkpoints, 0);
+    SetLength(BaseLand, 0, 0);
+    SetLength(BasePixels, 0, 0)
+end;
+
+end.
@@ -45,12 +45,22 @@ type TLineCollision = record
         cX, cY: LongInt; //for visual effects only
         end;
 
+type TCollisionEntry = record
+        X, Y, Radius: LongInt;
+        cGear: PGear;
+        end;
+    TCollisionEntries = array of TCollisionEntry;
+
 procedure initModule;
 procedure freeModule;
 
 procedure AddCI(Gear: PGear);
 procedure DeleteCI(Gear: PGear);
 
+// for checkpoints: entries are set as they are, Land has to be restored along with them
+procedure GetCollisionEntries(var entries: TCollisionEntries);
+procedure SetCollisionEntries(var entries: TCollisionEntries);
+
 function  CheckGearsCollision(Gear: PGear): PGearArray;
 function  CheckAllGearsCollision(SourceGear: PGear): PGearArray;
 
@@ -87,11 +97,6 @@ function  CalcSlopeTangent(Gear: PGear; collisionX, collisionY: LongInt; var out
 implementation
 uses uConsts, uLandGraphics, uVariables;
 
-type TCollisionEntry = record
-    X, Y, Radius: LongInt;
-    cGear: PGear;
-    end;
-
 const MAXRECTSINDEX = 1023;
 var Count: Longword;
     cinfos: array[0..MAXRECTSINDEX] of TCollisionEntry;
@@ -129,6 +134,28 @@ if Gear^.CollisionIndex >= 0 then
     end;
 end;
 
+procedure GetCollisionEntries(var entries: TCollisionEntries);
+var i: Longword;
+begin
+SetLength(entries, Count);
+if Count > 0 then
+    for i:= 0 to Pred(Count) do
+        entries[i]:= cinfos[i]
+end;
+
+procedure SetCollisionEntries(var entries: TCollisionEntries);
+var i: Longword;
+begin
+Count:= Length(entries);
+if Count > 0 then
+    for i:= 0 to Pred(Count) do
+        begin
+        cinfos[i]:= entries[i];
+        cinfos[i].cGear^.CollisionIndex:= i
+        end;
+ClearHitOrder
+end;
+
 function CheckCoordInWater(X, Y: LongInt): boolean; inline;
 begin
     CheckCoordInWater:= (Y > cWaterLine)
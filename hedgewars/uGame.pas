@@ -27,7 +27,7 @@ procedure DoGameTick(Lag: LongInt);
     implementation
 ////////////////////
 uses uInputHandler, uTeams, uIO, uAI, uGears, uSound, uLocale, uCaptions,
-     uTypes, uVariables, uCommands, uConsts, uVisualGearsList, uUtils
+     uTypes, uVariables, uCommands, uConsts, uVisualGearsList, uUtils, uCheckpoints
      {$IFDEF USE_TOUCH_INTERFACE}, uTouch{$ENDIF}, uDebug;
 
 procedure DoGameTick(Lag: LongInt);
@@ -78,6 +78,9 @@ if GameType <> gmtRecord then
 if cTestLua then
     Lag:= High(LongInt);
 
+if GameType = gmtDemo then
+    SeekStep(Lag);
+
 inc(SoundTimerTicks, Lag);
 if SoundTimerTicks >= 50 then
     begin
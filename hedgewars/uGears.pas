@@ -35,6 +35,18 @@ unit uGears;
 interface
 uses uConsts, uFloat, uTypes, uChat, uCollisions;
 
+type TTurnStep = (stInit, stDelay, stChDmg, stSweep, stTurnReact,
+        stAfterDelay, stChWin, stWater, stChWin2, stHealth,
+        stSpawn, stNTurn);
+
+    // state of the turn machine in ProcessGears, for checkpoints
+    TGearsStepState = record
+        delay, delay2: LongWord;
+        step: TTurnStep;
+        NewTurnTick: LongWord;
+        skipFlag: boolean;
+        end;
+
 procedure initModule;
 procedure freeModule;
 function  SpawnCustomCrateAt(x, y: LongInt; crate: TCrateType; content, cnt: Longword): PGear;
@@ -49,9 +61,11 @@ procedure AssignHHCoords;
 procedure StartSuddenDeath;
 function  GearByUID(uid : Longword) : PGear;
 function  IsClockRunning() : boolean;
+procedure GetGearsStepState(var state: TGearsStepState);
+procedure SetGearsStepState(var state: TGearsStepState);
 
 implementation
-uses uStore, uSound, uTeams, uRandom, uIO, uLandGraphics,
+uses uStore, uSound, uTeams, uRandom, uIO, uLandGraphics, uCheckpoints,
     {$IFDEF USE_TOUCH_INTERFACE}uTouch,{$ENDIF}
     uLocale, uAmmos, uStats, uVisualGears, uScript, uVariables,
     uCommands, uUtils, uTextures, uRenderUtils, uGearsRender, uCaptions,
@@ -62,9 +76,7 @@ var skipFlag: boolean;
 
 var delay: LongWord;
     delay2: LongWord;
-    step: (stInit, stDelay, stChDmg, stSweep, stTurnReact,
-    stAfterDelay, stChWin, stWater, stChWin2, stHealth,
-    stSpawn, stNTurn);
+    step: TTurnStep;
     NewTurnTick: LongWord;
     //SDMusic: shortstring;
 
@@ -490,7 +502,11 @@ if ((GameTicks and $FFFF) = $FFFF) then
     end;
 AddRandomness(CheckSum);
 TurnClockActive:= prevtime <> TurnTimeLeft;
-inc(GameTicks)
+inc(GameTicks);
+
+// a turn has just been set up and nothing of it has run yet
+if (cCheckpointInterval > 0) and (GameTicks = NewTurnTick) then
+    TakeCheckpoint
 end;
 
 //Purpose, to reset all transient attributes toggled by a utility and clean up various gears and effects at end of turn
@@ -1121,6 +1137,24 @@ begin
 end;
 
 
+procedure GetGearsStepState(var state: TGearsStepState);
+begin
+state.delay:= delay;
+state.delay2:= delay2;
+state.step:= step;
+state.NewTurnTick:= NewTurnTick;
+state.skipFlag:= skipFlag
+end;
+
+procedure SetGearsStepState(var state: TGearsStepState);
+begin
+delay:= state.delay;
+delay2:= state.delay2;
+step:= state.step;
+NewTurnTick:= state.NewTurnTick;
+skipFlag:= state.skipFlag
+end;
+
 procedure chSkip(var s: shortstring);
 begin
 s:= s; // avoid compiler hint
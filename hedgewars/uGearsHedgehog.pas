@@ -32,14 +32,14 @@ procedure AddPickup(HH: THedgehog; ammo: TAmmoType; cnt, X, Y: LongWord);
 procedure CheckIce(Gear: PGear); inline;
 procedure PlayTaunt(taunt: Longword);
 
+var GHStepTicks: LongWord = 0;
+
 implementation
 uses uConsts, uVariables, uFloat, uAmmos, uSound, uCaptions,
     uCommands, uLocale, uUtils, uStats, uIO, uScript,
     uGearsList, uCollisions, uRandom, uStore, uTeams,
     uGearsUtils, uVisualGearsList, uChat;
 
-var GHStepTicks: LongWord = 0;
-
 procedure AFKSkip;
 var
     t: byte;
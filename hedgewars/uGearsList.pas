@@ -29,6 +29,7 @@ procedure InsertGearToList(Gear: PGear);
 procedure RemoveGearFromList(Gear: PGear);
 
 var curHandledGear: PGear;
+    GCounter: LongWord = 0; // this does not get re-initialized, but should be harmless
 
 implementation
 
@@ -110,9 +111,6 @@ const
 (*  gtMinigunBullet *) , amMinigun
     );
 
-
-var GCounter: LongWord = 0; // this does not get re-initialized, but should be harmless
-
 const
     cUsualZ = 500;
     cOnHHZ = 2000;
@@ -24,6 +24,7 @@ uses SDLh, uTypes;
 
 procedure initModule;
 procedure freeModule;
+procedure initCommands;
 
 procedure InitIPC;
 procedure SendIPC(s: shortstring);
@@ -38,12 +39,25 @@ procedure IPCCheckSock;
 procedure NetGetNextCmd;
 procedure doPut(putX, putY: LongInt; fromAI: boolean);
 
+// processed commands are kept instead of being freed, so that a demo can be
+// replayed again from a checkpoint
+procedure EnableCommandHistory;
+function  CommandHistoryMark: pointer;
+procedure RewindCommands(mark: pointer);
+
 implementation
-uses uConsole, uConsts, uVariables, uCommands, uUtils, uDebug;
+uses uConsole, uConsts, uVariables, uCommands, uUtils, uDebug, uLandPainted, uPhysFSLayer, uCheckpoints
+    {$IFDEF USE_LOCAL_IPC}, BaseUnix, Sockets{$ENDIF};
 
 const
     cSendEmptyPacketTime = 1000;
     cSendBufferSize = 1024;
+    // a zero length byte starts an extended frame:
+    // #0, version byte, 32-bit big endian payload length, payload
+    cExtendedFrameMark = #0;
+    cExtendedFrameVersion = 1;
+    cExtendedFrameHeader = 6;
+    cMaxExtendedFrameSize = 16 * 1024 * 1024;
 
 type PCmd = ^TCmd;
      TCmd = packed record
@@ -57,12 +71,21 @@ type PCmd = ^TCmd;
 
 var IPCSock: PTCPSocket;
     fds: PSDLNet_SocketSet;
+{$IFDEF USE_LOCAL_IPC}
+    IPCLocalSock: LongInt;
+{$ENDIF}
     isPonged: boolean;
     SocketString: shortstring;
+    extFrame: PByte;
+    extFrameSize, extFrameRead: LongWord;
 
     headcmd: PCmd;
     lastcmd: PCmd;
 
+    keepHistory: boolean;
+    histHead: PCmd;
+    histTail: PCmd;
+
     flushDelayTicks: LongWord;
     sendBuffer: record
                 buf: array[0..Pred(cSendBufferSize)] of byte;
@@ -113,9 +136,182 @@ tmp:= headcmd;
 headcmd:= headcmd^.Next;
 if headcmd = nil then
     lastcmd:= nil;
-dispose(tmp)
+
+if keepHistory then
+    begin
+    tmp^.Next:= nil;
+    if histTail = nil then
+        histHead:= tmp
+    else
+        histTail^.Next:= tmp;
+    histTail:= tmp
+    end
+else
+    dispose(tmp)
+end;
+
+procedure EnableCommandHistory;
+begin
+keepHistory:= true
 end;
 
+function CommandHistoryMark: pointer;
+begin
+CommandHistoryMark:= histTail
+end;
+
+// puts the commands processed after mark back in front of the queue
+procedure RewindCommands(mark: pointer);
+var first: PCmd;
+begin
+if mark = nil then
+    first:= histHead
+else
+    first:= PCmd(mark)^.Next;
+
+if first = nil then
+    exit;
+
+histTail^.Next:= headcmd;
+if headcmd = nil then
+    lastcmd:= histTail;
+headcmd:= first;
+
+if mark = nil then
+    histHead:= nil;
+histTail:= PCmd(mark);
+if histTail <> nil then
+    histTail^.Next:= nil
+end;
+
+// IPC transport: tcp socket through SDL_net or, if the frontend asked for it, a unix domain socket
+
+function IPCConnected: boolean;
+begin
+{$IFDEF USE_LOCAL_IPC}
+    if IPCLocalSock >= 0 then
+        exit(true);
+{$ENDIF}
+    IPCConnected:= IPCSock <> nil
+end;
+
+procedure IPCClose; forward;
+
+procedure IPCSend(p: pointer; len: Longword);
+{$IFDEF USE_LOCAL_IPC}
+var sent, err: LongInt;
+    wfds: TFDSet;
+{$ENDIF}
+begin
+{$IFDEF USE_LOCAL_IPC}
+    // the whole buffer has to go out, a partial command would corrupt the stream
+    if IPCLocalSock >= 0 then
+        begin
+        while len > 0 do
+            begin
+            sent:= fpSend(IPCLocalSock, p, len, MSG_NOSIGNAL);
+            if sent > 0 then
+                begin
+                p:= @(PByte(p)[sent]);
+                dec(len, sent);
+                continue
+                end;
+
+            err:= fpgeterrno;
+            if (sent < 0) and (err = ESysEINTR) then
+                continue;
+            if (sent < 0) and (err = ESysEAGAIN) then
+                begin
+                // socket buffer is full, wait for the frontend to read
+                fpFD_ZERO(wfds);
+                fpFD_SET(IPCLocalSock, wfds);
+                fpSelect(IPCLocalSock + 1, nil, @wfds, nil, nil);
+                continue
+                end;
+
+            // a real error, like a failed receive on the tcp path
+            IPCClose;
+            if cPreviewServer then
+                begin
+                WriteLnToConsole('IPC connection closed');
+                allOK:= false
+                end
+            else
+                OutError('IPC connection lost', true);
+            exit
+            end;
+        exit
+        end;
+{$ENDIF}
+    if IPCSock <> nil then
+        SDLNet_TCP_Send(IPCSock, p, len)
+end;
+
+function IPCDataAvailable: boolean;
+{$IFDEF USE_LOCAL_IPC}
+var rfds: TFDSet;
+    tv: TTimeVal;
+{$ENDIF}
+begin
+{$IFDEF USE_LOCAL_IPC}
+    if IPCLocalSock >= 0 then
+        begin
+        fpFD_ZERO(rfds);
+        fpFD_SET(IPCLocalSock, rfds);
+        tv.tv_sec:= 0;
+        tv.tv_usec:= 0;
+        exit(fpSelect(IPCLocalSock + 1, @rfds, nil, nil, @tv) > 0)
+        end;
+{$ENDIF}
+    fds^.numsockets:= 0;
+    SDLNet_AddSocket(fds, IPCSock);
+    IPCDataAvailable:= SDLNet_CheckSockets(fds, 0) > 0
+end;
+
+function IPCRecv(p: pointer; len: LongInt): LongInt;
+begin
+{$IFDEF USE_LOCAL_IPC}
+    if IPCLocalSock >= 0 then
+        exit(fpRecv(IPCLocalSock, p, len, 0));
+{$ENDIF}
+    IPCRecv:= SDLNet_TCP_Recv(IPCSock, p, len)
+end;
+
+procedure IPCClose;
+begin
+{$IFDEF USE_LOCAL_IPC}
+    if IPCLocalSock >= 0 then
+        CloseSocket(IPCLocalSock);
+    IPCLocalSock:= -1;
+{$ENDIF}
+    if IPCSock <> nil then
+        SDLNet_TCP_Close(IPCSock);
+    IPCSock:= nil
+end;
+
+{$IFDEF USE_LOCAL_IPC}
+procedure InitLocalIPC;
+var addr: TUnixSockAddr;
+begin
+    WriteToConsole('Establishing IPC connection to ' + ipcSocketPath + ' ');
+    IPCLocalSock:= fpSocket(AF_UNIX, SOCK_STREAM, 0);
+    if checkFails(IPCLocalSock >= 0, 'fpSocket', true) then exit;
+
+    FillChar(addr, sizeof(addr), 0);
+    addr.family:= AF_UNIX;
+    Move(ipcSocketPath[1], addr.path[0], min(Length(ipcSocketPath), High(addr.path)));
+
+    if checkFails(fpConnect(IPCLocalSock, @addr, sizeof(addr)) = 0, 'fpConnect', true) then
+        begin
+        CloseSocket(IPCLocalSock);
+        IPCLocalSock:= -1;
+        exit
+        end;
+
+    WriteLnToConsole(msgOK)
+end;
+{$ENDIF}
+
 procedure InitIPC;
 var ipaddr: TIPAddress;
 begin
@@ -124,6 +320,13 @@ begin
     fds:= SDLNet_AllocSocketSet(1);
     SDLCheck(fds <> nil, 'SDLNet_AllocSocketSet', true);
     WriteLnToConsole(msgOK);
+{$IFDEF USE_LOCAL_IPC}
+    if ipcSocketPath <> '' then
+        begin
+        InitLocalIPC;
+        exit
+        end;
+{$ENDIF}
     WriteToConsole('Establishing IPC connection to tcp 127.0.0.1:' + IntToStr(ipcPort) + ' ');
     {$HINTS OFF}
     SDLCheck(SDLNet_ResolveHost(ipaddr, PChar('127.0.0.1'), ipcPort) = 0, 'SDLNet_ResolveHost', true);
@@ -190,34 +393,167 @@ case s[1] of
     end
 end;
 
+procedure ParseIPCPayload(p: PByte; len: LongWord);
+var s: shortstring;
+begin
+    if len <= 255 then
+        begin
+        s[0]:= char(len);
+        Move(p^, s[1], len);
+        ParseIPCCommand(s)
+        end
+    else
+        begin
+        // only drawn maps are allowed to exceed a shortstring
+        s[0]:= #6;
+        Move(p^, s[1], 6);
+        if s = 'edraw ' then
+            AddDrawData(p + 6, len - 6)
+        else
+            OutError('IPC frame too long: ' + sanitizeCharForLog(s[1]), false)
+        end
+end;
+
+// Parses complete frames from buf, the remainder is kept for the next call.
+// Extended frames are collected in extFrame until their payload is complete.
+procedure ParseIPCBuffer(var buf: shortstring);
+var n: LongWord;
+begin
+    while allOK do
+        if extFrame <> nil then
+            begin
+            n:= extFrameSize - extFrameRead;
+            if n > Length(buf) then
+                n:= Length(buf);
+            Move(buf[1], (extFrame + extFrameRead)^, n);
+            Delete(buf, 1, n);
+            inc(extFrameRead, n);
+
+            if extFrameRead < extFrameSize then
+                exit;
+
+            ParseIPCPayload(extFrame, extFrameSize);
+            FreeMem(extFrame, extFrameSize);
+            extFrame:= nil
+            end
+        else if (Length(buf) > 0) and (buf[1] = cExtendedFrameMark) then
+            begin
+            if Length(buf) < cExtendedFrameHeader then
+                exit;
+
+            if byte(buf[2]) <> cExtendedFrameVersion then
+                begin
+                OutError('Unsupported IPC frame version ' + IntToStr(byte(buf[2])), true);
+                exit
+                end;
+
+            extFrameSize:= SDLNet_Read32(@buf[3]);
+            Delete(buf, 1, cExtendedFrameHeader);
+
+            if checkFails(extFrameSize <= cMaxExtendedFrameSize, 'IPC frame is too big', true) then
+                exit;
+
+            if extFrameSize > 0 then
+                begin
+                GetMem(extFrame, extFrameSize);
+                extFrameRead:= 0
+                end
+            end
+        else if (Length(buf) > 1) and (Length(buf) > byte(buf[1])) then
+            begin
+            ParseIPCCommand(copy(buf, 2, byte(buf[1])));
+            Delete(buf, 1, Succ(byte(buf[1])))
+            end
+        else
+            exit
+end;
+
 procedure IPCCheckSock;
 var i: LongInt;
     s: shortstring;
 begin
-    if IPCSock = nil then
+    if not IPCConnected then
         exit;
 
-    fds^.numsockets:= 0;
-    SDLNet_AddSocket(fds, IPCSock);
-
-    while SDLNet_CheckSockets(fds, 0) > 0 do
+    while IPCDataAvailable do
     begin
-        i:= SDLNet_TCP_Recv(IPCSock, @s[1], 255 - Length(SocketString));
+        i:= IPCRecv(@s[1], 255 - Length(SocketString));
         if i > 0 then
         begin
             s[0]:= char(i);
             SocketString:= SocketString + s;
-            while (Length(SocketString) > 1) and (Length(SocketString) > byte(SocketString[1])) do
-            begin
-                ParseIPCCommand(copy(SocketString, 2, byte(SocketString[1])));
-                Delete(SocketString, 1, Succ(byte(SocketString[1])))
-            end
+            ParseIPCBuffer(SocketString)
+        end
+    else if cPreviewServer then
+        begin
+        // frontend is done with us, this is how a preview server session ends
+        WriteLnToConsole('IPC connection closed');
+        IPCClose;
+        allOK:= false;
+        exit
         end
     else
         OutError('IPC connection lost', true)
     end;
 end;
 
+// Packed records are unpacked block by block, see hwdemo.h in physlayer
+procedure LoadPackedRecord(var f: File; start: shortstring);
+var header, data, unpacked: PByte;
+    headerSize, b, i: LongInt;
+    block: TDemoBlock;
+    ss : shortstring = '';
+    done, n: LongWord;
+begin
+headerSize:= hwdemoHeaderSize(@start[1], Length(start));
+if checkFails(headerSize > 0, 'Unsupported record format', true) then
+    exit;
+
+GetMem(header, headerSize);
+Move(start[1], header^, Length(start));
+BlockRead(f, (header + Length(start))^, headerSize - Length(start), i);
+
+if not checkFails(i = headerSize - Length(start), 'Record is truncated', true) then
+    for b:= 0 to Pred(hwdemoBlockCount(header)) do
+        begin
+        hwdemoBlockInfo(header, b, @block);
+        GetMem(data, block.packedSize);
+        GetMem(unpacked, block.unpackedSize);
+
+        Seek(f, block.offset);
+        BlockRead(f, data^, block.packedSize, i);
+
+        if not checkFails((IOResult = 0) and (LongWord(i) = block.packedSize)
+                and (hwdemoUnpackBlock(header, b, data, block.packedSize, unpacked) = 0),
+                'Record is damaged', true) then
+            begin
+            done:= 0;
+            while allOK and (done < block.unpackedSize) do
+                begin
+                n:= 255 - Length(ss);
+                if n > block.unpackedSize - done then
+                    n:= block.unpackedSize - done;
+                // a frame which doesn't fit into a shortstring can't be parsed
+                if checkFails(n > 0, 'Record is damaged', true) then
+                    break;
+
+                Move((unpacked + done)^, ss[Succ(Length(ss))], n);
+                ss[0]:= char(Length(ss) + n);
+                inc(done, n);
+                ParseIPCBuffer(ss)
+                end
+            end;
+
+        FreeMem(data, block.packedSize);
+        FreeMem(unpacked, block.unpackedSize);
+
+        if not allOK then
+            break
+        end;
+
+FreeMem(header, headerSize)
+end;
+
 procedure LoadRecordFromFile(fileName: shortstring);
 var f  : File;
     ss : shortstring = '';
@@ -234,18 +570,27 @@ if checkFails(IOResult = 0, 'Error opening file ' + fileName, true) then
     exit;
 
 i:= 0; // avoid compiler hints
-s[0]:= #0;
+
+// packed records start with a magic, old ones are plain IPC frames
+BlockRead(f, s[1], cDemoHeaderSize, i);
+s[0]:= char(i);
+if hwdemoHeaderSize(@s[1], Length(s)) <> 0 then
+    begin
+    LoadPackedRecord(f, s);
+    close(f);
+    exit
+    end;
+
+ss:= s;
+ParseIPCBuffer(ss);
+
 repeat
     BlockRead(f, s[1], 255 - Length(ss), i);
     if i > 0 then
         begin
         s[0]:= char(i);
         ss:= ss + s;
-        while (Length(ss) > 1)and(Length(ss) > byte(ss[1])) and allOK do
-            begin
-            ParseIPCCommand(copy(ss, 2, byte(ss[1])));
-            Delete(ss, 1, Succ(byte(ss[1])));
-            end
+        ParseIPCBuffer(ss)
         end
 until (i = 0) or (not allOK);
 
@@ -254,9 +599,11 @@ close(f)
 end;
 
 procedure SendStat(sit: TStatInfoType; s: shortstring);
-const stc: array [TStatInfoType] of char = ('r', 'D', 'k', 'K', 'H', 'T', 'P', 's', 'S', 'B', 'c', 'g', 'p');
+const stc: array [TStatInfoType] of char = ('r', 'D', 'k', 'K', 'H', 'T', 'P', 's', 'S', 'B', 'c', 'g', 'p', 'h');
 var buf: shortstring;
 begin
+// stats of a part replayed again after seeking back have been sent already
+if StatsMuted then exit;
 buf:= 'i' + stc[sit] + s;
 SendIPCRaw(@buf[0], length(buf) + 1)
 end;
@@ -276,9 +623,9 @@ end;
 
 procedure flushBuffer();
 begin
-    if IPCSock <> nil then
+    if IPCConnected then
         begin
-        SDLNet_TCP_Send(IPCSock, @sendBuffer.buf, sendBuffer.count);
+        IPCSend(@sendBuffer.buf, sendBuffer.count);
         flushDelayTicks:= 0;
         sendBuffer.count:= 0
         end
@@ -286,7 +633,7 @@ end;
 
 procedure SendIPC(s: shortstring);
 begin
-if IPCSock <> nil then
+if IPCConnected then
     begin
     if s[0] > #251 then
         s[0]:= #251;
@@ -307,15 +654,15 @@ if IPCSock <> nil then
         if (s[1] = 'N') or (s[1] = '#') then
             flushBuffer();
         end else
-        SDLNet_TCP_Send(IPCSock, @s, Succ(byte(s[0])))
+        IPCSend(@s, Succ(byte(s[0])))
     end
 end;
 
 procedure SendIPCRaw(p: pointer; len: Longword);
 begin
-if IPCSock <> nil then
+if IPCConnected then
     begin
-    SDLNet_TCP_Send(IPCSock, p, len)
+    IPCSend(p, len)
     end
 end;
 
@@ -463,7 +810,7 @@ begin
     // TODO: should we try to clean more stuff here?
     SDL_Quit;
 
-    if IPCSock <> nil then
+    if IPCConnected then
         halt(HaltFatalError)
     else
         halt(HaltFatalErrorNoIPC);
@@ -518,17 +865,29 @@ with CurrentHedgehog^.Gear^,
             OutError('got /put while not being in choose target mode', false)
 end;
 
-procedure initModule;
+procedure initCommands;
 begin
     RegisterVariable('fatal', @chFatalError, true );
+end;
+
+procedure initModule;
+begin
+    initCommands;
 
     IPCSock:= nil;
+{$IFDEF USE_LOCAL_IPC}
+    IPCLocalSock:= -1;
+{$ENDIF}
     fds:= nil;
 
     headcmd:= nil;
     lastcmd:= nil;
+    keepHistory:= false;
+    histHead:= nil;
+    histTail:= nil;
     isPonged:= false;
     SocketString:= '';
+    extFrame:= nil;
 
     hiTicks:= 0;
     flushDelayTicks:= 0;
@@ -536,10 +895,20 @@ begin
 end;
 
 procedure freeModule;
+var tmp: PCmd;
 begin
+    keepHistory:= false;
     while headcmd <> nil do RemoveCmd;
+    while histHead <> nil do
+        begin
+        tmp:= histHead;
+        histHead:= histHead^.Next;
+        dispose(tmp)
+        end;
+    if extFrame <> nil then
+        FreeMem(extFrame, extFrameSize);
     SDLNet_FreeSocketSet(fds);
-    SDLNet_TCP_Close(IPCSock);
+    IPCClose;
     SDLNet_Quit();
 
 end;
@@ -23,6 +23,7 @@ unit uLandPainted;
 interface
 
 procedure Draw;
+procedure AddDrawData(p: PByte; len: LongWord);
 procedure initModule;
 procedure freeModule;
 
@@ -44,18 +45,15 @@ type
 
 var pointsListHead, pointsListLast: PPointEntry;
 
-procedure chDraw(var s: shortstring);
+procedure AddDrawData(p: PByte; len: LongWord);
 var rec: PointRec;
-    prec: PPointRec;
     pe: PPointEntry;
-    i, l: byte;
+    i: LongWord;
 begin
-    i:= 1;
-    l:= length(s);
-    while i < l do
+    i:= 0;
+    while i + SizeOf(PointRec) <= len do
         begin
-        prec:= PPointRec(@s[i]);
-        rec:= prec^;
+        rec:= PPointRec(p + i)^;
         rec.X:= SDLNet_Read16(@rec.X);
         rec.Y:= SDLNet_Read16(@rec.Y);
         if rec.X < -318 then rec.X:= -318;
@@ -73,10 +71,15 @@ begin
         pe^.point:= rec;
         pe^.next:= nil;
 
-        inc(i, 5)
+        inc(i, SizeOf(PointRec))
         end;
 end;
 
+procedure chDraw(var s: shortstring);
+begin
+    AddDrawData(@s[1], length(s))
+end;
+
 procedure Draw;
 var pe: PPointEntry;
     prevPoint: PointRec;
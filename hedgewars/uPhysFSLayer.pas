@@ -39,6 +39,19 @@ function  physfsReader(L: Plua_State; f: PFSFile; sz: Psize_t) : PChar; cdecl; e
 procedure physfsReaderSetBuffer(buf: pointer); cdecl; external PhyslayerLibName;
 procedure hedgewarsMountPackage(filename: PChar); cdecl; external PhyslayerLibName;
 
+// packed records, see hwdemo.h
+const cDemoHeaderSize = 18;
+
+type PDemoBlock = ^TDemoBlock;
+     TDemoBlock = record
+            firstTick, offset, packedSize, unpackedSize: LongWord;
+            end;
+
+function  hwdemoHeaderSize(data: pointer; size: LongWord): LongInt; cdecl; external PhyslayerLibName;
+function  hwdemoBlockCount(header: pointer): LongInt; cdecl; external PhyslayerLibName;
+function  hwdemoBlockInfo(header: pointer; block: LongInt; info: PDemoBlock): LongInt; cdecl; external PhyslayerLibName;
+function  hwdemoUnpackBlock(header: pointer; block: LongInt; data: pointer; size: LongWord; output: pointer): LongInt; cdecl; external PhyslayerLibName;
+
 implementation
 uses uConsts, uUtils, uVariables{$IFNDEF PAS2C}{$IFDEF HWLIBRARY}, sysutils{$ENDIF}{$ELSE}, physfs{$ENDIF};
 
@@ -30,11 +30,18 @@ unit uRandom;
 interface
 uses uFloat;
 
+type TRandomState = record
+        buf: array[0..63] of Longword;
+        n: byte;
+        end;
+
 procedure SetRandomSeed(Seed: shortstring; dropAdditionalPart: boolean); // Sets the seed that should be used for generating pseudo-random values.
 function  GetRandomf: hwFloat; // Returns a pseudo-random hwFloat.
 function  GetRandom(m: LongWord): LongWord; inline; // Returns a positive pseudo-random integer smaller than m.
 procedure AddRandomness(r: LongWord); inline;
 function  rndSign(num: hwFloat): hwFloat; // Returns num with a random chance of having a inverted sign.
+procedure GetRandomState(var state: TRandomState); // Copies the generator state, for checkpoints.
+procedure SetRandomState(var state: TRandomState); // Continues from a copied generator state.
 
 
 implementation
@@ -102,4 +109,20 @@ num.isNegative:= odd(GetNext);
 rndSign:= num
 end;
 
+procedure GetRandomState(var state: TRandomState);
+var i: LongInt;
+begin
+for i:= 0 to 63 do
+    state.buf[i]:= cirbuf[i];
+state.n:= n
+end;
+
+procedure SetRandomState(var state: TRandomState);
+var i: LongInt;
+begin
+for i:= 0 to 63 do
+    cirbuf[i]:= state.buf[i];
+n:= state.n
+end;
+
 end.
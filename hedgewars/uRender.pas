@@ -85,6 +85,7 @@ procedure UpdateViewLimits();
 
 procedure RendererSetup();
 procedure RendererCleanup();
+function  glLoadExtension(extension : shortstring) : boolean;
 
 procedure ChangeDepth(rm: TRenderMode; d: GLfloat);
 procedure ResetDepth(rm: TRenderMode);
@@ -47,6 +47,7 @@ function ScriptCall(fname : shortstring; par1, par2: LongInt) : LongInt;
 function ScriptCall(fname : shortstring; par1, par2, par3: LongInt) : LongInt;
 function ScriptCall(fname : shortstring; par1, par2, par3, par4 : LongInt) : LongInt;
 function ScriptExists(fname : shortstring) : boolean;
+function ScriptIsLoaded : boolean;
 
 procedure LuaParseString(s: shortString);
 
@@ -263,7 +264,7 @@ function LuaToStatInfoTypeOrd(L : Plua_State; i: LongInt; call, paramsyntax: sho
 begin
     if lua_isnoneornil(L, i) then i:= -1
     else i:= Trunc(lua_tonumber(L, i));
-    if (i < ord(Low(TStatInfoType))) or (i > ord(High(TStatInfoType))) then
+    if (i < ord(Low(TStatInfoType))) or (i >= ord(siStateHash)) then
         begin
         LuaCallError('Invalid statInfoType!', call, paramsyntax);
         LuaToStatInfoTypeOrd:= -1;
@@ -3647,6 +3648,11 @@ ScriptExists:= not lua_isnoneornil(luaState, -1);
 lua_pop(luaState, 1)
 end;
 
+function ScriptIsLoaded : boolean;
+begin
+ScriptIsLoaded:= ScriptLoaded
+end;
+
 procedure ScriptPrepareAmmoStore;
 var i: ShortInt;
 begin
@@ -3832,7 +3838,8 @@ for st:= Low(TSound) to High(TSound) do
 for am:= Low(TAmmoType) to High(TAmmoType) do
     ScriptSetInteger(EnumToStr(am), ord(am));
 
-for si:= Low(TStatInfoType) to High(TStatInfoType) do
+// siStateHash is engine internal, scripts can't send it
+for si:= Low(TStatInfoType) to Pred(siStateHash) do
     ScriptSetInteger(EnumToStr(si), ord(si));
 
 for he:= Low(THogEffect) to High(THogEffect) do
@@ -4130,6 +4137,11 @@ begin
     fname:= fname; // avoid hint
     ScriptExists:= false
 end;
+
+function ScriptIsLoaded : boolean;
+begin
+    ScriptIsLoaded:= false
+end;
 (*
 function ParseCommandOverride(key, value : shortstring) : shortstring;
 begin
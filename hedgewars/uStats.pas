@@ -29,6 +29,18 @@ var TotalRounds: LongInt; // Number of rounds played (-1 if game not started)
     SendAchievementsStatsOn : boolean = true;
     SendHealthStatsOn : boolean = true;
 
+type TStatsState = record
+        DamageClan, DamageTotal, DamageTurn: Longword;
+        PoisonTurn, PoisonClan, PoisonTotal: Longword;
+        KillsClan, Kills, KillsTotal: LongWord;
+        HitTargets, AmmoUsedCount: LongWord;
+        AmmoDamagingUsed: boolean;
+        SkippedTurns: LongWord;
+        isTurnSkipped: boolean;
+        vpHurtSameClan, vpHurtEnemy: PVoicepack;
+        TotalRounds, FinishedTurnsTotal: LongInt;
+        end;
+
 procedure initModule;
 procedure freeModule;
 
@@ -40,13 +52,16 @@ procedure TargetHit;
 procedure Skipped;
 procedure TurnReaction;
 procedure SendStats;
+procedure SendStateHash;
 procedure hedgehogFlight(Gear: PGear; time: Longword);
 procedure declareAchievement(id, teamname, location: shortstring; value: LongInt);
 procedure startGhostPoints(n: LongInt);
 procedure dumpPoint(x, y: LongInt);
+procedure GetStatsState(var state: TStatsState);
+procedure SetStatsState(var state: TStatsState);
 
 implementation
-uses uSound, uLocale, uVariables, uUtils, uIO, uCaptions, uMisc, uConsole, uScript;
+uses uSound, uLocale, uVariables, uUtils, uIO, uCaptions, uMisc, uConsole, uScript, uFloat;
 
 var DamageClan  : Longword = 0;
     DamageTotal : Longword = 0;
@@ -385,6 +400,46 @@ if SendHealthStatsOn then
     ScriptCall('onAchievementsDeclaration');
 end;
 
+// every value is rotated in separately, so swapped values hash differently
+function mixHash(hash, v: Longword): Longword;
+begin
+    mixHash:= ((hash shl 5) or (hash shr 27)) xor v
+end;
+
+function mixHashFloat(hash: Longword; const f: hwFloat): Longword;
+begin
+    mixHashFloat:= mixHash(mixHash(mixHash(hash, Longword(ord(f.isNegative))), f.round), f.frac)
+end;
+
+// Hash of the final game state for replay regression checks. Unlike the turn
+// checksum it depends on gear order and leaves CheckSum and the random
+// generator alone
+procedure SendStateHash;
+var gi: PGear;
+    hash: Longword;
+begin
+    hash:= GameTicks;
+    gi:= GearsList;
+    while gi <> nil do
+        begin
+        with gi^ do
+            begin
+            hash:= mixHash(hash, Longword(ord(Kind)));
+            hash:= mixHashFloat(hash, X);
+            hash:= mixHashFloat(hash, Y);
+            hash:= mixHashFloat(hash, dX);
+            hash:= mixHashFloat(hash, dY);
+            hash:= mixHash(hash, Longword(Health));
+            hash:= mixHash(hash, State);
+            hash:= mixHash(hash, Timer);
+            hash:= mixHash(hash, Angle)
+            end;
+        gi:= gi^.NextGear
+        end;
+
+    SendStat(siStateHash, IntToStr(LongInt(hash)) + ' ' + IntToStr(GameTicks));
+end;
+
 procedure declareAchievement(id, teamname, location: shortstring; value: LongInt);
 begin
 if (length(id) = 0) or (length(teamname) = 0) or (length(location) = 0) then exit;
@@ -407,6 +462,50 @@ begin
     WriteLnToConsole(inttostr(y));
 end;
 
+procedure GetStatsState(var state: TStatsState);
+begin
+    state.DamageClan:= DamageClan;
+    state.DamageTotal:= DamageTotal;
+    state.DamageTurn:= DamageTurn;
+    state.PoisonTurn:= PoisonTurn;
+    state.PoisonClan:= PoisonClan;
+    state.PoisonTotal:= PoisonTotal;
+    state.KillsClan:= KillsClan;
+    state.Kills:= Kills;
+    state.KillsTotal:= KillsTotal;
+    state.HitTargets:= HitTargets;
+    state.AmmoUsedCount:= AmmoUsedCount;
+    state.AmmoDamagingUsed:= AmmoDamagingUsed;
+    state.SkippedTurns:= SkippedTurns;
+    state.isTurnSkipped:= isTurnSkipped;
+    state.vpHurtSameClan:= vpHurtSameClan;
+    state.vpHurtEnemy:= vpHurtEnemy;
+    state.TotalRounds:= TotalRounds;
+    state.FinishedTurnsTotal:= FinishedTurnsTotal
+end;
+
+procedure SetStatsState(var state: TStatsState);
+begin
+    DamageClan:= state.DamageClan;
+    DamageTotal:= state.DamageTotal;
+    DamageTurn:= state.DamageTurn;
+    PoisonTurn:= state.PoisonTurn;
+    PoisonClan:= state.PoisonClan;
+    PoisonTotal:= state.PoisonTotal;
+    KillsClan:= state.KillsClan;
+    Kills:= state.Kills;
+    KillsTotal:= state.KillsTotal;
+    HitTargets:= state.HitTargets;
+    AmmoUsedCount:= state.AmmoUsedCount;
+    AmmoDamagingUsed:= state.AmmoDamagingUsed;
+    SkippedTurns:= state.SkippedTurns;
+    isTurnSkipped:= state.isTurnSkipped;
+    vpHurtSameClan:= state.vpHurtSameClan;
+    vpHurtEnemy:= state.vpHurtEnemy;
+    TotalRounds:= state.TotalRounds;
+    FinishedTurnsTotal:= state.FinishedTurnsTotal
+end;
+
 procedure initModule;
 begin
     DamageClan  := 0;
@@ -43,15 +43,14 @@ procedure TeamGoneEffect(var Team: TTeam);
 procedure SwitchCurrentHedgehog(newHog: PHedgehog);
 
 var MaxTeamHealth: LongInt;
+    TeamsGameOver: boolean;
+    NextClan: boolean;
 
 implementation
 uses uLocale, uAmmos, uChat, uVariables, uUtils, uIO, uCaptions, uCommands, uDebug,
     uGearsUtils, uGearsList, uVisualGearsList, uTextures
     {$IFDEF USE_TOUCH_INTERFACE}, uTouch{$ENDIF};
 
-var TeamsGameOver: boolean;
-    NextClan: boolean;
-
 function CheckForWin: boolean;
 var AliveClan: PClan;
     s, cap: ansistring;
@@ -39,6 +39,7 @@ var
     cNewScreenHeight   : LongInt;
     cScreenResizeDelay : LongWord;
     ipcPort            : Word;
+    ipcSocketPath      : shortstring;
     AprilOne           : boolean;
     cFullScreen        : boolean;
     cLocaleFName       : shortstring;
@@ -60,6 +61,8 @@ var
     cReadyDelay        : Longword;
     cStereoMode        : TStereoMode;
     cOnlyStats         : boolean;
+    cPreviewServer     : boolean;
+    cCheckpointInterval: LongWord; // game ticks between demo checkpoints, 0 - no checkpoints
 {$IFDEF USE_VIDEO_RECORDING}
     RecPrefix          : shortstring;
     cAVFormat          : shortstring;
@@ -2610,6 +2613,7 @@ begin
 
     UserPathPrefix  := '';
     ipcPort         := 0;
+    ipcSocketPath   := '';
     recordFileName  := '';
     UserNick        := '';
     cStereoMode     := smNone;
@@ -2617,6 +2621,8 @@ begin
     PathPrefix      := './';
     GameType        := gmtLocal;
     cOnlyStats      := False;
+    cPreviewServer  := False;
+    cCheckpointInterval:= 0;
     cScriptName     := '';
     cScriptParam    := '';
     cTestLua        := False;
@@ -18,6 +18,7 @@
 
 
 {$INCLUDE "options.inc"}
+{$IF GLunit = GL}{$DEFINE GLunit:=GL,GLext}{$ENDIF}
 
 unit uVideoRec;
 
@@ -34,6 +35,8 @@ end.
 interface
 
 var flagPrerecording: boolean = false;
+    recordingPaused: boolean = false; // set by the frontend to hold the recorder loop
+    recordingAutoCamera: boolean = false; // no prerecorded camera, follow the game like a player would
 
 function BeginVideoRecording: Boolean;
 function LoadNextCameraPosition(out newRealTicks, newGameTicks: LongInt): Boolean;
@@ -48,7 +51,7 @@ procedure initModule;
 procedure freeModule;
 
 implementation
-uses uVariables, GLunit, SDLh, SysUtils, uUtils, uIO, uMisc, uTypes, uDebug;
+uses uVariables, GLunit, SDLh, SysUtils, uUtils, uIO, uMisc, uTypes, uDebug, uRender, uCommands;
 
 type TAddFileLogRaw = procedure (s: pchar); cdecl;
 const AvwrapperLibName = 'libavwrapper';
@@ -58,6 +61,7 @@ function AVWrapper_Init(
               filename, desc, soundFile, format, vcodec, acodec: PChar;
               width, height, framerateNum, framerateDen, vquality: LongInt): LongInt; cdecl; external AvwrapperLibName;
 function AVWrapper_Close: LongInt; cdecl; external AvwrapperLibName;
+function AVWrapper_GetFrameBuffer: PByte; cdecl; external AvwrapperLibName;
 function AVWrapper_WriteFrame(rgb: PByte): LongInt; cdecl; external AvwrapperLibName;
 
 type TFrame = record
@@ -67,19 +71,86 @@ type TFrame = record
                   zoom: single;
               end;
 
-var RGB_Buffer: PByte;
-    cameraFile: File of TFrame;
+// Frames are read into pixel buffer objects in turn, so glReadPixels returns
+// without waiting for rendering to finish. A frame is mapped and passed to
+// the encoder when its buffer is needed again, i.e. two frames later.
+const PixelBufferCount = 3;
+
+var cameraFile: File of TFrame;
     audioFile: File;
-    numPixels: LongWord;
     startTime, numFrames, curTime, progress, maxProgress: LongWord;
+    autoCameraTicks: LongWord; // expected length of the game, for progress
     soundFilePath: shortstring;
     thumbnailSaved : Boolean;
+    pixelBuffers: array[0..PixelBufferCount - 1] of GLuint;
+    usePixelBuffers: boolean;
+    framesRead, framesWritten: LongWord;
+
+procedure SaveThumbnail; forward;
+
+procedure InitPixelBuffers;
+var i: LongInt;
+begin
+    usePixelBuffers:= glLoadExtension('GL_ARB_vertex_buffer_object') and glLoadExtension('GL_ARB_pixel_buffer_object');
+    framesRead:= 0;
+    framesWritten:= 0;
+    if not usePixelBuffers then
+    begin
+        AddFileLog('Pixel buffer objects are not supported, frames will be read synchronously.');
+        exit;
+    end;
+
+    glGenBuffersARB(PixelBufferCount, @pixelBuffers[0]);
+    for i:= 0 to PixelBufferCount - 1 do
+    begin
+        glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, pixelBuffers[i]);
+        glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB, 4*cScreenWidth*cScreenHeight, nil, GL_STREAM_READ_ARB);
+    end;
+    glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+end;
+
+// passes the oldest frame in the pixel buffers to the encoder
+procedure WritePixelBuffer;
+var pixels: PByte;
+begin
+    glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, pixelBuffers[framesWritten mod PixelBufferCount]);
+    pixels:= glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+    if pixels = nil then
+    begin
+        AddFileLog('Error: Could not map pixel buffer.');
+        halt(-1);
+    end;
+
+    if AVWrapper_WriteFrame(pixels) < 0 then
+        halt(-1);
+
+    glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+    glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+    inc(framesWritten);
+end;
+
+procedure FreePixelBuffers;
+begin
+    if not usePixelBuffers then
+        exit;
+
+    while framesWritten < framesRead do
+        WritePixelBuffer();
+
+    glDeleteBuffersARB(PixelBufferCount, @pixelBuffers[0]);
+    usePixelBuffers:= false;
+end;
 
 function BeginVideoRecording: Boolean;
 var filename, desc: shortstring;
 begin
     AddFileLog('BeginVideoRecording');
 
+    if recordingAutoCamera then
+        // progress is measured in game ticks then
+        maxProgress:= max(autoCameraTicks, 1)
+    else
+    begin
 {$IOCHECKS OFF}
     // open file with prerecorded camera positions
     filename:= UserPathPrefix + '/VideoTemp/' + RecPrefix + '.txtin';
@@ -92,6 +163,7 @@ begin
         exit(false);
     end;
 {$IOCHECKS ON}
+    end;
 
     { Store some description in output file.
     The comment must follow a particular format and must be in English.
@@ -126,41 +198,57 @@ begin
         'AVWrapper_Init failed',
         true) then exit(false);
 
-    numPixels:= cScreenWidth*cScreenHeight;
-
-    RGB_Buffer:= GetMem(4*numPixels);
-    if RGB_Buffer = nil then
-    begin
-        AddFileLog('Error: Could not allocate memory for video recording (RGB buffer).');
-        exit(false);
-    end;
+    InitPixelBuffers();
 
     curTime:= 0;
     numFrames:= 0;
     progress:= 0;
+    thumbnailSaved:= not recordingAutoCamera; // otherwise saved while prerecording
     BeginVideoRecording:= true;
 end;
 
 procedure StopVideoRecording;
 begin
     AddFileLog('StopVideoRecording');
-    FreeMem(RGB_Buffer, 4*numPixels);
-    Close(cameraFile);
+    FreePixelBuffers();
+    if not recordingAutoCamera then
+        Close(cameraFile);
     if AVWrapper_Close() < 0 then
         halt(-1);
-    Erase(cameraFile);
+    if not recordingAutoCamera then
+        Erase(cameraFile);
     DeleteFile(soundFilePath);
     SendIPC(_S'v'); // inform frontend that we finished
 end;
 
 procedure EncodeFrame;
 var s: shortstring;
+    buffer: PByte;
 begin
-    // read pixels from OpenGL
-    glReadPixels(0, 0, cScreenWidth, cScreenHeight, GL_RGBA, GL_UNSIGNED_BYTE, RGB_Buffer);
+    // without prerecording the thumbnail is taken from the video
+    if (not thumbnailSaved) and (ScreenFade = sfNone) then
+        SaveThumbnail();
 
-    if AVWrapper_WriteFrame(RGB_Buffer) < 0 then
-        halt(-1);
+    if usePixelBuffers then
+    begin
+        glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, pixelBuffers[framesRead mod PixelBufferCount]);
+        glReadPixels(0, 0, cScreenWidth, cScreenHeight, GL_RGBA, GL_UNSIGNED_BYTE, nil);
+        glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+        inc(framesRead);
+
+        if framesRead - framesWritten = PixelBufferCount then
+            WritePixelBuffer();
+    end
+    else
+    begin
+        // read pixels from OpenGL right into the encoder queue, the wrapper
+        // converts and encodes them in its own threads
+        buffer:= AVWrapper_GetFrameBuffer();
+        glReadPixels(0, 0, cScreenWidth, cScreenHeight, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
+
+        if AVWrapper_WriteFrame(buffer) < 0 then
+            halt(-1);
+    end;
 
     // inform frontend that we have encoded new frame
     s[0]:= #3;
@@ -173,6 +261,16 @@ end;
 function LoadNextCameraPosition(out newRealTicks, newGameTicks: LongInt): Boolean;
 var frame: TFrame = (realTicks: 0; gameTicks: 0; CamX: 0; CamY: 0; zoom: 0);
 begin
+    // game runs in real time, one frame after another; the recorder loop
+    // ends when the demo does
+    if recordingAutoCamera then
+    begin
+        newRealTicks:= Int64(numFrames)*cVideoFramerateDen*1000 div cVideoFramerateNum;
+        newGameTicks:= newRealTicks;
+        progress:= min(newGameTicks, maxProgress);
+        exit(true);
+    end;
+
     // we need to skip or duplicate frames to match target framerate
     while Int64(curTime)*cVideoFramerateNum <= Int64(numFrames)*cVideoFramerateDen*1000 do
     begin
@@ -340,8 +438,37 @@ begin
     BlockWrite(cameraFile, frame, 1);
 end;
 
+// 'recautocam <ticks>' records without a camera file from prerecording,
+// ticks is the length of the game if known, 0 otherwise
+procedure chRecAutoCamera(var s: shortstring);
+var c: Word;
+begin
+    recordingAutoCamera:= true;
+    val(s, autoCameraTicks, c);
+    if c <> 0 then
+        autoCameraTicks:= 0;
+    AddFileLog('Recording with automatic camera, ' + IntToStr(autoCameraTicks) + ' ticks expected');
+end;
+
+// 'recpause on' stops encoding until 'recpause off', so the frontend can
+// pause a recording without losing what has been encoded so far
+procedure chRecPause(var s: shortstring);
+begin
+    recordingPaused:= s = 'on';
+    if recordingPaused then
+        AddFileLog('Recording paused')
+    else
+        AddFileLog('Recording resumed');
+end;
+
 procedure initModule;
 begin
+    RegisterVariable('recpause', @chRecPause, true);
+    RegisterVariable('recautocam', @chRecAutoCamera, true);
+    recordingPaused:= false;
+    recordingAutoCamera:= false;
+    autoCameraTicks:= 0;
+
     // we need to make sure these variables are initialized before the main loop
     // or the wrapper will keep the default values of preinit
     cScreenWidth:= max(cWindowedWidth, 640);
@@ -857,7 +857,7 @@ begin
     else
         ZoomValue:= zoom;
 
-    if (not isPaused) and (not isAFK) and (GameType <> gmtRecord) then
+    if (not isPaused) and (not isAFK) and ((GameType <> gmtRecord){$IFDEF USE_VIDEO_RECORDING} or recordingAutoCamera{$ENDIF}) then
         MoveCamera;
 
     if cStereoMode = smNone then
@@ -6,11 +6,15 @@ LOCAL_MODULE    := physlayer
 
 LOCAL_CFLAGS := -O2
 
-LOCAL_C_INCLUDES := $(LOCAL_PATH) $(MISC_DIR)/liblua $(MISC_DIR)/liblua $(JNI_DIR)/SDL/include
+LOCAL_C_INCLUDES := $(LOCAL_PATH) $(MISC_DIR)/liblua $(MISC_DIR)/liblua $(JNI_DIR)/SDL/include \
+                    $(MISC_DIR)/libphysfs/lzma/C/Compress/Lzma
 
 LOCAL_SRC_FILES := hwpacksmounter.c \
                    physfslualoader.c \
                    physfsrwops.c \
+                   hwdemo.c \
+                   lzmaencode.c \
+                   ../libphysfs/lzma/C/Compress/Lzma/LzmaDecode.c \
 
 LOCAL_SHARED_LIBRARIES += SDL lua
 
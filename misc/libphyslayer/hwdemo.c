@@ -0,0 +1,241 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "hwdemo.h"
+#include "lzmaencode.h"
+
+static unsigned int readLE32(const unsigned char * p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8)
+        | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void writeLE32(unsigned char * p, unsigned int v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+PHYSFS_DECL int hwdemoHeaderSize(const void * data, unsigned int size)
+{
+    const unsigned char * p = (const unsigned char *)data;
+
+    if (size < 4 || memcmp(p, HWDEMO_MAGIC, 4) != 0)
+        return 0;
+
+    if (size < HWDEMO_HEADER_SIZE || p[4] != HWDEMO_VERSION
+            || readLE32(p + 10) > 0xFFFFFFu)
+        return -1;
+
+    return HWDEMO_HEADER_SIZE + hwdemoBlockCount(data) * HWDEMO_INDEX_ENTRY_SIZE;
+}
+
+PHYSFS_DECL int hwdemoBlockCount(const void * header)
+{
+    return (int)readLE32((const unsigned char *)header + 10);
+}
+
+PHYSFS_DECL unsigned int hwdemoUnpackedSize(const void * header)
+{
+    return readLE32((const unsigned char *)header + 14);
+}
+
+PHYSFS_DECL int hwdemoBlockInfo(const void * header, int block, HWDemoBlock * info)
+{
+    const unsigned char * p;
+
+    if (block < 0 || block >= hwdemoBlockCount(header))
+        return -1;
+
+    p = (const unsigned char *)header + HWDEMO_HEADER_SIZE + block * HWDEMO_INDEX_ENTRY_SIZE;
+    info->firstTick = readLE32(p);
+    info->offset = readLE32(p + 4);
+    info->packedSize = readLE32(p + 8);
+    info->unpackedSize = readLE32(p + 12);
+
+    return 0;
+}
+
+PHYSFS_DECL int hwdemoFindBlock(const void * header, unsigned int tick)
+{
+    int count = hwdemoBlockCount(header);
+    int lo = 0, hi = count - 1;
+    HWDemoBlock info;
+
+    if (count == 0)
+        return -1;
+
+    /* first ticks never decrease, find the last one not past tick */
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        hwdemoBlockInfo(header, mid, &info);
+        if (info.firstTick <= tick)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return lo;
+}
+
+PHYSFS_DECL int hwdemoUnpackBlock(const void * header, int block,
+                                  const void * packed, unsigned int packedSize,
+                                  void * out)
+{
+    HWDemoBlock info;
+    CLzmaDecoderState state;
+    SizeT inProcessed, outProcessed;
+    int result;
+
+    if (hwdemoBlockInfo(header, block, &info) != 0 || packedSize != info.packedSize)
+        return -1;
+
+    if (info.packedSize == info.unpackedSize)
+    {
+        memcpy(out, packed, packedSize);
+        return 0;
+    }
+
+    if (LzmaDecodeProperties(&state.Properties, (const unsigned char *)header + 5, LZMA_PROPERTIES_SIZE) != LZMA_RESULT_OK)
+        return -1;
+
+    state.Probs = (CProb *)malloc(LzmaGetNumProbs(&state.Properties) * sizeof(CProb));
+    if (state.Probs == NULL)
+        return -1;
+
+    result = LzmaDecode(&state, (const unsigned char *)packed, packedSize, &inProcessed,
+                        (unsigned char *)out, info.unpackedSize, &outProcessed);
+
+    free(state.Probs);
+
+    if (result != LZMA_RESULT_OK || outProcessed != info.unpackedSize)
+        return -1;
+
+    return 0;
+}
+
+PHYSFS_DECL size_t hwdemoPackBound(size_t size)
+{
+    /* every block but the last one holds at least HWDEMO_BLOCK_SIZE bytes,
+       blocks which don't compress are stored */
+    return HWDEMO_HEADER_SIZE + (size / HWDEMO_BLOCK_SIZE + 1) * HWDEMO_INDEX_ENTRY_SIZE + size;
+}
+
+/* Size of the IPC frame at p, 0 if it is incomplete. Frames are a length
+   byte and payload, or a zero byte, version, 32-bit big endian length and
+   payload. */
+static size_t frameAt(const unsigned char * p, size_t avail, const unsigned char ** payload, size_t * payloadSize)
+{
+    size_t header = 1;
+
+    if (avail < 1)
+        return 0;
+
+    *payloadSize = p[0];
+    if (p[0] == 0)
+    {
+        if (avail < 6)
+            return 0;
+        header = 6;
+        *payloadSize = ((size_t)p[2] << 24) | ((size_t)p[3] << 16) | ((size_t)p[4] << 8) | p[5];
+    }
+
+    if (avail - header < *payloadSize)
+        return 0;
+
+    *payload = p + header;
+    return header + *payloadSize;
+}
+
+/* Engine messages end with the low 16 bits of their tick, '#' increments the
+   high part. These are parsed by the engine as they arrive and carry none. */
+static int hasTimestamp(unsigned char cmd)
+{
+    return strchr("!?eEWMoTVIFG#", cmd) == NULL;
+}
+
+PHYSFS_DECL size_t hwdemoPack(const void * data, size_t size, void * out, size_t outSize)
+{
+    const unsigned char * in = (const unsigned char *)data;
+    unsigned char * o = (unsigned char *)out;
+    unsigned int * firstTicks;
+    size_t * blockEnds;
+    size_t maxBlocks = size / HWDEMO_BLOCK_SIZE + 1;
+    size_t blocks = 0, pos = 0, blockStart = 0, written, i;
+    unsigned int hiTicks = 0, tick = 0, blockTick = 0;
+
+    if (outSize < hwdemoPackBound(size) || size > 0xFFFFFFFFu)
+        return 0;
+
+    firstTicks = (unsigned int *)malloc(maxBlocks * sizeof(unsigned int));
+    blockEnds = (size_t *)malloc(maxBlocks * sizeof(size_t));
+    if (firstTicks == NULL || blockEnds == NULL)
+    {
+        free(firstTicks);
+        free(blockEnds);
+        return 0;
+    }
+
+    /* cut the stream into blocks at frame boundaries */
+    while (pos < size)
+    {
+        const unsigned char * payload;
+        size_t payloadSize;
+        size_t frame = frameAt(in + pos, size - pos, &payload, &payloadSize);
+
+        if (frame == 0)
+            frame = size - pos; /* truncated record, keep the tail as is */
+        else if (payloadSize > 0 && payload[0] == '#')
+            hiTicks++;
+        else if (payloadSize > 2 && hasTimestamp(payload[0]))
+            tick = (hiTicks << 16) | ((unsigned int)payload[payloadSize - 2] << 8) | payload[payloadSize - 1];
+
+        pos += frame;
+
+        if (pos - blockStart >= HWDEMO_BLOCK_SIZE || pos == size)
+        {
+            firstTicks[blocks] = blockTick;
+            blockEnds[blocks] = pos;
+            blocks++;
+            blockStart = pos;
+            blockTick = tick;
+        }
+    }
+
+    memcpy(o, HWDEMO_MAGIC, 4);
+    o[4] = HWDEMO_VERSION;
+    writeLE32(o + 10, (unsigned int)blocks);
+    writeLE32(o + 14, (unsigned int)size);
+    LzmaEncodeProperties(o + 5, HWDEMO_BLOCK_SIZE);
+
+    written = HWDEMO_HEADER_SIZE + blocks * HWDEMO_INDEX_ENTRY_SIZE;
+    blockStart = 0;
+    for (i = 0; i < blocks; i++)
+    {
+        unsigned char * entry = o + HWDEMO_HEADER_SIZE + i * HWDEMO_INDEX_ENTRY_SIZE;
+        size_t unpacked = blockEnds[i] - blockStart;
+        size_t packed = LzmaEncodeBuffer(in + blockStart, unpacked, o + written, unpacked - 1);
+
+        if (packed == 0)
+        {
+            memcpy(o + written, in + blockStart, unpacked);
+            packed = unpacked;
+        }
+
+        writeLE32(entry, firstTicks[i]);
+        writeLE32(entry + 4, (unsigned int)written);
+        writeLE32(entry + 8, (unsigned int)packed);
+        writeLE32(entry + 12, (unsigned int)unpacked);
+
+        written += packed;
+        blockStart = blockEnds[i];
+    }
+
+    free(firstTicks);
+    free(blockEnds);
+
+    return written;
+}
@@ -0,0 +1,72 @@
+#ifndef HEDGEWARS_DEMO_CONTAINER_H
+#define HEDGEWARS_DEMO_CONTAINER_H
+
+#include <stddef.h>
+
+#include "physfs.h"
+#include "physfscompat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Packed demo container
+ *
+ * Records used to be a plain concatenation of IPC frames. A packed record
+ * splits the same stream into blocks at frame boundaries and stores each
+ * block LZMA compressed on its own, so any block can be unpacked without
+ * touching the ones before it. All numbers are little endian.
+ *
+ *   "HWDZ", version byte, 5 bytes LZMA properties,
+ *   u32 block count, u32 unpacked size of the whole stream,
+ *   block count * { u32 first tick, u32 offset, u32 packed size, u32 unpacked size },
+ *   packed blocks
+ *
+ * The first tick of a block is the game tick the replay has reached when
+ * the block starts, the configuration always ends up in block 0. A block whose
+ * packed size equals its unpacked size is stored as is.
+ */
+
+#define HWDEMO_MAGIC "HWDZ"
+#define HWDEMO_VERSION 1
+#define HWDEMO_HEADER_SIZE 18
+#define HWDEMO_INDEX_ENTRY_SIZE 16
+#define HWDEMO_BLOCK_SIZE 65536
+
+typedef struct
+{
+    unsigned int firstTick;
+    unsigned int offset;
+    unsigned int packedSize;
+    unsigned int unpackedSize;
+} HWDemoBlock;
+
+/* Size of header and index, 0 if data isn't a packed record or -1 if it is,
+   but size is less than HWDEMO_HEADER_SIZE or the version is unknown. */
+PHYSFS_DECL int hwdemoHeaderSize(const void * data, unsigned int size);
+
+/* header has to hold hwdemoHeaderSize() bytes for the functions below */
+PHYSFS_DECL int hwdemoBlockCount(const void * header);
+PHYSFS_DECL unsigned int hwdemoUnpackedSize(const void * header);
+PHYSFS_DECL int hwdemoBlockInfo(const void * header, int block, HWDemoBlock * info);
+
+/* last block starting at or before tick */
+PHYSFS_DECL int hwdemoFindBlock(const void * header, unsigned int tick);
+
+/* out has to hold the unpacked size of the block, returns 0 on success */
+PHYSFS_DECL int hwdemoUnpackBlock(const void * header, int block,
+                                  const void * packed, unsigned int packedSize,
+                                  void * out);
+
+/* worst case size of hwdemoPack() output */
+PHYSFS_DECL size_t hwdemoPackBound(size_t size);
+
+/* packs a raw record, returns the packed size or 0 on failure */
+PHYSFS_DECL size_t hwdemoPack(const void * data, size_t size, void * out, size_t outSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
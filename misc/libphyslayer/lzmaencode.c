@@ -0,0 +1,420 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+
+#include "lzmaencode.h"
+
+/* probability model layout, has to match LzmaDecode.c */
+#define kNumTopBits 24
+#define kTopValue ((UInt32)1 << kNumTopBits)
+
+#define kNumBitModelTotalBits 11
+#define kBitModelTotal (1 << kNumBitModelTotalBits)
+#define kNumMoveBits 5
+
+#define kNumPosBitsMax 4
+#define kNumPosStatesMax (1 << kNumPosBitsMax)
+
+#define kLenNumLowBits 3
+#define kLenNumLowSymbols (1 << kLenNumLowBits)
+#define kLenNumMidBits 3
+#define kLenNumMidSymbols (1 << kLenNumMidBits)
+#define kLenNumHighBits 8
+#define kLenNumHighSymbols (1 << kLenNumHighBits)
+
+#define LenChoice 0
+#define LenChoice2 (LenChoice + 1)
+#define LenLow (LenChoice2 + 1)
+#define LenMid (LenLow + (kNumPosStatesMax << kLenNumLowBits))
+#define LenHigh (LenMid + (kNumPosStatesMax << kLenNumMidBits))
+#define kNumLenProbs (LenHigh + kLenNumHighSymbols)
+
+#define kNumStates 12
+#define kNumLitStates 7
+
+#define kStartPosModelIndex 4
+#define kEndPosModelIndex 14
+#define kNumFullDistances (1 << (kEndPosModelIndex >> 1))
+
+#define kNumPosSlotBits 6
+#define kNumLenToPosStates 4
+
+#define kNumAlignBits 4
+#define kAlignTableSize (1 << kNumAlignBits)
+
+#define kMatchMinLen 2
+#define kMatchMaxLen (kMatchMinLen + kLenNumLowSymbols + kLenNumMidSymbols + kLenNumHighSymbols - 1)
+
+#define IsMatch 0
+#define IsRep (IsMatch + (kNumStates << kNumPosBitsMax))
+#define IsRepG0 (IsRep + kNumStates)
+#define IsRepG1 (IsRepG0 + kNumStates)
+#define IsRepG2 (IsRepG1 + kNumStates)
+#define IsRep0Long (IsRepG2 + kNumStates)
+#define PosSlot (IsRep0Long + (kNumStates << kNumPosBitsMax))
+#define SpecPos (PosSlot + (kNumLenToPosStates << kNumPosSlotBits))
+#define Align (SpecPos + kNumFullDistances - kEndPosModelIndex)
+#define LenCoder (Align + kAlignTableSize)
+#define RepLenCoder (LenCoder + kNumLenProbs)
+#define Literal (RepLenCoder + kNumLenProbs)
+
+#if Literal != LZMA_BASE_SIZE
+StopCompilingDueBUG
+#endif
+
+/* IPC traffic is text-like: default lc/lp/pb of the SDK */
+#define kLc 3
+#define kLp 0
+#define kPb 2
+
+#define kHashBits 16
+#define kMaxChainLength 48
+
+typedef struct _CRangeEncoder
+{
+    unsigned long long Low;
+    UInt32 Range;
+    Byte Cache;
+    SizeT CacheSize;
+    unsigned char *Buffer;
+    unsigned char *BufferLim;
+    int Overflow;
+} CRangeEncoder;
+
+static void RangeEncoderShiftLow(CRangeEncoder *rc)
+{
+    if ((UInt32)rc->Low < (UInt32)0xFF000000 || (rc->Low >> 32) != 0)
+    {
+        Byte temp = rc->Cache;
+        do
+        {
+            if (rc->Buffer == rc->BufferLim)
+                rc->Overflow = 1;
+            else
+                *rc->Buffer++ = (Byte)(temp + (Byte)(rc->Low >> 32));
+            temp = 0xFF;
+        }
+        while (--rc->CacheSize != 0);
+        rc->Cache = (Byte)((UInt32)rc->Low >> 24);
+    }
+    rc->CacheSize++;
+    rc->Low = (UInt32)rc->Low << 8;
+}
+
+static void RangeEncoderBit(CRangeEncoder *rc, CProb *prob, UInt32 bit)
+{
+    UInt32 bound = (rc->Range >> kNumBitModelTotalBits) * *prob;
+    if (bit == 0)
+    {
+        rc->Range = bound;
+        *prob = (CProb)(*prob + ((kBitModelTotal - *prob) >> kNumMoveBits));
+    }
+    else
+    {
+        rc->Low += bound;
+        rc->Range -= bound;
+        *prob = (CProb)(*prob - (*prob >> kNumMoveBits));
+    }
+    while (rc->Range < kTopValue)
+    {
+        rc->Range <<= 8;
+        RangeEncoderShiftLow(rc);
+    }
+}
+
+static void RangeEncoderDirectBits(CRangeEncoder *rc, UInt32 value, int numBits)
+{
+    do
+    {
+        rc->Range >>= 1;
+        numBits--;
+        rc->Low += rc->Range & (0 - ((value >> numBits) & 1));
+        while (rc->Range < kTopValue)
+        {
+            rc->Range <<= 8;
+            RangeEncoderShiftLow(rc);
+        }
+    }
+    while (numBits != 0);
+}
+
+static void BitTreeEncode(CRangeEncoder *rc, CProb *probs, int numLevels, UInt32 symbol)
+{
+    UInt32 m = 1;
+    while (numLevels-- != 0)
+    {
+        UInt32 bit = (symbol >> numLevels) & 1;
+        RangeEncoderBit(rc, probs + m, bit);
+        m = (m << 1) | bit;
+    }
+}
+
+static void ReverseBitTreeEncode(CRangeEncoder *rc, CProb *probs, int numLevels, UInt32 symbol)
+{
+    UInt32 m = 1;
+    while (numLevels-- != 0)
+    {
+        UInt32 bit = symbol & 1;
+        RangeEncoderBit(rc, probs + m, bit);
+        m = (m << 1) | bit;
+        symbol >>= 1;
+    }
+}
+
+/* len is relative to kMatchMinLen */
+static void LenEncode(CRangeEncoder *rc, CProb *probs, UInt32 len, UInt32 posState)
+{
+    if (len < kLenNumLowSymbols)
+    {
+        RangeEncoderBit(rc, probs + LenChoice, 0);
+        BitTreeEncode(rc, probs + LenLow + (posState << kLenNumLowBits), kLenNumLowBits, len);
+        return;
+    }
+
+    RangeEncoderBit(rc, probs + LenChoice, 1);
+    len -= kLenNumLowSymbols;
+    if (len < kLenNumMidSymbols)
+    {
+        RangeEncoderBit(rc, probs + LenChoice2, 0);
+        BitTreeEncode(rc, probs + LenMid + (posState << kLenNumMidBits), kLenNumMidBits, len);
+    }
+    else
+    {
+        RangeEncoderBit(rc, probs + LenChoice2, 1);
+        BitTreeEncode(rc, probs + LenHigh, kLenNumHighBits, len - kLenNumMidSymbols);
+    }
+}
+
+/* dist is the distance minus one, as it is stored in the stream */
+static void DistEncode(CRangeEncoder *rc, CProb *p, UInt32 dist, UInt32 len)
+{
+    UInt32 posSlot;
+    UInt32 lenState = len < kNumLenToPosStates ? len : kNumLenToPosStates - 1;
+
+    if (dist < kStartPosModelIndex)
+        posSlot = dist;
+    else
+    {
+        int i = 31;
+        while ((dist >> i) == 0)
+            i--;
+        posSlot = ((UInt32)i << 1) | ((dist >> (i - 1)) & 1);
+    }
+
+    BitTreeEncode(rc, p + PosSlot + (lenState << kNumPosSlotBits), kNumPosSlotBits, posSlot);
+
+    if (posSlot >= kStartPosModelIndex)
+    {
+        int footerBits = (int)(posSlot >> 1) - 1;
+        UInt32 base = (2 | (posSlot & 1)) << footerBits;
+        UInt32 reduced = dist - base;
+
+        if (posSlot < kEndPosModelIndex)
+            ReverseBitTreeEncode(rc, p + SpecPos + base - posSlot - 1, footerBits, reduced);
+        else
+        {
+            RangeEncoderDirectBits(rc, reduced >> kNumAlignBits, footerBits - kNumAlignBits);
+            ReverseBitTreeEncode(rc, p + Align, kNumAlignBits, reduced & (kAlignTableSize - 1));
+        }
+    }
+}
+
+static void LiteralEncode(CRangeEncoder *rc, CProb *p, const Byte *data, UInt32 pos, int state, UInt32 rep0)
+{
+    Byte previousByte = pos > 0 ? data[pos - 1] : 0;
+    UInt32 symbol = 1;
+    int i;
+    CProb *probs = p + Literal + LZMA_LIT_SIZE *
+        (((pos & ((1 << kLp) - 1)) << kLc) + (previousByte >> (8 - kLc)));
+
+    if (state >= kNumLitStates)
+    {
+        /* matched literal, the byte at rep0 is used as context until the first mismatch */
+        UInt32 matchByte = data[pos - rep0];
+        for (i = 7; i >= 0; i--)
+        {
+            UInt32 bit = (data[pos] >> i) & 1;
+            UInt32 matchBit = (matchByte >> i) & 1;
+            RangeEncoderBit(rc, probs + 0x100 + (matchBit << 8) + symbol, bit);
+            symbol = (symbol << 1) | bit;
+            if (matchBit != bit)
+                break;
+        }
+        i--;
+    }
+    else
+        i = 7;
+
+    for (; i >= 0; i--)
+    {
+        UInt32 bit = (data[pos] >> i) & 1;
+        RangeEncoderBit(rc, probs + symbol, bit);
+        symbol = (symbol << 1) | bit;
+    }
+}
+
+static UInt32 HashOf(const Byte *p)
+{
+    return (((UInt32)p[0] | ((UInt32)p[1] << 8) | ((UInt32)p[2] << 16)) * 2654435761U) >> (32 - kHashBits);
+}
+
+void LzmaEncodeProperties(unsigned char *props, UInt32 dictionarySize)
+{
+    int i;
+    props[0] = (Byte)((kPb * 5 + kLp) * 9 + kLc);
+    for (i = 0; i < 4; i++)
+        props[1 + i] = (Byte)(dictionarySize >> (8 * i));
+}
+
+SizeT LzmaEncodeBuffer(const unsigned char *in, SizeT inSize,
+                       unsigned char *out, SizeT outSize)
+{
+    CRangeEncoder rc;
+    CProb *p;
+    int *head;
+    int *chain;
+    UInt32 numProbs = LZMA_BASE_SIZE + (LZMA_LIT_SIZE << (kLc + kLp));
+    UInt32 rep0 = 1; /* only rep0 is used, older reps don't need tracking */
+    UInt32 pos = 0;
+    UInt32 i;
+    int state = 0;
+
+    p = (CProb *)malloc(numProbs * sizeof(CProb));
+    head = (int *)malloc((1 << kHashBits) * sizeof(int));
+    chain = (int *)malloc((inSize > 0 ? inSize : 1) * sizeof(int));
+    if (p == NULL || head == NULL || chain == NULL)
+    {
+        free(p);
+        free(head);
+        free(chain);
+        return 0;
+    }
+
+    for (i = 0; i < numProbs; i++)
+        p[i] = kBitModelTotal >> 1;
+    for (i = 0; i < (1 << kHashBits); i++)
+        head[i] = -1;
+
+    rc.Low = 0;
+    rc.Range = 0xFFFFFFFF;
+    rc.Cache = 0;
+    rc.CacheSize = 1;
+    rc.Buffer = out;
+    rc.BufferLim = out + outSize;
+    rc.Overflow = 0;
+
+    while (pos < inSize && !rc.Overflow)
+    {
+        UInt32 posState = pos & ((1 << kPb) - 1);
+        UInt32 avail = (UInt32)inSize - pos;
+        UInt32 maxLen = avail < kMatchMaxLen ? avail : kMatchMaxLen;
+        UInt32 len = 0, dist = 0, repLen = 0, advance;
+
+        /* longest match in the hash chain, this also links pos into it */
+        if (avail >= 3)
+        {
+            UInt32 h = HashOf(in + pos);
+            int cur = head[h];
+            int depth = kMaxChainLength;
+
+            while (cur >= 0 && depth-- > 0)
+            {
+                if (in[cur + len] == in[pos + len])
+                {
+                    UInt32 l = 0;
+                    while (l < maxLen && in[cur + l] == in[pos + l])
+                        l++;
+                    if (l > len)
+                    {
+                        len = l;
+                        dist = pos - (UInt32)cur;
+                        if (l == maxLen)
+                            break;
+                    }
+                }
+                cur = chain[cur];
+            }
+
+            chain[pos] = head[h];
+            head[h] = (int)pos;
+        }
+
+        if (pos >= rep0)
+            while (repLen < maxLen && in[pos + repLen] == in[pos - rep0 + repLen])
+                repLen++;
+
+        if (repLen >= kMatchMinLen && repLen + 1 >= len)
+        {
+            RangeEncoderBit(&rc, p + IsMatch + (state << kNumPosBitsMax) + posState, 1);
+            RangeEncoderBit(&rc, p + IsRep + state, 1);
+            RangeEncoderBit(&rc, p + IsRepG0 + state, 0);
+            RangeEncoderBit(&rc, p + IsRep0Long + (state << kNumPosBitsMax) + posState, 1);
+            LenEncode(&rc, p + RepLenCoder, repLen - kMatchMinLen, posState);
+            state = state < kNumLitStates ? 8 : 11;
+            advance = repLen;
+        }
+        else if (len >= 3)
+        {
+            RangeEncoderBit(&rc, p + IsMatch + (state << kNumPosBitsMax) + posState, 1);
+            RangeEncoderBit(&rc, p + IsRep + state, 0);
+            LenEncode(&rc, p + LenCoder, len - kMatchMinLen, posState);
+            DistEncode(&rc, p, dist - 1, len - kMatchMinLen);
+            rep0 = dist;
+            state = state < kNumLitStates ? 7 : 10;
+            advance = len;
+        }
+        else if (repLen == 1)
+        {
+            /* short rep: a single byte at rep0 */
+            RangeEncoderBit(&rc, p + IsMatch + (state << kNumPosBitsMax) + posState, 1);
+            RangeEncoderBit(&rc, p + IsRep + state, 1);
+            RangeEncoderBit(&rc, p + IsRepG0 + state, 0);
+            RangeEncoderBit(&rc, p + IsRep0Long + (state << kNumPosBitsMax) + posState, 0);
+            state = state < kNumLitStates ? 9 : 11;
+            advance = 1;
+        }
+        else
+        {
+            RangeEncoderBit(&rc, p + IsMatch + (state << kNumPosBitsMax) + posState, 0);
+            LiteralEncode(&rc, p, in, pos, state, rep0);
+            if (state < 4) state = 0;
+            else if (state < 10) state -= 3;
+            else state -= 6;
+            advance = 1;
+        }
+
+        /* link the skipped positions for later matches */
+        for (pos++, advance--; advance > 0; pos++, advance--)
+            if (inSize - pos >= 3)
+            {
+                UInt32 h = HashOf(in + pos);
+                chain[pos] = head[h];
+                head[h] = (int)pos;
+            }
+    }
+
+    for (i = 0; i < 5; i++)
+        RangeEncoderShiftLow(&rc);
+
+    free(p);
+    free(head);
+    free(chain);
+
+    return rc.Overflow ? 0 : (SizeT)(rc.Buffer - out);
+}
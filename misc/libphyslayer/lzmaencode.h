@@ -0,0 +1,46 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef HEDGEWARS_LZMAENCODE_H
+#define HEDGEWARS_LZMAENCODE_H
+
+#include "LzmaDecode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The vendored LZMA SDK only comes with a C decoder. This is a small greedy
+ * encoder for the same model, it produces a raw stream without end marker
+ * which LzmaDecode() reads back when it is given the unpacked size.
+ * Matches are searched in the whole input, there is no sliding window.
+ *
+ * Returns the packed size, or 0 if out is too small.
+ */
+SizeT LzmaEncodeBuffer(const unsigned char *in, SizeT inSize,
+                       unsigned char *out, SizeT outSize);
+
+/* Writes the LZMA_PROPERTIES_SIZE bytes describing streams of LzmaEncodeBuffer() */
+void LzmaEncodeProperties(unsigned char *props, UInt32 dictionarySize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
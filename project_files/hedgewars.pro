@@ -69,10 +69,22 @@ HEADERS += ../QTfrontend/model/ThemeModel.h \
     ../QTfrontend/ui/widget/HistoryLineEdit.h \
     ../QTfrontend/ui/widget/SmartLineEdit.h \
     ../QTfrontend/util/DataManager.h \
+    ../QTfrontend/util/DemoContainer.h \
+    ../QTfrontend/util/MetadataIndex.h \
+    ../QTfrontend/util/DemoIndex.h \
+    ../QTfrontend/util/VideoIndex.h \
+    ../QTfrontend/util/IPCFrameBuffer.h \
+    ../QTfrontend/util/NetMessageBuffer.h \
+    ../QTfrontend/util/KeywordMatcher.h \
+    ../QTfrontend/util/IPCStats.h \
+    ../QTfrontend/util/PreviewCache.h \
     ../QTfrontend/net/netregister.h \
     ../QTfrontend/net/netserver.h \
     ../QTfrontend/net/netudpwidget.h \
     ../QTfrontend/net/tcpBase.h \
+    ../QTfrontend/net/enginejobpool.h \
+    ../QTfrontend/net/recorderscheduler.h \
+    ../QTfrontend/net/previewengine.h \
     ../QTfrontend/net/proto.h \
     ../QTfrontend/net/newnetclient.h \
     ../QTfrontend/net/netudpserver.h \
@@ -171,7 +183,19 @@ SOURCES += ../QTfrontend/model/gameSchemeModel.cpp \
     ../QTfrontend/ui/widget/HistoryLineEdit.cpp \
     ../QTfrontend/ui/widget/SmartLineEdit.cpp \
     ../QTfrontend/util/DataManager.cpp \
+    ../QTfrontend/util/DemoContainer.cpp \
+    ../QTfrontend/util/MetadataIndex.cpp \
+    ../QTfrontend/util/DemoIndex.cpp \
+    ../QTfrontend/util/VideoIndex.cpp \
+    ../QTfrontend/util/IPCFrameBuffer.cpp \
+    ../QTfrontend/util/NetMessageBuffer.cpp \
+    ../QTfrontend/util/KeywordMatcher.cpp \
+    ../QTfrontend/util/IPCStats.cpp \
+    ../QTfrontend/util/PreviewCache.cpp \
     ../QTfrontend/net/tcpBase.cpp \
+    ../QTfrontend/net/enginejobpool.cpp \
+    ../QTfrontend/net/recorderscheduler.cpp \
+    ../QTfrontend/net/previewengine.cpp \
     ../QTfrontend/net/netregister.cpp \
     ../QTfrontend/net/proto.cpp \
     ../QTfrontend/net/hwmap.cpp \
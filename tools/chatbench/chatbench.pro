@@ -0,0 +1,15 @@
+#-------------------------------------------------
+#
+# Replays a chat log into a text browser, full re-render vs appending
+#
+#-------------------------------------------------
+
+QT       += core gui widgets
+
+TARGET = chatbench
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+RESOURCES += chatbench.qrc
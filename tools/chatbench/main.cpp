@@ -0,0 +1,212 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Replays chat lines into a QTextBrowser styled with the frontend's chat.css
+// as fast as possible, the way HWChatWidget showed them before (the whole
+// history passed to setHtml for every line) and the way it does now (lines
+// appended at the end of the document, which drops its first blocks beyond
+// the scrollback, several lines per event loop iteration). Each iteration
+// processes events, so layout and painting are part of the measurement.
+// Checks that both ways end up with the same text.
+//
+// The log has one "nick: message" per line, without one a synthetic lobby
+// chat is used. Run with QT_QPA_PLATFORM=offscreen where there's no display.
+//
+// usage: chatbench [log [lines [scrollback [lines per iteration]]]]
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QScrollBar>
+#include <QStringList>
+#include <QTextBlockFormat>
+#include <QTextBrowser>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextStream>
+
+static QString styleSheet()
+{
+    QFile file(":/chat.css");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QString();
+
+    return QString::fromUtf8(file.readAll());
+}
+
+// markup like HWChatWidget::addLine and linkedNick produce
+static QString chatLine(const QString & line, int i)
+{
+    QString nick = line.section(": ", 0, 0);
+    QString message = line.section(": ", 1);
+    if (message.isEmpty())
+    {
+        message = nick;
+        nick = "someone";
+    }
+
+    return QString("<span class=\"msg_UserChat\"><span class=\"timestamp\">[%1]</span> "
+                   "<a href=\"hwnick://?%2\" class=\"nick\">%3</a>: %4</span>")
+        .arg(QString("%1:%2").arg(i / 60 % 60, 2, 10, QChar('0')).arg(i % 60, 2, 10, QChar('0')))
+        .arg(QString(nick.toUtf8().toBase64()))
+        .arg(nick.toHtmlEscaped())
+        .arg(message.toHtmlEscaped());
+}
+
+static QStringList syntheticLog(int lines)
+{
+    QStringList log;
+    for (int i = 0; i < lines; ++i)
+        log << QString("player%1: message %2, anyone up for a game of %3?")
+            .arg(i % 97).arg(i).arg(i % 3 ? "shoppa" : "the classic fort mode");
+    return log;
+}
+
+static QString normalized(const QString & text)
+{
+    QString result = text;
+    result.replace(QChar::LineSeparator, '\n');
+    result.replace(QChar::ParagraphSeparator, '\n');
+    return result.trimmed();
+}
+
+static void settle(QTextBrowser & browser)
+{
+    QApplication::processEvents();
+    browser.verticalScrollBar()->setValue(browser.verticalScrollBar()->maximum());
+}
+
+static qint64 replayFull(QTextBrowser & browser, const QStringList & log, int scrollback)
+{
+    QStringList chatStrings;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < log.size(); ++i)
+    {
+        if (chatStrings.size() >= scrollback)
+            chatStrings.removeFirst();
+
+        chatStrings.append(chatLine(log[i], i));
+        browser.setHtml("<html><body>" + chatStrings.join("<br>") + "</body></html>");
+        settle(browser);
+    }
+
+    return timer.elapsed();
+}
+
+static qint64 replayAppend(QTextBrowser & browser, const QStringList & log, int scrollback, int batch)
+{
+    QTextDocument * doc = browser.document();
+    QElapsedTimer timer;
+
+    browser.clear();
+    browser.setUndoRedoEnabled(false);
+    doc->setMaximumBlockCount(scrollback);
+
+    timer.start();
+    for (int i = 0; i < log.size(); i += batch)
+    {
+        QTextCursor cursor(doc);
+        cursor.movePosition(QTextCursor::End);
+        cursor.beginEditBlock();
+
+        for (int j = i; j < qMin(i + batch, log.size()); ++j)
+        {
+            if (!doc->isEmpty())
+                cursor.insertBlock(QTextBlockFormat(), QTextCharFormat());
+            cursor.insertHtml(chatLine(log[j], j));
+        }
+
+        cursor.endEditBlock();
+        settle(browser);
+    }
+
+    return timer.elapsed();
+}
+
+static void report(QTextStream & out, const QString & name, qint64 ms, int lines)
+{
+    out << QString("%1  %2 ms, %3 us/line")
+        .arg(name, -14)
+        .arg(ms)
+        .arg(ms * 1000.0 / qMax(lines, 1), 0, 'f', 1)
+        << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+    QStringList args = app.arguments().mid(1);
+
+    int lines = args.size() > 1 ? args[1].toInt() : 3000;
+    int scrollback = args.size() > 2 ? args[2].toInt() : 250;
+    int batch = args.size() > 3 ? args[3].toInt() : 16;
+
+    if ((lines <= 0) || (scrollback <= 0) || (batch <= 0))
+    {
+        out << "usage: chatbench [log [lines [scrollback [lines per iteration]]]]" << endl;
+        return 1;
+    }
+
+    QStringList log;
+    if (args.isEmpty() || args[0].isEmpty())
+        log = syntheticLog(lines);
+    else
+    {
+        QFile file(args[0]);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            out << "Can't read " << args[0] << endl;
+            return 1;
+        }
+
+        QStringList all = QString::fromUtf8(file.readAll()).split('\n', QString::SkipEmptyParts);
+        // repeat short logs up to the requested number of lines
+        while (!all.isEmpty() && (log.size() < lines))
+            log << all.mid(0, lines - log.size());
+    }
+
+    QTextBrowser browser;
+    browser.document()->setDefaultStyleSheet(styleSheet());
+    browser.resize(640, 400);
+    browser.show();
+
+    out << QString("%1 lines, scrollback %2").arg(log.size()).arg(scrollback) << endl;
+
+    qint64 ms = replayFull(browser, log, scrollback);
+    QString fullText = normalized(browser.toPlainText());
+    report(out, "setHtml", ms, log.size());
+
+    ms = replayAppend(browser, log, scrollback, 1);
+    QString appendText = normalized(browser.toPlainText());
+    report(out, "append", ms, log.size());
+
+    ms = replayAppend(browser, log, scrollback, batch);
+    QString batchText = normalized(browser.toPlainText());
+    report(out, QString("append x%1").arg(batch), ms, log.size());
+
+    if ((fullText != appendText) || (appendText != batchText))
+    {
+        out << "MISMATCH: the documents differ" << endl;
+        return 1;
+    }
+
+    return 0;
+}
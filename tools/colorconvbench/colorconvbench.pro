@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Checks and times the RGBA to YUV 4:2:0 kernels of the av-wrapper
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = colorconvbench
+CONFIG   += console
+CONFIG   -= app_bundle qt
+TEMPLATE = app
+
+INCLUDEPATH += ../../hedgewars/avwrapper
+
+SOURCES += main.c \
+    ../../hedgewars/avwrapper/colorconv.c
+
+HEADERS += ../../hedgewars/avwrapper/colorconv.h
@@ -0,0 +1,277 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Compares the color conversion kernels of the av-wrapper with each other
+// and with the float conversion AVWrapper_WriteFrame did before, on a few
+// image sizes and patterns, then times them on frames of the given size.
+// All kernels have to give the same output, and that output must not
+// differ from the float version by more than one.
+//
+// usage: colorconvbench [width height [frames]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "colorconv.h"
+
+typedef struct
+{
+    int Width, Height;
+    int Stride[3];
+    uint8_t* pData[3];
+} Picture;
+
+static void AllocPicture(Picture* pPic, int Width, int Height)
+{
+    int i;
+    // padded strides like libav uses
+    pPic->Width = Width;
+    pPic->Height = Height;
+    pPic->Stride[0] = (Width + 31) & ~31;
+    pPic->Stride[1] = pPic->Stride[2] = ((Width + 1) / 2 + 31) & ~31;
+    for (i = 0; i < 3; i++)
+    {
+        int Rows = i == 0 ? Height : (Height + 1) / 2;
+        pPic->pData[i] = malloc(pPic->Stride[i] * Rows);
+        memset(pPic->pData[i], 0, pPic->Stride[i] * Rows);
+    }
+}
+
+static void FreePicture(Picture* pPic)
+{
+    int i;
+    for (i = 0; i < 3; i++)
+        free(pPic->pData[i]);
+}
+
+static uint8_t Clip(int Value)
+{
+    return Value < 0 ? 0 : Value > 255 ? 255 : Value;
+}
+
+// the conversion of AVWrapper_WriteFrame before the kernels, needs even sizes
+static void ConvertFloat(const uint8_t* buf, Picture* pPic)
+{
+    int x, y, stride = pPic->Width * 4;
+    uint8_t *data[3];
+
+    memcpy(data, pPic->pData, sizeof(data));
+    buf += (pPic->Height - 1) * stride;
+
+    for (y = 0; y < pPic->Height; y++) {
+        for (x = 0; x < pPic->Width; x++) {
+            int r = buf[x * 4 + 0];
+            int g = buf[x * 4 + 1];
+            int b = buf[x * 4 + 2];
+
+            int luma = (int)(0.299f * r +  0.587f * g + 0.114f * b);
+            data[0][x] = Clip(luma);
+
+            if (!(x & 1) && !(y & 1)) {
+                int r = (buf[x * 4 + 0]          + buf[(x + 1) * 4 + 0] +
+                         buf[x * 4 + 0 - stride] + buf[(x + 1) * 4 + 0 - stride]) / 4;
+                int g = (buf[x * 4 + 1]          + buf[(x + 1) * 4 + 1] +
+                         buf[x * 4 + 1 - stride] + buf[(x + 1) * 4 + 1 - stride]) / 4;
+                int b = (buf[x * 4 + 2]          + buf[(x + 1) * 4 + 2] +
+                         buf[x * 4 + 2 - stride] + buf[(x + 1) * 4 + 2 - stride]) / 4;
+
+                int cr = (int)(-0.14713f * r - 0.28886f * g + 0.436f   * b);
+                int cb = (int)( 0.615f   * r - 0.51499f * g - 0.10001f * b);
+                data[1][x / 2] = Clip(128 + cr);
+                data[2][x / 2] = Clip(128 + cb);
+            }
+        }
+        buf += -stride;
+        data[0] += pPic->Stride[0];
+        if (y & 1) {
+            data[1] += pPic->Stride[1];
+            data[2] += pPic->Stride[2];
+        }
+    }
+}
+
+static void Convert(int Kernel, const uint8_t* buf, Picture* pPic)
+{
+    int Stride = pPic->Width * 4;
+    ColorConv_RGBAToYUV420(Kernel, buf + (pPic->Height - 1) * Stride, -Stride,
+                           pPic->Width, pPic->Height, pPic->pData, pPic->Stride);
+}
+
+// largest difference between two pictures
+static int Compare(const Picture* a, const Picture* b, long* pDiffering)
+{
+    int i, x, y, Max = 0;
+    *pDiffering = 0;
+    for (i = 0; i < 3; i++)
+    {
+        int Width = i == 0 ? a->Width : (a->Width + 1) / 2;
+        int Height = i == 0 ? a->Height : (a->Height + 1) / 2;
+        for (y = 0; y < Height; y++)
+            for (x = 0; x < Width; x++)
+            {
+                int Diff = abs(a->pData[i][y * a->Stride[i] + x] - b->pData[i][y * b->Stride[i] + x]);
+                if (Diff)
+                    ++*pDiffering;
+                if (Diff > Max)
+                    Max = Diff;
+            }
+    }
+    return Max;
+}
+
+static uint8_t* MakeImage(int Width, int Height, int Pattern)
+{
+    uint8_t* pImage = malloc(Width * Height * 4);
+    int i;
+
+    for (i = 0; i < Width * Height; i++)
+    {
+        uint8_t* p = pImage + i * 4;
+        int x = i % Width, y = i / Width;
+        switch (Pattern)
+        {
+            case 0: // noise
+                p[0] = rand(); p[1] = rand(); p[2] = rand(); p[3] = rand();
+                break;
+            case 1: // gradients
+                p[0] = x * 255 / Width; p[1] = y * 255 / Height; p[2] = (x + y) & 0xFF; p[3] = 255;
+                break;
+            default: // only 0 and 255, worst case for clipping
+                p[0] = rand() & 1 ? 255 : 0; p[1] = rand() & 1 ? 255 : 0; p[2] = rand() & 1 ? 255 : 0; p[3] = 255;
+        }
+    }
+
+    return pImage;
+}
+
+static int Check(int Width, int Height)
+{
+    int Pattern, Kernel, Failed = 0;
+
+    for (Pattern = 0; Pattern < 3; Pattern++)
+    {
+        uint8_t* pImage = MakeImage(Width, Height, Pattern);
+        Picture Scalar;
+        long Differing;
+
+        AllocPicture(&Scalar, Width, Height);
+        Convert(COLORCONV_SCALAR, pImage, &Scalar);
+
+        if (!(Width & 1) && !(Height & 1))
+        {
+            Picture Float;
+            int Max;
+
+            AllocPicture(&Float, Width, Height);
+            ConvertFloat(pImage, &Float);
+            Max = Compare(&Float, &Scalar, &Differing);
+            if (Max > 1)
+            {
+                printf("%dx%d pattern %d: scalar differs from float by %d\n", Width, Height, Pattern, Max);
+                Failed = 1;
+            }
+            else if (Differing)
+                printf("%dx%d pattern %d: %ld samples off by one from float\n", Width, Height, Pattern, Differing);
+            FreePicture(&Float);
+        }
+
+        for (Kernel = COLORCONV_SCALAR + 1; Kernel < COLORCONV_KERNELS; Kernel++)
+        {
+            Picture Simd;
+            if (!ColorConv_Supported(Kernel))
+                continue;
+
+            AllocPicture(&Simd, Width, Height);
+            Convert(Kernel, pImage, &Simd);
+            Compare(&Scalar, &Simd, &Differing);
+            if (Differing)
+            {
+                printf("%dx%d pattern %d: %s differs from scalar in %ld samples\n",
+                       Width, Height, Pattern, ColorConv_Name(Kernel), Differing);
+                Failed = 1;
+            }
+            FreePicture(&Simd);
+        }
+
+        FreePicture(&Scalar);
+        free(pImage);
+    }
+
+    return Failed;
+}
+
+static double Time(int Kernel, const uint8_t* pImage, Picture* pPic, int Frames)
+{
+    clock_t Start = clock();
+    int i;
+    for (i = 0; i < Frames; i++)
+    {
+        if (Kernel < 0)
+            ConvertFloat(pImage, pPic);
+        else
+            Convert(Kernel, pImage, pPic);
+    }
+    return (double)(clock() - Start) * 1000 / CLOCKS_PER_SEC / Frames;
+}
+
+int main(int argc, char* argv[])
+{
+    static const int Sizes[][2] = { {16, 2}, {48, 10}, {62, 8}, {31, 7}, {1, 1}, {17, 16}, {800, 600}, {1280, 720} };
+    int Width = argc > 2 ? atoi(argv[1]) : 1920;
+    int Height = argc > 2 ? atoi(argv[2]) : 1080;
+    int Frames = argc > 3 ? atoi(argv[3]) : 100;
+    int i, Kernel, Failed = 0;
+
+    if (Width <= 0 || Height <= 0 || Frames <= 0)
+    {
+        printf("usage: colorconvbench [width height [frames]]\n");
+        return 1;
+    }
+
+    srand(1);
+    for (i = 0; i < (int)(sizeof(Sizes) / sizeof(Sizes[0])); i++)
+        Failed |= Check(Sizes[i][0], Sizes[i][1]);
+    Failed |= Check(Width, Height);
+
+    if (Failed)
+    {
+        printf("MISMATCH: kernels disagree\n");
+        return 1;
+    }
+
+    {
+        uint8_t* pImage = MakeImage(Width, Height, 1);
+        Picture Pic;
+
+        AllocPicture(&Pic, Width, Height);
+        printf("%dx%d, %d frames, best kernel %s\n", Width, Height, Frames, ColorConv_Name(ColorConv_Best()));
+        if (!(Width & 1) && !(Height & 1))
+            printf("%-6s  %.3f ms/frame\n", "float", Time(-1, pImage, &Pic, Frames));
+        for (Kernel = 0; Kernel < COLORCONV_KERNELS; Kernel++)
+            if (ColorConv_Supported(Kernel))
+                printf("%-6s  %.3f ms/frame\n", ColorConv_Name(Kernel), Time(Kernel, pImage, &Pic, Frames));
+
+        FreePicture(&Pic);
+        free(pImage);
+    }
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Replays a directory of demos headless in parallel engines
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+TARGET = demoreplay
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../QTfrontend/util \
+    ../../misc/libphyslayer \
+    ../../misc/libphysfs \
+    ../../misc/libphysfs/lzma/C/Compress/Lzma
+
+SOURCES += main.cpp \
+    ../../QTfrontend/util/IPCFrameBuffer.cpp \
+    ../../QTfrontend/util/DemoContainer.cpp \
+    ../../misc/libphyslayer/hwdemo.c \
+    ../../misc/libphyslayer/lzmaencode.c \
+    ../../misc/libphysfs/lzma/C/Compress/Lzma/LzmaDecode.c
+
+HEADERS += ../../QTfrontend/util/IPCFrameBuffer.h \
+    ../../QTfrontend/util/DemoContainer.h
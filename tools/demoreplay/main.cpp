@@ -0,0 +1,560 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Replays every demo of a directory headless to catch desyncs and engine
+// errors after engine changes, and to measure replay throughput.
+//
+// Each demo gets its own engine process, started the way HWGame starts it
+// (--internal and an IPC port) plus --stats-only, which replays at maximum
+// speed without video and sound. Up to -j engines run at once. The engine
+// reports the game tick and a hash of the final state when the replay ends,
+// hashes can be saved and checked against a later run.
+//
+// With --seek every demo is also replayed with checkpoints. Once the engine
+// reports its second checkpoint it is sent back to the first one, and the
+// final state has to match the one of the straight replay.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <QProcess>
+#include <QQueue>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include "DemoContainer.h"
+#include "IPCFrameBuffer.h"
+
+struct Options
+{
+    QString engine;
+    QString prefix;
+    QString userPrefix;
+    QString writeHashes;
+    QString checkHashes;
+    QStringList patterns;
+    int jobs;
+    int timeout;
+    int seekInterval; // seconds between checkpoints, 0 - no seek runs
+};
+
+struct ReplayResult
+{
+    QString name;
+    qint64 wallMs;
+    quint32 ticks;
+    quint32 hash;
+    bool hasHash;
+    bool seeking;
+    bool seeked;
+    quint32 seekFrom;
+    quint32 seekTo;
+    bool timedOut;
+    int exitCode;
+    QStringList errors;
+};
+
+class ReplayJob : public QObject
+{
+        Q_OBJECT
+
+    public:
+        ReplayJob(const QString & fileName, const Options & options, bool seeking, QObject * parent = 0) :
+            QObject(parent),
+            m_fileName(fileName),
+            m_options(options),
+            m_socket(0),
+            m_checkpoints(0),
+            m_done(false)
+        {
+            m_result.name = QFileInfo(fileName).fileName();
+            m_result.wallMs = 0;
+            m_result.ticks = 0;
+            m_result.hash = 0;
+            m_result.hasHash = false;
+            m_result.seeking = seeking;
+            m_result.seeked = false;
+            m_result.seekFrom = 0;
+            m_result.seekTo = 0;
+            m_result.timedOut = false;
+            m_result.exitCode = -1;
+        }
+
+        const ReplayResult & result() const { return m_result; }
+
+    signals:
+        void finished(ReplayJob * job);
+
+    public slots:
+        void start()
+        {
+            QFile file(m_fileName);
+            if(file.open(QIODevice::ReadOnly))
+                m_demo = DemoContainer::unpack(file.readAll());
+
+            if(m_demo.isEmpty())
+            {
+                fail("can't read demo");
+                return;
+            }
+
+            if(!m_server.listen(QHostAddress::LocalHost))
+            {
+                fail("can't listen for the engine: " + m_server.errorString());
+                return;
+            }
+
+            connect(&m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+            connect(&m_process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(onEngineFinished(int)));
+            connect(&m_process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onEngineError(QProcess::ProcessError)));
+            connect(&m_timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+
+            QStringList arguments;
+            arguments << "--internal"; // must be the first argument
+            arguments << "--port" << QString::number(m_server.serverPort());
+            arguments << "--prefix" << m_options.prefix;
+            arguments << "--user-prefix" << m_options.userPrefix;
+            arguments << "--stats-only";
+            arguments << "--nosound";
+            arguments << "--nomusic";
+            if(m_result.seeking)
+                arguments << "--checkpoint-interval" << QString::number(m_options.seekInterval);
+
+            // the engine prints game results on stdout in stats only mode
+            m_process.setStandardOutputFile(QProcess::nullDevice());
+            m_process.setStandardErrorFile(QProcess::nullDevice());
+
+            m_timer.setSingleShot(true);
+            m_timer.start(m_options.timeout * 1000);
+            m_wallTime.start();
+            m_process.start(m_options.engine, arguments);
+        }
+
+    private slots:
+        void onNewConnection()
+        {
+            m_socket = m_server.nextPendingConnection();
+            m_server.close();
+
+            m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+
+            // the same as HWGame does for gtDemo: the whole record, no config
+            m_socket->write(m_demo);
+            m_demo.clear();
+        }
+
+        void onReadyRead()
+        {
+            m_frames.readFrom(m_socket);
+
+            QByteArray frame;
+            while(m_frames.next(frame))
+                parseMessage(frame);
+        }
+
+        void onEngineFinished(int exitCode)
+        {
+            // stats sent right before exiting may not have been read yet
+            if(m_socket)
+                onReadyRead();
+
+            m_result.exitCode = exitCode;
+            finish();
+        }
+
+        void onEngineError(QProcess::ProcessError error)
+        {
+            if(error == QProcess::FailedToStart)
+                fail("can't run engine " + m_options.engine);
+        }
+
+        void onTimeout()
+        {
+            m_result.timedOut = true;
+            m_process.kill();
+        }
+
+    private:
+        QString m_fileName;
+        Options m_options;
+        QByteArray m_demo;
+        QTcpServer m_server;
+        QTcpSocket * m_socket;
+        QProcess m_process;
+        QTimer m_timer;
+        QElapsedTimer m_wallTime;
+        IPCFrameBuffer m_frames;
+        ReplayResult m_result;
+        int m_checkpoints;
+        bool m_done;
+
+        void parseMessage(const QByteArray & msg)
+        {
+            switch(msg.at(1))
+            {
+                case '?':
+                {
+                    m_socket->write(QByteArray("\x01!", 2));
+                    break;
+                }
+                case 'E':
+                {
+                    // strip length byte, command and the timestamp
+                    m_result.errors << QString::fromUtf8(msg.mid(2, msg.size() - 4));
+                    break;
+                }
+                case 'K':
+                {
+                    if(!m_result.seeking || m_result.seeked)
+                        break;
+
+                    // strip length byte, command and the timestamp
+                    quint32 ticks = msg.mid(2, msg.size() - 4).toUInt();
+
+                    // the engine is past the second checkpoint, so seeking
+                    // to the first one restores it and plays the rest again
+                    if(++m_checkpoints == 1)
+                        m_result.seekTo = ticks;
+                    else
+                    {
+                        QByteArray cmd = QString("eseek %1").arg(m_result.seekTo).toLatin1();
+                        m_socket->write(QByteArray(1, (char)cmd.size()) + cmd);
+                        m_result.seekFrom = ticks;
+                        m_result.seeked = true;
+                    }
+                    break;
+                }
+                case 'i':
+                {
+                    if(msg.at(2) == 'h')
+                    {
+                        QStringList values = QString::fromLatin1(msg.mid(3)).split(' ');
+                        if(values.size() == 2)
+                        {
+                            m_result.hash = (quint32)values[0].toInt();
+                            m_result.ticks = values[1].toUInt();
+                            m_result.hasHash = true;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+
+        void fail(const QString & error)
+        {
+            m_result.errors << error;
+            finish();
+        }
+
+        void finish()
+        {
+            if(m_done)
+                return;
+
+            m_done = true;
+            m_timer.stop();
+            m_result.wallMs = m_wallTime.isValid() ? m_wallTime.elapsed() : 0;
+            emit finished(this);
+        }
+};
+
+class ReplayRunner : public QObject
+{
+        Q_OBJECT
+
+    public:
+        ReplayRunner(const QStringList & files, const Options & options) :
+            m_options(options),
+            m_running(0),
+            m_failed(0),
+            m_totalTicks(0),
+            m_out(stdout)
+        {
+            foreach(const QString & file, files)
+            {
+                m_queue.enqueue(qMakePair(file, false));
+                if(m_options.seekInterval > 0)
+                    m_queue.enqueue(qMakePair(file, true));
+            }
+
+            if(!m_options.checkHashes.isEmpty())
+                readHashes();
+        }
+
+    public slots:
+        void start()
+        {
+            m_wallTime.start();
+
+            if(m_queue.isEmpty())
+            {
+                m_out << "No demos found" << endl;
+                QCoreApplication::exit(1);
+                return;
+            }
+
+            while((m_running < m_options.jobs) && !m_queue.isEmpty())
+                startNext();
+        }
+
+    private slots:
+        void onJobFinished(ReplayJob * job)
+        {
+            --m_running;
+            const ReplayResult & r = job->result();
+
+            // a seek run is checked against the straight one of the same demo
+            if(!r.seeking)
+            {
+                report(r);
+                m_straight[r.name] = r;
+                if(m_seekRuns.contains(r.name))
+                    report(m_seekRuns.take(r.name));
+            }
+            else if(m_straight.contains(r.name))
+                report(r);
+            else
+                m_seekRuns[r.name] = r;
+
+            job->deleteLater();
+
+            if(!m_queue.isEmpty())
+                startNext();
+            else if(m_running == 0)
+                summary();
+        }
+
+    private:
+        QQueue<QPair<QString, bool> > m_queue;
+        Options m_options;
+        int m_running;
+        int m_failed;
+        quint64 m_totalTicks;
+        QElapsedTimer m_wallTime;
+        QHash<QString, quint32> m_expected;
+        QHash<QString, ReplayResult> m_straight;
+        QHash<QString, ReplayResult> m_seekRuns;
+        QStringList m_hashLines;
+        QTextStream m_out;
+
+        void startNext()
+        {
+            QPair<QString, bool> next = m_queue.dequeue();
+            ReplayJob * job = new ReplayJob(next.first, m_options, next.second, this);
+            connect(job, SIGNAL(finished(ReplayJob *)), this, SLOT(onJobFinished(ReplayJob *)));
+            ++m_running;
+            // queued, so that a job failing right away doesn't recurse into startNext()
+            QTimer::singleShot(0, job, SLOT(start()));
+        }
+
+        void readHashes()
+        {
+            QFile file(m_options.checkHashes);
+            if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            {
+                m_out << "Can't read hashes from " << m_options.checkHashes << endl;
+                return;
+            }
+
+            // one "hash name" line per demo, names may contain spaces
+            while(!file.atEnd())
+            {
+                QString line = QString::fromUtf8(file.readLine()).trimmed();
+                int space = line.indexOf(' ');
+                if(space > 0)
+                    m_expected[line.mid(space + 1)] = line.left(space).toUInt(0, 16);
+            }
+        }
+
+        void report(const ReplayResult & r)
+        {
+            QStringList problems = r.errors;
+
+            if(r.timedOut)
+                problems << QString("timed out after %1 s").arg(m_options.timeout);
+            else if(r.exitCode != 0 && r.errors.isEmpty())
+                problems << QString("engine exit code %1").arg(r.exitCode);
+
+            if(!r.hasHash && problems.isEmpty())
+                problems << "no final state reported";
+
+            QString hash = r.hasHash ? QString("%1").arg(r.hash, 8, 16, QChar('0')) : QString("--------");
+
+            if(r.seeking)
+            {
+                const ReplayResult & straight = m_straight[r.name];
+                if(r.hasHash && straight.hasHash && (straight.hash != r.hash))
+                    problems << QString("state hash differs after seeking, straight replay has %1").arg(straight.hash, 8, 16, QChar('0'));
+            }
+            else if(r.hasHash && m_expected.contains(r.name) && (m_expected[r.name] != r.hash))
+                problems << QString("state hash differs, expected %1").arg(m_expected[r.name], 8, 16, QChar('0'));
+
+            if(r.hasHash && !r.seeking)
+                m_hashLines << hash + ' ' + r.name;
+
+            m_totalTicks += r.ticks;
+            if(!problems.isEmpty())
+                ++m_failed;
+
+            double ticksPerSecond = r.wallMs > 0 ? r.ticks * 1000.0 / r.wallMs : 0;
+
+            m_out << QString("%1  %2  %3 ms  %4 ticks  %5 ticks/s  hash %6")
+                .arg(problems.isEmpty() ? "OK  " : "FAIL")
+                .arg(r.name)
+                .arg(r.wallMs)
+                .arg(r.ticks)
+                .arg(ticksPerSecond, 0, 'f', 0)
+                .arg(hash)
+                << endl;
+
+            // Lua games and short demos have fewer than two checkpoints
+            if(r.seeking)
+                m_out << (r.seeked
+                        ? QString("      seeked from %1 back to %2 ticks").arg(r.seekFrom).arg(r.seekTo)
+                        : QString("      not seeked, fewer than two checkpoints"))
+                    << endl;
+
+            foreach(const QString & problem, problems)
+                m_out << "      " << problem << endl;
+        }
+
+        void summary()
+        {
+            qint64 wallMs = m_wallTime.elapsed();
+
+            m_out << QString("%1 failed, %2 game ticks in %3 s wall time, %4 ticks/s overall")
+                .arg(m_failed)
+                .arg(m_totalTicks)
+                .arg(wallMs / 1000.0, 0, 'f', 1)
+                .arg(wallMs > 0 ? m_totalTicks * 1000.0 / wallMs : 0, 0, 'f', 0)
+                << endl;
+
+            if(!m_options.writeHashes.isEmpty())
+            {
+                QFile file(m_options.writeHashes);
+                if(file.open(QIODevice::WriteOnly | QIODevice::Text))
+                {
+                    m_hashLines.sort();
+                    file.write(m_hashLines.join("\n").toUtf8() + '\n');
+                }
+                else
+                    m_out << "Can't write hashes to " << m_options.writeHashes << endl;
+            }
+
+            QCoreApplication::exit(m_failed > 0 ? 1 : 0);
+        }
+};
+
+static void usage(QTextStream & out)
+{
+    out << "Usage: demoreplay [options] <demo directory>" << endl
+        << "  --prefix <dir>          game data directory (required)" << endl
+        << "  --user-prefix <dir>     user data directory, a temporary one by default" << endl
+        << "  --engine <path>         hwengine binary, next to demoreplay by default" << endl
+        << "  --pattern <glob>        demo file pattern, may be repeated, *.hwd by default" << endl
+        << "  -j <n>                  engines to run at once, one per core by default" << endl
+        << "  --timeout <s>           wall time limit per demo, 600 by default" << endl
+        << "  --seek <s>              replay each demo again with checkpoints every <s> s of" << endl
+        << "                          game time, seek back once and compare the final states" << endl
+        << "  --write-hashes <file>   save final state hashes" << endl
+        << "  --check-hashes <file>   compare final state hashes with a saved run" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    Options options;
+    options.engine = QCoreApplication::applicationDirPath() + "/hwengine";
+    options.jobs = QThread::idealThreadCount();
+    options.timeout = 600;
+    options.seekInterval = 0;
+
+    QString directory;
+    QStringList args = app.arguments().mid(1);
+
+    while(!args.isEmpty())
+    {
+        QString arg = args.takeFirst();
+        bool hasValue = !args.isEmpty();
+
+        if(arg == "--prefix" && hasValue)
+            options.prefix = args.takeFirst();
+        else if(arg == "--user-prefix" && hasValue)
+            options.userPrefix = args.takeFirst();
+        else if(arg == "--engine" && hasValue)
+            options.engine = args.takeFirst();
+        else if(arg == "--pattern" && hasValue)
+            options.patterns << args.takeFirst();
+        else if(arg == "-j" && hasValue)
+            options.jobs = args.takeFirst().toInt();
+        else if(arg == "--timeout" && hasValue)
+            options.timeout = args.takeFirst().toInt();
+        else if(arg == "--seek" && hasValue)
+            options.seekInterval = args.takeFirst().toInt();
+        else if(arg == "--write-hashes" && hasValue)
+            options.writeHashes = args.takeFirst();
+        else if(arg == "--check-hashes" && hasValue)
+            options.checkHashes = args.takeFirst();
+        else if(!arg.startsWith('-') && directory.isEmpty())
+            directory = arg;
+        else
+        {
+            usage(out);
+            return 1;
+        }
+    }
+
+    if(directory.isEmpty() || options.prefix.isEmpty() || (options.jobs < 1) || (options.timeout < 1) || (options.seekInterval < 0))
+    {
+        usage(out);
+        return 1;
+    }
+
+    // engines write their logs there, keep them out of the real config dir
+    QTemporaryDir userPrefix;
+    if(options.userPrefix.isEmpty())
+        options.userPrefix = userPrefix.path();
+
+    if(options.patterns.isEmpty())
+        options.patterns << "*.hwd";
+
+    QDir dir(directory);
+    QStringList files;
+    foreach(const QString & name, dir.entryList(options.patterns, QDir::Files, QDir::Name))
+        files << dir.absoluteFilePath(name);
+
+    ReplayRunner runner(files, options);
+    QTimer::singleShot(0, &runner, SLOT(start()));
+
+    return app.exec();
+}
+
+#include "main.moc"
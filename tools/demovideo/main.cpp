@@ -0,0 +1,582 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Renders demos to video files without the frontend, for producing many
+// videos at once.
+//
+// The frontend records a video by replaying the camera positions saved
+// while the demo was watched. Here there are none, the engine is told to
+// move the camera by itself like it does for a player who doesn't touch the
+// mouse ("recautocam"). Each demo is first replayed with --stats-only to
+// learn its length in game ticks, which the engine needs to report
+// progress, then rendered with --recorder. Video and thumbnail are moved
+// from the VideoTemp directory of the user prefix to the output directory.
+// Sound can't be recorded this way, videos have no audio track.
+//
+// Output is one tab separated line per event, meant to be read by scripts:
+//   start     <demo>
+//   progress  <demo>  <fraction done>  <encoded frames per second>
+//   done      <demo>  <video>  <thumbnail or ->  <seconds>
+//   fail      <demo>  <reason>
+//   summary   <videos done>  <failed>  <seconds>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QQueue>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include "DemoContainer.h"
+#include "IPCFrameBuffer.h"
+
+struct Options
+{
+    QString engine;
+    QString prefix;
+    QString userPrefix;
+    QString output;
+    QString format;
+    QString videoCodec;
+    int width;
+    int height;
+    int bitrate; // kbit/s
+    int framerate;
+    int jobs;
+    int timeout;
+};
+
+class RecordJob : public QObject
+{
+        Q_OBJECT
+
+    public:
+        RecordJob(const QString & fileName, int id, const Options & options, QTextStream & out, QObject * parent = 0) :
+            QObject(parent),
+            m_fileName(fileName),
+            m_name(QFileInfo(fileName).fileName()),
+            m_recPrefix(QString("demovideo-%1-%2").arg(QCoreApplication::applicationPid()).arg(id)),
+            m_options(options),
+            m_out(out),
+            m_socket(0),
+            m_recording(false),
+            m_ticks(0),
+            m_frames(0),
+            m_lastProgress(-1),
+            m_encoded(false),
+            m_done(false),
+            m_success(false)
+        {
+        }
+
+        bool success() const { return m_success; }
+
+    signals:
+        void finished(RecordJob * job);
+
+    public slots:
+        void start()
+        {
+            QFile file(m_fileName);
+            if(file.open(QIODevice::ReadOnly))
+                m_demo = DemoContainer::unpack(file.readAll());
+
+            if(m_demo.isEmpty())
+            {
+                fail("can't read demo");
+                return;
+            }
+
+            connect(&m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+            connect(&m_process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(onEngineFinished(int)));
+            connect(&m_process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onEngineError(QProcess::ProcessError)));
+            connect(&m_timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+
+            m_out << "start\t" << m_name << endl;
+            m_wallTime.start();
+            m_timer.setSingleShot(true);
+            m_timer.start(m_options.timeout * 1000);
+
+            // first pass: replay at full speed to get the length of the game
+            QStringList arguments;
+            arguments << "--stats-only";
+            startEngine(arguments);
+        }
+
+    private slots:
+        void onNewConnection()
+        {
+            m_socket = m_server.nextPendingConnection();
+            m_server.close();
+
+            m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+
+            if(!m_recording)
+            {
+                m_socket->write(m_demo);
+                return;
+            }
+
+            // same as HWRecorder, but with the camera left to the engine
+            QByteArray command = "erecautocam " + QByteArray::number(m_ticks);
+            m_socket->write(QByteArray(1, char(command.size())) + command);
+
+            QByteArray record = m_demo;
+            record.replace(QByteArray("\x02TD"), QByteArray("\x02TV"));
+            record.replace(QByteArray("\x02TL"), QByteArray("\x02TV"));
+            record.replace(QByteArray("\x02TN"), QByteArray("\x02TV"));
+            record.replace(QByteArray("\x02TS"), QByteArray("\x02TV"));
+            m_socket->write(record);
+
+            m_frameTime.start();
+        }
+
+        void onReadyRead()
+        {
+            m_ipc.readFrom(m_socket);
+
+            QByteArray frame;
+            while(m_ipc.next(frame))
+                parseMessage(frame);
+        }
+
+        void onEngineFinished(int exitCode)
+        {
+            // messages sent right before exiting may not have been read yet
+            if(m_socket)
+            {
+                onReadyRead();
+                m_socket->deleteLater();
+                m_socket = 0;
+            }
+
+            if(m_done)
+                return;
+
+            if(!m_recording)
+            {
+                // an unknown length only costs the progress
+                m_recording = true;
+                m_ipc.clear();
+                m_errors.clear();
+                startEngine(recorderArguments());
+                return;
+            }
+
+            if(!m_encoded)
+            {
+                fail(m_errors.isEmpty() ? QString("engine exit code %1").arg(exitCode) : m_errors.join("; "));
+                return;
+            }
+
+            collectOutput();
+        }
+
+        void onEngineError(QProcess::ProcessError error)
+        {
+            if(error == QProcess::FailedToStart)
+                fail("can't run engine " + m_options.engine);
+        }
+
+        void onTimeout()
+        {
+            fail(QString("timed out after %1 s").arg(m_options.timeout));
+            m_process.kill();
+        }
+
+    private:
+        QString m_fileName;
+        QString m_name;
+        QString m_recPrefix; // name of the files in VideoTemp
+        Options m_options;
+        QTextStream & m_out;
+        QByteArray m_demo;
+        QTcpServer m_server;
+        QTcpSocket * m_socket;
+        QProcess m_process;
+        QTimer m_timer;
+        QElapsedTimer m_wallTime;
+        QElapsedTimer m_frameTime;
+        IPCFrameBuffer m_ipc;
+        QStringList m_errors;
+        bool m_recording; // second pass
+        quint32 m_ticks;
+        qint64 m_frames;
+        int m_lastProgress; // in 1/10000
+        bool m_encoded;
+        bool m_done;
+        bool m_success;
+
+        QStringList recorderArguments() const
+        {
+            QStringList arguments;
+            arguments << "--width" << QString::number(m_options.width);
+            arguments << "--height" << QString::number(m_options.height);
+            arguments << "--volume" << "0";
+            arguments << "--recorder";
+            arguments << QString::number(m_options.framerate); //cVideoFramerateNum
+            arguments << "1"; //cVideoFramerateDen
+            arguments << m_recPrefix;
+            arguments << m_options.format;
+            arguments << m_options.videoCodec;
+            arguments << QString::number(m_options.bitrate * 1024);
+            arguments << "no"; // audio codec
+            return arguments;
+        }
+
+        void startEngine(const QStringList & extraArguments)
+        {
+            if(!m_server.listen(QHostAddress::LocalHost))
+            {
+                fail("can't listen for the engine: " + m_server.errorString());
+                return;
+            }
+
+            QStringList arguments;
+            arguments << "--internal"; // must be the first argument
+            arguments << "--port" << QString::number(m_server.serverPort());
+            arguments << "--prefix" << m_options.prefix;
+            arguments << "--user-prefix" << m_options.userPrefix;
+            arguments << "--nosound";
+            arguments << "--nomusic";
+            arguments << extraArguments;
+
+            // the engine prints game results on stdout in stats only mode
+            m_process.setStandardOutputFile(QProcess::nullDevice());
+            m_process.setStandardErrorFile(QProcess::nullDevice());
+            m_process.start(m_options.engine, arguments);
+        }
+
+        void parseMessage(const QByteArray & msg)
+        {
+            switch(msg.at(1))
+            {
+                case '?':
+                {
+                    m_socket->write(QByteArray("\x01!", 2));
+                    break;
+                }
+                case 'E':
+                {
+                    // strip length byte, command and the timestamp
+                    m_errors << QString::fromUtf8(msg.mid(2, msg.size() - 4));
+                    break;
+                }
+                case 'i':
+                {
+                    // final state hash and game tick of the first pass
+                    if(!m_recording && (msg.at(2) == 'h'))
+                    {
+                        QStringList values = QString::fromLatin1(msg.mid(3)).split(' ');
+                        if(values.size() == 2)
+                            m_ticks = values[1].toUInt();
+                    }
+                    break;
+                }
+                case 'p':
+                {
+                    if(msg.size() < 4)
+                        break;
+
+                    ++m_frames;
+                    int progress = quint8(msg.at(2))*256 + quint8(msg.at(3));
+
+                    // a line per percent is plenty
+                    if(progress / 100 != m_lastProgress / 100)
+                    {
+                        qint64 ms = m_frameTime.elapsed();
+                        m_out << QString("progress\t%1\t%2\t%3")
+                            .arg(m_name)
+                            .arg(progress / 10000.0, 0, 'f', 4)
+                            .arg(ms > 0 ? m_frames * 1000.0 / ms : 0, 0, 'f', 1)
+                            << endl;
+                    }
+                    m_lastProgress = progress;
+                    break;
+                }
+                case 'v':
+                {
+                    m_encoded = true;
+                    break;
+                }
+            }
+        }
+
+        void collectOutput()
+        {
+            QDir temp(m_options.userPrefix + "/VideoTemp");
+            QDir output(m_options.output);
+            QString base = QFileInfo(m_fileName).completeBaseName();
+            QString video, thumbnail = "-";
+
+            // the engine adds the extension of the format to the prefix
+            foreach(const QFileInfo & fi, temp.entryInfoList(QStringList(m_recPrefix + ".*"), QDir::Files))
+            {
+                QString target = output.absoluteFilePath(base + "." + fi.suffix());
+                QFile::remove(target);
+                if(!QFile::rename(fi.absoluteFilePath(), target))
+                {
+                    fail("can't move " + fi.fileName() + " to " + target);
+                    return;
+                }
+
+                if((fi.suffix() == "png") || (fi.suffix() == "bmp"))
+                    thumbnail = target;
+                else
+                    video = target;
+            }
+
+            if(video.isEmpty())
+            {
+                fail("engine finished, but there is no video");
+                return;
+            }
+
+            m_success = true;
+            m_out << QString("done\t%1\t%2\t%3\t%4")
+                .arg(m_name)
+                .arg(video)
+                .arg(thumbnail)
+                .arg(m_wallTime.elapsed() / 1000.0, 0, 'f', 1)
+                << endl;
+            finish();
+        }
+
+        void fail(const QString & error)
+        {
+            if(m_done)
+                return;
+
+            m_out << "fail\t" << m_name << '\t' << error << endl;
+            finish();
+        }
+
+        void finish()
+        {
+            if(m_done)
+                return;
+
+            m_done = true;
+            m_timer.stop();
+            emit finished(this);
+        }
+};
+
+class RecordRunner : public QObject
+{
+        Q_OBJECT
+
+    public:
+        RecordRunner(const QStringList & files, const Options & options) :
+            m_options(options),
+            m_running(0),
+            m_started(0),
+            m_done(0),
+            m_failed(0),
+            m_out(stdout)
+        {
+            foreach(const QString & file, files)
+                m_queue.enqueue(file);
+        }
+
+    public slots:
+        void start()
+        {
+            m_wallTime.start();
+
+            if(m_queue.isEmpty())
+            {
+                m_out << "fail\t-\tno demos found" << endl;
+                QCoreApplication::exit(1);
+                return;
+            }
+
+            while((m_running < m_options.jobs) && !m_queue.isEmpty())
+                startNext();
+        }
+
+    private slots:
+        void onJobFinished(RecordJob * job)
+        {
+            --m_running;
+            if(job->success())
+                ++m_done;
+            else
+                ++m_failed;
+
+            // the engine may still be exiting after a failure
+            job->deleteLater();
+
+            if(!m_queue.isEmpty())
+                startNext();
+            else if(m_running == 0)
+                summary();
+        }
+
+    private:
+        QQueue<QString> m_queue;
+        Options m_options;
+        int m_running;
+        int m_started;
+        int m_done;
+        int m_failed;
+        QElapsedTimer m_wallTime;
+        QTextStream m_out;
+
+        void startNext()
+        {
+            RecordJob * job = new RecordJob(m_queue.dequeue(), m_started++, m_options, m_out, this);
+            connect(job, SIGNAL(finished(RecordJob *)), this, SLOT(onJobFinished(RecordJob *)));
+            ++m_running;
+            // queued, so that a job failing right away doesn't recurse into startNext()
+            QTimer::singleShot(0, job, SLOT(start()));
+        }
+
+        void summary()
+        {
+            m_out << QString("summary\t%1\t%2\t%3")
+                .arg(m_done)
+                .arg(m_failed)
+                .arg(m_wallTime.elapsed() / 1000.0, 0, 'f', 1)
+                << endl;
+
+            QCoreApplication::exit(m_failed > 0 ? 1 : 0);
+        }
+};
+
+static void usage(QTextStream & out)
+{
+    out << "Usage: demovideo [options] <demo or directory>..." << endl
+        << "  --prefix <dir>          game data directory (required)" << endl
+        << "  --user-prefix <dir>     user data directory, a temporary one by default" << endl
+        << "  --engine <path>         hwengine binary, next to demovideo by default" << endl
+        << "  --output <dir>          where videos and thumbnails go, current directory by default" << endl
+        << "  --format <name>         container format, mp4 by default" << endl
+        << "  --vcodec <name>         video codec, libx264 by default" << endl
+        << "  --size <w>x<h>          resolution, 1280x720 by default" << endl
+        << "  --bitrate <kbit/s>      video bitrate in multiples of 1024 bit/s, 2000 by default" << endl
+        << "  --fps <n>               frame rate, 30 by default" << endl
+        << "  -j <n>                  videos to encode at once, a quarter of the cores by default" << endl
+        << "  --timeout <s>           wall time limit per demo, 3600 by default" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    Options options;
+    options.engine = QCoreApplication::applicationDirPath() + "/hwengine";
+    options.output = QDir::currentPath();
+    options.format = "mp4";
+    options.videoCodec = "libx264";
+    options.width = 1280;
+    options.height = 720;
+    options.bitrate = 2000;
+    options.framerate = 30;
+    // every engine converts and encodes frames in several threads already
+    options.jobs = qMax(1, QThread::idealThreadCount() / 4);
+    options.timeout = 3600;
+
+    QStringList inputs;
+    QStringList args = app.arguments().mid(1);
+
+    while(!args.isEmpty())
+    {
+        QString arg = args.takeFirst();
+        bool hasValue = !args.isEmpty();
+
+        if(arg == "--prefix" && hasValue)
+            options.prefix = args.takeFirst();
+        else if(arg == "--user-prefix" && hasValue)
+            options.userPrefix = args.takeFirst();
+        else if(arg == "--engine" && hasValue)
+            options.engine = args.takeFirst();
+        else if(arg == "--output" && hasValue)
+            options.output = args.takeFirst();
+        else if(arg == "--format" && hasValue)
+            options.format = args.takeFirst();
+        else if(arg == "--vcodec" && hasValue)
+            options.videoCodec = args.takeFirst();
+        else if(arg == "--size" && hasValue)
+        {
+            QStringList size = args.takeFirst().split('x');
+            options.width = size.value(0).toInt();
+            options.height = size.value(1).toInt();
+        }
+        else if(arg == "--bitrate" && hasValue)
+            options.bitrate = args.takeFirst().toInt();
+        else if(arg == "--fps" && hasValue)
+            options.framerate = args.takeFirst().toInt();
+        else if(arg == "-j" && hasValue)
+            options.jobs = args.takeFirst().toInt();
+        else if(arg == "--timeout" && hasValue)
+            options.timeout = args.takeFirst().toInt();
+        else if(!arg.startsWith('-'))
+            inputs << arg;
+        else
+        {
+            usage(out);
+            return 1;
+        }
+    }
+
+    if(inputs.isEmpty() || options.prefix.isEmpty() || (options.jobs < 1) || (options.timeout < 1)
+            || (options.width <= 0) || (options.height <= 0) || (options.bitrate <= 0) || (options.framerate <= 0))
+    {
+        usage(out);
+        return 1;
+    }
+
+    // engines write their logs there, keep them out of the real config dir
+    QTemporaryDir userPrefix;
+    if(options.userPrefix.isEmpty())
+        options.userPrefix = userPrefix.path();
+    QDir().mkpath(options.userPrefix + "/VideoTemp");
+    QDir().mkpath(options.output);
+
+    QStringList files;
+    foreach(const QString & input, inputs)
+    {
+        QFileInfo fi(input);
+        if(fi.isDir())
+        {
+            QDir dir(input);
+            foreach(const QString & name, dir.entryList(QStringList("*.hwd"), QDir::Files, QDir::Name))
+                files << dir.absoluteFilePath(name);
+        }
+        else
+            files << fi.absoluteFilePath();
+    }
+
+    RecordRunner runner(files, options);
+    QTimer::singleShot(0, &runner, SLOT(start()));
+
+    return app.exec();
+}
+
+#include "main.moc"
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Round-trip latency and throughput of the frontend/engine IPC transports
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+TARGET = ipcbench
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../QTfrontend/util
+
+SOURCES += main.cpp \
+    ../../QTfrontend/util/IPCFrameBuffer.cpp
+
+HEADERS += ../../QTfrontend/util/IPCFrameBuffer.h
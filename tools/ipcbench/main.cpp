@@ -0,0 +1,209 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Compares the IPC transports TCPBase can use to talk to the engine:
+// tcp on localhost and unix domain sockets (QLocalSocket).
+// An echo server runs in a separate thread and sends back every frame it
+// parses, the client measures round trips of small engine-like frames and
+// the throughput of maximum sized normal and extended frames. Both sides
+// split the stream with IPCFrameBuffer like the frontend does.
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSemaphore>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QThread>
+#include <QtEndian>
+
+#include "IPCFrameBuffer.h"
+
+static const int roundTrips = 20000;
+static const int bulkBytes = 64 * 1024 * 1024;
+
+class EchoThread : public QThread
+{
+    public:
+        EchoThread(bool local) : m_local(local), m_port(0) {}
+
+        QString serverName() const { return m_name; }
+        quint16 port() const { return m_port; }
+        QSemaphore ready;
+
+    protected:
+        void run()
+        {
+            QIODevice * socket;
+            QTcpServer tcpServer;
+            QLocalServer localServer;
+
+            if(m_local)
+            {
+                m_name = QString("ipcbench-%1").arg(QCoreApplication::applicationPid());
+                QLocalServer::removeServer(m_name);
+                localServer.listen(m_name);
+                m_name = localServer.fullServerName();
+                ready.release();
+                localServer.waitForNewConnection(-1);
+                socket = localServer.nextPendingConnection();
+            }
+            else
+            {
+                tcpServer.listen(QHostAddress::LocalHost);
+                m_port = tcpServer.serverPort();
+                ready.release();
+                tcpServer.waitForNewConnection(-1);
+                socket = tcpServer.nextPendingConnection();
+            }
+
+            if(QTcpSocket * tcpSocket = qobject_cast<QTcpSocket *>(socket))
+                tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+            IPCFrameBuffer frames;
+            QByteArray frame;
+            while(socket->waitForReadyRead(5000))
+            {
+                frames.readFrom(socket);
+                while(frames.next(frame))
+                    socket->write(frame);
+                while(socket->bytesToWrite() > 0)
+                    socket->waitForBytesWritten(-1);
+            }
+        }
+
+    private:
+        bool m_local;
+        QString m_name;
+        quint16 m_port;
+};
+
+// waits for count frames, returns their size
+static qint64 receiveFrames(QIODevice * socket, IPCFrameBuffer & frames, int count)
+{
+    qint64 received = 0;
+    QByteArray frame;
+
+    for(;;)
+    {
+        while((count > 0) && frames.next(frame))
+        {
+            received += frame.size();
+            --count;
+        }
+
+        if(count == 0)
+            return received;
+
+        if(socket->bytesAvailable() == 0)
+            socket->waitForReadyRead(-1);
+        frames.readFrom(socket);
+    }
+}
+
+// bulk data the way demos are sent, count frames per write
+static double throughput(QIODevice * socket, IPCFrameBuffer & frames, const QByteArray & chunk, int count)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 sent = 0;
+    while(sent < bulkBytes)
+    {
+        socket->write(chunk);
+        sent += chunk.size();
+        receiveFrames(socket, frames, count);
+    }
+
+    return bulkBytes / (timer.nsecsElapsed() / 1e9) / (1024 * 1024);
+}
+
+static void benchmark(QTextStream & out, const QString & name, QIODevice * socket)
+{
+    QElapsedTimer timer;
+    IPCFrameBuffer frames;
+
+    // engine messages are small: length byte, command, two bytes of ticks
+    QByteArray frame("\x03+\x00\x01", 4);
+
+    timer.start();
+    for(int i = 0; i < roundTrips; ++i)
+    {
+        socket->write(frame);
+        receiveFrames(socket, frames, 1);
+    }
+    qint64 latencyNs = timer.nsecsElapsed() / roundTrips;
+
+    // the largest normal frames, an engine command padded to the limit
+    QByteArray normal(1 + IPC_MAX_FRAME_PAYLOAD, 'x');
+    normal[0] = char(IPC_MAX_FRAME_PAYLOAD);
+    normal[1] = 'e';
+    double normalSpeed = throughput(socket, frames, normal.repeated(64), 64);
+
+    // extended frames as used for drawn maps
+    QByteArray extended(IPC_EXTENDED_HEADER + 64 * 1024, 'x');
+    extended[0] = 0;
+    extended[1] = IPC_EXTENDED_VERSION;
+    qToBigEndian<quint32>(64 * 1024, (uchar *)extended.data() + 2);
+    extended[IPC_EXTENDED_HEADER] = 'e';
+    double extendedSpeed = throughput(socket, frames, extended, 1);
+
+    out << QString("%1: round trip %2 us, throughput %3 MiB/s in normal frames, %4 MiB/s in extended frames")
+        .arg(name, -6)
+        .arg(latencyNs / 1000.0, 0, 'f', 2)
+        .arg(normalSpeed, 0, 'f', 1)
+        .arg(extendedSpeed, 0, 'f', 1)
+        << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    {
+        EchoThread server(false);
+        server.start();
+        server.ready.acquire();
+
+        QTcpSocket socket;
+        socket.connectToHost(QHostAddress::LocalHost, server.port());
+        socket.waitForConnected(-1);
+        socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        benchmark(out, "tcp", &socket);
+        socket.close();
+        server.wait();
+    }
+
+    {
+        EchoThread server(true);
+        server.start();
+        server.ready.acquire();
+
+        QLocalSocket socket;
+        socket.connectToServer(server.serverName());
+        socket.waitForConnected(-1);
+        benchmark(out, "local", &socket);
+        socket.close();
+        server.wait();
+    }
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Compares the old and the ring buffer engine IPC frame parsers
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = ipcframebench
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../QTfrontend/util
+
+SOURCES += main.cpp \
+    ../../QTfrontend/util/IPCFrameBuffer.cpp
+
+HEADERS += ../../QTfrontend/util/IPCFrameBuffer.h
@@ -0,0 +1,161 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Feeds engine traffic through the frame parser HWGame and HWRecorder
+// used before (QByteArray::left + remove per message) and through
+// IPCFrameBuffer. Traffic is taken from a demo file, which is the engine
+// message stream as recorded by the frontend, or generated if none is
+// given. It is delivered in socket sized chunks like QIODevice would.
+//
+// usage: ipcframebench [demo.hwd] [chunk size]
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+#include "IPCFrameBuffer.h"
+
+struct Result
+{
+    qint64 frames;
+    quint32 checksum;
+    qint64 nsecs;
+};
+
+static void consume(Result & result, const QByteArray & msg)
+{
+    ++result.frames;
+    result.checksum = result.checksum * 31 + quint8(msg.at(1)) + msg.size();
+}
+
+static Result oldParser(const QByteArray & traffic, int chunkSize)
+{
+    Result result = {0, 0, 0};
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray readbuffer;
+    for(int pos = 0; pos < traffic.size(); pos += chunkSize)
+    {
+        readbuffer.append(traffic.mid(pos, chunkSize));
+
+        quint8 msglen;
+        quint32 bufsize;
+        while (!readbuffer.isEmpty() && ((bufsize = readbuffer.size()) > 0) &&
+                ((msglen = readbuffer.data()[0]) < bufsize))
+        {
+            QByteArray msg = readbuffer.left(msglen + 1);
+            readbuffer.remove(0, msglen + 1);
+            consume(result, msg);
+        }
+    }
+
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+static Result newParser(const QByteArray & traffic, int chunkSize)
+{
+    Result result = {0, 0, 0};
+    QElapsedTimer timer;
+    timer.start();
+
+    IPCFrameBuffer frames;
+    QByteArray msg;
+    for(int pos = 0; pos < traffic.size(); pos += chunkSize)
+    {
+        frames.append(traffic.constData() + pos, qMin(chunkSize, traffic.size() - pos));
+
+        while (frames.next(msg))
+            consume(result, msg);
+    }
+
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+// what a fast-forwarded game mostly consists of: ticks, cursor and
+// movement messages, with occasional chat lines
+static QByteArray generateTraffic(int messages)
+{
+    QByteArray traffic;
+    qsrand(1);
+
+    for(int i = 0; i < messages; ++i)
+    {
+        QByteArray msg;
+        switch(qrand() % 8)
+        {
+            case 0:
+                msg = "s" + QByteArray(qrand() % 100, 'c');
+                break;
+            case 1:
+            case 2:
+                msg = QByteArray("c") + char(qrand()) + char(qrand()) + char(qrand()) + char(qrand());
+                break;
+            default:
+                msg = QByteArray("+") + char(0) + char(qrand() % 50);
+        }
+        traffic.append(char(msg.size()));
+        traffic.append(msg);
+    }
+
+    return traffic;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QStringList args = app.arguments();
+
+    QByteArray traffic;
+    if(args.size() > 1)
+    {
+        QFile demo(args[1]);
+        if(!demo.open(QIODevice::ReadOnly))
+        {
+            out << "Can't open " << args[1] << endl;
+            return 1;
+        }
+        traffic = demo.readAll();
+    }
+    else
+        traffic = generateTraffic(2000000);
+
+    int chunkSize = args.size() > 2 ? args[2].toInt() : 64 * 1024;
+    if(chunkSize <= 0)
+        chunkSize = 64 * 1024;
+
+    Result before = oldParser(traffic, chunkSize);
+    Result after = newParser(traffic, chunkSize);
+
+    out << QString("%1 bytes in %2 byte chunks").arg(traffic.size()).arg(chunkSize) << endl;
+    out << QString("left/remove: %1 frames, %2 ms").arg(before.frames).arg(before.nsecs / 1e6, 0, 'f', 1) << endl;
+    out << QString("ring buffer: %1 frames, %2 ms").arg(after.frames).arg(after.nsecs / 1e6, 0, 'f', 1) << endl;
+
+    if((before.frames != after.frames) || (before.checksum != after.checksum))
+    {
+        out << "MISMATCH: parsers disagree" << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Checks that HWProto frames engine IPC payloads of every size so that
+# IPCFrameBuffer and the engine can read them back
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = ipcframetest
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../QTfrontend/util \
+    ../../QTfrontend/net
+
+SOURCES += main.cpp \
+    ../../QTfrontend/net/proto.cpp \
+    ../../QTfrontend/util/IPCFrameBuffer.cpp
+
+HEADERS += ../../QTfrontend/net/proto.h \
+    ../../QTfrontend/util/IPCFrameBuffer.h
@@ -0,0 +1,124 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Frames payloads around the size limits with
+// HWProto::addExtendedByteArrayToBuffer and checks the headers the engine
+// relies on: payloads of 1 to IPC_MAX_FRAME_PAYLOAD bytes get a length
+// byte, everything else, the empty payload included, an extended header.
+// The frames are then parsed back with IPCFrameBuffer, delivered in small
+// chunks. Exits with 1 if anything doesn't match.
+//
+// usage: ipcframetest
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QtEndian>
+
+#include "IPCFrameBuffer.h"
+#include "proto.h"
+
+static QByteArray payloadOfSize(int size)
+{
+    QByteArray payload(size, 0);
+    for (int i = 0; i < size; ++i)
+        payload[i] = (char)(i * 7 + size);
+    return payload;
+}
+
+static bool checkHeader(QTextStream & out, const QByteArray & frame, int size)
+{
+    if ((size > 0) && (size <= IPC_MAX_FRAME_PAYLOAD))
+    {
+        if ((frame.size() == size + 1) && ((quint8)frame.at(0) == size))
+            return true;
+
+        out << "FAIL: payload of " << size << " bytes should have a length byte" << endl;
+        return false;
+    }
+
+    if ((frame.size() == size + IPC_EXTENDED_HEADER)
+            && (frame.at(0) == 0)
+            && (frame.at(1) == IPC_EXTENDED_VERSION)
+            && (qFromBigEndian<quint32>((const uchar *)frame.constData() + 2) == (quint32)size))
+        return true;
+
+    out << "FAIL: payload of " << size << " bytes should have an extended header" << endl;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const int sizes[] = {0, 1, 250, 251, 255, 256, 70000};
+    const int count = sizeof(sizes) / sizeof(sizes[0]);
+    bool ok = true;
+
+    QByteArray stream;
+    for (int i = 0; i < count; ++i)
+    {
+        QByteArray frame;
+        HWProto::addExtendedByteArrayToBuffer(frame, payloadOfSize(sizes[i]));
+        ok = checkHeader(out, frame, sizes[i]) && ok;
+        stream.append(frame);
+    }
+
+    if (IPCFrameBuffer::completeFramesSize(stream) != stream.size())
+    {
+        out << "FAIL: the stream doesn't consist of complete frames" << endl;
+        ok = false;
+    }
+
+    IPCFrameBuffer buffer(64);
+    QByteArray frame;
+    int parsed = 0;
+
+    for (int pos = 0; pos < stream.size(); pos += 100)
+    {
+        buffer.append(stream.mid(pos, 100));
+
+        while (buffer.next(frame))
+        {
+            if (parsed >= count)
+            {
+                out << "FAIL: more frames than payloads" << endl;
+                return 1;
+            }
+
+            if (IPCFrameBuffer::payload(frame) != payloadOfSize(sizes[parsed]))
+            {
+                out << "FAIL: payload of " << sizes[parsed] << " bytes reads back differently" << endl;
+                ok = false;
+            }
+
+            ++parsed;
+        }
+    }
+
+    if ((parsed != count) || !buffer.isEmpty())
+    {
+        out << "FAIL: " << parsed << " of " << count << " frames read back" << endl;
+        ok = false;
+    }
+
+    if (ok)
+        out << "OK: " << count << " payloads framed and read back" << endl;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Checks KeywordMatcher against a naive search
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = keywordmatchertest
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../QTfrontend/util
+
+SOURCES += main.cpp \
+    ../../QTfrontend/util/KeywordMatcher.cpp
+
+HEADERS += ../../QTfrontend/util/KeywordMatcher.h
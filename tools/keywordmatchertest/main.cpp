@@ -0,0 +1,121 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Compares the matches KeywordMatcher::findAll reports with a naive
+// search for every keyword, including overlapping keywords and keywords
+// which are suffixes of others. Keywords are added in two rounds with a
+// search in between, so the second search runs on a rebuilt automaton.
+// Exits with 1 if anything doesn't match.
+//
+// usage: keywordmatchertest
+
+#include <QCoreApplication>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include "KeywordMatcher.h"
+
+typedef QPair<int, int> Found; // keyword, start
+
+static QList<Found> naiveMatches(const QStringList & keywords, const QString & text)
+{
+    QList<Found> found;
+
+    for (int k = 0; k < keywords.size(); ++k)
+        for (int pos = text.indexOf(keywords[k]); pos >= 0; pos = text.indexOf(keywords[k], pos + 1))
+            found << Found(k, pos);
+
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+static bool check(QTextStream & out, const KeywordMatcher & matcher, const QStringList & keywords, const QString & text)
+{
+    QVector<KeywordMatcher::Match> matches;
+    matcher.findAll(text, matches);
+
+    QList<Found> found;
+    foreach (const KeywordMatcher::Match & match, matches)
+        found << Found(match.keyword, match.start);
+    std::sort(found.begin(), found.end());
+
+    QList<Found> expected = naiveMatches(keywords, text);
+    if (found == expected)
+        return true;
+
+    out << "FAIL: \"" << text << "\" with " << keywords.join(", ")
+        << ": " << found.size() << " matches, expected " << expected.size() << endl;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList texts = QStringList()
+        << "" << "she sells seashells" << "hershey's ushers"
+        << "hedgewars.org and www.hedgewars.org/forum" << "aaaaaa";
+
+    KeywordMatcher matcher;
+    QStringList keywords;
+    bool ok = true;
+
+    foreach (const QString & keyword, QStringList() << "he" << "she" << "hers" << "aa")
+    {
+        if (matcher.addKeyword(keyword) != keywords.size())
+            ok = false;
+        keywords << keyword;
+    }
+
+    if (matcher.addKeyword(QString()) != -1)
+    {
+        out << "FAIL: an empty keyword was added" << endl;
+        ok = false;
+    }
+
+    foreach (const QString & text, texts)
+        ok = check(out, matcher, keywords, text) && ok;
+
+    // adding keywords after a search rebuilds the automaton, no match may
+    // be reported twice afterwards
+    foreach (const QString & keyword, QStringList() << "s" << "hedgewars.org" << "ushers" << "a")
+    {
+        matcher.addKeyword(keyword);
+        keywords << keyword;
+
+        foreach (const QString & text, texts)
+            ok = check(out, matcher, keywords, text) && ok;
+    }
+
+    matcher.clear();
+    if (!matcher.isEmpty() || !check(out, matcher, QStringList(), "she"))
+    {
+        out << "FAIL: the matcher isn't empty after clear()" << endl;
+        ok = false;
+    }
+
+    if (ok)
+        out << "OK: " << keywords.size() << " keywords matched in " << texts.size() << " texts" << endl;
+
+    return ok ? 0 : 1;
+}
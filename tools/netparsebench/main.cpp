@@ -0,0 +1,389 @@
+/*
+ * Hedgewars, a free turn based strategy game
+ * Copyright (c) 2004-2015 Andrey Korotaev <unC0Rr@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Decodes a lobby session the way HWNewNet did before (readLine, a QString
+// per line, a QStringList per message and a chain of string compares) and
+// with NetMessageBuffer and a hash of commands, checks that both see the
+// same messages and compares their speed.
+//
+// The session is the raw stream a server sent, as written by --capture,
+// which logs in with a throwaway nick and records the lobby for a while.
+// Without a capture a synthetic busy lobby is used.
+//
+// usage: netparsebench [capture [repeats]]
+//        netparsebench --capture host[:port] capture [seconds [proto]]
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QVector>
+
+#include "NetMessageBuffer.h"
+
+// in the order HWNewNet::ParseCmd tested them
+static const char * const commandNames[] = {
+    "NICK", "PROTO", "ERROR", "WARNING", "CONNECTED", "SERVER_AUTH", "PING",
+    "ROOMS", "SERVER_MESSAGE", "CHAT", "INFO", "SERVER_VARS", "BANLIST",
+    "CLIENT_FLAGS", "CF", "KICKED", "LOBBY:JOINED", "ROOM", "LOBBY:LEFT",
+    "ASKPASSWORD", "NOTICE", "BYE", "JOINING", "JOINED", "EM",
+    "ROUND_FINISHED", "ADD_TEAM", "REMOVE_TEAM", "ROOMABANDONED", "RUN_GAME",
+    "TEAM_ACCEPTED", "CFG", "HH_NUM", "TEAM_COLOR", "LEFT"
+};
+static const int commandsCount = sizeof(commandNames) / sizeof(commandNames[0]);
+
+// size of the pieces the new parser gets, like reads from a socket
+static const int chunkSize = 1460;
+
+// keeps the string conversions from being optimized away
+static int stringsDecoded = 0;
+
+static void appendMessage(QByteArray & data, const QStringList & fields)
+{
+    data.append(fields.join("\n").toUtf8());
+    data.append("\n\n");
+}
+
+static QStringList roomInfo(int room, int players)
+{
+    return QStringList()
+        << (room % 3 ? "-" : "+g")
+        << QString("Room %1 \xc3\xa4\xc3\xb6").arg(room)
+        << QString::number(players)
+        << QString::number(players * 2 % 8)
+        << QString("owner%1").arg(room)
+        << "+rnd+"
+        << "Normal"
+        << "Default"
+        << "Default";
+}
+
+static QByteArray syntheticSession()
+{
+    const int players = 800;
+    const int rooms = 150;
+    QByteArray data;
+
+    appendMessage(data, QStringList() << "CONNECTED" << "Hedgewars server" << "3");
+    appendMessage(data, QStringList() << "NICK" << "netbench");
+    appendMessage(data, QStringList() << "PROTO" << "56");
+    appendMessage(data, QStringList() << "SERVER_MESSAGE" << QString(400, 'm'));
+
+    QStringList roomsList("ROOMS");
+    for(int i = 0; i < rooms; ++i)
+        roomsList << roomInfo(i, i % 6 + 1);
+    appendMessage(data, roomsList);
+
+    QStringList joined("LOBBY:JOINED");
+    QStringList registered;
+    for(int i = 0; i < players; ++i)
+    {
+        joined << QString("player%1").arg(i);
+        if(i % 3 == 0)
+            registered << joined.last();
+    }
+    appendMessage(data, joined);
+    appendMessage(data, QStringList() << "CLIENT_FLAGS" << "+u" << registered);
+
+    // room updates and players coming and going dominate a busy lobby
+    for(int i = 0; i < 60000; ++i)
+    {
+        int room = i % rooms;
+        QString nick = QString("player%1").arg(i % players);
+
+        switch(i % 10)
+        {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+                appendMessage(data, QStringList() << "ROOM" << "UPD" << QString("Room %1 \xc3\xa4\xc3\xb6").arg(room)
+                    << roomInfo(room, i % 6 + 1));
+                break;
+            case 4:
+                appendMessage(data, QStringList() << "CLIENT_FLAGS" << (i & 1 ? "+i" : "-i") << nick);
+                break;
+            case 5:
+                appendMessage(data, QStringList() << "LOBBY:LEFT" << nick << "Quit: bye");
+                break;
+            case 6:
+                appendMessage(data, QStringList() << "LOBBY:JOINED" << nick);
+                break;
+            case 7:
+                appendMessage(data, QStringList() << "CHAT" << nick << QString("hello everyone, message %1").arg(i));
+                break;
+            case 8:
+                appendMessage(data, QStringList() << "ROOM" << "ADD" << roomInfo(rooms + i, 1));
+                break;
+            default:
+                if(i % 100 == 9)
+                    appendMessage(data, QStringList() << "PING" << QString::number(i));
+                else
+                    appendMessage(data, QStringList() << "ROOM" << "DEL" << QString("Room %1 \xc3\xa4\xc3\xb6").arg(rooms + i - 1));
+        }
+    }
+
+    return data;
+}
+
+// the parser HWNewNet used before, one QString per line
+static int oldDecode(const QByteArray & data, QVector<int> & counts)
+{
+    QBuffer device;
+    device.setData(data);
+    device.open(QIODevice::ReadOnly);
+
+    QStringList cmdbuf;
+    int messages = 0;
+
+    while(device.canReadLine())
+    {
+        QString s = QString::fromUtf8(device.readLine());
+        if(s.endsWith('\n')) s.chop(1);
+
+        if(s.size() == 0)
+        {
+            ++messages;
+            if(!cmdbuf.isEmpty())
+            {
+                for(int i = 0; i < commandsCount; ++i)
+                    if(cmdbuf[0] == commandNames[i])
+                    {
+                        ++counts[i];
+                        break;
+                    }
+            }
+            cmdbuf.clear();
+        }
+        else
+            cmdbuf << s;
+    }
+
+    return messages;
+}
+
+static int newDecode(const QByteArray & data, QVector<int> & counts, bool toStrings)
+{
+    static QHash<QLatin1String, int> commands;
+    if(commands.isEmpty())
+        for(int i = 0; i < commandsCount; ++i)
+            commands.insert(QLatin1String(commandNames[i]), i);
+
+    NetMessageBuffer buffer;
+    NetMessage msg;
+    int messages = 0;
+
+    for(int pos = 0; pos < data.size(); pos += chunkSize)
+    {
+        buffer.append(data.constData() + pos, qMin(chunkSize, data.size() - pos));
+
+        while(buffer.next(msg))
+        {
+            ++messages;
+            if(msg.isEmpty())
+                continue;
+
+            QHash<QLatin1String, int>::const_iterator it = commands.constFind(msg.command());
+            if(it != commands.constEnd())
+                ++counts[*it];
+
+            // what handlers build for the UI at most
+            if(toStrings)
+                stringsDecoded += msg.strings(1).size();
+        }
+    }
+
+    return messages;
+}
+
+static void report(QTextStream & out, const QString & name, qint64 ns, int messages, qint64 bytes)
+{
+    out << QString("%1  %2 ns/message, %3 MiB/s")
+        .arg(name, -12)
+        .arg(ns / qMax(messages, 1))
+        .arg(bytes / (ns / 1e9) / (1024 * 1024), 0, 'f', 1)
+        << endl;
+}
+
+static int benchmark(QTextStream & out, const QByteArray & data, int repeats)
+{
+    QVector<int> oldCounts(commandsCount), newCounts(commandsCount), stringCounts(commandsCount);
+    QElapsedTimer timer;
+    int oldMessages = 0, newMessages = 0, stringMessages = 0;
+    qint64 oldNs, newNs, stringNs;
+
+    timer.start();
+    for(int i = 0; i < repeats; ++i)
+        oldMessages = oldDecode(data, oldCounts);
+    oldNs = timer.nsecsElapsed();
+
+    timer.start();
+    for(int i = 0; i < repeats; ++i)
+        newMessages = newDecode(data, newCounts, false);
+    newNs = timer.nsecsElapsed();
+
+    timer.start();
+    for(int i = 0; i < repeats; ++i)
+        stringMessages = newDecode(data, stringCounts, true);
+    stringNs = timer.nsecsElapsed();
+
+    if((oldMessages != newMessages) || (oldCounts != newCounts) || (newCounts != stringCounts))
+    {
+        out << "MISMATCH: parsers disagree" << endl;
+        for(int i = 0; i < commandsCount; ++i)
+            if(oldCounts[i] != newCounts[i])
+                out << QString("%1: %2 vs %3").arg(commandNames[i]).arg(oldCounts[i]).arg(newCounts[i]) << endl;
+        return 1;
+    }
+
+    out << QString("%1 bytes, %2 messages, %3 repeats").arg(data.size()).arg(newMessages).arg(repeats) << endl;
+    for(int i = 0; i < commandsCount; ++i)
+        if(newCounts[i] > 0)
+            out << QString("  %1 %2").arg(commandNames[i], -16).arg(newCounts[i] / repeats) << endl;
+
+    qint64 bytes = (qint64)data.size() * repeats;
+    report(out, "readLine", oldNs, oldMessages * repeats, bytes);
+    report(out, "buffer", newNs, newMessages * repeats, bytes);
+    report(out, "buffer+utf8", stringNs, stringMessages * repeats, bytes);
+
+    return 0;
+}
+
+static void send(QTcpSocket & socket, const QByteArray & message)
+{
+    socket.write(message);
+    socket.write("\n\n", 2);
+}
+
+static int capture(QTextStream & out, const QString & address, const QString & fileName, int seconds, const QString & proto)
+{
+    QString host = address.section(':', 0, 0);
+    quint16 port = address.contains(':') ? address.section(':', 1).toUShort() : 46631;
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        out << "Can't write " << fileName << endl;
+        return 1;
+    }
+
+    QTcpSocket socket;
+    socket.connectToHost(host, port);
+    if(!socket.waitForConnected(10000))
+    {
+        out << "Can't connect to " << address << ": " << socket.errorString() << endl;
+        return 1;
+    }
+
+    // a nick nobody registered, so the server doesn't ask for a password
+    QByteArray nick = QString("netbench%1").arg(QCoreApplication::applicationPid() % 100000).toUtf8();
+    NetMessageBuffer buffer;
+    NetMessage msg;
+    QElapsedTimer timer;
+    qint64 total = 0;
+    int messages = 0;
+
+    timer.start();
+    while((timer.elapsed() < seconds * 1000) && (socket.state() == QAbstractSocket::ConnectedState))
+    {
+        if(!socket.waitForReadyRead(100))
+            continue;
+
+        QByteArray data = socket.readAll();
+        file.write(data);
+        buffer.append(data);
+        total += data.size();
+
+        while(buffer.next(msg))
+        {
+            ++messages;
+            if(msg.isEmpty())
+                continue;
+
+            if(msg.equals(0, "CONNECTED"))
+            {
+                send(socket, "NICK\n" + nick);
+                send(socket, "PROTO\n" + proto.toUtf8());
+            }
+            else if(msg.equals(0, "PING"))
+                send(socket, msg.size() > 1 ? "PONG\n" + msg.bytes(1) : QByteArray("PONG"));
+            else if(msg.equals(0, "ASKPASSWORD") || msg.equals(0, "BYE"))
+                out << "Server said " << msg.string(0) << ", stopping" << endl;
+        }
+    }
+
+    if(socket.state() == QAbstractSocket::ConnectedState)
+    {
+        send(socket, "QUIT\nnetparsebench");
+        socket.waitForBytesWritten(1000);
+        socket.disconnectFromHost();
+    }
+
+    out << QString("Captured %1 bytes, %2 messages in %3 s")
+        .arg(total).arg(messages).arg(timer.elapsed() / 1000) << endl;
+
+    return total > 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QStringList args = app.arguments().mid(1);
+
+    if(!args.isEmpty() && (args[0] == "--capture"))
+    {
+        if(args.size() < 3)
+        {
+            out << "usage: netparsebench --capture host[:port] capture [seconds [proto]]" << endl;
+            return 1;
+        }
+
+        int seconds = args.size() > 3 ? args[3].toInt() : 300;
+        QString proto = args.size() > 4 ? args[4] : "56";
+        return capture(out, args[1], args[2], seconds, proto);
+    }
+
+    QByteArray data;
+    int repeats = args.size() > 1 ? args[1].toInt() : 20;
+
+    if(args.isEmpty())
+        data = syntheticSession();
+    else
+    {
+        QFile file(args[0]);
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            out << "Can't read " << args[0] << endl;
+            return 1;
+        }
+        data = file.readAll();
+    }
+
+    if(data.isEmpty() || (repeats <= 0))
+    {
+        out << "usage: netparsebench [capture [repeats]]" << endl;
+        return 1;
+    }
+
+    return benchmark(out, data, repeats);
+}
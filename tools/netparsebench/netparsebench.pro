@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Decoding speed of the lobby protocol, old line parser vs NetMessageBuffer
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+TARGET = netparsebench
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ../../QTfrontend/util
+
+SOURCES += main.cpp \
+    ../../QTfrontend/util/NetMessageBuffer.cpp
+
+HEADERS += ../../QTfrontend/util/NetMessageBuffer.h